@@ -0,0 +1,18 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 20:41:17 UTC 2026
+// Last Modified: Fri Oct 16 20:41:17 UTC 2026
+// Filename:      fingerprint.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/cli/fingerprint.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Identify duplicate and near-duplicate scores.
+//
+
+#include "humlib.h"
+
+RAW_STREAM_INTERFACE(Tool_fingerprint)
+
+
+
@@ -0,0 +1,19 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 20:58:12 UTC 2026
+// Last Modified: Fri Oct 16 20:58:12 UTC 2026
+// Filename:      hum2musicxml.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/cli/hum2musicxml.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Command-line interface for converting Humdrum files into
+//                MusicXML files.
+//
+
+#include "humlib.h"
+
+STREAM_INTERFACE(Tool_hum2musicxml)
+
+
+
@@ -17,6 +17,8 @@
 
 using namespace std;
 
+int batchConvert(hum::Tool_mei2hum& converter);
+
 int main(int argc, char** argv) {
 	hum::Tool_mei2hum converter;
 	if (!converter.process(argc, argv)) {
@@ -26,6 +28,10 @@ int main(int argc, char** argv) {
 	// hum::Options options(converter.getOptionDefinitions());
 	// options.process(argc, argv);
 
+	if (converter.getBoolean("batch")) {
+		return batchConvert(converter);
+	}
+
 	pugi::xml_document infile;
 	string filename;
 	if (converter.getArgCount() == 0) {
@@ -39,6 +45,7 @@ int main(int argc, char** argv) {
 	//converter.setOptions(argc, argv);
 	stringstream out;
 	bool status = converter.convert(out, infile);
+	converter.getError(cerr);
 	if (!status) {
 		cerr << "Error converting file: " << filename << endl;
 	}
@@ -47,3 +54,43 @@ int main(int argc, char** argv) {
 	return 0;
 }
 
+
+
+//////////////////////////////
+//
+// batchConvert -- Convert the files listed in the input manifest (or
+//     in lines read from stdin) on a pool of threads, printing a line
+//     of JSON for each file.  Each worker keeps a copy of the processed
+//     command-line options for the converters that it creates.
+//
+
+int batchConvert(hum::Tool_mei2hum& converter) {
+	hum::HumBatch batch;
+	batch.setThreadCount(converter.getInteger("threads"));
+	vector<hum::Options> settings(batch.getThreadCount(), converter);
+
+	auto convertFile = [&settings](int worker, const string& input,
+			ostream& output, ostream& error) {
+		hum::Tool_mei2hum workerconverter;
+		(hum::Options&)workerconverter = settings[worker];
+		bool status = workerconverter.convertFile(output, input.c_str());
+		workerconverter.getError(error);
+		return status;
+	};
+
+	bool status;
+	if (converter.getArgCount() == 0) {
+		status = batch.run(cin, cout, convertFile);
+	} else {
+		ifstream manifest(converter.getArg(1));
+		if (!manifest.is_open()) {
+			cerr << "Cannot read manifest: " << converter.getArg(1) << endl;
+			return 1;
+		}
+		status = batch.run(manifest, cout, convertFile);
+	}
+	return status ? 0 : 1;
+}
+
+
+
@@ -17,6 +17,8 @@
 
 using namespace std;
 
+int batchConvert(hum::Tool_musicxml2hum& converter);
+
 int main(int argc, char** argv) {
 	hum::Tool_musicxml2hum converter;
 	if (!converter.process(argc, argv)) {
@@ -26,19 +28,22 @@ int main(int argc, char** argv) {
 	// hum::Options options(converter.getOptionDefinitions());
 	// options.process(argc, argv);
 
-	pugi::xml_document infile;
+	if (converter.getBoolean("batch")) {
+		return batchConvert(converter);
+	}
+
 	string filename;
+	stringstream out;
+	bool status;
 	if (converter.getArgCount() == 0) {
 		filename = "<STDIN>";
-		infile.load(cin);
+		status = converter.convert(out, cin);
 	} else {
 		filename = converter.getArg(1);
-		infile.load_file(filename.c_str());
+		status = converter.convertFile(out, filename.c_str());
 	}
 
-	//converter.setOptions(argc, argv);
-	stringstream out;
-	bool status = converter.convert(out, infile);
+	converter.getError(cerr);
 	if (!status) {
 		cerr << "Error converting file: " << filename << endl;
 	}
@@ -47,3 +52,48 @@ int main(int argc, char** argv) {
 	return 0;
 }
 
+
+
+//////////////////////////////
+//
+// batchConvert -- Convert the files listed in the input manifest (or
+//     in lines read from stdin) on a pool of threads, printing a line
+//     of JSON for each file.  Each worker keeps a copy of the processed
+//     command-line options for the converters that it creates.
+//
+
+int batchConvert(hum::Tool_musicxml2hum& converter) {
+	hum::HumBatch batch;
+	batch.setThreadCount(converter.getInteger("threads"));
+	if (!converter.getBoolean("part-threads")) {
+		// Files are already converted in parallel, so only use
+		// threads for the parts of a file when asked to.
+		converter.setModified("part-threads", "1");
+	}
+	vector<hum::Options> settings(batch.getThreadCount(), converter);
+
+	auto convertFile = [&settings](int worker, const string& input,
+			ostream& output, ostream& error) {
+		hum::Tool_musicxml2hum workerconverter;
+		(hum::Options&)workerconverter = settings[worker];
+		bool status = workerconverter.convertFile(output, input.c_str());
+		workerconverter.getError(error);
+		return status;
+	};
+
+	bool status;
+	if (converter.getArgCount() == 0) {
+		status = batch.run(cin, cout, convertFile);
+	} else {
+		ifstream manifest(converter.getArg(1));
+		if (!manifest.is_open()) {
+			cerr << "Cannot read manifest: " << converter.getArg(1) << endl;
+			return 1;
+		}
+		status = batch.run(manifest, cout, convertFile);
+	}
+	return status ? 0 : 1;
+}
+
+
+
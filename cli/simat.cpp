@@ -13,7 +13,7 @@
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_simat)
+SET_INTERFACE(Tool_simat)
 
 
 
@@ -23,6 +23,20 @@ namespace hum {
 
 // START_MERGE
 
+//
+// HumRecipDuration: The parsed value of a **recip string, as stored
+//    in the cache used by Convert::recipToDuration().
+//
+
+class HumRecipDuration {
+	public:
+		HumNum   m_duration;      // duration in whole notes
+		HumNum   m_quarters;      // duration in quarter notes
+		HumNum   m_undotted;      // duration in whole notes, ignoring dots
+		int      m_dots = 0;      // number of augmentation dots
+};
+
+
 class Convert {
 	public:
 
@@ -131,6 +145,37 @@ class Convert {
 		static int     base7ToBase40        (int base7);
 		static int     base40IntervalToDiatonic(int base40interval);
 
+		// Batch pitch processing, defined in Convert-pitch.cpp.  Output
+		// values are the same as for the single-token functions.
+		static void    kernToBase40         (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToBase40         (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToBase12         (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToBase12         (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToBase7          (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToBase7          (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToMidiNoteNumber (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToMidiNoteNumber (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToOctaveNumber   (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToOctaveNumber   (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToAccidentalCount(std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToAccidentalCount(std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    base40ToKern         (std::string& buffer,
+		                                     std::vector<int>& offsets,
+		                                     const std::vector<int>& b40s);
+		static const std::vector<std::string>& getBase40KernTable(void);
+
 
 		// **mens, mensual notation, defiend in Convert-mens.cpp
 		static bool    isMensRest           (const std::string& mensdata);
@@ -255,6 +300,28 @@ class Convert {
 		static std::string getReferenceKeyMeaning(HTp token);
 		static std::string getReferenceKeyMeaning(const std::string& token);
 		static std::string getLanguageName(const std::string& abbreviation);
+
+	protected:
+		static const HumRecipDuration& getRecipDuration(const std::string& recip,
+		                                     const std::string& separator);
+		static void    parseRecip           (const std::string& subtok,
+		                                     HumNum& undotted, int& dots);
+		static void    kernToPitchParts     (const std::string& kerndata,
+		                                     int& diatonic, int& accid,
+		                                     int& octave);
+		static const std::string& getPitchText(HTp token) { return *token; }
+		static const std::string& getPitchText(const std::string& token)
+				{ return token; }
+		static int     pitchPartsToBase40   (int diatonic, int accid, int octave);
+		static int     pitchPartsToBase12   (int diatonic, int accid, int octave);
+		static int     pitchPartsToBase7    (int diatonic, int accid, int octave);
+		static int     pitchPartsToMidi     (int diatonic, int accid, int octave);
+		static int     pitchPartsToOctave   (int diatonic, int accid, int octave);
+		static int     pitchPartsToAccidental(int diatonic, int accid, int octave);
+		template <class TOKEN, class FUNCTION>
+		static void    kernToPitchArray     (std::vector<int>& output,
+		                                     const std::vector<TOKEN>& tokens,
+		                                     FUNCTION convert);
 };
 
 
@@ -44,11 +44,13 @@ class HumAddress {
 		HLp                 getLine           (void) const;
 		HLp                 getOwner          (void) const { return getLine(); }
 		bool                hasOwner          (void) const;
+		static const std::string* internSpineInfo(const std::string& spineinfo);
 
 	protected:
 		void                setOwner          (HLp aLine);
 		void                setFieldIndex     (int fieldlindex);
 		void                setSpineInfo      (const std::string& spineinfo);
+		void                setSpineInfo      (const std::string* spineinfo);
 		void                setTrack          (int aTrack, int aSubtrack);
 		void                setTrack          (int aTrack);
 		void                setSubtrack       (int aSubtrack);
@@ -70,7 +72,12 @@ class HumAddress {
 		// But in this case there is a spine info simplification which will
 		// convert "(#)a (#)b" into "#" where # is the original spine number.
 		// Other more complicated mergers may be simplified in the future.
-		std::string m_spining;
+		// The string is shared by all tokens with the same spine info
+		// (see internSpineInfo()).  NULL means an empty spine info.
+		// Interned strings are never released, even after the files using
+		// them are deleted, so long-running programs which read many files
+		// with distinct spine splits will slowly grow the table.
+		const std::string* m_spining;
 
 		// track: This is the track number of the spine.  It is the first
 		// number found in the spineinfo string.
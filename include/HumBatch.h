@@ -0,0 +1,84 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 21:52:08 UTC 2026
+// Last Modified: Fri Oct 16 21:52:08 UTC 2026
+// Filename:      HumBatch.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumBatch.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Batch conversion of a list of files on a pool of worker
+//                threads, with a JSON-lines report for each file.
+//
+
+#ifndef _HUMBATCH_H_INCLUDED
+#define _HUMBATCH_H_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+
+namespace hum {
+
+// START_MERGE
+
+class HumBatch {
+	public:
+		// Converter: convert the input file into the output stream.  The
+		// worker index is in the range 0 to getThreadCount()-1, so that a
+		// worker can reuse its own converter settings.
+		typedef std::function<bool (int worker, const std::string& input,
+				std::ostream& output, std::ostream& error)> Converter;
+
+		              HumBatch          (void);
+		             ~HumBatch          () {}
+
+		void          setThreadCount    (int count);
+		int           getThreadCount    (void) const;
+		void          setExtension      (const std::string& extension);
+		bool          run               (std::istream& requests,
+		                                 std::ostream& report,
+		                                 Converter converter);
+
+	protected:
+		bool          parseRequest      (const std::string& line,
+		                                 std::string& input,
+		                                 std::string& output);
+		void          processJobs       (int worker, Converter& converter,
+		                                 std::ostream& report);
+		void          convertJob        (int worker, Converter& converter,
+		                                 const std::string& input,
+		                                 const std::string& output,
+		                                 std::ostream& report);
+		std::string   escapeJson        (const std::string& value);
+
+	private:
+		int           m_threads = 1;          // number of worker threads
+		std::string   m_extension = ".krn";   // for inputs without output paths
+
+		// job queue shared by the reader and the workers:
+		std::deque<std::pair<std::string, std::string>> m_jobs;
+		std::mutex              m_jobmutex;
+		std::condition_variable m_jobready;
+		bool                    m_finished = false;
+
+		// serializes report lines and counts:
+		std::mutex    m_reportmutex;
+		int           m_count = 0;
+		int           m_failures = 0;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMBATCH_H_INCLUDED */
+
+
+
@@ -56,6 +56,10 @@ class HumTool : public Options {
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
 
+	protected:
+		static bool     isEmpty       (std::stringstream& stream);
+		static ostream& printStream   (ostream& out, std::stringstream& stream);
+
 	protected:
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
@@ -18,7 +18,9 @@
 #ifndef _HUMDRUMFILEBASE_H_INCLUDED
 #define _HUMDRUMFILEBASE_H_INCLUDED
 
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -152,6 +154,74 @@ class HumFileAnalysis {
 bool sortTokenPairsByLineIndex(const TokenPair& a, const TokenPair& b);
 
 
+// HumTimelineEntry: class used by HumdrumFileBase to index the lines
+// of a file by their starting times.  There is one entry for each
+// distinct line timestamp in the file (see HumdrumFileBase-timeline.cpp).
+
+class HumTimelineEntry {
+	public:
+		// m_ticks: The timestamp of the lines, in units of
+		// HumdrumFileBase::getTimelineTpq() ticks per quarter note.
+		// Always 0 if the timeline ticks per quarter note is 0.
+		int64_t m_ticks = 0;
+
+		// m_timestamp: The timestamp of the lines in quarter notes.
+		HumNum m_timestamp;
+
+		// m_firstline: The first line at the timestamp.
+		int m_firstline = -1;
+
+		// m_lastline: The last line at the timestamp.
+		int m_lastline = -1;
+
+		// m_firstdata: The first data line at the timestamp, or -1
+		// if there are no data lines at the timestamp.
+		int m_firstdata = -1;
+
+		// m_lastdata: The last data line at or before the timestamp, or -1
+		// if there are no data lines up to the timestamp.
+		int m_lastdata = -1;
+
+		// m_measure: Index of the barline (see getBarline()) which
+		// starts the measure containing the timestamp, or -1 if
+		// barlines have not been analyzed.
+		int m_measure = -1;
+};
+
+
+// HumMetricGrid: Metric analysis of the lines in a file, using the time
+// signatures of one track (see HumdrumFileContent::getMetricGrid()).
+// Each array has one entry per line.  Times are in units of m_tpq ticks
+// per quarter note.
+
+class HumMetricGrid {
+	public:
+		// m_track: The track whose time signatures are used.
+		int m_track = 0;
+
+		// m_tpq: Ticks per quarter note (see HumdrumFileStructure::tpq()).
+		int m_tpq = 1;
+
+		// m_level: The metric level of each data line (0 for the beat,
+		// 1 for the first subdivision, and so on).  Non-data lines are NAN.
+		std::vector<double> m_level;
+
+		// m_position: Ticks from the start of the measure.
+		std::vector<int> m_position;
+
+		// m_beat: Ticks per beat in the meter at the line.
+		std::vector<int> m_beat;
+
+		// m_measure: The measure (barline index) containing the line.
+		std::vector<int> m_measure;
+
+		// m_metertop/m_meterbottom: The time signature at the line.
+		std::vector<int> m_metertop;
+		std::vector<int> m_meterbottom;
+};
+
+
+
 class HumdrumFileBase : public HumHash {
 	public:
 		              HumdrumFileBase          (void);
@@ -268,6 +338,9 @@ class HumdrumFileBase : public HumHash {
 		int           getTrackEndCount         (int track) const;
 		HTp           getTrackEnd              (int track, int subtrack = 0) const;
 		void          createLinesFromTokens    (void);
+		std::string   getText                  (void);
+		std::string   getTextFromTokens        (void);
+		std::ostream& printFromTokens          (std::ostream& out = std::cout);
 		void          removeExtraTabs          (void);
 		void          addExtraTabs             (void);
 		std::vector<int> getTrackWidths        (void);
@@ -290,6 +363,16 @@ class HumdrumFileBase : public HumHash {
 
 		void          clearTokenLinkInfo       (void);
 
+		// timeline functionality (in HumdrumFileBase-timeline.cpp):
+		int           getLineAtTime            (HumNum timestamp);
+		int           getDataLineAtTime        (HumNum timestamp);
+		int           getMeasureAtTime         (HumNum timestamp);
+		bool          getLineRangeAtTimes      (int& startline, int& endline,
+		                                        HumNum starttime,
+		                                        HumNum endtime);
+		int64_t       getTimelineTpq           (void);
+		const std::vector<HumTimelineEntry>& getTimeline(void);
+
 		void          deleteLine               (int index);
 //		void          adjustMergeSpineLines    (void);
 
@@ -365,7 +448,7 @@ class HumdrumFileBase : public HumHash {
 		bool          stitchLinesTogether       (HumdrumLine& previous,
 		                                         HumdrumLine& next);
 		void          addToTrackStarts          (HTp token);
-		void          addUniqueTokens           (std::vector<HTp>& target,
+		void          addUniqueTokens           (HumTokenLinks& target,
 		                                         std::vector<HTp>& source);
 		bool          processNonNullDataTokensForTrackForward(HTp starttoken,
 		                                         std::vector<HTp> ptokens);
@@ -376,6 +459,15 @@ class HumdrumFileBase : public HumHash {
 		bool          setParseError             (const char* format, ...);
 		bool          analyzeLines              (void);
 //		void          fixMerges                 (int linei);
+		void          analyzeTimeline           (void);
+		void          clearTimeIndexes          (void);
+		void          updateTimeIndexesForInsert(int index);
+		void          updateTimeIndexesForDelete(int index);
+		int           getTimelineIndex          (HumNum timestamp,
+		                                         bool& exact);
+		bool          getTimelineTicks          (HumNum timestamp,
+		                                         int64_t& ticks, bool& exact);
+		int           compareTimelineTimes      (HumNum time1, HumNum time2);
 
 	protected:
 
@@ -411,6 +503,19 @@ class HumdrumFileBase : public HumHash {
 		// m_ticksperquarternote: this is the number of tick
 		int m_ticksperquarternote;
 
+		// m_timeline: index of lines by timestamp, built when first
+		// needed by the timeline functions, updated when lines are
+		// added or removed, and cleared when the rhythm is reanalyzed.
+		std::vector<HumTimelineEntry> m_timeline;
+
+		// m_timelinetpq: the ticks per quarter note of m_timeline.
+		int64_t m_timelinetpq = 1;
+
+		// m_metricgrids: metric analyses for each track that has been
+		// requested, indexed by track (see HumdrumFileContent::getMetricGrid()).
+		// Cleared along with m_timeline.
+		std::map<int, HumMetricGrid> m_metricgrids;
+
 		// m_idprefix: an XML id prefix used to avoid id collisions when
 		// including multiple HumdrumFile XML in a single group.
 		std::string m_idprefix;
@@ -55,9 +55,13 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		// in HumdrumFileContent-stem.cpp
 		bool analyzeKernStemLengths       (void);
 
+		// in HumdrumFileContent-parallel.cpp
+		bool  analyzeAllContent           (int threads = 0);
+
 		// in HumdrumFileContent-metlev.cpp
 		void  getMetricLevels             (std::vector<double>& output, int track = 0,
 		                                   double undefined = NAN);
+		const HumMetricGrid& getMetricGrid(int track = 0);
 		// in HumdrumFileContent-timesig.cpp
 		void  getTimeSigs                 (std::vector<std::pair<int, HumNum> >& output,
 		                                   int track = 0);
@@ -102,6 +106,7 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		bool   hasDifferentBarlines       (void);
 
 	protected:
+		void   fillMetricGrid             (HumMetricGrid& grid, int track);
 
 		bool   analyzeKernSlurs           (HTp spinestart, std::vector<HTp>& slurstarts,
 		                                   std::vector<HTp>& slurends,
@@ -117,6 +122,9 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		bool   analyzeKernTies            (std::vector<std::pair<HTp, int>>& linkedtiestarts,
 		                                   std::vector<std::pair<HTp, int>>& linkedtieends,
 		                                   std::string& linkSignifier);
+		bool   analyzeKernAccidentals     (int onlytrack);
+		void   getLabelSequence           (std::vector<std::pair<HTp, HTp>>& labels,
+		                                   std::vector<int>& endings);
 		void   fillKeySignature           (std::vector<int>& states,
 		                                   const std::string& keysig);
 		void   resetDiatonicStatesWithKeySignature(std::vector<int>& states,
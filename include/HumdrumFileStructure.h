@@ -28,6 +28,48 @@ namespace hum {
 
 // START_MERGE
 
+// HumMeasureInfo: Description of a measure, as returned by
+// HumdrumFileStructure::getMeasure().  Measures are indexed in the
+// same way as barlines (see HumdrumFileStructure::getBarline()).
+
+class HumMeasureInfo {
+	public:
+		// m_index: The index of the measure (and of its starting barline).
+		int m_index = -1;
+
+		// m_startline: The first line of the measure, which is the
+		// starting barline except for a pickup measure.
+		int m_startline = -1;
+
+		// m_endline: The last line of the measure (the line before the
+		// next barline, or the last line in the file).
+		int m_endline = -1;
+
+		// m_barline: The first token of the starting barline, or NULL
+		// for a pickup measure.
+		HTp m_barline = NULL;
+
+		// m_number: The measure number of the starting barline, or -1
+		// if the barline is not numbered.
+		int m_number = -1;
+
+		// m_durationFromStart: The starting time of the measure in
+		// quarter notes.
+		HumNum m_durationFromStart;
+
+		// m_duration: The duration of the measure in quarter notes.
+		HumNum m_duration;
+
+		// m_repeatstart: True if the starting barline opens a repeat
+		// (such as "=5!|:").
+		bool m_repeatstart = false;
+
+		// m_repeatend: True if the barline after the measure closes a
+		// repeat (such as "=6:|!").
+		bool m_repeatend = false;
+};
+
+
 class HumdrumFileStructure : public HumdrumFileBase {
 	public:
 		              HumdrumFileStructure         (void);
@@ -127,8 +169,16 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		HumNum        getBarlineDurationFromStart  (int index) const;
 		HumNum        getBarlineDurationToEnd      (int index) const;
 
+		// measure functionality (located in src/HumdrumFileStructure-measure.cpp)
+		int           getMeasureCount              (void) const
+		                                           { return getBarlineCount(); }
+		HumMeasureInfo getMeasure                  (int index) const;
+		std::vector<HumMeasureInfo> getMeasures    (void) const;
+		int           getMeasureIndex              (int lineindex) const;
+
 		bool          analyzeStructure             (void);
 		bool          analyzeStructureNoRhythm     (void);
+		bool          analyzeStructureFromTokens   (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
 
@@ -155,12 +205,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            int line);
 		bool          decrementDurStates           (std::vector<HumNum>& durs,
 		                                            HumNum linedur, int line);
-		bool          assignDurationsToTrack       (HTp starttoken,
-		                                            HumNum startdur);
-		bool          prepareDurations             (HTp token, int state,
-		                                            HumNum startdur);
+		bool          assignDurationsFromStart     (void);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
-		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
 		bool          analyzeNullLineRhythms       (void);
 		void          fillInNegativeStartTimes     (void);
 		void          assignLineDurations          (void);
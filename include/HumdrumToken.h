@@ -31,6 +31,48 @@ namespace hum {
 
 typedef HumdrumToken* HTp;
 
+
+// HumTokenLinks: Compact list of links between tokens in a spine.  Most
+// tokens have a single link in each direction, which is stored inline.
+// Only split and merge manipulators need an array of links.
+
+class HumTokenLinks {
+	public:
+		               HumTokenLinks  (void) {}
+		               HumTokenLinks  (const HumTokenLinks& links);
+		              ~HumTokenLinks  ();
+		HumTokenLinks& operator=      (const HumTokenLinks& links);
+
+		int            size           (void) const { return m_size; }
+		bool           empty          (void) const { return m_size == 0; }
+		HTp&           operator[]     (int index)
+		                                  { return m_capacity ? m_many[index] : m_one; }
+		HTp            operator[]     (int index) const
+		                                  { return m_capacity ? m_many[index] : m_one; }
+		HTp            back           (void) const { return (*this)[m_size - 1]; }
+		const HTp*     begin          (void) const
+		                                  { return m_capacity ? m_many : &m_one; }
+		const HTp*     end            (void) const { return begin() + m_size; }
+		void           clear          (void) { m_size = 0; }
+		void           resize         (int size);
+		void           push_back      (HTp token);
+		               operator std::vector<HTp> (void) const
+		                                  { return std::vector<HTp>(begin(), end()); }
+
+	private:
+		void           reserve        (int capacity);
+
+		// m_one: the link when there is no more than one (m_capacity == 0),
+		// otherwise m_many: array of m_capacity links.
+		union {
+			HTp  m_one = NULL;
+			HTp* m_many;
+		};
+		int m_size     = 0;
+		int m_capacity = 0;
+};
+
+
 class HumdrumToken : public std::string, public HumHash {
 	public:
 		         HumdrumToken              (void);
@@ -280,6 +322,7 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setLineIndex              (int lineindex);
 		void     setFieldIndex             (int fieldlindex);
 		void     setSpineInfo              (const std::string& spineinfo);
+		void     setSpineInfo              (const std::string* spineinfo);
 		void     setSubtrack               (int aSubtrack);
 		void     setSubtrackCount          (int count);
 		void     setPreviousToken          (HTp aToken);
@@ -288,8 +331,6 @@ class HumdrumToken : public std::string, public HumHash {
 		void     makeForwardLink           (HumdrumToken& nextToken);
 		void     makeBackwardLink          (HumdrumToken& previousToken);
 		void     setOwner                  (HLp aLine);
-		int      getState                  (void) const;
-		void     incrementState            (void);
 		void     setDuration               (const HumNum& dur);
 		void     setStrandIndex            (int index);
 
@@ -322,26 +363,22 @@ class HumdrumToken : public std::string, public HumHash {
 		// following token, but there can be two tokens if the current
 		// token is *^, and there will be zero following tokens after a
 		// spine terminating token (*-).
-		std::vector<HTp> m_nextTokens;     // link to next token(s) in spine
+		HumTokenLinks m_nextTokens;     // link to next token(s) in spine
 
 		// previousTokens: Simiar to nextTokens, but for the immediately
 		// follow token(s) in the data.  Typically there will be one
 		// preceding token, but there can be multiple tokens when the previous
 		// line has *v merge tokens for the spine.  Exclusive interpretations
 		// have no tokens preceding them.
-		std::vector<HTp> m_previousTokens; // link to last token(s) in spine
+		HumTokenLinks m_previousTokens; // link to last token(s) in spine
 
 		// nextNonNullTokens: This is a list of non-tokens in the spine
 		// that follow this one.
-		std::vector<HTp> m_nextNonNullTokens;
+		HumTokenLinks m_nextNonNullTokens;
 
 		// previousNonNullTokens: This is a list of non-tokens in the spine
 		// that preced this one.
-		std::vector<HTp> m_previousNonNullTokens;
-
-		// rhycheck: Used to perfrom HumdrumFileStructure::analyzeRhythm
-		// recursively.
-		int m_rhycheck;
+		HumTokenLinks m_previousNonNullTokens;
 
 		// strand: Used to keep track of contiguous voice connections between
 		// secondary spines/tracks.  This is the 1-D strand index number
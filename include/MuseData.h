@@ -75,6 +75,8 @@ class MuseData {
 		int               getInitialTpq       (void);
 
 		int               read                (std::istream& input);
+		int               read                (std::vector<std::string>& lines,
+		                                       int startindex, int stopindex);
 		int               readString          (const std::string& filename);
 		int               readFile            (const std::string& filename);
 		void              analyzeLayers       (void);
@@ -114,6 +116,7 @@ class MuseData {
 
 		// additional mark-up analysis functions for post-processing:
 		void              doAnalyses          (void);
+		int               finishRead          (void);
 		void              analyzeType         (void);
 		void              analyzeRhythm       (void);
 		void              analyzeTies         (void);
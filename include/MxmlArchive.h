@@ -0,0 +1,109 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 22:31:40 UTC 2026
+// Last Modified: Fri Oct 16 22:31:40 UTC 2026
+// Filename:      MxmlArchive.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/MxmlArchive.h
+// Syntax:        C++11; humlib
+// vim:           ts=3 noexpandtab
+//
+// Description:   Reader for compressed MusicXML (.mxl) files, which are
+//                ZIP archives containing the MusicXML score and a
+//                META-INF/container.xml file that names it.
+//
+
+#ifndef _MXMLARCHIVE_H_INCLUDED
+#define _MXMLARCHIVE_H_INCLUDED
+
+#include <stdint.h>
+
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class MxmlArchiveEntry {
+	public:
+		std::string name;            // filename in archive
+		int         method = 0;      // 0 = stored, 8 = deflated
+		int         flags = 0;       // general purpose bit flags
+		uint32_t    crc = 0;         // CRC-32 of uncompressed data
+		size_t      compressed = 0;  // size of data in archive
+		size_t      size = 0;        // size of uncompressed data
+		size_t      offset = 0;      // offset of local header in archive
+};
+
+
+class MxmlArchive {
+	public:
+		                 MxmlArchive      (void);
+		                ~MxmlArchive      () {}
+
+		void             clear            (void);
+		bool             read             (const std::string& filename);
+		bool             read             (std::istream& input);
+		bool             readBuffer       (const char* data, size_t size);
+		static bool      isArchive        (const char* data, size_t size);
+
+		int              getFileCount     (void) const;
+		std::string      getFilename      (int index) const;
+		bool             getFile          (int index, std::vector<char>& data);
+		bool             getFile          (const std::string& name,
+		                                   std::vector<char>& data);
+		std::string      getRootFilename  (void);
+		bool             getRootFile      (std::vector<char>& data);
+		std::string      getError         (void) const;
+
+	protected:
+		bool             readDirectory    (void);
+		uint32_t         getUint16        (size_t offset) const;
+		uint32_t         getUint32        (size_t offset) const;
+		bool             setError         (const std::string& message);
+		static uint32_t  calculateCrc     (const char* data, size_t size);
+
+		// deflate decoding (RFC 1951):
+		bool             inflate          (const unsigned char* input,
+		                                   size_t size, std::vector<char>& output,
+		                                   size_t limit);
+		int              getBits          (int count);
+		bool             inflateStored    (std::vector<char>& output);
+		bool             inflateFixed     (std::vector<char>& output);
+		bool             inflateDynamic   (std::vector<char>& output);
+		bool             inflateCodes     (std::vector<char>& output,
+		                                   const std::vector<short>& lencount,
+		                                   const std::vector<short>& lensymbol,
+		                                   const std::vector<short>& distcount,
+		                                   const std::vector<short>& distsymbol);
+		bool             buildHuffman     (std::vector<short>& count,
+		                                   std::vector<short>& symbol,
+		                                   const short* lengths, int n);
+		int              decodeSymbol     (const std::vector<short>& count,
+		                                   const std::vector<short>& symbol);
+
+	private:
+		std::vector<char>             m_data;     // contents of archive
+		std::vector<MxmlArchiveEntry> m_entries;  // central directory
+		std::string                   m_error;
+
+		// inflate input state:
+		const unsigned char* m_in = NULL;
+		size_t               m_insize = 0;
+		size_t               m_inpos = 0;
+		uint32_t             m_bitbuf = 0;
+		int                  m_bitcount = 0;
+		bool                 m_inerror = false;
+		size_t               m_outlimit = 0;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _MXMLARCHIVE_H_INCLUDED */
+
+
+
@@ -75,7 +75,6 @@ class NoteGrid {
 	private:
 		vector<vector<NoteCell*> > m_grid;
 		vector<HTp>                m_kernspines;
-		vector<double>             m_metriclevels;
 		HumdrumFile*               m_infile;
 };
 
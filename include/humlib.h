@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Mon Sep 13 13:47:44 EDT 2021
+// Last Modified: Sat Oct 17 02:48:56 UTC 2026
 // Filename:      humlib.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/humlib.h
 // Syntax:        C++11
@@ -43,21 +43,30 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <list>
 #include <locale>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -68,14 +77,17 @@ using std::endl;
 using std::ends;
 using std::ifstream;
 using std::invalid_argument;
+using std::ios;
 using std::istream;
 using std::istreambuf_iterator;
 using std::list;
 using std::map;
+using std::ofstream;
 using std::ostream;
 using std::pair;
 using std::regex;
 using std::set;
+using std::streambuf;
 using std::string;
 using std::stringstream;
 using std::to_string;
@@ -115,6 +127,54 @@ class HumdrumFile;
 class GridVoice;
 
 
+class HumBatch {
+	public:
+		// Converter: convert the input file into the output stream.  The
+		// worker index is in the range 0 to getThreadCount()-1, so that a
+		// worker can reuse its own converter settings.
+		typedef std::function<bool (int worker, const std::string& input,
+				std::ostream& output, std::ostream& error)> Converter;
+
+		              HumBatch          (void);
+		             ~HumBatch          () {}
+
+		void          setThreadCount    (int count);
+		int           getThreadCount    (void) const;
+		void          setExtension      (const std::string& extension);
+		bool          run               (std::istream& requests,
+		                                 std::ostream& report,
+		                                 Converter converter);
+
+	protected:
+		bool          parseRequest      (const std::string& line,
+		                                 std::string& input,
+		                                 std::string& output);
+		void          processJobs       (int worker, Converter& converter,
+		                                 std::ostream& report);
+		void          convertJob        (int worker, Converter& converter,
+		                                 const std::string& input,
+		                                 const std::string& output,
+		                                 std::ostream& report);
+		std::string   escapeJson        (const std::string& value);
+
+	private:
+		int           m_threads = 1;          // number of worker threads
+		std::string   m_extension = ".krn";   // for inputs without output paths
+
+		// job queue shared by the reader and the workers:
+		std::deque<std::pair<std::string, std::string>> m_jobs;
+		std::mutex              m_jobmutex;
+		std::condition_variable m_jobready;
+		bool                    m_finished = false;
+
+		// serializes report lines and counts:
+		std::mutex    m_reportmutex;
+		int           m_count = 0;
+		int           m_failures = 0;
+};
+
+
+
 class HumParameter : public std::string {
 	public:
 		HumParameter(void);
@@ -827,11 +887,13 @@ class HumAddress {
 		HLp                 getLine           (void) const;
 		HLp                 getOwner          (void) const { return getLine(); }
 		bool                hasOwner          (void) const;
+		static const std::string* internSpineInfo(const std::string& spineinfo);
 
 	protected:
 		void                setOwner          (HLp aLine);
 		void                setFieldIndex     (int fieldlindex);
 		void                setSpineInfo      (const std::string& spineinfo);
+		void                setSpineInfo      (const std::string* spineinfo);
 		void                setTrack          (int aTrack, int aSubtrack);
 		void                setTrack          (int aTrack);
 		void                setSubtrack       (int aSubtrack);
@@ -853,7 +915,12 @@ class HumAddress {
 		// But in this case there is a spine info simplification which will
 		// convert "(#)a (#)b" into "#" where # is the original spine number.
 		// Other more complicated mergers may be simplified in the future.
-		std::string m_spining;
+		// The string is shared by all tokens with the same spine info
+		// (see internSpineInfo()).  NULL means an empty spine info.
+		// Interned strings are never released, even after the files using
+		// them are deleted, so long-running programs which read many files
+		// with distinct spine splits will slowly grow the table.
+		const std::string* m_spining;
 
 		// track: This is the track number of the spine.  It is the first
 		// number found in the spineinfo string.
@@ -1271,6 +1338,7 @@ class HumdrumLine : public std::string, public HumHash {
 		std::string   getXmlIdPrefix       (void) const;
 		void          clearTokenLinkInfo   (void);
 		void          createLineFromTokens (void);
+		void          appendTextFromTokens (std::string& output);
 		void          removeExtraTabs      (void);
 		void          addExtraTabs         (std::vector<int>& trackWidths);
 		int           getLineIndex         (void) const;
@@ -1427,6 +1495,48 @@ std::ostream& operator<< (std::ostream& out, HLp line);
 
 typedef HumdrumToken* HTp;
 
+
+// HumTokenLinks: Compact list of links between tokens in a spine.  Most
+// tokens have a single link in each direction, which is stored inline.
+// Only split and merge manipulators need an array of links.
+
+class HumTokenLinks {
+	public:
+		               HumTokenLinks  (void) {}
+		               HumTokenLinks  (const HumTokenLinks& links);
+		              ~HumTokenLinks  ();
+		HumTokenLinks& operator=      (const HumTokenLinks& links);
+
+		int            size           (void) const { return m_size; }
+		bool           empty          (void) const { return m_size == 0; }
+		HTp&           operator[]     (int index)
+		                                  { return m_capacity ? m_many[index] : m_one; }
+		HTp            operator[]     (int index) const
+		                                  { return m_capacity ? m_many[index] : m_one; }
+		HTp            back           (void) const { return (*this)[m_size - 1]; }
+		const HTp*     begin          (void) const
+		                                  { return m_capacity ? m_many : &m_one; }
+		const HTp*     end            (void) const { return begin() + m_size; }
+		void           clear          (void) { m_size = 0; }
+		void           resize         (int size);
+		void           push_back      (HTp token);
+		               operator std::vector<HTp> (void) const
+		                                  { return std::vector<HTp>(begin(), end()); }
+
+	private:
+		void           reserve        (int capacity);
+
+		// m_one: the link when there is no more than one (m_capacity == 0),
+		// otherwise m_many: array of m_capacity links.
+		union {
+			HTp  m_one = NULL;
+			HTp* m_many;
+		};
+		int m_size     = 0;
+		int m_capacity = 0;
+};
+
+
 class HumdrumToken : public std::string, public HumHash {
 	public:
 		         HumdrumToken              (void);
@@ -1676,6 +1786,7 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setLineIndex              (int lineindex);
 		void     setFieldIndex             (int fieldlindex);
 		void     setSpineInfo              (const std::string& spineinfo);
+		void     setSpineInfo              (const std::string* spineinfo);
 		void     setSubtrack               (int aSubtrack);
 		void     setSubtrackCount          (int count);
 		void     setPreviousToken          (HTp aToken);
@@ -1684,8 +1795,6 @@ class HumdrumToken : public std::string, public HumHash {
 		void     makeForwardLink           (HumdrumToken& nextToken);
 		void     makeBackwardLink          (HumdrumToken& previousToken);
 		void     setOwner                  (HLp aLine);
-		int      getState                  (void) const;
-		void     incrementState            (void);
 		void     setDuration               (const HumNum& dur);
 		void     setStrandIndex            (int index);
 
@@ -1718,26 +1827,22 @@ class HumdrumToken : public std::string, public HumHash {
 		// following token, but there can be two tokens if the current
 		// token is *^, and there will be zero following tokens after a
 		// spine terminating token (*-).
-		std::vector<HTp> m_nextTokens;     // link to next token(s) in spine
+		HumTokenLinks m_nextTokens;     // link to next token(s) in spine
 
 		// previousTokens: Simiar to nextTokens, but for the immediately
 		// follow token(s) in the data.  Typically there will be one
 		// preceding token, but there can be multiple tokens when the previous
 		// line has *v merge tokens for the spine.  Exclusive interpretations
 		// have no tokens preceding them.
-		std::vector<HTp> m_previousTokens; // link to last token(s) in spine
+		HumTokenLinks m_previousTokens; // link to last token(s) in spine
 
 		// nextNonNullTokens: This is a list of non-tokens in the spine
 		// that follow this one.
-		std::vector<HTp> m_nextNonNullTokens;
+		HumTokenLinks m_nextNonNullTokens;
 
 		// previousNonNullTokens: This is a list of non-tokens in the spine
 		// that preced this one.
-		std::vector<HTp> m_previousNonNullTokens;
-
-		// rhycheck: Used to perfrom HumdrumFileStructure::analyzeRhythm
-		// recursively.
-		int m_rhycheck;
+		HumTokenLinks m_previousNonNullTokens;
 
 		// strand: Used to keep track of contiguous voice connections between
 		// secondary spines/tracks.  This is the 1-D strand index number
@@ -1887,6 +1992,74 @@ class HumFileAnalysis {
 bool sortTokenPairsByLineIndex(const TokenPair& a, const TokenPair& b);
 
 
+// HumTimelineEntry: class used by HumdrumFileBase to index the lines
+// of a file by their starting times.  There is one entry for each
+// distinct line timestamp in the file (see HumdrumFileBase-timeline.cpp).
+
+class HumTimelineEntry {
+	public:
+		// m_ticks: The timestamp of the lines, in units of
+		// HumdrumFileBase::getTimelineTpq() ticks per quarter note.
+		// Always 0 if the timeline ticks per quarter note is 0.
+		int64_t m_ticks = 0;
+
+		// m_timestamp: The timestamp of the lines in quarter notes.
+		HumNum m_timestamp;
+
+		// m_firstline: The first line at the timestamp.
+		int m_firstline = -1;
+
+		// m_lastline: The last line at the timestamp.
+		int m_lastline = -1;
+
+		// m_firstdata: The first data line at the timestamp, or -1
+		// if there are no data lines at the timestamp.
+		int m_firstdata = -1;
+
+		// m_lastdata: The last data line at or before the timestamp, or -1
+		// if there are no data lines up to the timestamp.
+		int m_lastdata = -1;
+
+		// m_measure: Index of the barline (see getBarline()) which
+		// starts the measure containing the timestamp, or -1 if
+		// barlines have not been analyzed.
+		int m_measure = -1;
+};
+
+
+// HumMetricGrid: Metric analysis of the lines in a file, using the time
+// signatures of one track (see HumdrumFileContent::getMetricGrid()).
+// Each array has one entry per line.  Times are in units of m_tpq ticks
+// per quarter note.
+
+class HumMetricGrid {
+	public:
+		// m_track: The track whose time signatures are used.
+		int m_track = 0;
+
+		// m_tpq: Ticks per quarter note (see HumdrumFileStructure::tpq()).
+		int m_tpq = 1;
+
+		// m_level: The metric level of each data line (0 for the beat,
+		// 1 for the first subdivision, and so on).  Non-data lines are NAN.
+		std::vector<double> m_level;
+
+		// m_position: Ticks from the start of the measure.
+		std::vector<int> m_position;
+
+		// m_beat: Ticks per beat in the meter at the line.
+		std::vector<int> m_beat;
+
+		// m_measure: The measure (barline index) containing the line.
+		std::vector<int> m_measure;
+
+		// m_metertop/m_meterbottom: The time signature at the line.
+		std::vector<int> m_metertop;
+		std::vector<int> m_meterbottom;
+};
+
+
+
 class HumdrumFileBase : public HumHash {
 	public:
 		              HumdrumFileBase          (void);
@@ -2003,6 +2176,9 @@ class HumdrumFileBase : public HumHash {
 		int           getTrackEndCount         (int track) const;
 		HTp           getTrackEnd              (int track, int subtrack = 0) const;
 		void          createLinesFromTokens    (void);
+		std::string   getText                  (void);
+		std::string   getTextFromTokens        (void);
+		std::ostream& printFromTokens          (std::ostream& out = std::cout);
 		void          removeExtraTabs          (void);
 		void          addExtraTabs             (void);
 		std::vector<int> getTrackWidths        (void);
@@ -2025,6 +2201,16 @@ class HumdrumFileBase : public HumHash {
 
 		void          clearTokenLinkInfo       (void);
 
+		// timeline functionality (in HumdrumFileBase-timeline.cpp):
+		int           getLineAtTime            (HumNum timestamp);
+		int           getDataLineAtTime        (HumNum timestamp);
+		int           getMeasureAtTime         (HumNum timestamp);
+		bool          getLineRangeAtTimes      (int& startline, int& endline,
+		                                        HumNum starttime,
+		                                        HumNum endtime);
+		int64_t       getTimelineTpq           (void);
+		const std::vector<HumTimelineEntry>& getTimeline(void);
+
 		void          deleteLine               (int index);
 //		void          adjustMergeSpineLines    (void);
 
@@ -2100,7 +2286,7 @@ class HumdrumFileBase : public HumHash {
 		bool          stitchLinesTogether       (HumdrumLine& previous,
 		                                         HumdrumLine& next);
 		void          addToTrackStarts          (HTp token);
-		void          addUniqueTokens           (std::vector<HTp>& target,
+		void          addUniqueTokens           (HumTokenLinks& target,
 		                                         std::vector<HTp>& source);
 		bool          processNonNullDataTokensForTrackForward(HTp starttoken,
 		                                         std::vector<HTp> ptokens);
@@ -2111,6 +2297,15 @@ class HumdrumFileBase : public HumHash {
 		bool          setParseError             (const char* format, ...);
 		bool          analyzeLines              (void);
 //		void          fixMerges                 (int linei);
+		void          analyzeTimeline           (void);
+		void          clearTimeIndexes          (void);
+		void          updateTimeIndexesForInsert(int index);
+		void          updateTimeIndexesForDelete(int index);
+		int           getTimelineIndex          (HumNum timestamp,
+		                                         bool& exact);
+		bool          getTimelineTicks          (HumNum timestamp,
+		                                         int64_t& ticks, bool& exact);
+		int           compareTimelineTimes      (HumNum time1, HumNum time2);
 
 	protected:
 
@@ -2146,6 +2341,19 @@ class HumdrumFileBase : public HumHash {
 		// m_ticksperquarternote: this is the number of tick
 		int m_ticksperquarternote;
 
+		// m_timeline: index of lines by timestamp, built when first
+		// needed by the timeline functions, updated when lines are
+		// added or removed, and cleared when the rhythm is reanalyzed.
+		std::vector<HumTimelineEntry> m_timeline;
+
+		// m_timelinetpq: the ticks per quarter note of m_timeline.
+		int64_t m_timelinetpq = 1;
+
+		// m_metricgrids: metric analyses for each track that has been
+		// requested, indexed by track (see HumdrumFileContent::getMetricGrid()).
+		// Cleared along with m_timeline.
+		std::map<int, HumMetricGrid> m_metricgrids;
+
 		// m_idprefix: an XML id prefix used to avoid id collisions when
 		// including multiple HumdrumFile XML in a single group.
 		std::string m_idprefix;
@@ -2210,6 +2418,48 @@ std::ostream& operator<<(std::ostream& out, HumdrumFileBase& infile);
 
 
 
+// HumMeasureInfo: Description of a measure, as returned by
+// HumdrumFileStructure::getMeasure().  Measures are indexed in the
+// same way as barlines (see HumdrumFileStructure::getBarline()).
+
+class HumMeasureInfo {
+	public:
+		// m_index: The index of the measure (and of its starting barline).
+		int m_index = -1;
+
+		// m_startline: The first line of the measure, which is the
+		// starting barline except for a pickup measure.
+		int m_startline = -1;
+
+		// m_endline: The last line of the measure (the line before the
+		// next barline, or the last line in the file).
+		int m_endline = -1;
+
+		// m_barline: The first token of the starting barline, or NULL
+		// for a pickup measure.
+		HTp m_barline = NULL;
+
+		// m_number: The measure number of the starting barline, or -1
+		// if the barline is not numbered.
+		int m_number = -1;
+
+		// m_durationFromStart: The starting time of the measure in
+		// quarter notes.
+		HumNum m_durationFromStart;
+
+		// m_duration: The duration of the measure in quarter notes.
+		HumNum m_duration;
+
+		// m_repeatstart: True if the starting barline opens a repeat
+		// (such as "=5!|:").
+		bool m_repeatstart = false;
+
+		// m_repeatend: True if the barline after the measure closes a
+		// repeat (such as "=6:|!").
+		bool m_repeatend = false;
+};
+
+
 class HumdrumFileStructure : public HumdrumFileBase {
 	public:
 		              HumdrumFileStructure         (void);
@@ -2309,8 +2559,16 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		HumNum        getBarlineDurationFromStart  (int index) const;
 		HumNum        getBarlineDurationToEnd      (int index) const;
 
+		// measure functionality (located in src/HumdrumFileStructure-measure.cpp)
+		int           getMeasureCount              (void) const
+		                                           { return getBarlineCount(); }
+		HumMeasureInfo getMeasure                  (int index) const;
+		std::vector<HumMeasureInfo> getMeasures    (void) const;
+		int           getMeasureIndex              (int lineindex) const;
+
 		bool          analyzeStructure             (void);
 		bool          analyzeStructureNoRhythm     (void);
+		bool          analyzeStructureFromTokens   (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
 
@@ -2337,12 +2595,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		                                            int line);
 		bool          decrementDurStates           (std::vector<HumNum>& durs,
 		                                            HumNum linedur, int line);
-		bool          assignDurationsToTrack       (HTp starttoken,
-		                                            HumNum startdur);
-		bool          prepareDurations             (HTp token, int state,
-		                                            HumNum startdur);
+		bool          assignDurationsFromStart     (void);
 		bool          setLineDurationFromStart     (HTp token, HumNum dursum);
-		bool          analyzeRhythmOfFloatingSpine (HTp spinestart);
 		bool          analyzeNullLineRhythms       (void);
 		void          fillInNegativeStartTimes     (void);
 		void          assignLineDurations          (void);
@@ -2390,9 +2644,13 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		// in HumdrumFileContent-stem.cpp
 		bool analyzeKernStemLengths       (void);
 
+		// in HumdrumFileContent-parallel.cpp
+		bool  analyzeAllContent           (int threads = 0);
+
 		// in HumdrumFileContent-metlev.cpp
 		void  getMetricLevels             (std::vector<double>& output, int track = 0,
 		                                   double undefined = NAN);
+		const HumMetricGrid& getMetricGrid(int track = 0);
 		// in HumdrumFileContent-timesig.cpp
 		void  getTimeSigs                 (std::vector<std::pair<int, HumNum> >& output,
 		                                   int track = 0);
@@ -2437,6 +2695,7 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		bool   hasDifferentBarlines       (void);
 
 	protected:
+		void   fillMetricGrid             (HumMetricGrid& grid, int track);
 
 		bool   analyzeKernSlurs           (HTp spinestart, std::vector<HTp>& slurstarts,
 		                                   std::vector<HTp>& slurends,
@@ -2452,6 +2711,9 @@ class HumdrumFileContent : public HumdrumFileStructure {
 		bool   analyzeKernTies            (std::vector<std::pair<HTp, int>>& linkedtiestarts,
 		                                   std::vector<std::pair<HTp, int>>& linkedtieends,
 		                                   std::string& linkSignifier);
+		bool   analyzeKernAccidentals     (int onlytrack);
+		void   getLabelSequence           (std::vector<std::pair<HTp, HTp>>& labels,
+		                                   std::vector<int>& endings);
 		void   fillKeySignature           (std::vector<int>& states,
 		                                   const std::string& keysig);
 		void   resetDiatonicStatesWithKeySignature(std::vector<int>& states,
@@ -3418,6 +3680,8 @@ class MuseData {
 		int               getInitialTpq       (void);
 
 		int               read                (std::istream& input);
+		int               read                (std::vector<std::string>& lines,
+		                                       int startindex, int stopindex);
 		int               readString          (const std::string& filename);
 		int               readFile            (const std::string& filename);
 		void              analyzeLayers       (void);
@@ -3457,6 +3721,7 @@ class MuseData {
 
 		// additional mark-up analysis functions for post-processing:
 		void              doAnalyses          (void);
+		int               finishRead          (void);
 		void              analyzeType         (void);
 		void              analyzeRhythm       (void);
 		void              analyzeTies         (void);
@@ -3708,12 +3973,25 @@ class NoteGrid {
 	private:
 		vector<vector<NoteCell*> > m_grid;
 		vector<HTp>                m_kernspines;
-		vector<double>             m_metriclevels;
 		HumdrumFile*               m_infile;
 };
 
 
 
+//
+// HumRecipDuration: The parsed value of a **recip string, as stored
+//    in the cache used by Convert::recipToDuration().
+//
+
+class HumRecipDuration {
+	public:
+		HumNum   m_duration;      // duration in whole notes
+		HumNum   m_quarters;      // duration in quarter notes
+		HumNum   m_undotted;      // duration in whole notes, ignoring dots
+		int      m_dots = 0;      // number of augmentation dots
+};
+
+
 class Convert {
 	public:
 
@@ -3822,6 +4100,37 @@ class Convert {
 		static int     base7ToBase40        (int base7);
 		static int     base40IntervalToDiatonic(int base40interval);
 
+		// Batch pitch processing, defined in Convert-pitch.cpp.  Output
+		// values are the same as for the single-token functions.
+		static void    kernToBase40         (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToBase40         (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToBase12         (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToBase12         (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToBase7          (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToBase7          (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToMidiNoteNumber (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToMidiNoteNumber (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToOctaveNumber   (std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToOctaveNumber   (std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    kernToAccidentalCount(std::vector<int>& output,
+		                                     const std::vector<HTp>& tokens);
+		static void    kernToAccidentalCount(std::vector<int>& output,
+		                                     const std::vector<std::string>& subtokens);
+		static void    base40ToKern         (std::string& buffer,
+		                                     std::vector<int>& offsets,
+		                                     const std::vector<int>& b40s);
+		static const std::vector<std::string>& getBase40KernTable(void);
+
 
 		// **mens, mensual notation, defiend in Convert-mens.cpp
 		static bool    isMensRest           (const std::string& mensdata);
@@ -3946,6 +4255,28 @@ class Convert {
 		static std::string getReferenceKeyMeaning(HTp token);
 		static std::string getReferenceKeyMeaning(const std::string& token);
 		static std::string getLanguageName(const std::string& abbreviation);
+
+	protected:
+		static const HumRecipDuration& getRecipDuration(const std::string& recip,
+		                                     const std::string& separator);
+		static void    parseRecip           (const std::string& subtok,
+		                                     HumNum& undotted, int& dots);
+		static void    kernToPitchParts     (const std::string& kerndata,
+		                                     int& diatonic, int& accid,
+		                                     int& octave);
+		static const std::string& getPitchText(HTp token) { return *token; }
+		static const std::string& getPitchText(const std::string& token)
+				{ return token; }
+		static int     pitchPartsToBase40   (int diatonic, int accid, int octave);
+		static int     pitchPartsToBase12   (int diatonic, int accid, int octave);
+		static int     pitchPartsToBase7    (int diatonic, int accid, int octave);
+		static int     pitchPartsToMidi     (int diatonic, int accid, int octave);
+		static int     pitchPartsToOctave   (int diatonic, int accid, int octave);
+		static int     pitchPartsToAccidental(int diatonic, int accid, int octave);
+		template <class TOKEN, class FUNCTION>
+		static void    kernToPitchArray     (std::vector<int>& output,
+		                                     const std::vector<TOKEN>& tokens,
+		                                     FUNCTION convert);
 };
 
 
@@ -4595,6 +4926,81 @@ ostream& operator<<(ostream& out, HumGrid& grid);
 
 
 
+class MxmlArchiveEntry {
+	public:
+		std::string name;            // filename in archive
+		int         method = 0;      // 0 = stored, 8 = deflated
+		int         flags = 0;       // general purpose bit flags
+		uint32_t    crc = 0;         // CRC-32 of uncompressed data
+		size_t      compressed = 0;  // size of data in archive
+		size_t      size = 0;        // size of uncompressed data
+		size_t      offset = 0;      // offset of local header in archive
+};
+
+
+class MxmlArchive {
+	public:
+		                 MxmlArchive      (void);
+		                ~MxmlArchive      () {}
+
+		void             clear            (void);
+		bool             read             (const std::string& filename);
+		bool             read             (std::istream& input);
+		bool             readBuffer       (const char* data, size_t size);
+		static bool      isArchive        (const char* data, size_t size);
+
+		int              getFileCount     (void) const;
+		std::string      getFilename      (int index) const;
+		bool             getFile          (int index, std::vector<char>& data);
+		bool             getFile          (const std::string& name,
+		                                   std::vector<char>& data);
+		std::string      getRootFilename  (void);
+		bool             getRootFile      (std::vector<char>& data);
+		std::string      getError         (void) const;
+
+	protected:
+		bool             readDirectory    (void);
+		uint32_t         getUint16        (size_t offset) const;
+		uint32_t         getUint32        (size_t offset) const;
+		bool             setError         (const std::string& message);
+		static uint32_t  calculateCrc     (const char* data, size_t size);
+
+		// deflate decoding (RFC 1951):
+		bool             inflate          (const unsigned char* input,
+		                                   size_t size, std::vector<char>& output,
+		                                   size_t limit);
+		int              getBits          (int count);
+		bool             inflateStored    (std::vector<char>& output);
+		bool             inflateFixed     (std::vector<char>& output);
+		bool             inflateDynamic   (std::vector<char>& output);
+		bool             inflateCodes     (std::vector<char>& output,
+		                                   const std::vector<short>& lencount,
+		                                   const std::vector<short>& lensymbol,
+		                                   const std::vector<short>& distcount,
+		                                   const std::vector<short>& distsymbol);
+		bool             buildHuffman     (std::vector<short>& count,
+		                                   std::vector<short>& symbol,
+		                                   const short* lengths, int n);
+		int              decodeSymbol     (const std::vector<short>& count,
+		                                   const std::vector<short>& symbol);
+
+	private:
+		std::vector<char>             m_data;     // contents of archive
+		std::vector<MxmlArchiveEntry> m_entries;  // central directory
+		std::string                   m_error;
+
+		// inflate input state:
+		const unsigned char* m_in = NULL;
+		size_t               m_insize = 0;
+		size_t               m_inpos = 0;
+		uint32_t             m_bitbuf = 0;
+		int                  m_bitcount = 0;
+		bool                 m_inerror = false;
+		size_t               m_outlimit = 0;
+};
+
+
+
 class MxmlMeasure;
 class MxmlPart;
 
@@ -4723,7 +5129,7 @@ class MxmlEvent {
 		std::vector<MxmlEvent*> m_links;   // list of secondary chord notes
 		bool               m_linked;       // true if a secondary chord note
 		int                m_sequence;     // ordering of event in XML file
-		static int         m_counter;      // counter for sequence variable
+		static std::atomic<int> m_counter; // counter for sequence variable
 		short              m_staff;        // staff number in part for event
 		short              m_voice;        // voice number in part for event
 		int                m_voiceindex;   // voice index of item (remapping)
@@ -5055,6 +5461,10 @@ class HumTool : public Options {
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
 
+	protected:
+		static bool     isEmpty       (std::stringstream& stream);
+		static ostream& printStream   (ostream& out, std::stringstream& stream);
+
 	protected:
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
@@ -6112,6 +6522,9 @@ class Tool_esac2hum : public HumTool {
 		void      example               (void);
 		void      usage                 (const string& command);
 		void      convertEsacToHumdrum  (ostream& out, istream& input);
+		void      convertCollection     (ostream& out, istream& input);
+		string    getSplitFilename      (int index);
+		string    getSongKey            (vector<string>& song);
 		bool      getSong               (vector<string>& song, istream& infile,
 		                                int init);
 		void      convertSong           (vector<string>& song, ostream& out);
@@ -6156,9 +6569,12 @@ class Tool_esac2hum : public HumTool {
 		vector<string> trailer;           // used with -t option
 		string         fileextension;     // used with -x option
 		string         namebase;          // used with -s option
+		int            threadcount = 1;   // used with --threads option
+		int            segmentQ = 0;      // used with --segment option
 
 		vector<int>    chartable;  // used printChars() & printSpecialChars()
 		int inputline = 0;
+		ostream*       errorstream = &cerr; // error messages for current song
 
 };
 
@@ -6318,6 +6734,59 @@ class Tool_filter : public HumTool {
 };
 
 
+// MinHash value of an empty shingle set:
+#define FINGERPRINT_EMPTY 0xffffffffffffffffULL
+
+class Tool_fingerprint : public HumTool {
+	public:
+		         Tool_fingerprint   (void);
+		        ~Tool_fingerprint   () {};
+
+		bool     run                (HumdrumFileSet& infiles);
+		bool     run                (HumdrumFile& infile);
+		bool     run                (const string& indata, ostream& out);
+		bool     run                (HumdrumFile& infile, ostream& out);
+		bool     run                (HumdrumFileStream& instream);
+
+	protected:
+		bool     initialize         (void);
+		void     processFile        (HumdrumFile& infile);
+		void     finish             (void);
+		void     getShingles        (std::vector<uint64_t>& shingles, HumdrumFile& infile);
+		void     getSignature       (std::vector<uint64_t>& signature,
+		                             std::vector<uint64_t>& shingles);
+		void     addSignature       (const std::string& name,
+		                             std::vector<uint64_t>& signature);
+		double   getSimilarity      (int index1, int index2);
+		int      findCluster        (int index);
+		void     joinClusters       (int index1, int index2);
+		void     printSignature     (const std::string& name, int shinglecount,
+		                             std::vector<uint64_t>& signature);
+		void     printClusters      (void);
+		uint64_t mixHash            (uint64_t value);
+
+	private:
+		bool     m_initialized = false;
+		int      m_shingle     = 4;     // number of intervals in a shingle
+		int      m_hashcount   = 64;    // number of MinHash values in a signature
+		int      m_bands       = 16;    // number of LSH bands
+		int      m_rows        = 4;     // number of MinHash values in a band
+		double   m_threshold   = 0.5;   // minimum similarity for duplicates
+		int      m_count       = 0;     // number of scores read
+		std::string m_group;            // reference key for grouping movements
+
+		std::vector<uint64_t>              m_seeds;      // MinHash seeds
+		std::vector<std::string>           m_names;      // name of each signature
+		std::vector<std::vector<uint64_t>> m_signatures; // MinHash signatures
+		std::vector<int>                   m_parent;     // cluster union-find tree
+		std::vector<std::unordered_map<uint64_t, std::vector<int>>> m_buckets;
+
+		// signatures of movement groups, combined until all input is read:
+		std::map<std::string, std::vector<uint64_t>> m_groups;
+		std::vector<std::string>                     m_grouporder;
+};
+
+
 class Tool_fixps : public HumTool {
 	public:
 		         Tool_fixps         (void);
@@ -6547,6 +7016,59 @@ class Tool_hproof : public HumTool {
 
 
 
+class Tool_hum2musicxml : public HumTool {
+	public:
+		         Tool_hum2musicxml  (void);
+		        ~Tool_hum2musicxml  () {};
+
+		bool     run                (HumdrumFileSet& infiles);
+		bool     run                (HumdrumFile& infile);
+		bool     run                (const string& indata, ostream& out);
+		bool     run                (HumdrumFile& infile, ostream& out);
+		bool     convert            (ostream& out, HumdrumFile& infile);
+
+	protected:
+		void     initialize         (void);
+		void     printHeader        (ostream& out, HumdrumFile& infile);
+		void     printPartList      (ostream& out, std::vector<HTp>& kernstarts);
+		void     printPart          (ostream& out, HumdrumFile& infile,
+		                             HTp kernstart, int partnum);
+		void     printMeasure       (ostream& out, std::vector<std::vector<HTp>>& voices,
+		                             std::vector<HTp>& attributes, HumNum starttime,
+		                             int number, HTp leftbar, HTp rightbar,
+		                             bool firstQ);
+		void     printAttributes    (ostream& out, std::vector<HTp>& tokens,
+		                             bool divisionsQ);
+		void     printKey           (ostream& out, HTp token);
+		void     printTime          (ostream& out, HTp token);
+		void     printClef          (ostream& out, HTp token);
+		int      printToken         (ostream& out, HTp token, int voice);
+		void     printNote          (ostream& out, HTp token, int index,
+		                             const std::string& subtok, int voice,
+		                             int ticks, std::vector<std::string>& beams);
+		void     printNotations     (ostream& out, HTp token, int index,
+		                             const std::string& subtok);
+		void     printSlurs         (ostream& out, HTp token);
+		void     getBeamStates      (std::vector<std::string>& states,
+		                             HTp token, int voice);
+		std::string getPartName     (HTp kernstart);
+		std::string getNoteType     (HumNum duration);
+		int      getFirstMeasureNumber(HumdrumFile& infile);
+		int      getTicks           (HumNum duration);
+		std::string escapeXml       (const std::string& value);
+
+	private:
+		int      m_divisions = 1;         // ticks per quarter note (tpq of file)
+		bool     m_stemsQ    = true;      // print explicit stem directions
+		bool     m_beamsQ    = true;      // print beams
+
+		// state for the part being printed:
+		std::vector<int> m_beamdepth;     // open beam levels in each voice
+		// MusicXML numbers of open slurs by start note and slur enumeration:
+		std::map<std::pair<HTp, int>, int> m_slurs;
+};
+
+
 // A TimePoint records the event times in a file.  These are positions of note attacks
 // in the file.  The "index" variable keeps track of the line in the original file
 // (for the first position in index), and other positions in index keep track of the
@@ -6591,6 +7113,7 @@ class NotePoint {
 		int         processed      = 0;      // has note been processed/matched
 		int         sourceindex    = -1;     // source file index for note
 		int         tpindex        = -1;     // timepoint index of note in source
+		int         agreement      = 0;      // number of other sources containing the note
 		vector<int> matched;       // indexes to the location of the note in TimePoint list.
 		                           // the index indicate which score the match is related to,
 		                           // and a value of -1 means there is no equivalent timepoint.
@@ -6607,11 +7130,41 @@ class NotePoint {
 			processed = 0;
 			sourceindex = -1;
 			tpindex = -1;
+			agreement = 0;
 			matched.clear();
 		}
 };
 
 
+// NoteIndex is a hash table of the notes at a timepoint, keyed by pitch
+// and duration, so that equivalent notes in another score can be found
+// without a linear search through the list of notes.
+typedef std::unordered_map<uint64_t, std::vector<int>> NoteIndex;
+
+
+// MeasurePoint is a measure in a score, used to align the measures of two
+// scores before comparing notes.  Timestamps of the timepoints in the measure
+// are relative to the start of the measure.
+class MeasurePoint {
+	public:
+		int               startline = -1;   // line index of the starting barline
+		int               endline   = -1;   // line index of the ending barline
+		int               measure   = -1;   // measure number
+		HumNum            start     = 0;    // timestamp of start of measure
+		uint64_t          hash      = 0;    // hash of the notes in the measure
+		vector<TimePoint> timepoints;       // attack times in the measure
+
+		void clear(void) {
+			startline = -1;
+			endline = -1;
+			measure = -1;
+			start = 0;
+			hash = 0;
+			timepoints.clear();
+		}
+};
+
+
 // Function declarations:
 
 class Tool_humdiff : public HumTool {
@@ -6621,19 +7174,46 @@ class Tool_humdiff : public HumTool {
 		bool     run                (HumdrumFileSet& infiles);
 
 	protected:
-		void     compareFiles       (HumdrumFile& reference, HumdrumFile& alternate);
+		void     compareFiles       (HumdrumFileSet& infiles, int reference);
 
-		void     compareTimePoints  (vector<vector<TimePoint>>& timepoints, HumdrumFile& reference, HumdrumFile& alternate);
+		void     compareTimePoints  (vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*>& infiles);
 		void     extractTimePoints  (vector<TimePoint>& points, HumdrumFile& infile);
 		void     printTimePoints    (vector<TimePoint>& timepoints);
 		void     compareLines       (HumNum minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles);
 		void     getNoteList        (vector<NotePoint>& notelist, HumdrumFile& infile, int line, int measure, int sourceindex, int tpindex);
-		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps);
+		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps, NoteIndex& index);
+		void     buildNoteIndex     (NoteIndex& index, vector<NotePoint>& nps);
+		uint64_t getNoteKey         (NotePoint& np);
+
+		void     alignFiles         (HumdrumFile& reference,
+		                             vector<MeasurePoint>& refmeasures,
+		                             HumdrumFile& alternate);
+		void     extractMeasurePoints(vector<MeasurePoint>& measures, HumdrumFile& infile);
+		void     alignMeasures      (vector<pair<int, int>>& matches,
+		                             vector<MeasurePoint>& reference,
+		                             vector<MeasurePoint>& alternate);
+		void     alignMeasureRange  (vector<pair<int, int>>& matches,
+		                             vector<MeasurePoint>& reference,
+		                             vector<MeasurePoint>& alternate,
+		                             int x0, int x1, int y0, int y1);
+		void     findMiddleSnake    (vector<MeasurePoint>& reference,
+		                             vector<MeasurePoint>& alternate,
+		                             int x0, int x1, int y0, int y1,
+		                             int& xstart, int& ystart,
+		                             int& xend, int& yend);
+		void     compareMeasures    (MeasurePoint& refmeasure, MeasurePoint& altmeasure,
+		                             HumdrumFile& reference, HumdrumFile& alternate);
+		void     markMeasure        (MeasurePoint& measure, HumdrumFile& infile);
 		void     printNotePoints    (vector<NotePoint>& notelist);
-		void     markNote           (NotePoint& np);
+		void     markNote           (NotePoint& np, int sourcecount = 1);
+		void     printAgreements    (HumdrumLine& line);
+		int      getSourceNumber    (int index);
 
 	private:
 		int m_marked = 0;
+		vector<int> m_sources;             // file index of each score being compared
+		vector<string> m_structure;        // structural differences found when aligning
+		std::unordered_map<HTp, std::string> m_agreements; // matching source counts of marked notes
 
 
 };
@@ -6986,6 +7566,8 @@ class Tool_mei2hum : public HumTool {
 		string getHumdrumPitch      (xml_node note, vector<xml_node>& children);
 		string getHumdrumRecip      (HumNum duration, int dotcount);
 		void   buildIdLinkMap       (xml_document& doc);
+		int    internId             (const char* id);
+		int    getIdIndex           (xml_node node);
 		void   processNodeStartLinks(string& output, xml_node node,
 		                             vector<xml_node>& nodelist);
 		void   processNodeStopLinks(string& output, xml_node node,
@@ -7086,8 +7668,13 @@ class Tool_mei2hum : public HumTool {
 
 		vector<hairpin_info> m_hairpins;
 
-		map<string, vector<xml_node>> m_startlinks;
-		map<string, vector<xml_node>> m_stoplinks;
+		// ID links built by buildIdLinkMap().  xml:id, @startid and @endid
+		// values are interned as indexes into m_startlinks/m_stoplinks, and
+		// elements are keyed by their pugixml hash_value():
+		std::unordered_map<std::string, int>  m_idindex;    // ID string to index
+		std::unordered_map<size_t, int>       m_nodeids;    // element to xml:id index
+		vector<vector<xml_node>>              m_startlinks; // elements with @startid, by ID
+		vector<vector<xml_node>>              m_stoplinks;  // elements with @endid, by ID
 
 };
 
@@ -7667,11 +8254,23 @@ class Tool_musedata2hum : public HumTool {
 		HTp m_lastfigure = NULL;     // last figured bass token
 		int m_lastbarnum = -1;       // barnumber carried over from previous bar
 		HTp m_lastnote = NULL;       // for dealing with chords.
+		std::map<HumNum, GridMeasure*> m_measuretimes; // measures by start time
 
 };
 
 
 
+// Markup items returned by Tool_musicxml2hum::readMarkup():
+enum musicxml_markup_type {
+	mxml_eof,        // end of input
+	mxml_error,      // unterminated markup
+	mxml_text,       // character data between tags
+	mxml_start,      // <element>
+	mxml_empty,      // <element/>
+	mxml_end,        // </element>
+	mxml_other       // XML declaration, DOCTYPE, comment, CDATA, PI
+};
+
 class MusicXmlHarmonyInfo {
 	public:
 		HTp    token;
@@ -7690,12 +8289,14 @@ class MusicXmlFiguredBassInfo {
 class Tool_musicxml2hum : public HumTool {
 	public:
 		        Tool_musicxml2hum    (void);
-		       ~Tool_musicxml2hum    () {}
+		       ~Tool_musicxml2hum    () { releaseFragments(); }
 
 		bool    convertFile          (ostream& out, const char* filename);
 		bool    convert              (ostream& out, pugi::xml_document& infile);
 		bool    convert              (ostream& out, const char* input);
 		bool    convert              (ostream& out, istream& input);
+		bool    convertStream        (ostream& out, istream& input);
+		bool    convertArchive       (ostream& out, istream& input);
 
 		void    setOptions           (int argc, char** argv);
 		void    setOptions           (const std::vector<std::string>& argvlist);
@@ -7725,9 +8326,29 @@ class Tool_musicxml2hum : public HumTool {
 		                             const std::vector<std::string>& partids,
 		                             map<std::string, pugi::xml_node>& partinfo,
 		                             map<std::string, pugi::xml_node>& partcontent);
-		bool   fillPartData         (MxmlPart& partdata, const std::string& id,
-		                             pugi::xml_node partdeclaration,
-		                             pugi::xml_node partcontent);
+		void   preparePartData      (std::vector<MxmlPart>& partdata,
+		                             const std::vector<std::string>& partids,
+		                             map<std::string, pugi::xml_node>& partinfo);
+		void   preparePart          (MxmlPart& partdata,
+		                             pugi::xml_node partdeclaration);
+		void   addPartMeasure       (MxmlPart& partdata, pugi::xml_node measure);
+		void   addPartMeasures      (std::vector<MxmlPart>& partdata,
+		                             std::vector<std::vector<pugi::xml_node>>& partmeasures);
+		bool   convertPartData      (ostream& out, pugi::xml_document& doc,
+		                             std::vector<std::string>& partids,
+		                             map<std::string, pugi::xml_node>& partinfo,
+		                             map<std::string, pugi::xml_node>& partcontent,
+		                             std::vector<MxmlPart>& partdata);
+		int    readMarkup           (std::streambuf* input, std::string& markup,
+		                             std::string& name);
+		bool   readMarkupUntil      (std::streambuf* input, std::string& markup,
+		                             const std::string& ending);
+		bool   readElement          (std::streambuf* input, std::string& text,
+		                             const std::string& name);
+		bool   parseFragment        (pugi::xml_document& doc,
+		                             const std::string& text,
+		                             const std::string& description);
+		void   releaseFragments     (void);
 		void   appendZeroEvents     (GridMeasure* outfile,
 		                             std::vector<SimultaneousEvents*>& nowevents,
 		                             HumNum nowtime,
@@ -7855,6 +8476,7 @@ class Tool_musicxml2hum : public HumTool {
 		void prepareRdfs       (std::vector<MxmlPart>& partdata);
 		void printRdfs         (ostream& out);
 		void printResult       (ostream& out, HumdrumFile& outfile);
+		void printResult       (ostream& out, HumdrumFile& outfile, istream& text);
 		void addMeasureOneNumber(HumdrumFile& infile);
 		bool isUsedHairpin     (pugi::xml_node hairpin, int partindex);
 
@@ -7868,6 +8490,7 @@ class Tool_musicxml2hum : public HumTool {
 		bool VoiceDebugQ;
 		bool m_recipQ        = false;
 		bool m_stemsQ        = false;
+		int  m_partthreads   = 0;      // threads for filling part data
 		int  m_slurabove     = 0;
 		int  m_slurbelow     = 0;
 		char m_hasEditorial  = '\0';
@@ -7910,6 +8533,16 @@ class Tool_musicxml2hum : public HumTool {
 		// to process.
 		std::map<std::string, vector<pugi::xml_node>> m_post_note_text;
 
+		// m_prolog is the XML declaration of a streamed file, which is
+		// prefixed to each fragment so that its encoding is preserved.
+		std::string m_prolog;
+
+		// m_fragments stores a document for each streamed <part> element,
+		// into which its measures are copied after being parsed.  MxmlEvents
+		// point into these documents, so they are kept until the HumGrid
+		// has been filled.
+		std::vector<pugi::xml_document*> m_fragments;
+
 };
 
 
@@ -8574,6 +9207,12 @@ class Tool_sic : public HumTool {
 };
 
 
+// Row stride of the packed histogram matrices (7 pitch classes padded to 8).
+#define SIMAT_STRIDE   8
+// Block sizes for the correlation grid calculation.
+#define SIMAT_ROWBLOCK 16
+#define SIMAT_COLBLOCK 512
+
 class MeasureData {
 	public:
 		            MeasureData               (void);
@@ -8658,6 +9297,14 @@ class MeasureComparisonGrid {
 		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2);
 		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2);
 
+		void         setThreadCount            (int count);
+		void         setTopK                   (int count);
+		double       getBestMatchScore         (void);
+		int          getRows                   (void) { return m_rows; }
+		int          getColumns                (void) { return m_cols; }
+		bool         hasCorrelation            (int i, int j);
+		double       getCorrelation7pc         (int i, int j);
+
 		double       getStartTime1             (int index);
 		double       getStopTime1              (int index);
 		double       getDuration1              (int index);
@@ -8679,10 +9326,33 @@ class MeasureComparisonGrid {
 		void         getColorMapping           (double input, double& hue, double& saturation,
 				 double& lightness);
 
+	protected:
+		void         packHistograms            (MeasureDataSet& set,
+		                                        std::vector<double>& matrix,
+		                                        std::vector<char>& state);
+		void         correlateRows             (int startrow, int endrow);
+		void         storeRow                  (int row, const double* values);
+		void         printCorrelation          (ostream& out, int i, int j);
+
 	private:
-		std::vector<std::vector<MeasureComparison>> m_grid;
-		MeasureDataSet* m_set1 = NULL;
-		MeasureDataSet* m_set2 = NULL;
+		// Rows of the packed matrices are mean-centered unit vectors, so
+		// the Pearson correlation of two measures is a single dot product.
+		std::vector<double> m_matrix1;
+		std::vector<double> m_matrix2;
+		std::vector<char>   m_state1;
+		std::vector<char>   m_state2;
+
+		// m_grid: dense row-major correlations (when m_topk == 0).
+		std::vector<double> m_grid;
+		// m_sparse: best matches for each row (when m_topk > 0).
+		std::vector<std::vector<std::pair<int, double>>> m_sparse;
+
+		int             m_rows    = 0;
+		int             m_cols    = 0;
+		int             m_topk    = 0;
+		int             m_threads = 1;
+		MeasureDataSet* m_set1    = NULL;
+		MeasureDataSet* m_set2    = NULL;
 };
 
 
@@ -8700,6 +9370,16 @@ class Tool_simat : public HumTool {
 	protected:
 		void     initialize         (HumdrumFile& infile1, HumdrumFile& infile2);
 		void     processFile        (HumdrumFile& infile1, HumdrumFile& infile2);
+		void     processCorpus      (HumdrumFileSet& infiles);
+		bool     createSketch       (MeasureDataSet& set, std::vector<double>& sketch);
+		void     compareCandidates  (std::vector<MeasureDataSet*>& sets,
+		                             std::vector<std::pair<int, int>>& candidates,
+		                             std::vector<double>& scores);
+		void     printCorpusResults (HumdrumFileSet& infiles,
+		                             std::vector<std::pair<int, int>>& candidates,
+		                             std::vector<double>& sketchscores,
+		                             std::vector<double>& scores,
+		                             std::vector<bool>& flat);
 
 	private:
 		MeasureDataSet        m_data1;
@@ -8886,6 +9566,23 @@ class Tool_timebase : public HumTool {
 
 
 
+//
+// TransposePitchField: The location and base-40 value of the pitch in a
+//    **kern subtoken, so that the subtoken can be transposed by any
+//    interval without being parsed again.
+//
+
+class TransposePitchField {
+	public:
+		int      m_start      = 0;   // index of subtoken in token
+		int      m_length     = 0;   // length of subtoken
+		int      m_pitchstart = 0;   // index of pitch in token
+		int      m_pitchsize  = 0;   // length of pitch
+		int      m_base40     = 0;   // base-40 pitch
+		int      m_type       = 0;   // see TRANSPOSE_* defines
+};
+
+
 class Tool_transpose : public HumTool {
 	public:
 		         Tool_transpose  (void);
@@ -8895,6 +9592,12 @@ class Tool_transpose : public HumTool {
 		bool     run             (HumdrumFile& infile);
 		bool     run             (const std::string& indata, ostream& out);
 		bool     run             (HumdrumFile& infile, ostream& out);
+		bool     transposeToIntervals(HumdrumFile& infile,
+		                          const std::vector<int>& intervals,
+		                          std::vector<std::string>& outputs);
+		bool     transposeToKeys (HumdrumFile& infile,
+		                          const std::vector<int>& tonics,
+		                          std::vector<std::string>& outputs);
 
 	protected:
 
@@ -8974,6 +9677,17 @@ class Tool_transpose : public HumTool {
 		                                 int line, int transval);
 		int      getTransposeInfo       (HumdrumFile& infile, int row, int col);
 		void     printNewKernString     (const std::string& string, int transval);
+		void     getSpineProcess        (HumdrumFile& infile,
+		                                 vector<bool>& spineprocess);
+		void     parseKernPitches       (HumdrumFile& infile);
+		void     parseKernToken         (HTp token,
+		                                 vector<TransposePitchField>& fields);
+		void     printParsedKernToken   (HTp token,
+		                                 vector<TransposePitchField>& fields,
+		                                 int transval);
+		bool     isKeySignature         (const std::string& token);
+		bool     isKeyDesignation       (const std::string& token);
+		static const std::string& getKernPitchName(int base40);
 
 	private:
 		int      transval     = 0;   // used with -b option
@@ -8988,6 +9702,10 @@ class Tool_transpose : public HumTool {
 		int      writtenQ     = 0;   // used with -W option
 		int      quietQ       = 0;   // used with -q option
 		int      instrumentQ  = 0;   // used with -I option
+
+		// pre-parsed pitches of **kern tokens, indexed by line and field:
+		vector<vector<vector<TransposePitchField>>> m_pitchfields;
+		vector<TransposePitchField> m_tempfields;
 };
 
 
@@ -64,6 +64,9 @@ class Tool_esac2hum : public HumTool {
 		void      example               (void);
 		void      usage                 (const string& command);
 		void      convertEsacToHumdrum  (ostream& out, istream& input);
+		void      convertCollection     (ostream& out, istream& input);
+		string    getSplitFilename      (int index);
+		string    getSongKey            (vector<string>& song);
 		bool      getSong               (vector<string>& song, istream& infile,
 		                                int init);
 		void      convertSong           (vector<string>& song, ostream& out);
@@ -108,9 +111,12 @@ class Tool_esac2hum : public HumTool {
 		vector<string> trailer;           // used with -t option
 		string         fileextension;     // used with -x option
 		string         namebase;          // used with -s option
+		int            threadcount = 1;   // used with --threads option
+		int            segmentQ = 0;      // used with --segment option
 
 		vector<int>    chartable;  // used printChars() & printSpecialChars()
 		int inputline = 0;
+		ostream*       errorstream = &cerr; // error messages for current song
 
 };
 
@@ -0,0 +1,91 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 20:41:17 UTC 2026
+// Last Modified: Fri Oct 16 20:41:17 UTC 2026
+// Filename:      tool-fingerprint.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-fingerprint.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Interface for fingerprint tool, which identifies duplicate
+//                and near-duplicate scores.
+//
+
+#ifndef _TOOL_FINGERPRINT_H
+#define _TOOL_FINGERPRINT_H
+
+#include "HumTool.h"
+#include "HumdrumFile.h"
+#include "HumdrumFileSet.h"
+#include "HumdrumFileStream.h"
+#include "NoteGrid.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+// MinHash value of an empty shingle set:
+#define FINGERPRINT_EMPTY 0xffffffffffffffffULL
+
+class Tool_fingerprint : public HumTool {
+	public:
+		         Tool_fingerprint   (void);
+		        ~Tool_fingerprint   () {};
+
+		bool     run                (HumdrumFileSet& infiles);
+		bool     run                (HumdrumFile& infile);
+		bool     run                (const string& indata, ostream& out);
+		bool     run                (HumdrumFile& infile, ostream& out);
+		bool     run                (HumdrumFileStream& instream);
+
+	protected:
+		bool     initialize         (void);
+		void     processFile        (HumdrumFile& infile);
+		void     finish             (void);
+		void     getShingles        (std::vector<uint64_t>& shingles, HumdrumFile& infile);
+		void     getSignature       (std::vector<uint64_t>& signature,
+		                             std::vector<uint64_t>& shingles);
+		void     addSignature       (const std::string& name,
+		                             std::vector<uint64_t>& signature);
+		double   getSimilarity      (int index1, int index2);
+		int      findCluster        (int index);
+		void     joinClusters       (int index1, int index2);
+		void     printSignature     (const std::string& name, int shinglecount,
+		                             std::vector<uint64_t>& signature);
+		void     printClusters      (void);
+		uint64_t mixHash            (uint64_t value);
+
+	private:
+		bool     m_initialized = false;
+		int      m_shingle     = 4;     // number of intervals in a shingle
+		int      m_hashcount   = 64;    // number of MinHash values in a signature
+		int      m_bands       = 16;    // number of LSH bands
+		int      m_rows        = 4;     // number of MinHash values in a band
+		double   m_threshold   = 0.5;   // minimum similarity for duplicates
+		int      m_count       = 0;     // number of scores read
+		std::string m_group;            // reference key for grouping movements
+
+		std::vector<uint64_t>              m_seeds;      // MinHash seeds
+		std::vector<std::string>           m_names;      // name of each signature
+		std::vector<std::vector<uint64_t>> m_signatures; // MinHash signatures
+		std::vector<int>                   m_parent;     // cluster union-find tree
+		std::vector<std::unordered_map<uint64_t, std::vector<int>>> m_buckets;
+
+		// signatures of movement groups, combined until all input is read:
+		std::map<std::string, std::vector<uint64_t>> m_groups;
+		std::vector<std::string>                     m_grouporder;
+};
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _TOOL_FINGERPRINT_H */
+
+
+
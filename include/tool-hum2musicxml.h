@@ -0,0 +1,87 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 20:58:12 UTC 2026
+// Last Modified: Fri Oct 16 20:58:12 UTC 2026
+// Filename:      tool-hum2musicxml.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-hum2musicxml.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Interface for converting **kern data into MusicXML.
+//
+
+#ifndef _TOOL_HUM2MUSICXML_H
+#define _TOOL_HUM2MUSICXML_H
+
+#include "HumTool.h"
+#include "HumdrumFile.h"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class Tool_hum2musicxml : public HumTool {
+	public:
+		         Tool_hum2musicxml  (void);
+		        ~Tool_hum2musicxml  () {};
+
+		bool     run                (HumdrumFileSet& infiles);
+		bool     run                (HumdrumFile& infile);
+		bool     run                (const string& indata, ostream& out);
+		bool     run                (HumdrumFile& infile, ostream& out);
+		bool     convert            (ostream& out, HumdrumFile& infile);
+
+	protected:
+		void     initialize         (void);
+		void     printHeader        (ostream& out, HumdrumFile& infile);
+		void     printPartList      (ostream& out, std::vector<HTp>& kernstarts);
+		void     printPart          (ostream& out, HumdrumFile& infile,
+		                             HTp kernstart, int partnum);
+		void     printMeasure       (ostream& out, std::vector<std::vector<HTp>>& voices,
+		                             std::vector<HTp>& attributes, HumNum starttime,
+		                             int number, HTp leftbar, HTp rightbar,
+		                             bool firstQ);
+		void     printAttributes    (ostream& out, std::vector<HTp>& tokens,
+		                             bool divisionsQ);
+		void     printKey           (ostream& out, HTp token);
+		void     printTime          (ostream& out, HTp token);
+		void     printClef          (ostream& out, HTp token);
+		int      printToken         (ostream& out, HTp token, int voice);
+		void     printNote          (ostream& out, HTp token, int index,
+		                             const std::string& subtok, int voice,
+		                             int ticks, std::vector<std::string>& beams);
+		void     printNotations     (ostream& out, HTp token, int index,
+		                             const std::string& subtok);
+		void     printSlurs         (ostream& out, HTp token);
+		void     getBeamStates      (std::vector<std::string>& states,
+		                             HTp token, int voice);
+		std::string getPartName     (HTp kernstart);
+		std::string getNoteType     (HumNum duration);
+		int      getFirstMeasureNumber(HumdrumFile& infile);
+		int      getTicks           (HumNum duration);
+		std::string escapeXml       (const std::string& value);
+
+	private:
+		int      m_divisions = 1;         // ticks per quarter note (tpq of file)
+		bool     m_stemsQ    = true;      // print explicit stem directions
+		bool     m_beamsQ    = true;      // print beams
+
+		// state for the part being printed:
+		std::vector<int> m_beamdepth;     // open beam levels in each voice
+		// MusicXML numbers of open slurs by start note and slur enumeration:
+		std::map<std::pair<HTp, int>, int> m_slurs;
+};
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _TOOL_HUM2MUSICXML_H */
+
+
+
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Jul 29 11:38:01 CEST 2019
-// Last Modified: Sat Aug  3 17:48:04 EDT 2019
+// Last Modified: Fri Oct 16 20:02:41 UTC 2026
 // Filename:      tool-humdiff.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-humdiff.h
 // Syntax:        C++11; humlib
@@ -18,6 +18,8 @@
 #include "HumdrumFileSet.h"
 
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
 namespace hum {
 
@@ -67,6 +69,7 @@ class NotePoint {
 		int         processed      = 0;      // has note been processed/matched
 		int         sourceindex    = -1;     // source file index for note
 		int         tpindex        = -1;     // timepoint index of note in source
+		int         agreement      = 0;      // number of other sources containing the note
 		vector<int> matched;       // indexes to the location of the note in TimePoint list.
 		                           // the index indicate which score the match is related to,
 		                           // and a value of -1 means there is no equivalent timepoint.
@@ -83,11 +86,41 @@ class NotePoint {
 			processed = 0;
 			sourceindex = -1;
 			tpindex = -1;
+			agreement = 0;
 			matched.clear();
 		}
 };
 
 
+// NoteIndex is a hash table of the notes at a timepoint, keyed by pitch
+// and duration, so that equivalent notes in another score can be found
+// without a linear search through the list of notes.
+typedef std::unordered_map<uint64_t, std::vector<int>> NoteIndex;
+
+
+// MeasurePoint is a measure in a score, used to align the measures of two
+// scores before comparing notes.  Timestamps of the timepoints in the measure
+// are relative to the start of the measure.
+class MeasurePoint {
+	public:
+		int               startline = -1;   // line index of the starting barline
+		int               endline   = -1;   // line index of the ending barline
+		int               measure   = -1;   // measure number
+		HumNum            start     = 0;    // timestamp of start of measure
+		uint64_t          hash      = 0;    // hash of the notes in the measure
+		vector<TimePoint> timepoints;       // attack times in the measure
+
+		void clear(void) {
+			startline = -1;
+			endline = -1;
+			measure = -1;
+			start = 0;
+			hash = 0;
+			timepoints.clear();
+		}
+};
+
+
 // Function declarations:
 
 class Tool_humdiff : public HumTool {
@@ -97,19 +130,46 @@ class Tool_humdiff : public HumTool {
 		bool     run                (HumdrumFileSet& infiles);
 
 	protected:
-		void     compareFiles       (HumdrumFile& reference, HumdrumFile& alternate);
+		void     compareFiles       (HumdrumFileSet& infiles, int reference);
 
-		void     compareTimePoints  (vector<vector<TimePoint>>& timepoints, HumdrumFile& reference, HumdrumFile& alternate);
+		void     compareTimePoints  (vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*>& infiles);
 		void     extractTimePoints  (vector<TimePoint>& points, HumdrumFile& infile);
 		void     printTimePoints    (vector<TimePoint>& timepoints);
 		void     compareLines       (HumNum minval, vector<int>& indexes, vector<vector<TimePoint>>& timepoints, vector<HumdrumFile*> infiles);
 		void     getNoteList        (vector<NotePoint>& notelist, HumdrumFile& infile, int line, int measure, int sourceindex, int tpindex);
-		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps);
+		int      findNoteInList     (NotePoint& np, vector<NotePoint>& nps, NoteIndex& index);
+		void     buildNoteIndex     (NoteIndex& index, vector<NotePoint>& nps);
+		uint64_t getNoteKey         (NotePoint& np);
+
+		void     alignFiles         (HumdrumFile& reference,
+		                             vector<MeasurePoint>& refmeasures,
+		                             HumdrumFile& alternate);
+		void     extractMeasurePoints(vector<MeasurePoint>& measures, HumdrumFile& infile);
+		void     alignMeasures      (vector<pair<int, int>>& matches,
+		                             vector<MeasurePoint>& reference,
+		                             vector<MeasurePoint>& alternate);
+		void     alignMeasureRange  (vector<pair<int, int>>& matches,
+		                             vector<MeasurePoint>& reference,
+		                             vector<MeasurePoint>& alternate,
+		                             int x0, int x1, int y0, int y1);
+		void     findMiddleSnake    (vector<MeasurePoint>& reference,
+		                             vector<MeasurePoint>& alternate,
+		                             int x0, int x1, int y0, int y1,
+		                             int& xstart, int& ystart,
+		                             int& xend, int& yend);
+		void     compareMeasures    (MeasurePoint& refmeasure, MeasurePoint& altmeasure,
+		                             HumdrumFile& reference, HumdrumFile& alternate);
+		void     markMeasure        (MeasurePoint& measure, HumdrumFile& infile);
 		void     printNotePoints    (vector<NotePoint>& notelist);
-		void     markNote           (NotePoint& np);
+		void     markNote           (NotePoint& np, int sourcecount = 1);
+		void     printAgreements    (HumdrumLine& line);
+		int      getSourceNumber    (int index);
 
 	private:
 		int m_marked = 0;
+		vector<int> m_sources;             // file index of each score being compared
+		vector<string> m_structure;        // structural differences found when aligning
+		std::unordered_map<HTp, std::string> m_agreements; // matching source counts of marked notes
 
 
 };
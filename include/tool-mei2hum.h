@@ -28,6 +28,8 @@
 #include "MxmlEvent.h"
 #include "HumGrid.h"
 
+#include <unordered_map>
+
 
 using namespace std;
 using namespace pugi;
@@ -201,6 +203,8 @@ class Tool_mei2hum : public HumTool {
 		string getHumdrumPitch      (xml_node note, vector<xml_node>& children);
 		string getHumdrumRecip      (HumNum duration, int dotcount);
 		void   buildIdLinkMap       (xml_document& doc);
+		int    internId             (const char* id);
+		int    getIdIndex           (xml_node node);
 		void   processNodeStartLinks(string& output, xml_node node,
 		                             vector<xml_node>& nodelist);
 		void   processNodeStopLinks(string& output, xml_node node,
@@ -301,8 +305,13 @@ class Tool_mei2hum : public HumTool {
 
 		vector<hairpin_info> m_hairpins;
 
-		map<string, vector<xml_node>> m_startlinks;
-		map<string, vector<xml_node>> m_stoplinks;
+		// ID links built by buildIdLinkMap().  xml:id, @startid and @endid
+		// values are interned as indexes into m_startlinks/m_stoplinks, and
+		// elements are keyed by their pugixml hash_value():
+		std::unordered_map<std::string, int>  m_idindex;    // ID string to index
+		std::unordered_map<size_t, int>       m_nodeids;    // element to xml:id index
+		vector<vector<xml_node>>              m_startlinks; // elements with @startid, by ID
+		vector<vector<xml_node>>              m_stoplinks;  // elements with @endid, by ID
 
 };
 
@@ -21,6 +21,7 @@
 #include "HumTool.h"
 #include "HumGrid.h"
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -76,6 +77,7 @@ class Tool_musedata2hum : public HumTool {
 		HTp m_lastfigure = NULL;     // last figured bass token
 		int m_lastbarnum = -1;       // barnumber carried over from previous bar
 		HTp m_lastnote = NULL;       // for dealing with chords.
+		std::map<HumNum, GridMeasure*> m_measuretimes; // measures by start time
 
 };
 
@@ -26,6 +26,7 @@
 #include "MxmlEvent.h"
 #include "HumGrid.h"
 
+#include <istream>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,17 @@ namespace hum {
 
 // START_MERGE
 
+// Markup items returned by Tool_musicxml2hum::readMarkup():
+enum musicxml_markup_type {
+	mxml_eof,        // end of input
+	mxml_error,      // unterminated markup
+	mxml_text,       // character data between tags
+	mxml_start,      // <element>
+	mxml_empty,      // <element/>
+	mxml_end,        // </element>
+	mxml_other       // XML declaration, DOCTYPE, comment, CDATA, PI
+};
+
 class MusicXmlHarmonyInfo {
 	public:
 		HTp    token;
@@ -51,12 +63,14 @@ class MusicXmlFiguredBassInfo {
 class Tool_musicxml2hum : public HumTool {
 	public:
 		        Tool_musicxml2hum    (void);
-		       ~Tool_musicxml2hum    () {}
+		       ~Tool_musicxml2hum    () { releaseFragments(); }
 
 		bool    convertFile          (ostream& out, const char* filename);
 		bool    convert              (ostream& out, pugi::xml_document& infile);
 		bool    convert              (ostream& out, const char* input);
 		bool    convert              (ostream& out, istream& input);
+		bool    convertStream        (ostream& out, istream& input);
+		bool    convertArchive       (ostream& out, istream& input);
 
 		void    setOptions           (int argc, char** argv);
 		void    setOptions           (const std::vector<std::string>& argvlist);
@@ -86,9 +100,29 @@ class Tool_musicxml2hum : public HumTool {
 		                             const std::vector<std::string>& partids,
 		                             map<std::string, pugi::xml_node>& partinfo,
 		                             map<std::string, pugi::xml_node>& partcontent);
-		bool   fillPartData         (MxmlPart& partdata, const std::string& id,
-		                             pugi::xml_node partdeclaration,
-		                             pugi::xml_node partcontent);
+		void   preparePartData      (std::vector<MxmlPart>& partdata,
+		                             const std::vector<std::string>& partids,
+		                             map<std::string, pugi::xml_node>& partinfo);
+		void   preparePart          (MxmlPart& partdata,
+		                             pugi::xml_node partdeclaration);
+		void   addPartMeasure       (MxmlPart& partdata, pugi::xml_node measure);
+		void   addPartMeasures      (std::vector<MxmlPart>& partdata,
+		                             std::vector<std::vector<pugi::xml_node>>& partmeasures);
+		bool   convertPartData      (ostream& out, pugi::xml_document& doc,
+		                             std::vector<std::string>& partids,
+		                             map<std::string, pugi::xml_node>& partinfo,
+		                             map<std::string, pugi::xml_node>& partcontent,
+		                             std::vector<MxmlPart>& partdata);
+		int    readMarkup           (std::streambuf* input, std::string& markup,
+		                             std::string& name);
+		bool   readMarkupUntil      (std::streambuf* input, std::string& markup,
+		                             const std::string& ending);
+		bool   readElement          (std::streambuf* input, std::string& text,
+		                             const std::string& name);
+		bool   parseFragment        (pugi::xml_document& doc,
+		                             const std::string& text,
+		                             const std::string& description);
+		void   releaseFragments     (void);
 		void   appendZeroEvents     (GridMeasure* outfile,
 		                             std::vector<SimultaneousEvents*>& nowevents,
 		                             HumNum nowtime,
@@ -216,6 +250,7 @@ class Tool_musicxml2hum : public HumTool {
 		void prepareRdfs       (std::vector<MxmlPart>& partdata);
 		void printRdfs         (ostream& out);
 		void printResult       (ostream& out, HumdrumFile& outfile);
+		void printResult       (ostream& out, HumdrumFile& outfile, istream& text);
 		void addMeasureOneNumber(HumdrumFile& infile);
 		bool isUsedHairpin     (pugi::xml_node hairpin, int partindex);
 
@@ -229,6 +264,7 @@ class Tool_musicxml2hum : public HumTool {
 		bool VoiceDebugQ;
 		bool m_recipQ        = false;
 		bool m_stemsQ        = false;
+		int  m_partthreads   = 0;      // threads for filling part data
 		int  m_slurabove     = 0;
 		int  m_slurbelow     = 0;
 		char m_hasEditorial  = '\0';
@@ -271,6 +307,16 @@ class Tool_musicxml2hum : public HumTool {
 		// to process.
 		std::map<std::string, vector<pugi::xml_node>> m_post_note_text;
 
+		// m_prolog is the XML declaration of a streamed file, which is
+		// prefixed to each fragment so that its encoding is preserved.
+		std::string m_prolog;
+
+		// m_fragments stores a document for each streamed <part> element,
+		// into which its measures are copied after being parsed.  MxmlEvents
+		// point into these documents, so they are kept until the HumGrid
+		// has been filled.
+		std::vector<pugi::xml_document*> m_fragments;
+
 };
 
 
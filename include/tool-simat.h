@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Tue Jul 17 08:18:29 CEST 2018
-// Last Modified: Tue Jul 17 08:18:24 CEST 2018
+// Last Modified: Fri Oct 16 19:30:12 UTC 2026
 // Filename:      tool-simat.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-simat.h
 // Syntax:        C++11; humlib
@@ -17,11 +17,19 @@
 #include "HumdrumFile.h"
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
 namespace hum {
 
 // START_MERGE
 
+// Row stride of the packed histogram matrices (7 pitch classes padded to 8).
+#define SIMAT_STRIDE   8
+// Block sizes for the correlation grid calculation.
+#define SIMAT_ROWBLOCK 16
+#define SIMAT_COLBLOCK 512
+
 class MeasureData {
 	public:
 		            MeasureData               (void);
@@ -106,6 +114,14 @@ class MeasureComparisonGrid {
 		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2);
 		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2);
 
+		void         setThreadCount            (int count);
+		void         setTopK                   (int count);
+		double       getBestMatchScore         (void);
+		int          getRows                   (void) { return m_rows; }
+		int          getColumns                (void) { return m_cols; }
+		bool         hasCorrelation            (int i, int j);
+		double       getCorrelation7pc         (int i, int j);
+
 		double       getStartTime1             (int index);
 		double       getStopTime1              (int index);
 		double       getDuration1              (int index);
@@ -127,10 +143,33 @@ class MeasureComparisonGrid {
 		void         getColorMapping           (double input, double& hue, double& saturation,
 				 double& lightness);
 
+	protected:
+		void         packHistograms            (MeasureDataSet& set,
+		                                        std::vector<double>& matrix,
+		                                        std::vector<char>& state);
+		void         correlateRows             (int startrow, int endrow);
+		void         storeRow                  (int row, const double* values);
+		void         printCorrelation          (ostream& out, int i, int j);
+
 	private:
-		std::vector<std::vector<MeasureComparison>> m_grid;
-		MeasureDataSet* m_set1 = NULL;
-		MeasureDataSet* m_set2 = NULL;
+		// Rows of the packed matrices are mean-centered unit vectors, so
+		// the Pearson correlation of two measures is a single dot product.
+		std::vector<double> m_matrix1;
+		std::vector<double> m_matrix2;
+		std::vector<char>   m_state1;
+		std::vector<char>   m_state2;
+
+		// m_grid: dense row-major correlations (when m_topk == 0).
+		std::vector<double> m_grid;
+		// m_sparse: best matches for each row (when m_topk > 0).
+		std::vector<std::vector<std::pair<int, double>>> m_sparse;
+
+		int             m_rows    = 0;
+		int             m_cols    = 0;
+		int             m_topk    = 0;
+		int             m_threads = 1;
+		MeasureDataSet* m_set1    = NULL;
+		MeasureDataSet* m_set2    = NULL;
 };
 
 
@@ -148,6 +187,16 @@ class Tool_simat : public HumTool {
 	protected:
 		void     initialize         (HumdrumFile& infile1, HumdrumFile& infile2);
 		void     processFile        (HumdrumFile& infile1, HumdrumFile& infile2);
+		void     processCorpus      (HumdrumFileSet& infiles);
+		bool     createSketch       (MeasureDataSet& set, std::vector<double>& sketch);
+		void     compareCandidates  (std::vector<MeasureDataSet*>& sets,
+		                             std::vector<std::pair<int, int>>& candidates,
+		                             std::vector<double>& scores);
+		void     printCorpusResults (HumdrumFileSet& infiles,
+		                             std::vector<std::pair<int, int>>& candidates,
+		                             std::vector<double>& sketchscores,
+		                             std::vector<double>& scores,
+		                             std::vector<bool>& flat);
 
 	private:
 		MeasureDataSet        m_data1;
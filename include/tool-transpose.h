@@ -20,6 +20,23 @@ namespace hum {
 
 // START_MERGE
 
+//
+// TransposePitchField: The location and base-40 value of the pitch in a
+//    **kern subtoken, so that the subtoken can be transposed by any
+//    interval without being parsed again.
+//
+
+class TransposePitchField {
+	public:
+		int      m_start      = 0;   // index of subtoken in token
+		int      m_length     = 0;   // length of subtoken
+		int      m_pitchstart = 0;   // index of pitch in token
+		int      m_pitchsize  = 0;   // length of pitch
+		int      m_base40     = 0;   // base-40 pitch
+		int      m_type       = 0;   // see TRANSPOSE_* defines
+};
+
+
 class Tool_transpose : public HumTool {
 	public:
 		         Tool_transpose  (void);
@@ -29,6 +46,12 @@ class Tool_transpose : public HumTool {
 		bool     run             (HumdrumFile& infile);
 		bool     run             (const std::string& indata, ostream& out);
 		bool     run             (HumdrumFile& infile, ostream& out);
+		bool     transposeToIntervals(HumdrumFile& infile,
+		                          const std::vector<int>& intervals,
+		                          std::vector<std::string>& outputs);
+		bool     transposeToKeys (HumdrumFile& infile,
+		                          const std::vector<int>& tonics,
+		                          std::vector<std::string>& outputs);
 
 	protected:
 
@@ -108,6 +131,17 @@ class Tool_transpose : public HumTool {
 		                                 int line, int transval);
 		int      getTransposeInfo       (HumdrumFile& infile, int row, int col);
 		void     printNewKernString     (const std::string& string, int transval);
+		void     getSpineProcess        (HumdrumFile& infile,
+		                                 vector<bool>& spineprocess);
+		void     parseKernPitches       (HumdrumFile& infile);
+		void     parseKernToken         (HTp token,
+		                                 vector<TransposePitchField>& fields);
+		void     printParsedKernToken   (HTp token,
+		                                 vector<TransposePitchField>& fields,
+		                                 int transval);
+		bool     isKeySignature         (const std::string& token);
+		bool     isKeyDesignation       (const std::string& token);
+		static const std::string& getKernPitchName(int base40);
 
 	private:
 		int      transval     = 0;   // used with -b option
@@ -122,6 +156,10 @@ class Tool_transpose : public HumTool {
 		int      writtenQ     = 0;   // used with -W option
 		int      quietQ       = 0;   // used with -q option
 		int      instrumentQ  = 0;   // used with -I option
+
+		// pre-parsed pitches of **kern tokens, indexed by line and field:
+		vector<vector<vector<TransposePitchField>>> m_pitchfields;
+		vector<TransposePitchField> m_tempfields;
 };
 
 
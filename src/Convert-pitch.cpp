@@ -10,6 +10,7 @@
 // Description:   Conversions related to pitch.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 #include <ctype.h>
@@ -1309,6 +1310,332 @@ int Convert::kernToStaffLocation(const string& token, const string& clef) {
 
 
 
+//////////////////////////////
+//
+// Convert::kernToPitchParts -- Extract the diatonic pitch class,
+//    accidental count and octave of the first subtoken in a **kern
+//    string in a single pass with a character lookup table.  The values
+//    (including the error values for rests and missing pitches) are the
+//    same as for kernToDiatonicPC(), kernToAccidentalCount() and
+//    kernToOctaveNumber().
+//
+
+void Convert::kernToPitchParts(const string& kerndata, int& diatonic,
+		int& accid, int& octave) {
+	// Character classes: 1-7 = lower-case C-B, 8-14 = upper-case C-B,
+	// 15 = sharp, 16 = flat, 17 = rest, 18 = subtoken separator.
+	static const vector<unsigned char> classes = []() {
+		vector<unsigned char> table(256, 0);
+		const string letters = "cdefgab";
+		for (int i=0; i<(int)letters.size(); i++) {
+			table[(unsigned char)letters[i]] = i + 1;
+			table[(unsigned char)toupper(letters[i])] = i + 8;
+		}
+		table['#'] = 15;
+		table['-'] = 16;
+		table['r'] = 17;
+		table[' '] = 18;
+		return table;
+	}();
+
+	diatonic = -2000;
+	accid = 0;
+	int uc = 0;
+	int lc = 0;
+	bool rest = false;
+	int size = (int)kerndata.size();
+	for (int i=0; i<size; i++) {
+		int cclass = classes[(unsigned char)kerndata[i]];
+		if (cclass == 0) {
+			continue;
+		}
+		if (cclass == 18) {
+			break;
+		}
+		if (cclass <= 14) {
+			int lower = cclass <= 7;
+			lc += lower;
+			uc += !lower;
+			if (diatonic == -2000) {
+				diatonic = lower ? cclass - 1 : cclass - 8;
+			}
+		} else if (cclass == 17) {
+			rest = true;
+			if (diatonic == -2000) {
+				diatonic = -1000;
+			}
+		} else {
+			accid += (cclass == 15) ? 1 : -1;
+		}
+	}
+
+	if (rest || ((uc > 0) && (lc > 0)) || ((size == 1) && (kerndata[0] == '.'))) {
+		octave = -1000;
+	} else if (uc > 0) {
+		octave = 4 - uc;
+	} else if (lc > 0) {
+		octave = 3 + lc;
+	} else {
+		octave = -1000;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToPitchArray -- Parse a list of **kern tokens (or
+//    subtokens) and store a value calculated from the pitch of each
+//    one in output.
+//
+
+template <class TOKEN, class FUNCTION>
+void Convert::kernToPitchArray(vector<int>& output,
+		const vector<TOKEN>& tokens, FUNCTION convert) {
+	output.resize(tokens.size());
+	int diatonic;
+	int accid;
+	int octave;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		kernToPitchParts(getPitchText(tokens[i]), diatonic, accid, octave);
+		output[i] = convert(diatonic, accid, octave);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToBase40 -- Convert a list of **kern tokens (or subtokens)
+//    into base-40 pitches.  Only the first subtoken in each token is
+//    considered.
+//
+
+void Convert::kernToBase40(vector<int>& output, const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToBase40);
+}
+
+
+void Convert::kernToBase40(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToBase40);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToBase12 -- Convert a list of **kern tokens (or subtokens)
+//    into base-12 pitches (middle C = 48).
+//
+
+void Convert::kernToBase12(vector<int>& output, const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToBase12);
+}
+
+
+void Convert::kernToBase12(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToBase12);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToBase7 -- Convert a list of **kern tokens (or subtokens)
+//    into base-7 pitches.
+//
+
+void Convert::kernToBase7(vector<int>& output, const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToBase7);
+}
+
+
+void Convert::kernToBase7(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToBase7);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToMidiNoteNumber -- Convert a list of **kern tokens (or
+//    subtokens) into MIDI note numbers (middle C = 60).
+//
+
+void Convert::kernToMidiNoteNumber(vector<int>& output,
+		const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToMidi);
+}
+
+
+void Convert::kernToMidiNoteNumber(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToMidi);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToOctaveNumber -- Convert a list of **kern tokens (or
+//    subtokens) into octave numbers.
+//
+
+void Convert::kernToOctaveNumber(vector<int>& output,
+		const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToOctave);
+}
+
+
+void Convert::kernToOctaveNumber(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToOctave);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToAccidentalCount -- Convert a list of **kern tokens (or
+//    subtokens) into accidental counts (+1 = sharp, -1 = flat).
+//
+
+void Convert::kernToAccidentalCount(vector<int>& output,
+		const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToAccidental);
+}
+
+
+void Convert::kernToAccidentalCount(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToAccidental);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::pitchPartsToBase40 -- Functions for combining the output
+//     of kernToPitchParts() in the same way as the single-token
+//     conversion functions.
+//
+
+int Convert::pitchPartsToBase40(int diatonic, int accid, int octave) {
+	static const int pcs[7] = {0, 6, 12, 17, 23, 29, 35};
+	if (diatonic < 0) {
+		return diatonic;
+	}
+	int pc = pcs[diatonic] + accid + 2;
+	if (pc < 0) {
+		return pc;
+	}
+	return pc + 40 * octave;
+}
+
+
+int Convert::pitchPartsToBase12(int diatonic, int accid, int octave) {
+	static const int pcs[7] = {0, 2, 4, 5, 7, 9, 11};
+	int pc = diatonic < 0 ? diatonic : pcs[diatonic] + accid;
+	return pc + 12 * octave;
+}
+
+
+int Convert::pitchPartsToBase7(int diatonic, int accid, int octave) {
+	if (diatonic < 0) {
+		return diatonic;
+	}
+	return diatonic + 7 * octave;
+}
+
+
+int Convert::pitchPartsToMidi(int diatonic, int accid, int octave) {
+	return pitchPartsToBase12(diatonic, accid, octave) + 12;
+}
+
+
+int Convert::pitchPartsToOctave(int diatonic, int accid, int octave) {
+	return octave;
+}
+
+
+int Convert::pitchPartsToAccidental(int diatonic, int accid, int octave) {
+	return accid;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::base40ToKern -- Convert a list of base-40 pitches into **kern
+//     pitches, which are stored one after another in buffer.  The pitch
+//     at index i in the list is stored in the buffer from offsets[i] to
+//     offsets[i+1].  The buffer is allocated once for all of the pitches.
+//     Negative base-40 values (such as rests) are converted to empty strings.
+//
+
+void Convert::base40ToKern(string& buffer, vector<int>& offsets,
+		const vector<int>& b40s) {
+	const vector<string>& table = getBase40KernTable();
+	int count = (int)b40s.size();
+	offsets.resize(count + 1);
+
+	// Names outside of the lookup table are rare, so calculate them separately:
+	vector<string> others;
+	vector<const string*> names(count);
+	int size = 0;
+	for (int i=0; i<count; i++) {
+		int b40 = b40s[i];
+		if (b40 < 0) {
+			names[i] = NULL;
+			continue;
+		}
+		if (b40 < (int)table.size()) {
+			names[i] = &table[b40];
+		} else {
+			if (others.empty()) {
+				others.reserve(count);
+			}
+			others.push_back(base40ToKern(b40));
+			names[i] = &others.back();
+		}
+		size += (int)names[i]->size();
+	}
+
+	buffer.resize(size);
+	int position = 0;
+	for (int i=0; i<count; i++) {
+		offsets[i] = position;
+		if (names[i]) {
+			std::copy(names[i]->begin(), names[i]->end(), buffer.begin() + position);
+			position += (int)names[i]->size();
+		}
+	}
+	offsets[count] = position;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::getBase40KernTable -- Return a lookup table of **kern pitch
+//     names for base-40 pitches in octaves 0 through 9.
+//
+
+const vector<string>& Convert::getBase40KernTable(void) {
+	static const vector<string> table = []() {
+		vector<string> names(40 * 10);
+		for (int i=0; i<(int)names.size(); i++) {
+			names[i] = Convert::base40ToKern(i);
+		}
+		return names;
+	}();
+	return table;
+}
+
+
 
 // END_MERGE
 
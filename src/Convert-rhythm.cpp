@@ -15,6 +15,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
 
 using namespace std;
 
@@ -48,85 +51,17 @@ HumNum Convert::recipToDuration(string* recip, HumNum scale,
 
 HumNum Convert::recipToDuration(const string& recip, HumNum scale,
 		const string& separator) {
-	size_t loc;
-	loc = recip.find(separator);
-	string subtok;
-	if (loc != string::npos) {
-		subtok = recip.substr(0, loc);
-	} else {
-		subtok = recip;
-	}
-
-	loc = recip.find('q');
-	if (loc != string::npos) {
+	if (recip.find('q') != string::npos) {
 		// grace note, ignore printed rhythm
 		HumNum zero(0);
 		return zero;
 	}
 
-	int dotcount = 0;
-	int i;
-	int numi = -1;
-	for (i=0; i<(int)subtok.size(); i++) {
-		if (subtok[i] == '.') {
-			dotcount++;
-		}
-		if ((numi < 0) && isdigit(subtok[i])) {
-			numi = i;
-		}
+	const HumRecipDuration& value = getRecipDuration(recip, separator);
+	if (scale == 4) {
+		return value.m_quarters;
 	}
-	loc = subtok.find("%");
-	int numerator = 1;
-	int denominator = 1;
-	HumNum output;
-	if (loc != string::npos) {
-		// reciprocal rhythm
-		numerator = 1;
-		denominator = subtok[numi++] - '0';
-		while ((numi<(int)subtok.size()) && isdigit(subtok[numi])) {
-			denominator = denominator * 10 + (subtok[numi++] - '0');
-		}
-		if ((loc + 1 < subtok.size()) && isdigit(subtok[loc+1])) {
-			int xi = (int)loc + 1;
-			numerator = subtok[xi++] - '0';
-			while ((xi<(int)subtok.size()) && isdigit(subtok[xi])) {
-				numerator = numerator * 10 + (subtok[xi++] - '0');
-			}
-		}
-		output.setValue(numerator, denominator);
-	} else if (numi < 0) {
-		// no rhythm found
-		HumNum zero(0);
-		return zero;
-	} else if (subtok[numi] == '0') {
-		// 0-symbol
-		int zerocount = 1;
-		for (i=numi+1; i<(int)subtok.size(); i++) {
-			if (subtok[i] == '0') {
-				zerocount++;
-			} else {
-				break;
-			}
-		}
-		numerator = (int)pow(2, zerocount);
-		output.setValue(numerator, 1);
-	} else {
-		// plain rhythm
-		denominator = subtok[numi++] - '0';
-		while ((numi<(int)subtok.size()) && isdigit(subtok[numi])) {
-			denominator = denominator * 10 + (subtok[numi++] - '0');
-		}
-		output.setValue(1, denominator);
-	}
-
-	if (dotcount <= 0) {
-		return output * scale;
-	}
-
-	int bot = (int)pow(2.0, dotcount);
-	int top = (int)pow(2.0, dotcount + 1) - 1;
-	HumNum factor(top, bot);
-	return output * factor * scale;
+	return value.m_duration * scale;
 }
 
 
@@ -148,30 +83,156 @@ HumNum Convert::recipToDurationIgnoreGrace(string* recip, HumNum scale,
 
 HumNum Convert::recipToDurationIgnoreGrace(const string& recip, HumNum scale,
 		const string& separator) {
-	size_t loc;
-	loc = recip.find(separator);
-	string subtok;
-	if (loc != string::npos) {
-		subtok = recip.substr(0, loc);
+	const HumRecipDuration& value = getRecipDuration(recip, separator);
+	if (scale == 4) {
+		return value.m_quarters;
+	}
+	return value.m_duration * scale;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::recipToDurationNoDots -- Same as recipToDuration(), but ignore
+//   any augmentation dots.
+//
+
+HumNum Convert::recipToDurationNoDots(string* recip, HumNum scale,
+		const string& separator) {
+	return Convert::recipToDurationNoDots(*recip, scale, separator);
+}
+
+
+HumNum Convert::recipToDurationNoDots(const string& recip, HumNum scale,
+		const string& separator) {
+	if (recip.find('q') != string::npos) {
+		// grace note, ignore printed rhythm
+		HumNum zero(0);
+		return zero;
+	}
+	return getRecipDuration(recip, separator).m_undotted * scale;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::getRecipDuration -- Return the parsed duration of the first
+//     subtoken of a **recip string.  Parsed durations are stored in a
+//     process-wide cache which is shared by all threads.  The cache is
+//     keyed by the rhythm characters of the subtoken (digits, dots and
+//     "%"), so that tokens such as "4c" and "(4d" share the same entry.
+//     Entries are never removed, so the returned reference stays valid.
+//     Each thread also keeps its own index of the entries which it has
+//     used, so that the shared cache only needs to be locked the first
+//     time that a thread uses a rhythm.
+//
+
+const HumRecipDuration& Convert::getRecipDuration(const string& recip,
+		const string& separator) {
+	static const int shardcount = 16;
+	static std::mutex locks[shardcount];
+	static std::unordered_map<string, HumRecipDuration> caches[shardcount];
+	// Per-thread indexes of the cache: keys of up to 8 characters are
+	// packed into an integer for faster lookups.
+	static thread_local std::unordered_map<uint64_t, const HumRecipDuration*> shortkeys;
+	static thread_local std::unordered_map<string, const HumRecipDuration*> longkeys;
+
+	size_t end = recip.find(separator);
+	if (end == string::npos) {
+		end = recip.size();
+	}
+
+	// Non-rhythm characters between rhythm characters are replaced by a
+	// single "_" since they separate numbers.
+	uint64_t packed = 0;
+	int length = 0;
+	string key;
+	auto append = [&](char value) {
+		if (length < 8) {
+			packed |= (uint64_t)(unsigned char)value << (8 * length);
+		} else {
+			key += value;
+		}
+		length++;
+	};
+	bool pending = false;
+	for (size_t i=0; i<end; i++) {
+		char ch = recip[i];
+		if ((('0' <= ch) && (ch <= '9')) || (ch == '.') || (ch == '%')) {
+			if (pending) {
+				append('_');
+				pending = false;
+			}
+			append(ch);
+		} else if (length > 0) {
+			pending = true;
+		}
+	}
+
+	if (length <= 8) {
+		auto found = shortkeys.find(packed);
+		if (found != shortkeys.end()) {
+			return *found->second;
+		}
 	} else {
-		subtok = recip;
+		auto found = longkeys.find(key);
+		if (found != longkeys.end()) {
+			return *found->second;
+		}
+	}
+	for (int i=std::min(length, 8) - 1; i>=0; i--) {
+		key.insert(key.begin(), (char)(packed >> (8 * i)));
+	}
+	const HumRecipDuration*& localentry = (length <= 8) ?
+			shortkeys[packed] : longkeys[key];
+
+	int shard = (int)(std::hash<string>()(key) % shardcount);
+	std::lock_guard<std::mutex> lock(locks[shard]);
+	auto it = caches[shard].find(key);
+	if (it != caches[shard].end()) {
+		localentry = &it->second;
+		return it->second;
 	}
 
-	int dotcount = 0;
+	HumRecipDuration& value = caches[shard][key];
+	localentry = &value;
+	parseRecip(key, value.m_undotted, value.m_dots);
+	value.m_duration = value.m_undotted;
+	if (value.m_dots > 0) {
+		int bot = (int)pow(2.0, value.m_dots);
+		int top = (int)pow(2.0, value.m_dots + 1) - 1;
+		HumNum factor(top, bot);
+		value.m_duration *= factor;
+	}
+	value.m_quarters = value.m_duration * 4;
+	return value;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::parseRecip -- Parse a **recip subtoken into its duration in
+//     whole notes without augmentation dots, and the number of dots.
+//
+
+void Convert::parseRecip(const string& subtok, HumNum& undotted, int& dots) {
+	dots = 0;
 	int i;
 	int numi = -1;
 	for (i=0; i<(int)subtok.size(); i++) {
 		if (subtok[i] == '.') {
-			dotcount++;
+			dots++;
 		}
 		if ((numi < 0) && isdigit(subtok[i])) {
 			numi = i;
 		}
 	}
-	loc = subtok.find("%");
+	size_t loc = subtok.find("%");
 	int numerator = 1;
 	int denominator = 1;
-	HumNum output;
 	if (loc != string::npos) {
 		// reciprocal rhythm
 		numerator = 1;
@@ -186,11 +247,11 @@ HumNum Convert::recipToDurationIgnoreGrace(const string& recip, HumNum scale,
 				numerator = numerator * 10 + (subtok[xi++] - '0');
 			}
 		}
-		output.setValue(numerator, denominator);
+		undotted.setValue(numerator, denominator);
 	} else if (numi < 0) {
 		// no rhythm found
-		HumNum zero(0);
-		return zero;
+		undotted = 0;
+		dots = 0;
 	} else if (subtok[numi] == '0') {
 		// 0-symbol
 		int zerocount = 1;
@@ -202,45 +263,15 @@ HumNum Convert::recipToDurationIgnoreGrace(const string& recip, HumNum scale,
 			}
 		}
 		numerator = (int)pow(2, zerocount);
-		output.setValue(numerator, 1);
+		undotted.setValue(numerator, 1);
 	} else {
 		// plain rhythm
 		denominator = subtok[numi++] - '0';
 		while ((numi<(int)subtok.size()) && isdigit(subtok[numi])) {
 			denominator = denominator * 10 + (subtok[numi++] - '0');
 		}
-		output.setValue(1, denominator);
-	}
-
-	if (dotcount <= 0) {
-		return output * scale;
+		undotted.setValue(1, denominator);
 	}
-
-	int bot = (int)pow(2.0, dotcount);
-	int top = (int)pow(2.0, dotcount + 1) - 1;
-	HumNum factor(top, bot);
-	return output * factor * scale;
-}
-
-
-
-//////////////////////////////
-//
-// Convert::recipToDurationNoDots -- Same as recipToDuration(), but ignore
-//   any augmentation dots.
-//
-
-HumNum Convert::recipToDurationNoDots(string* recip, HumNum scale,
-		const string& separator) {
-	return Convert::recipToDurationNoDots(*recip, scale, separator);
-}
-
-
-HumNum Convert::recipToDurationNoDots(const string& recip, HumNum scale,
-		const string& separator) {
-	string temp = recip;
-	std::replace(temp.begin(), temp.end(), '.', 'Z');
-	return Convert::recipToDuration(temp, scale, separator);
 }
 
 
@@ -13,6 +13,9 @@
 #include "HumAddress.h"
 #include "HumdrumLine.h"
 
+#include <mutex>
+#include <unordered_set>
+
 using namespace std;
 
 namespace hum {
@@ -26,6 +29,7 @@ namespace hum {
 //
 
 HumAddress::HumAddress(void) {
+	m_spining       = NULL;
 	m_track         = -1;
 	m_subtrack      = -1;
 	m_subtrackcount = 0;
@@ -149,7 +153,8 @@ const HumdrumToken& HumAddress::getDataType(void) const {
 //
 
 const string& HumAddress::getSpineInfo(void) const {
-	return m_spining;
+	static const string empty;
+	return m_spining ? *m_spining : empty;
 }
 
 
@@ -290,11 +295,37 @@ void HumAddress::setFieldIndex(int index) {
 //
 
 void HumAddress::setSpineInfo(const string& spineinfo) {
+	m_spining = internSpineInfo(spineinfo);
+}
+
+//
+// Interned string version:
+//
+
+void HumAddress::setSpineInfo(const string* spineinfo) {
 	m_spining = spineinfo;
 }
 
 
 
+//////////////////////////////
+//
+// HumAddress::internSpineInfo -- Return a shared copy of the spine info
+//     string.  Spine info strings are stored once for the whole program
+//     and never deleted, so tokens only need to store a pointer to
+//     them, and tokens with the same spine info can be compared by
+//     pointer.
+//
+
+const string* HumAddress::internSpineInfo(const string& spineinfo) {
+	static std::mutex tablemutex;
+	static std::unordered_set<string> table;
+	std::lock_guard<std::mutex> lock(tablemutex);
+	return &*table.insert(spineinfo).first;
+}
+
+
+
 //////////////////////////////
 //
 // HumAddress::setTrack -- Set the track number of the associated token.
@@ -0,0 +1,321 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 21:52:08 UTC 2026
+// Last Modified: Fri Oct 16 21:52:08 UTC 2026
+// Filename:      HumBatch.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumBatch.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Batch conversion of a list of files on a pool of worker
+//                threads, with a JSON-lines report for each file.
+//
+// Requests are read one per line: an input filename, optionally followed
+// by a tab and the output filename.  When no output filename is given,
+// the extension of the input filename is replaced by the output
+// extension (".krn" by default).  Empty lines and lines starting with
+// "#" are ignored.  Requests are queued as they are read, so the input
+// can be a manifest file or a pipe that stays open (daemon mode).
+//
+// Each converted file generates a line of JSON in the report, in the
+// order that the conversions finish:
+//    {"input":"a.xml","output":"a.krn","worker":0,"status":"ok","ms":12.345,"bytes":2048,"error":""}
+// followed by a summary line after the input has ended:
+//    {"files":1,"failed":0,"ms":13.001}
+//
+
+#include "HumBatch.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+//////////////////////////////
+//
+// HumBatch::HumBatch -- Constructor.
+//
+
+HumBatch::HumBatch(void) {
+	setThreadCount(0);
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::setThreadCount -- Set the number of worker threads.  A
+//     value of 0 uses one thread for each hardware thread.
+//
+
+void HumBatch::setThreadCount(int count) {
+	if (count <= 0) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	if (count <= 0) {
+		count = 1;
+	}
+	m_threads = count;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::getThreadCount -- Return the number of worker threads.
+//
+
+int HumBatch::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::setExtension -- Set the extension of output files which
+//     are named after their input files.
+//
+
+void HumBatch::setExtension(const string& extension) {
+	m_extension = extension;
+	if (!m_extension.empty() && (m_extension[0] != '.')) {
+		m_extension = "." + m_extension;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::run -- Convert the files in the requests as they are read,
+//     and return false if any conversion failed.
+//
+
+bool HumBatch::run(istream& requests, ostream& report, Converter converter) {
+	m_jobs.clear();
+	m_finished = false;
+	m_count = 0;
+	m_failures = 0;
+	auto starttime = std::chrono::steady_clock::now();
+
+	vector<std::thread> workers;
+	for (int i=0; i<m_threads; i++) {
+		workers.emplace_back(&HumBatch::processJobs, this, i, std::ref(converter),
+				std::ref(report));
+	}
+
+	string line;
+	string input;
+	string output;
+	while (getline(requests, line)) {
+		if (!parseRequest(line, input, output)) {
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_jobmutex);
+			m_jobs.emplace_back(input, output);
+		}
+		m_jobready.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobmutex);
+		m_finished = true;
+	}
+	m_jobready.notify_all();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - starttime;
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.3f", elapsed.count());
+	report << "{\"files\":" << m_count << ",\"failed\":" << m_failures
+	       << ",\"ms\":" << buffer << "}" << endl;
+
+	return m_failures == 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::parseRequest -- Extract the input and output filenames from
+//     a line of the requests.  Returns false if the line has no request.
+//
+
+bool HumBatch::parseRequest(const string& line, string& input, string& output) {
+	string request = line;
+	if (!request.empty() && (request.back() == '\r')) {
+		request.pop_back();
+	}
+	if (request.empty() || (request[0] == '#')) {
+		return false;
+	}
+
+	size_t tab = request.find('\t');
+	if (tab == string::npos) {
+		input = request;
+		output.clear();
+	} else {
+		input = request.substr(0, tab);
+		output = request.substr(tab + 1);
+	}
+	if (input.empty()) {
+		return false;
+	}
+
+	if (output.empty()) {
+		size_t slash = input.rfind('/');
+		size_t dot = input.rfind('.');
+		if ((dot == string::npos) || ((slash != string::npos) && (dot < slash))) {
+			output = input + m_extension;
+		} else {
+			output = input.substr(0, dot) + m_extension;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::processJobs -- Worker thread loop: convert queued files until
+//     the requests have ended and the queue is empty.
+//
+
+void HumBatch::processJobs(int worker, Converter& converter, ostream& report) {
+	while (true) {
+		pair<string, string> job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobmutex);
+			m_jobready.wait(lock, [this]() { return m_finished || !m_jobs.empty(); });
+			if (m_jobs.empty()) {
+				return;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+		convertJob(worker, converter, job.first, job.second, report);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::convertJob -- Convert one file, write the output file and
+//     add the result to the report.
+//
+
+void HumBatch::convertJob(int worker, Converter& converter, const string& input,
+		const string& output, ostream& report) {
+	auto starttime = std::chrono::steady_clock::now();
+	stringstream out;
+	stringstream error;
+	bool status = false;
+	size_t bytes = 0;
+
+	ifstream testfile(input.c_str());
+	if (!testfile.is_open()) {
+		error << "Cannot read input file";
+	} else {
+		testfile.close();
+		try {
+			status = converter(worker, input, out, error);
+		} catch (const std::exception& e) {
+			error << e.what();
+			status = false;
+		}
+	}
+
+	if (status) {
+		string contents = out.str();
+		ofstream outfile(output.c_str(), ios::binary);
+		if (!outfile.is_open()) {
+			error << "Cannot write output file";
+			status = false;
+		} else {
+			outfile << contents;
+			bytes = contents.size();
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - starttime;
+	string message = error.str();
+	while (!message.empty() && isspace((unsigned char)message.back())) {
+		message.pop_back();
+	}
+	if (!status && message.empty()) {
+		message = "Conversion failed";
+	}
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.3f", elapsed.count());
+
+	std::lock_guard<std::mutex> lock(m_reportmutex);
+	m_count++;
+	if (!status) {
+		m_failures++;
+	}
+	report << "{\"input\":\"" << escapeJson(input) << "\""
+	       << ",\"output\":\"" << escapeJson(output) << "\""
+	       << ",\"worker\":" << worker
+	       << ",\"status\":\"" << (status ? "ok" : "error") << "\""
+	       << ",\"ms\":" << buffer
+	       << ",\"bytes\":" << bytes
+	       << ",\"error\":\"" << escapeJson(message) << "\"}" << endl;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::escapeJson -- Escape a string for use in a JSON string value.
+//
+
+string HumBatch::escapeJson(const string& value) {
+	string output;
+	output.reserve(value.size());
+	for (int i=0; i<(int)value.size(); i++) {
+		unsigned char ch = (unsigned char)value[i];
+		switch (ch) {
+			case '"':  output += "\\\""; break;
+			case '\\': output += "\\\\"; break;
+			case '\n': output += "\\n";  break;
+			case '\r': output += "\\r";  break;
+			case '\t': output += "\\t";  break;
+			default:
+				if (ch < 0x20) {
+					char buffer[8];
+					snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+					output += buffer;
+				} else {
+					output += (char)ch;
+				}
+		}
+	}
+	return output;
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -51,9 +51,9 @@ bool HumTool::hasAnyText(void) {
 	if (m_suppress) {
 		return true;
 	}
-	return ((!m_humdrum_text.str().empty())
-			|| (!m_free_text.str().empty())
-			|| (!m_json_text.str().empty()));
+	return ((!isEmpty(m_humdrum_text))
+			|| (!isEmpty(m_free_text))
+			|| (!isEmpty(m_json_text)));
 }
 
 
@@ -75,9 +75,9 @@ string HumTool::getAllText(void) {
 //
 
 ostream& HumTool::getAllText(ostream& out) {
-	out << m_humdrum_text.str();
-	out << m_json_text.str();
-	out << m_free_text.str();
+	printStream(out, m_humdrum_text);
+	printStream(out, m_json_text);
+	printStream(out, m_free_text);
 	return out;
 }
 
@@ -101,7 +101,7 @@ void HumTool::suppressHumdrumFileOutput(void) {
 //
 
 bool HumTool::hasHumdrumText(void) {
-	return m_humdrum_text.str().empty() ? false : true;
+	return isEmpty(m_humdrum_text) ? false : true;
 }
 
 
@@ -121,7 +121,7 @@ string HumTool::getHumdrumText(void) {
 //
 
 ostream& HumTool::getHumdrumText(ostream& out) {
-	out << m_humdrum_text.str();
+	printStream(out, m_humdrum_text);
 	return out;
 }
 
@@ -133,7 +133,7 @@ ostream& HumTool::getHumdrumText(ostream& out) {
 //
 
 bool HumTool::hasFreeText(void) {
-	return m_free_text.str().empty() ? false : true;
+	return isEmpty(m_free_text) ? false : true;
 }
 
 
@@ -153,7 +153,7 @@ string HumTool::getFreeText(void) {
 //
 
 ostream& HumTool::getFreeText(ostream& out) {
-	out << m_free_text.str();
+	printStream(out, m_free_text);
 	return out;
 }
 
@@ -165,7 +165,7 @@ ostream& HumTool::getFreeText(ostream& out) {
 //
 
 bool HumTool::hasJsonText(void) {
-	return m_json_text.str().empty() ? false : true;
+	return isEmpty(m_json_text) ? false : true;
 }
 
 
@@ -185,7 +185,7 @@ string HumTool::getJsonText(void) {
 //
 
 ostream& HumTool::getJsonText(ostream& out) {
-	out << m_json_text.str();
+	printStream(out, m_json_text);
 	return out;
 }
 
@@ -197,7 +197,7 @@ ostream& HumTool::getJsonText(ostream& out) {
 //
 
 bool HumTool::hasWarning(void) {
-	return m_warning_text.str().empty() ? false : true;
+	return isEmpty(m_warning_text) ? false : true;
 }
 
 
@@ -217,7 +217,7 @@ string HumTool::getWarning(void) {
 //
 
 ostream& HumTool::getWarning(ostream& out) {
-	out << m_warning_text.str();
+	printStream(out, m_warning_text);
 	return out;
 }
 
@@ -233,7 +233,7 @@ bool HumTool::hasError(void) {
 	if (hasParseError()) {
 		return true;
 	}
-	return m_error_text.str().empty() ? false : true;
+	return isEmpty(m_error_text) ? false : true;
 }
 
 
@@ -257,7 +257,7 @@ string HumTool::getError(void) {
 
 ostream& HumTool::getError(ostream& out) {
 	out << getParseError();
-	out << m_error_text.str();
+	printStream(out, m_error_text);
 	return out;
 }
 
@@ -289,6 +289,37 @@ void HumTool::setError(const string& message) {
 
 
 
+//////////////////////////////
+//
+// HumTool::isEmpty -- Returns true if nothing has been written to the
+//     output stream.  This avoids copying the contents of the stream
+//     just to check its size.
+//
+
+bool HumTool::isEmpty(std::stringstream& stream) {
+	return stream.rdbuf()->pubseekoff(0, ios::cur, ios::out) <= 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::printStream -- Copy the contents of the output stream into
+//     another stream without making a temporary copy of the contents.
+//     The contents of the stream are not changed, so it can be printed
+//     more than once.
+//
+
+ostream& HumTool::printStream(ostream& out, std::stringstream& stream) {
+	if (isEmpty(stream)) {
+		return out;
+	}
+	stream.rdbuf()->pubseekpos(0, ios::in);
+	out << stream.rdbuf();
+	return out;
+}
+
+
 
 // END_MERGE
 
@@ -0,0 +1,589 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 23:10:00 UTC 2026
+// Last Modified: Fri Oct 16 23:10:00 UTC 2026
+// Filename:      HumdrumFileBase-timeline.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileBase-timeline.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Index of lines by timestamp for time-based queries.
+//
+
+#include "HumdrumFileBase.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getLineAtTime -- Return the index of the first line
+//    which starts at the given timestamp (in quarter notes from the
+//    start of the file).  If no line starts at the timestamp, then
+//    return the last line starting before it.  Returns -1 if the
+//    timestamp is before the start of the file.
+//
+
+int HumdrumFileBase::getLineAtTime(HumNum timestamp) {
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return -1;
+	}
+	if (exact) {
+		return m_timeline[index].m_firstline;
+	}
+	return m_timeline[index].m_lastline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getDataLineAtTime -- Return the index of the first data
+//    line which starts at the given timestamp.  If no data line starts at
+//    the timestamp, then return the last data line starting before it.
+//    Returns -1 if there is no data line at or before the timestamp.
+//
+
+int HumdrumFileBase::getDataLineAtTime(HumNum timestamp) {
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return -1;
+	}
+	if (exact && (m_timeline[index].m_firstdata >= 0)) {
+		return m_timeline[index].m_firstdata;
+	}
+	return m_timeline[index].m_lastdata;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getMeasureAtTime -- Return the index of the barline
+//    (see getBarline()) starting the measure which contains the given
+//    timestamp.  Returns -1 if the timestamp is before the first barline,
+//    or if the rhythm of the file has not been analyzed.
+//
+
+int HumdrumFileBase::getMeasureAtTime(HumNum timestamp) {
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return -1;
+	}
+	return m_timeline[index].m_measure;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getLineRangeAtTimes -- Return the range of lines which
+//    start at or after starttime and before endtime.  Returns false if
+//    there are no lines in the time range.
+//
+
+bool HumdrumFileBase::getLineRangeAtTimes(int& startline, int& endline,
+		HumNum starttime, HumNum endtime) {
+	startline = -1;
+	endline = -1;
+	if (endtime <= starttime) {
+		return false;
+	}
+	bool exact = false;
+	int startindex = getTimelineIndex(starttime, exact);
+	if (!exact) {
+		// first entry after the start time:
+		startindex++;
+	}
+	int endindex = getTimelineIndex(endtime, exact);
+	if (exact) {
+		// last entry before the end time:
+		endindex--;
+	}
+	if ((startindex >= (int)m_timeline.size()) || (endindex < startindex)) {
+		return false;
+	}
+	startline = m_timeline[startindex].m_firstline;
+	endline = m_timeline[endindex].m_lastline;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimelineTpq -- Return the number of ticks per
+//    quarter note used in the timeline, which is the smallest value
+//    that gives an integer tick position for every line in the file.
+//    Returns 0 if the ticks would not fit into 64 bits, in which case
+//    the timeline entries are ordered by their timestamps only.
+//
+
+int64_t HumdrumFileBase::getTimelineTpq(void) {
+	if (m_timeline.empty()) {
+		analyzeTimeline();
+	}
+	return m_timelinetpq;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimeline -- Return the index of the lines in
+//    the file by timestamp.  The entries are sorted by time, and there
+//    is one entry for each timestamp.
+//
+
+const vector<HumTimelineEntry>& HumdrumFileBase::getTimeline(void) {
+	if (m_timeline.empty()) {
+		analyzeTimeline();
+	}
+	return m_timeline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimelineIndex -- Return the index of the last
+//    timeline entry at or before the given timestamp, or -1 if the
+//    timestamp is before the first entry.  exact is set to true if
+//    the entry is at the timestamp.
+//
+
+int HumdrumFileBase::getTimelineIndex(HumNum timestamp, bool& exact) {
+	exact = false;
+	if (m_timeline.empty()) {
+		analyzeTimeline();
+	}
+	if (m_timeline.empty()) {
+		return -1;
+	}
+	int index;
+	int64_t ticks = 0;
+	bool tickexact = false;
+	if (getTimelineTicks(timestamp, ticks, tickexact)) {
+		auto it = upper_bound(m_timeline.begin(), m_timeline.end(), ticks,
+				[](int64_t value, const HumTimelineEntry& entry) {
+					return value < entry.m_ticks;
+				});
+		index = (int)(it - m_timeline.begin()) - 1;
+		if (index < 0) {
+			return -1;
+		}
+		exact = tickexact && (m_timeline[index].m_ticks == ticks);
+	} else {
+		// The timestamp cannot be expressed in ticks, so compare
+		// the timestamps directly:
+		auto it = upper_bound(m_timeline.begin(), m_timeline.end(), timestamp,
+				[this](const HumNum& value, const HumTimelineEntry& entry) {
+					return compareTimelineTimes(value, entry.m_timestamp) < 0;
+				});
+		index = (int)(it - m_timeline.begin()) - 1;
+		if (index < 0) {
+			return -1;
+		}
+		exact = compareTimelineTimes(timestamp, m_timeline[index].m_timestamp) == 0;
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimelineTicks -- Convert a timestamp into timeline
+//    ticks, rounding down if the timestamp falls between ticks (exact is
+//    set to false in that case).  Returns false if the timeline does not
+//    use ticks, or if the timestamp is too large to be expressed in ticks.
+//
+
+bool HumdrumFileBase::getTimelineTicks(HumNum timestamp, int64_t& ticks,
+		bool& exact) {
+	ticks = 0;
+	exact = false;
+	if (m_timelinetpq <= 0) {
+		return false;
+	}
+	int64_t numerator = timestamp.getNumerator();
+	int64_t denominator = timestamp.getDenominator();
+	if (denominator <= 0) {
+		return false;
+	}
+	if ((numerator > INT64_MAX / m_timelinetpq) ||
+			(numerator < -(INT64_MAX / m_timelinetpq))) {
+		return false;
+	}
+	int64_t scaled = numerator * m_timelinetpq;
+	ticks = scaled / denominator;
+	exact = (scaled % denominator) == 0;
+	if (!exact && (scaled < 0)) {
+		// round down for negative timestamps
+		ticks--;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::compareTimelineTimes -- Compare two timestamps without
+//    rounding.  Returns a negative number if time1 is before time2, zero
+//    if they are the same, or a positive number if time1 is after time2.
+//
+
+int HumdrumFileBase::compareTimelineTimes(HumNum time1, HumNum time2) {
+	int64_t value1 = (int64_t)time1.getNumerator() * time2.getDenominator();
+	int64_t value2 = (int64_t)time2.getNumerator() * time1.getDenominator();
+	if (value1 < value2) {
+		return -1;
+	}
+	if (value1 > value2) {
+		return 1;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::analyzeTimeline -- Index the lines in the file by
+//    their starting times.  Lines are expected to be in time order
+//    (after rhythmic analysis).  A line which starts before the
+//    previous line is indexed with the previous line's time.  If the
+//    timestamps of the file cannot all be expressed as 64-bit ticks,
+//    then the timeline ticks per quarter note is set to 0, and the
+//    timestamps are compared directly instead.
+//
+
+void HumdrumFileBase::analyzeTimeline(void) {
+	m_timeline.clear();
+	m_timelinetpq = 1;
+	int linecount = getLineCount();
+	if (linecount == 0) {
+		return;
+	}
+
+	// Ticks per quarter note is the least common multiple of the
+	// timestamp denominators.
+	for (int i=0; i<linecount; i++) {
+		int64_t denominator = m_lines[i]->getDurationFromStart().getDenominator();
+		if (denominator <= 0) {
+			m_timelinetpq = 0;
+			break;
+		}
+		if (m_timelinetpq % denominator == 0) {
+			continue;
+		}
+		int64_t a = m_timelinetpq;
+		int64_t b = denominator;
+		while (b) {
+			int64_t t = a % b;
+			a = b;
+			b = t;
+		}
+		if (m_timelinetpq / a > INT64_MAX / denominator) {
+			// overflow
+			m_timelinetpq = 0;
+			break;
+		}
+		m_timelinetpq = m_timelinetpq / a * denominator;
+	}
+
+	int barindex = 0;
+	int measure = -1;
+	int lastdata = -1;
+	for (int i=0; i<linecount; i++) {
+		HumNum timestamp = m_lines[i]->getDurationFromStart();
+		int64_t ticks = 0;
+		bool exact = false;
+		if ((m_timelinetpq > 0) && !getTimelineTicks(timestamp, ticks, exact)) {
+			// Too large for ticks, so compare timestamps from now on.
+			m_timelinetpq = 0;
+		}
+		bool newentry;
+		if (m_timeline.empty()) {
+			newentry = true;
+		} else if (m_timelinetpq > 0) {
+			newentry = ticks > m_timeline.back().m_ticks;
+		} else {
+			newentry = compareTimelineTimes(timestamp, m_timeline.back().m_timestamp) > 0;
+		}
+		if (newentry) {
+			m_timeline.resize(m_timeline.size() + 1);
+			m_timeline.back().m_ticks = ticks;
+			m_timeline.back().m_timestamp = timestamp;
+			m_timeline.back().m_firstline = i;
+			m_timeline.back().m_lastdata = lastdata;
+		}
+		HumTimelineEntry& entry = m_timeline.back();
+		entry.m_lastline = i;
+		if (m_lines[i]->isData()) {
+			if (entry.m_firstdata < 0) {
+				entry.m_firstdata = i;
+			}
+			lastdata = i;
+			entry.m_lastdata = i;
+		}
+		while ((barindex < (int)m_barlines.size()) &&
+				(m_barlines[barindex]->getLineIndex() <= i)) {
+			measure = barindex++;
+		}
+		entry.m_measure = measure;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::updateTimeIndexesForInsert -- Add a line which has been
+//    inserted into the file at the given index to the timeline.  The line's
+//    timestamp should be set before it is inserted.  The timeline is
+//    cleared if the new line does not fit into the existing index, in
+//    which case it will be rebuilt when next needed.
+//
+
+void HumdrumFileBase::updateTimeIndexesForInsert(int index) {
+	m_metricgrids.clear();
+	if (m_timeline.empty()) {
+		return;
+	}
+	if (!m_lines[index]->m_rhythm_analyzed) {
+		// The line has no timestamp (such as a line inserted as a string).
+		clearTimeIndexes();
+		return;
+	}
+	HumNum timestamp = m_lines[index]->m_durationFromStart;
+	int64_t ticks = 0;
+	if (m_timelinetpq > 0) {
+		bool exact = false;
+		if (!getTimelineTicks(timestamp, ticks, exact) || !exact) {
+			clearTimeIndexes();
+			return;
+		}
+	}
+
+	// Move the following lines down by one:
+	for (int i=0; i<(int)m_timeline.size(); i++) {
+		HumTimelineEntry& entry = m_timeline[i];
+		if (entry.m_firstline >= index) {
+			entry.m_firstline++;
+		}
+		if (entry.m_lastline >= index) {
+			entry.m_lastline++;
+		}
+		if (entry.m_firstdata >= index) {
+			entry.m_firstdata++;
+		}
+		if (entry.m_lastdata >= index) {
+			entry.m_lastdata++;
+		}
+	}
+
+	// previous == entry containing the line before the new line.
+	int previous = -1;
+	if (index > 0) {
+		auto it = upper_bound(m_timeline.begin(), m_timeline.end(), index - 1,
+				[](int value, const HumTimelineEntry& entry) {
+					return value < entry.m_firstline;
+				});
+		previous = (int)(it - m_timeline.begin()) - 1;
+	}
+	// next == entry containing the line after the new line.
+	int next = previous + 1;
+	if ((previous >= 0) && (m_timeline[previous].m_lastline > index)) {
+		next = previous;
+	}
+
+	// target == entry which the new line is added to.
+	int target = -1;
+	if ((previous >= 0) &&
+			(compareTimelineTimes(timestamp, m_timeline[previous].m_timestamp) <= 0)) {
+		// A line which starts before the previous line is indexed
+		// with the previous line's time.
+		target = previous;
+		HumTimelineEntry& entry = m_timeline[target];
+		entry.m_lastline = std::max(entry.m_lastline, index);
+	} else if (next == previous) {
+		// The following lines in the entry would start before the new line.
+		clearTimeIndexes();
+		return;
+	} else if ((next < (int)m_timeline.size()) &&
+			(compareTimelineTimes(timestamp, m_timeline[next].m_timestamp) >= 0)) {
+		if (compareTimelineTimes(timestamp, m_timeline[next].m_timestamp) > 0) {
+			// The following lines would start before the new line.
+			clearTimeIndexes();
+			return;
+		}
+		target = next;
+		m_timeline[target].m_firstline = index;
+	} else {
+		target = next;
+		HumTimelineEntry newentry;
+		newentry.m_ticks = ticks;
+		newentry.m_timestamp = timestamp;
+		newentry.m_firstline = index;
+		newentry.m_lastline = index;
+		if (previous >= 0) {
+			newentry.m_lastdata = m_timeline[previous].m_lastdata;
+			newentry.m_measure = m_timeline[previous].m_measure;
+		}
+		m_timeline.insert(m_timeline.begin() + target, newentry);
+	}
+
+	if (!m_lines[index]->isData()) {
+		return;
+	}
+	HumTimelineEntry& entry = m_timeline[target];
+	if ((entry.m_firstdata < 0) || (entry.m_firstdata > index)) {
+		entry.m_firstdata = index;
+	}
+	// The new line is the last data line for following entries which
+	// have no data lines of their own:
+	for (int i=target; i<(int)m_timeline.size(); i++) {
+		if ((i > target) && (m_timeline[i].m_firstdata >= 0)) {
+			break;
+		}
+		if (m_timeline[i].m_lastdata < index) {
+			m_timeline[i].m_lastdata = index;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::updateTimeIndexesForDelete -- Remove a line from the
+//    timeline before it is deleted from the file.  The timeline is
+//    cleared if the index cannot be updated, in which case it will be
+//    rebuilt when next needed.
+//
+
+void HumdrumFileBase::updateTimeIndexesForDelete(int index) {
+	m_metricgrids.clear();
+	if (m_timeline.empty()) {
+		return;
+	}
+	HLp line = m_lines[index];
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		if (m_barlines[i] == line) {
+			// measure indexes will change
+			clearTimeIndexes();
+			return;
+		}
+	}
+
+	auto it = upper_bound(m_timeline.begin(), m_timeline.end(), index,
+			[](int value, const HumTimelineEntry& entry) {
+				return value < entry.m_firstline;
+			});
+	int target = (int)(it - m_timeline.begin()) - 1;
+	if (target < 0) {
+		clearTimeIndexes();
+		return;
+	}
+	HumTimelineEntry& entry = m_timeline[target];
+	bool removeQ = (entry.m_firstline == index) && (entry.m_lastline == index);
+	if ((entry.m_firstline == index) && !removeQ &&
+			(compareTimelineTimes(m_lines[index+1]->getDurationFromStart(),
+			entry.m_timestamp) != 0)) {
+		// The next line is indexed with the deleted line's time.
+		clearTimeIndexes();
+		return;
+	}
+
+	if (line->isData()) {
+		if (entry.m_firstdata == index) {
+			entry.m_firstdata = -1;
+			for (int i=index+1; i<=entry.m_lastline; i++) {
+				if (m_lines[i]->isData()) {
+					entry.m_firstdata = i;
+					break;
+				}
+			}
+		}
+		if (entry.m_lastdata == index) {
+			// The data line before the deleted one replaces it:
+			int lastdata = -1;
+			for (int i=index-1; i>=entry.m_firstline; i--) {
+				if (m_lines[i]->isData()) {
+					lastdata = i;
+					break;
+				}
+			}
+			if ((lastdata < 0) && (target > 0)) {
+				lastdata = m_timeline[target-1].m_lastdata;
+			}
+			for (int i=target; i<(int)m_timeline.size(); i++) {
+				if (m_timeline[i].m_lastdata != index) {
+					break;
+				}
+				m_timeline[i].m_lastdata = lastdata;
+			}
+		}
+	}
+
+	if (removeQ) {
+		m_timeline.erase(m_timeline.begin() + target);
+	} else if (entry.m_lastline == index) {
+		entry.m_lastline--;
+	}
+
+	// Move the following lines up by one:
+	for (int i=0; i<(int)m_timeline.size(); i++) {
+		HumTimelineEntry& tentry = m_timeline[i];
+		if (tentry.m_firstline > index) {
+			tentry.m_firstline--;
+		}
+		if (tentry.m_lastline > index) {
+			tentry.m_lastline--;
+		}
+		if (tentry.m_firstdata > index) {
+			tentry.m_firstdata--;
+		}
+		if (tentry.m_lastdata > index) {
+			tentry.m_lastdata--;
+		}
+	}
+	if (m_timeline.empty()) {
+		m_timelinetpq = 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::clearTimeIndexes -- Clear the timeline and the other
+//    analyses which index lines by time, so that they will be rebuilt
+//    when next needed.  Called when lines are added or removed, or when
+//    the rhythm is reanalyzed.
+//
+
+void HumdrumFileBase::clearTimeIndexes(void) {
+	m_timeline.clear();
+	m_metricgrids.clear();
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
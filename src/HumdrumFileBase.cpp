@@ -79,6 +79,7 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_strand2d.clear();
 	m_strophes1d.clear();
 	m_strophes2d.clear();
+	clearTimeIndexes();
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
@@ -117,6 +118,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_strand2d.clear();
 	m_strophes1d.clear();
 	m_strophes2d.clear();
+	clearTimeIndexes();
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
@@ -172,6 +174,7 @@ void HumdrumFileBase::clear(void) {
 	m_filename.clear();
 	m_segmentlevel = 0;
 	m_analyses.clear();
+	clearTimeIndexes();
 }
 
 
@@ -822,6 +825,69 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::getText -- Return the contents of the file as a single
+//     string, with a newline after each line.  The text is collected
+//     from the line strings into one buffer sized for the whole file.
+//
+
+string HumdrumFileBase::getText(void) {
+	size_t size = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		size += m_lines[i]->size() + 1;
+	}
+	string output;
+	output.reserve(size);
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		output += *m_lines[i];
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTextFromTokens -- Return the contents of the file
+//     as a single string, with each line generated from its tokens.  The
+//     output is the same as calling createLinesFromTokens() and then
+//     printing the file, but the line strings are not rebuilt, so the
+//     lines in the file are not changed.  Line strings are used to
+//     estimate the size of the buffer.
+//
+
+string HumdrumFileBase::getTextFromTokens(void) {
+	size_t size = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		size += m_lines[i]->size() + 1;
+	}
+	string output;
+	output.reserve(size + size / 8);
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->appendTextFromTokens(output);
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::printFromTokens -- Print the file with each line
+//     generated from its tokens (see getTextFromTokens()).
+//
+
+ostream& HumdrumFileBase::printFromTokens(ostream& out) {
+	string output = getTextFromTokens();
+	out.write(output.data(), output.size());
+	return out;
+}
+
+
+
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
@@ -831,12 +897,14 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 void HumdrumFileBase::appendLine(const string& line) {
 	HLp s = new HumdrumLine(line);
 	m_lines.push_back(s);
+	updateTimeIndexesForInsert((int)m_lines.size() - 1);
 }
 
 
 void HumdrumFileBase::appendLine(HLp line) {
 	// deletion will be handled by class.
 	m_lines.push_back(line);
+	updateTimeIndexesForInsert((int)m_lines.size() - 1);
 }
 
 
@@ -855,6 +923,7 @@ void HumdrumFileBase::insertLine(int index, const string& line) {
 	for (int i=index; i<(int)m_lines.size(); i++) {
 		m_lines[i]->setLineIndex(i);
 	}
+	updateTimeIndexesForInsert(index);
 }
 
 
@@ -866,6 +935,7 @@ void HumdrumFileBase::insertLine(int index, HLp line) {
 	for (int i=index; i<(int)m_lines.size(); i++) {
 		m_lines[i]->setLineIndex(i);
 	}
+	updateTimeIndexesForInsert(index);
 }
 
 
@@ -885,9 +955,11 @@ void HumdrumFileBase::deleteLine(int index) {
 	if (index < 0) {
 		return;
 	}
+	updateTimeIndexesForDelete(index);
 	delete m_lines[index];
 	for (int i=index+1; i<(int)m_lines.size(); i++) {
 		m_lines[i-1] = m_lines[i];
+		m_lines[i-1]->setLineIndex(i-1);
 	}
 	m_lines.resize(m_lines.size() - 1);
 }
@@ -1625,6 +1697,7 @@ bool HumdrumFileBase::stitchLinesTogether(HumdrumLine& previous,
 bool HumdrumFileBase::analyzeSpines(void) {
 	vector<string> datatype;
 	vector<string> sinfo;
+	vector<const string*> sinfoid;  // interned copies of sinfo
 	vector<vector<HTp> > lastspine;
 	m_trackstarts.resize(0);
 	m_trackends.resize(0);
@@ -1649,12 +1722,14 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			init = true;
 			datatype.resize(m_lines[i]->getTokenCount());
 			sinfo.resize(m_lines[i]->getTokenCount());
+			sinfoid.resize(m_lines[i]->getTokenCount());
 			lastspine.resize(m_lines[i]->getTokenCount());
 			for (j=0; j<m_lines[i]->getTokenCount(); j++) {
 				datatype[j] = m_lines[i]->getTokenString(j);
 				addToTrackStarts(m_lines[i]->token(j));
 				sinfo[j]    = to_string(j+1);
-				m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+				sinfoid[j]  = HumAddress::internSpineInfo(sinfo[j]);
+				m_lines[i]->token(j)->setSpineInfo(sinfoid[j]);
 				m_lines[i]->token(j)->setFieldIndex(j);
 				lastspine[j].push_back(m_lines[i]->token(j));
 			}
@@ -1672,13 +1747,17 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			return setParseError(err);
 		}
 		for (j=0; j<m_lines[i]->getTokenCount(); j++) {
-			m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+			m_lines[i]->token(j)->setSpineInfo(sinfoid[j]);
 			m_lines[i]->token(j)->setFieldIndex(j);
 		}
 		if (!m_lines[i]->isManipulator()) {
 			continue;
 		}
 		if (!adjustSpines(*m_lines[i], datatype, sinfo)) { return isValid(); }
+		sinfoid.resize(sinfo.size());
+		for (j=0; j<(int)sinfo.size(); j++) {
+			sinfoid[j] = HumAddress::internSpineInfo(sinfo[j]);
+		}
 	}
 	return isValid();
 }
@@ -2071,7 +2150,7 @@ bool HumdrumFileBase::processNonNullDataTokensForTrackForward(HTp starttoken,
 //    variable in HumdrumTokens)
 //
 
-void HumdrumFileBase::addUniqueTokens(vector<HTp>& target,
+void HumdrumFileBase::addUniqueTokens(HumTokenLinks& target,
 		vector<HTp>& source) {
 	int i, j;
 	bool found;
@@ -2301,9 +2380,8 @@ void HumdrumFileBase::fixMerges(int linei) {
 //
 
 ostream& operator<<(ostream& out, HumdrumFileBase& infile) {
-	for (int i=0; i<infile.getLineCount(); i++) {
-		out << infile[i] << '\n';
-	}
+	string output = infile.getText();
+	out.write(output.data(), output.size());
 	return out;
 }
 
@@ -2445,41 +2523,27 @@ std::string HumdrumFileBase::getReferenceRecord(const std::string& key) {
 //
 
 HLp HumdrumFileBase::insertNullDataLine(HumNum timestamp) {
-	// for now do a linear search for the insertion point, but later
-	// do something more efficient.
 	HumdrumFileBase& infile = *this;
-	HumNum beforet(-1);
-	HumNum aftert(-1);
-	int beforei = -1;
-	// int afteri = -1;
-	HumNum current;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		current = infile[i].getDurationFromStart();
-		if (current == timestamp) {
-			return &infile[i];
-		} else if (current < timestamp) {
-			beforet = current;
-			beforei = i;
-		} else if (current > timestamp) {
-			aftert = current;
-			// afteri = i;
-			break;
-		}
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return NULL;
 	}
-
+	const HumTimelineEntry& entry = m_timeline[index];
+	if (exact && (entry.m_firstdata >= 0)) {
+		return &infile[entry.m_firstdata];
+	}
+	int beforei = entry.m_lastdata;
 	if (beforei < 0) {
 		return NULL;
 	}
+	HumNum beforet = infile[beforei].getDurationFromStart();
 	HLp newline = new HumdrumLine;
 	// copyStructure will add null tokens automatically
 	newline->copyStructure(&infile[beforei], ".");
 
-	infile.insertLine(beforei+1, newline);
-
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum delta = timestamp - beforet;
 	HumNum durationFromStart = infile[beforei].getDurationFromStart() + delta;
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline() + delta;
@@ -2492,6 +2556,8 @@ HLp HumdrumFileBase::insertNullDataLine(HumNum timestamp) {
 	newline->m_duration = infile[beforei].m_duration - delta;
 	infile[beforei].m_duration = delta;
 
+	infile.insertLine(beforei+1, newline);
+
 	for (int i=0; i<infile[beforei].getFieldCount(); i++) {
 		HTp token = infile.token(beforei, i);
 		HTp newtoken = newline->token(i);
@@ -2513,32 +2579,8 @@ HLp HumdrumFileBase::insertNullDataLine(HumNum timestamp) {
 //
 
 HLp HumdrumFileBase::insertNullInterpretationLine(HumNum timestamp) {
-	// for now do a linear search for the insertion point, but later
-	// do something more efficient.
 	HumdrumFileBase& infile = *this;
-	HumNum beforet(-1);
-	HumNum aftert(-1);
-	int beforei = -1;
-	// int afteri = -1;
-	HumNum current;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		current = infile[i].getDurationFromStart();
-		if (current == timestamp) {
-			beforei = i;
-			break;
-		} else if (current < timestamp) {
-			beforet = current;
-			beforei = i;
-		} else if (current > timestamp) {
-			aftert = current;
-			// afteri = i;
-			break;
-		}
-	}
-
+	int beforei = getDataLineAtTime(timestamp);
 	if (beforei < 0) {
 		return NULL;
 	}
@@ -2551,15 +2593,8 @@ HLp HumdrumFileBase::insertNullInterpretationLine(HumNum timestamp) {
 
 	int targeti = target->getLineIndex();
 
-	// There will be problems with linking to previous line if it is
-	// a manipulator.
-	// infile.insertLine(targeti-1, newline);
-	infile.insertLine(targeti, newline);
-
-	// inserted line will increment beforei by one:
-	beforei++;
-
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum durationFromStart = infile[beforei].getDurationFromStart();
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline();
 	HumNum durationToBarline = infile[beforei].getDurationToBarline();
@@ -2570,6 +2605,11 @@ HLp HumdrumFileBase::insertNullInterpretationLine(HumNum timestamp) {
 
 	newline->m_duration = 0;
 
+	// There will be problems with linking to previous line if it is
+	// a manipulator.
+	// infile.insertLine(targeti-1, newline);
+	infile.insertLine(targeti, newline);
+
 	// Problems here if targeti line is a manipulator.
 	for (int i=0; i<infile[targeti].getFieldCount(); i++) {
 		HTp token = infile.token(targeti, i);
@@ -2605,15 +2645,10 @@ HLp HumdrumFileBase::insertNullInterpretationLineAboveIndex(int index) {
 
 	int targeti = target->getLineIndex();
 
-	// There will be problems with linking to previous line if it is
-	// a manipulator.
-	// infile.insertLine(targeti-1, newline);
-	infile.insertLine(targeti, newline);
-
-	// inserted line will increment insertion line by one:
-	int beforei = index + 1;
+	int beforei = index;
 
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum durationFromStart = infile[beforei].getDurationFromStart();
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline();
 	HumNum durationToBarline = infile[beforei].getDurationToBarline();
@@ -2624,6 +2659,11 @@ HLp HumdrumFileBase::insertNullInterpretationLineAboveIndex(int index) {
 
 	newline->m_duration = 0;
 
+	// There will be problems with linking to previous line if it is
+	// a manipulator.
+	// infile.insertLine(targeti-1, newline);
+	infile.insertLine(targeti, newline);
+
 	// Problems here if targeti line is a manipulator.
 	for (int i=0; i<infile[targeti].getFieldCount(); i++) {
 		HTp token = infile.token(targeti, i);
@@ -2645,29 +2685,8 @@ HLp HumdrumFileBase::insertNullInterpretationLineAboveIndex(int index) {
 //
 
 HLp HumdrumFileBase::insertNullInterpretationLineAbove(HumNum timestamp) {
-	// for now do a linear search for the insertion point, but later
-	// do something more efficient.
 	HumdrumFileBase& infile = *this;
-	HumNum beforet(-1);
-	HumNum aftert(-1);
-	int beforei = -1;
-	// int afteri = -1;
-	HumNum current;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		current = infile[i].getDurationFromStart();
-		if (current == timestamp) {
-			beforei = i;
-			break;
-		} else if (current < timestamp) {
-			beforet = current;
-			beforei = i;
-		} else if (current > timestamp) {
-			aftert = current;
-			// afteri = i;
-			break;
-		}
-	}
-
+	int beforei = getLineAtTime(timestamp);
 	if (beforei < 0) {
 		return NULL;
 	}
@@ -2680,15 +2699,8 @@ HLp HumdrumFileBase::insertNullInterpretationLineAbove(HumNum timestamp) {
 
 	int targeti = target->getLineIndex();
 
-	// There will be problems with linking to previous line if it is
-	// a manipulator.
-	// infile.insertLine(targeti-1, newline);
-	infile.insertLine(targeti, newline);
-
-	// inserted line will increment beforei by one:
-	beforei++;
-
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum durationFromStart = infile[beforei].getDurationFromStart();
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline();
 	HumNum durationToBarline = infile[beforei].getDurationToBarline();
@@ -2699,6 +2711,11 @@ HLp HumdrumFileBase::insertNullInterpretationLineAbove(HumNum timestamp) {
 
 	newline->m_duration = 0;
 
+	// There will be problems with linking to previous line if it is
+	// a manipulator.
+	// infile.insertLine(targeti-1, newline);
+	infile.insertLine(targeti, newline);
+
 	// Problems here if targeti line is a manipulator.
 	for (int i=0; i<infile[targeti].getFieldCount(); i++) {
 		HTp token = infile.token(targeti, i);
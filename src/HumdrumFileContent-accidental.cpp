@@ -36,6 +36,26 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 	// ottava marks must be analyzed first:
 	this->analyzeOttavas();
 
+	bool status = analyzeKernAccidentals(0);
+
+	// Indicate that the accidental analysis has been done:
+	this->setValue("auto", "accidentalAnalysis", "true");
+
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeKernAccidentals -- Identify accidentals in
+//    a single **kern track, or in all **kern tracks if onlytrack is 0.
+//    Only tokens in the given track are modified, so separate tracks can
+//    be analyzed at the same time (see analyzeAllContent()).  Ottavas
+//    must be analyzed before calling this function.
+//
+
+bool HumdrumFileContent::analyzeKernAccidentals(int onlytrack) {
 	HumdrumFileContent& infile = *this;
 	int i, j, k;
 	int kindex;
@@ -101,6 +121,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 				}
 				if (infile[i].token(j)->compare(0, 3, "*k[") == 0) {
 					track = infile[i].token(j)->getTrack();
+					if (onlytrack && (track != onlytrack)) {
+						continue;
+					}
 					kindex = rtracks[track];
 					fillKeySignature(keysigs[kindex], *infile[i].token(j));
 					// resetting key states of current measure.  What to do if this
@@ -121,6 +144,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 				}
 				std::fill(firstinbar.begin(), firstinbar.end(), 1);
 				track = infile[i].token(j)->getTrack();
+				if (onlytrack && (track != onlytrack)) {
+					continue;
+				}
 				kindex = rtracks[track];
 				// reset the accidental states in dstates to match keysigs.
 				resetDiatonicStatesWithKeySignature(dstates[kindex],
@@ -148,8 +174,11 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 				continue;
 			}
 
-			int subcount = infile[i].token(j)->getSubtokenCount();
 			track = infile[i].token(j)->getTrack();
+			if (onlytrack && (track != onlytrack)) {
+				continue;
+			}
+			int subcount = infile[i].token(j)->getSubtokenCount();
 
 			if (lasttrack != track) {
 				fill(concurrentstate.begin(), concurrentstate.end(), 0);
@@ -457,9 +486,6 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 		std::fill(firstinbar.begin(), firstinbar.end(), 0);
 	}
 
-	// Indicate that the accidental analysis has been done:
-	infile.setValue("auto", "accidentalAnalysis", "true");
-
 	return true;
 }
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Nov 28 21:19:11 PST 2016
-// Last Modified: Mon Nov 28 21:40:41 PST 2016
+// Last Modified: Fri Oct 16 22:49:48 UTC 2026
 // Filename:      HumdrumFileContent-metlev.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileContent-metlev.cpp
 // Syntax:        C++11; humlib
@@ -31,7 +31,7 @@ namespace hum {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::getMetricLevels -- Each line in the output
+// HumdrumFileContent::getMetricLevels -- Each line in the output
 //     vector matches to the line of the metric analysis data.
 //     undefined is the value to represent undefined analysis data
 //     (for non-data spines).
@@ -45,18 +45,71 @@ namespace hum {
 
 void HumdrumFileContent::getMetricLevels(vector<double>& output,
 		int track, double undefined) {
+	const vector<double>& levels = getMetricGrid(track).m_level;
+	output = levels;
+	if (!std::isnan(undefined)) {
+		for (int i=0; i<(int)output.size(); i++) {
+			if (std::isnan(output[i])) {
+				output[i] = undefined;
+			}
+		}
+	}
+}
 
-	HumdrumFileStructure& infile = *this;
-	int lineCount = infile.getLineCount();
-	output.resize(lineCount);
-	fill(output.begin(), output.end(), undefined);
-	vector<HTp> kernspines = infile.getKernSpineStartList();
-	if ((track == 0) && (kernspines.size() > 0)) {
-		track = kernspines[0]->getTrack();
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricGrid -- Return the metric analysis of
+//     each line in the file, using the time signatures of the given
+//     track (0 means the first **kern track, as in getMetricLevels()).
+//     The analysis is calculated the first time it is needed for a
+//     track, and then shared by all later calls until the lines or
+//     rhythm of the file change.
+//
+
+const HumMetricGrid& HumdrumFileContent::getMetricGrid(int track) {
+	if (track == 0) {
+		vector<HTp> kernspines = getKernSpineStartList();
+		if (kernspines.size() > 0) {
+			track = kernspines[0]->getTrack();
+		}
 	}
 	if (track == 0) {
 		track = 1;
 	}
+	auto it = m_metricgrids.find(track);
+	if (it != m_metricgrids.end()) {
+		return it->second;
+	}
+	// Fill the grid before storing it, since line access may trigger
+	// a rhythm analysis that clears the stored grids:
+	HumMetricGrid grid;
+	fillMetricGrid(grid, track);
+	HumMetricGrid& output = m_metricgrids[track];
+	output = std::move(grid);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::fillMetricGrid -- Calculate the metric analysis
+//     for the given track.  Beat levels are calculated from the position
+//     of each data line in its measure and the time signature in effect.
+//
+
+void HumdrumFileContent::fillMetricGrid(HumMetricGrid& grid, int track) {
+	HumdrumFileStructure& infile = *this;
+	int lineCount = infile.getLineCount();
+	grid.m_track = track;
+	grid.m_level.assign(lineCount, NAN);
+	grid.m_position.assign(lineCount, 0);
+	grid.m_beat.assign(lineCount, 0);
+	grid.m_measure.assign(lineCount, -1);
+	grid.m_metertop.assign(lineCount, 0);
+	grid.m_meterbottom.assign(lineCount, 0);
 
 	int top = 1;                // top number of time signature (0 for no meter)
 	int bot = 4;                // bottom number of time signature
@@ -66,6 +119,13 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 	HumNum combeatdur;          // for adjusting beat level in compound meters
 	HumNum commeasurepos;       // for adjusting beat level in compound meters
 
+	// Beat durations at each line, stored until the ticks per quarter
+	// note are known:
+	vector<HumNum> beatdurs(lineCount);
+	vector<int> dems;
+	dems.push_back(infile.tpq());
+
+	int measure = -1;
 	for (int i=0; i<lineCount; i++) {
 		if (infile[i].isInterpretation()) {
 			// check for time signature:
@@ -85,10 +145,20 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 					} else {
 						compoundQ = false;
 					}
+					dems.push_back(beatdur.getDenominator());
 					break;
 				}
 			}
 		}
+		while ((measure + 1 < (int)m_barlines.size()) &&
+				(m_barlines[measure + 1]->getLineIndex() <= i)) {
+			measure++;
+		}
+		grid.m_measure[i] = measure;
+		grid.m_metertop[i] = top;
+		grid.m_meterbottom[i] = bot;
+		beatdurs[i] = beatdur;
+
 		if (!infile[i].isData()) {
 				continue;
 		}
@@ -99,8 +169,8 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 		measurepos /= beatdur;
 		int denominator = measurepos.getDenominator();
 		if (compoundQ) {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(3.0));
-			if ((output[i] != 0.0) && (output[i] != 1.0)) {
+			grid.m_level[i] = Convert::nearIntQuantize(log(denominator) / log(3.0));
+			if ((grid.m_level[i] != 0.0) && (grid.m_level[i] != 1.0)) {
 				// if not the beat or first level, then calculate
 				// levels above level 1.  In 6/8 this means
 				// to move the 8th note level to be the "beat"
@@ -109,12 +179,20 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 				combeatdur.setValue(4,bot);
 				commeasurepos = infile[i].getDurationFromBarline() / combeatdur;
 				denominator = commeasurepos.getDenominator();
-				output[i] = 1.0 + log(denominator)/log(2.0);
+				grid.m_level[i] = 1.0 + log(denominator)/log(2.0);
 			}
 		} else {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(2.0));
+			grid.m_level[i] = Convert::nearIntQuantize(log(denominator) / log(2.0));
 		}
 	}
+
+	grid.m_tpq = Convert::getLcm(dems);
+	for (int i=0; i<lineCount; i++) {
+		HumNum position = infile[i].getDurationFromBarline() * grid.m_tpq;
+		HumNum beat = beatdurs[i] * grid.m_tpq;
+		grid.m_position[i] = position.getNumerator() / position.getDenominator();
+		grid.m_beat[i] = beat.getNumerator() / beat.getDenominator();
+	}
 }
 
 
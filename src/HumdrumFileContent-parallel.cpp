@@ -0,0 +1,177 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sat Oct 17 01:20:00 UTC 2026
+// Last Modified: Sat Oct 17 01:20:00 UTC 2026
+// Filename:      HumdrumFileContent-parallel.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileContent-parallel.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Run the content analyses of **kern spines in parallel.
+//
+
+#include "HumdrumFileContent.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeAllContent -- Analyze accidentals, slurs,
+//    phrases, ties, rest positions and stem lengths.  Each **kern track
+//    is a separate job, and jobs are taken by the worker threads as they
+//    become free.  A job runs the analyses for its track one after
+//    another, and only modifies tokens in that track.  Analyses which
+//    link tokens across tracks (ties and linked slurs/phrases) are done
+//    after the jobs have finished.  The results are the same as running
+//    each analysis separately.  A thread count of 0 uses one thread for
+//    each hardware thread.  Slurs, phrases and accidentals are skipped if
+//    they have already been analyzed.
+//
+
+bool HumdrumFileContent::analyzeAllContent(int threads) {
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	// Analyses done on demand by the jobs must be done before they start:
+	if (!isRhythmAnalyzed()) {
+		analyzeRhythmStructure();
+	}
+	resolveNullTokens();
+
+	bool slursQ = !m_analyses.m_slurs_analyzed;
+	bool phrasesQ = !m_analyses.m_phrases_analyzed;
+	bool accidentalsQ = !getValueBool("auto", "accidentalAnalysis");
+	m_analyses.m_slurs_analyzed = true;
+	m_analyses.m_phrases_analyzed = true;
+	if (accidentalsQ) {
+		analyzeOttavas();
+	}
+
+	vector<pair<HTp, HTp>> labels;
+	vector<int> endings;
+	if (slursQ || phrasesQ) {
+		getLabelSequence(labels, endings);
+	}
+	string linkSignifier = m_signifiers.getKernLinkSignifier();
+
+	vector<vector<int>> centerlines;
+	getBaselines(centerlines);
+
+	vector<HTp> kernstarts = getKernSpineStartList();
+	int jobcount = (int)kernstarts.size();
+	vector<int> jobindex(getMaxTrack() + 1, -1);
+	for (int i=0; i<jobcount; i++) {
+		jobindex[kernstarts[i]->getTrack()] = i;
+	}
+
+	// strands == the strands in each job, for stem-length analysis.
+	vector<vector<pair<HTp, HTp>>> strands(jobcount);
+	for (int i=0; i<getStrandCount(); i++) {
+		HTp sstart = getStrandStart(i);
+		if (!sstart->isKern()) {
+			continue;
+		}
+		strands[jobindex[sstart->getTrack()]].emplace_back(sstart, getStrandEnd(i));
+	}
+
+	// Linked slurs and phrases are collected for each job, then
+	// joined in spine order.
+	vector<vector<HTp>> slurstarts(jobcount);
+	vector<vector<HTp>> slurends(jobcount);
+	vector<vector<HTp>> phrasestarts(jobcount);
+	vector<vector<HTp>> phraseends(jobcount);
+	vector<char> status(jobcount, 1);
+
+	std::atomic<int> nextjob(0);
+	auto processJobs = [&]() {
+		int job;
+		while ((job = nextjob++) < jobcount) {
+			HTp kernstart = kernstarts[job];
+			bool output = true;
+			if (accidentalsQ) {
+				output &= analyzeKernAccidentals(kernstart->getTrack());
+			}
+			if (slursQ) {
+				output &= analyzeKernSlurs(kernstart, slurstarts[job],
+						slurends[job], labels, endings, linkSignifier);
+			}
+			if (phrasesQ) {
+				output &= analyzeKernPhrasings(kernstart, phrasestarts[job],
+						phraseends[job], labels, endings, linkSignifier);
+			}
+			assignImplicitVerticalRestPositions(kernstart);
+			for (int i=0; i<(int)strands[job].size(); i++) {
+				output &= analyzeKernStemLengths(strands[job][i].first,
+						strands[job][i].second, centerlines);
+			}
+			status[job] = output;
+		}
+	};
+
+	threads = std::min(threads, jobcount);
+	if (threads <= 1) {
+		processJobs();
+	} else {
+		vector<std::thread> workers;
+		for (int i=0; i<threads; i++) {
+			workers.emplace_back(processJobs);
+		}
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	bool output = true;
+	for (int i=0; i<jobcount; i++) {
+		output &= (bool)status[i];
+	}
+
+	if (slursQ) {
+		vector<HTp> linkstarts;
+		vector<HTp> linkends;
+		for (int i=0; i<jobcount; i++) {
+			linkstarts.insert(linkstarts.end(), slurstarts[i].begin(), slurstarts[i].end());
+			linkends.insert(linkends.end(), slurends[i].begin(), slurends[i].end());
+		}
+		createLinkedSlurs(linkstarts, linkends);
+		output &= analyzeMensSlurs();
+	}
+	if (phrasesQ) {
+		vector<HTp> linkstarts;
+		vector<HTp> linkends;
+		for (int i=0; i<jobcount; i++) {
+			linkstarts.insert(linkstarts.end(), phrasestarts[i].begin(), phrasestarts[i].end());
+			linkends.insert(linkends.end(), phraseends[i].begin(), phraseends[i].end());
+		}
+		createLinkedPhrasings(linkstarts, linkends);
+	}
+	if (accidentalsQ) {
+		setValue("auto", "accidentalAnalysis", "true");
+	}
+	output &= analyzeKernTies();
+	checkForExplicitVerticalRestPositions();
+
+	return output;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
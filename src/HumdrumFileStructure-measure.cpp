@@ -0,0 +1,119 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 23:40:00 UTC 2026
+// Last Modified: Fri Oct 16 23:40:00 UTC 2026
+// Filename:      HumdrumFileStructure-measure.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileStructure-measure.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Functions for accessing measures.
+//
+
+#include "HumdrumFileStructure.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getMeasure -- Return a description of the
+//    measure starting at the given barline index.  Negative index
+//    accesses from the end of the list.  Returns an empty description
+//    (with m_index set to -1) if the index is out of range.
+//
+
+HumMeasureInfo HumdrumFileStructure::getMeasure(int index) const {
+	HumMeasureInfo output;
+	if (index < 0) {
+		index += (int)m_barlines.size();
+	}
+	if ((index < 0) || (index >= (int)m_barlines.size())) {
+		return output;
+	}
+
+	HLp startline = m_barlines[index];
+	HLp nextbar = NULL;
+	if (index + 1 < (int)m_barlines.size()) {
+		nextbar = m_barlines[index+1];
+	}
+
+	output.m_index = index;
+	output.m_startline = startline->getLineIndex();
+	if (nextbar) {
+		output.m_endline = nextbar->getLineIndex() - 1;
+	} else {
+		output.m_endline = getLineCount() - 1;
+	}
+	output.m_durationFromStart = startline->getDurationFromStart();
+	if (nextbar) {
+		output.m_duration = nextbar->getDurationFromStart() - output.m_durationFromStart;
+	} else {
+		output.m_duration = getScoreDuration() - output.m_durationFromStart;
+	}
+
+	if (startline->isBarline() && (startline->getFieldCount() > 0)) {
+		output.m_barline = startline->token(0);
+		output.m_number = startline->getBarNumber();
+		const string& bar = *output.m_barline;
+		output.m_repeatstart = (bar.find("|:") != string::npos) ||
+				(bar.find("!:") != string::npos);
+	}
+	if (nextbar && nextbar->isBarline() && (nextbar->getFieldCount() > 0)) {
+		const string& bar = *nextbar->token(0);
+		output.m_repeatend = (bar.find(":|") != string::npos) ||
+				(bar.find(":!") != string::npos);
+	}
+
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getMeasures -- Return a description of every
+//    measure in the file.
+//
+
+vector<HumMeasureInfo> HumdrumFileStructure::getMeasures(void) const {
+	vector<HumMeasureInfo> output(m_barlines.size());
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		output[i] = getMeasure(i);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getMeasureIndex -- Return the index of the
+//    measure which contains the given line.  Returns -1 if the line
+//    is before the first measure or is not a line in the file.
+//
+
+int HumdrumFileStructure::getMeasureIndex(int lineindex) const {
+	if ((lineindex < 0) || (lineindex >= getLineCount())) {
+		return -1;
+	}
+	auto it = upper_bound(m_barlines.begin(), m_barlines.end(), lineindex,
+			[](int value, HLp line) {
+				return value < line->getLineIndex();
+			});
+	return (int)(it - m_barlines.begin()) - 1;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
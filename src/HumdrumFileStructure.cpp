@@ -214,6 +214,49 @@ bool HumdrumFileStructure::analyzeStructure(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeStructureFromTokens -- Analyze content
+//    which was built or edited at the token level (such as the output of
+//    HumGrid::transferTokens()) without printing and reparsing it.  Line
+//    text is regenerated from the tokens, and a line is only re-tokenized
+//    when a reparse would split its tokens differently.
+//
+
+bool HumdrumFileStructure::analyzeStructureFromTokens(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		line.setOwner(this);
+		line.createLineFromTokens();
+		bool retokenize = (line.getTokenCount() > 1) && (line.compare(0, 2, "!!") == 0);
+		for (int j=0; j<line.getTokenCount(); j++) {
+			line.token(j)->setOwner(&line);
+			if (line.token(j)->find('\t') != string::npos) {
+				retokenize = true;
+			}
+		}
+		if (retokenize) {
+			line.createTokensFromLine();
+		}
+	}
+
+	m_barlines.clear();
+	m_ticksperquarternote = -1;
+	m_strand1d.clear();
+	m_strand2d.clear();
+	m_strophes1d.clear();
+	m_strophes2d.clear();
+	m_analyses.clear();
+
+	m_displayError = false;
+	if (!analyzeBaseFromTokens()) {
+		return isValid();
+	}
+	return analyzeStructure();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze global/local
@@ -241,6 +284,8 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 
 bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 	m_analyses.m_rhythm_analyzed = true;
+	// line timestamps will change, so rebuild timeline when needed:
+	clearTimeIndexes();
 	setLineRhythmAnalyzed();
 	if (!isStructureAnalyzed()) {
 		if (!analyzeStructureNoRhythm()) { return isValid(); }
@@ -609,44 +654,8 @@ bool HumdrumFileStructure::analyzeRhythm(void) {
 	if (getMaxTrack() == 0) {
 		return true;
 	}
-	int startline = getTrackStart(1)->getLineIndex();
-	int testline;
-	HumNum zero(0);
-
-	int i;
-	for (int i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
-			continue;
-		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline == startline) {
-			if (!assignDurationsToTrack(getTrackStart(i), zero)) {
-				return false;
-			}
-		} else {
-			// Spine does not start at beginning of data, so
-			// the starting position of the spine has to be
-			// determined before continuing.  Search for a token
-			// which is on a line with assigned duration, then work
-			// outwards from that position.
-			continue;
-		}
-	}
-
-	// Go back and analyze spines that do not start at the
-	// beginning of the data stream.
-	for (i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
-			continue;
-		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline > startline) {
-			if (!analyzeRhythmOfFloatingSpine(getTrackStart(i))) { return false; }
-		}
-	}
 
+	if (!assignDurationsFromStart()) { return false; }
 	if (!analyzeNullLineRhythms()) { return false; }
 	fillInNegativeStartTimes();
 	assignLineDurations();
@@ -999,81 +1008,133 @@ bool HumdrumFileStructure::decrementDurStates(vector<HumNum>& durs,
 
 //////////////////////////////
 //
-// HumdrumFileStructure::assignDurationsToTrack -- Assign duration from starts
-//    for each rhythmic spine in the file.  Analysis is done recursively, one
-//    sub-spine at a time.  Duplicate analyses are prevented by the state
-//    variable in the HumdrumToken (currently called rhycheck because it is only
-//    used in this function).  After the durationFromStarts have been assigned
-//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
-//    done elsewhere.
-//
-
-bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
-		HumNum startdur) {
-	if (!starttoken->hasRhythm()) {
-		return isValid();
-	}
-	int state = starttoken->getState();
-	if (!prepareDurations(starttoken, state, startdur)) {
-		return isValid();
-	}
-	return isValid();
-}
-
-
-
-//////////////////////////////
-//
-// HumdrumFileStructure::prepareDurations -- Helper function for
-//     HumdrumFileStructure::assignDurationsToTrack() which does all of the
-//     work for assigning durationFromStart values.
-//
-
-bool HumdrumFileStructure::prepareDurations(HTp token, int state,
-		HumNum startdur) {
-	if (state != token->getState()) {
-		return isValid();
-	}
-
-	HumNum dursum = startdur;
-	token->incrementState();
-
-	if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-	if (token->getDuration().isPositive()) {
-		dursum += token->getDuration();
-	}
-	int tcount = token->getNextTokenCount();
-
-	vector<HTp> reservoir;
-	vector<HumNum> startdurs;
+// HumdrumFileStructure::assignDurationsFromStart -- Assign the
+//    durationFromStart of lines from the rhythms of the tokens in the
+//    rhythmic spines.  The file is processed once from top to bottom:
+//    the start of each token is the end of the token before it in the
+//    spine (the leftmost rhythmic one after a merge), and the end times
+//    of the tokens on the last line with spines are kept in a state array.
+//    Spines which start after the beginning of the data (after *+) are
+//    timed relative to their start until one of their notes is on a line
+//    which has a known time, and then their earlier notes are placed in
+//    the score.  After the durationFromStarts have been assigned, the
+//    rhythmic analysis of non-data tokens and non-rhythmic spines is done
+//    elsewhere.
+//
+
+bool HumdrumFileStructure::assignDurationsFromStart(void) {
+	// state == end times of the tokens on the previous line with spines.
+	// group == 0 for times from the start of the score, -1 for tokens
+	// in non-rhythmic spines, or the index of a floating spine for
+	// times which are relative to the start of the floating spine.
+	vector<HumNum> laststate;
+	vector<int>    lastgroup;
+	vector<HumNum> state;
+	vector<int>    group;
+
+	// floatstart == start time of each floating spine in the score, or
+	// negative if not known yet.  floattokens == tokens in the floating
+	// spine which are waiting for its start time.
+	vector<HumNum> floatstart(1, 0);
+	vector<vector<pair<HTp, HumNum>>> floattokens(1);
+
+	bool firstline = true;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (!line.hasSpines()) {
+			continue;
+		}
+		int fieldcount = line.getFieldCount();
+		state.assign(fieldcount, HumNum(-1));
+		group.assign(fieldcount, -1);
+
+		for (int j=0; j<fieldcount; j++) {
+			HTp token = line.token(j);
+			int pcount = token->getPreviousTokenCount();
+			if (pcount == 0) {
+				if (!token->hasRhythm()) {
+					continue;
+				}
+				state[j] = 0;
+				if (firstline) {
+					group[j] = 0;
+				} else {
+					group[j] = (int)floatstart.size();
+					floatstart.push_back(-1);
+					floattokens.resize(floattokens.size() + 1);
+				}
+				continue;
+			}
+			for (int k=0; k<pcount; k++) {
+				int index = token->getPreviousToken(k)->getFieldIndex();
+				if ((index < (int)lastgroup.size()) && (lastgroup[index] >= 0)) {
+					state[j] = laststate[index];
+					group[j] = lastgroup[index];
+					break;
+				}
+			}
+			if ((group[j] > 0) && floatstart[group[j]].isNonNegative()) {
+				state[j] += floatstart[group[j]];
+				group[j] = 0;
+			}
+		}
 
-	// Assign line durationFromStarts for primary track first.
-	while (tcount > 0) {
-		for (int t=1; t<tcount; t++) {
-			reservoir.push_back(token->getNextToken(t));
-			startdurs.push_back(dursum);
+		// Tokens with times from the start of the score set the line time:
+		for (int j=0; j<fieldcount; j++) {
+			if (group[j] == 0) {
+				if (!setLineDurationFromStart(line.token(j), state[j])) { return isValid(); }
+			}
 		}
-		token = token->getNextToken(0);
-		if (state != token->getState()) {
-			break;
+
+		// Place floating spines which have a note on a line with a known time:
+		HumNum linestart = line.getDurationFromStart();
+		for (int j=0; j<fieldcount; j++) {
+			if (group[j] <= 0) {
+				continue;
+			}
+			HTp token = line.token(j);
+			bool timedQ = token->isTerminateInterpretation() ||
+					!token->getDuration().isNegative();
+			if (timedQ && linestart.isNonNegative() &&
+					floatstart[group[j]].isNegative()) {
+				HumNum offset = linestart - state[j];
+				floatstart[group[j]] = offset;
+				vector<pair<HTp, HumNum>>& waiting = floattokens[group[j]];
+				for (int k=0; k<(int)waiting.size(); k++) {
+					if (!setLineDurationFromStart(waiting[k].first, waiting[k].second + offset)) {
+						return isValid();
+					}
+				}
+				waiting.clear();
+			}
+			if (floatstart[group[j]].isNonNegative()) {
+				state[j] += floatstart[group[j]];
+				group[j] = 0;
+				if (!setLineDurationFromStart(token, state[j])) { return isValid(); }
+			} else if (timedQ) {
+				floattokens[group[j]].emplace_back(token, state[j]);
+			}
 		}
-		token->incrementState();
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-		if (token->getDuration().isPositive()) {
-			dursum += token->getDuration();
+
+		for (int j=0; j<fieldcount; j++) {
+			if (group[j] < 0) {
+				continue;
+			}
+			HumNum duration = line.token(j)->getDuration();
+			if (duration.isPositive()) {
+				state[j] += duration;
+			}
 		}
-		tcount = token->getNextTokenCount();
-	}
 
-	if ((tcount == 0) && (token->isTerminateInterpretation())) {
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
+		laststate.swap(state);
+		lastgroup.swap(group);
+		firstline = false;
 	}
 
-	// Process secondary tracks next:
-	int newstate = state;
-
-	for (int i=(int)reservoir.size()-1; i>=0; i--) {
-		prepareDurations(reservoir[i], newstate, startdurs[i]);
+	for (int i=1; i<(int)floatstart.size(); i++) {
+		if (floatstart[i].isNegative()) {
+			return setParseError("Error cannot link floating spine to score.");
+		}
 	}
 
 	return isValid();
@@ -1112,54 +1173,6 @@ bool HumdrumFileStructure::setLineDurationFromStart(HTp token,
 
 
 
-//////////////////////////////
-//
-// HumdrumFileStructure::analyzeRhythmOfFloatingSpine --  This analysis
-//    function is used to analyze the rhythm of spines which do not start at
-//    the beginning of the data.  The function searches for the first line
-//    which has an assigned durationFromStart value, and then uses that
-//    as the basis for assigning the initial durationFromStart position
-//    for the spine.
-//
-
-bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
-		HTp spinestart) {
-	HumNum dursum = 0;
-	HumNum founddur = 0;
-	HTp token = spinestart;
-	int tcount = token->getNextTokenCount();
-
-	// Find a known durationFromStart for a line in the Humdrum file, then
-	// use that to calculate the starting duration of the floating spine.
-	if (token->getDurationFromStart().isNonNegative()) {
-		founddur = token->getLine()->getDurationFromStart();
-	} else {
-		tcount = token->getNextTokenCount();
-		while (tcount > 0) {
-			if (token->getDurationFromStart().isNonNegative()) {
-				founddur = token->getLine()->getDurationFromStart();
-				break;
-			}
-			if (token->getDuration().isPositive()) {
-				dursum += token->getDuration();
-			}
-			token = token->getNextToken(0);
-		}
-	}
-
-	if (founddur.isZero()) {
-		return setParseError("Error cannot link floating spine to score.");
-	}
-
-	if (!assignDurationsToTrack(spinestart, founddur - dursum)) {
-		return isValid();
-	}
-
-	return isValid();
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeNullLineRhythms -- When a series of null-token
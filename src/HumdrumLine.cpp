@@ -1335,27 +1335,52 @@ int HumdrumLine::createTokensFromLine(void) {
 
 void HumdrumLine::createLineFromTokens(void) {
 	string& iline = *this;
-	iline = "";
 	// needed for empty lines for some reason:
 	if (m_tokens.size()) {
 		if (m_tokens.back() == NULL) {
 			m_tokens.resize(m_tokens.size() - 1);
 		}
 	}
-	for (int i=0; i<(int)m_tokens.size(); i++) {
-		iline += (string)(*m_tokens.at(i));
-		if (i < (int)m_tokens.size() - 1) {
-			if ((int)m_tabs.size() <= i) {
-				for (int j=0; j<(int)m_tokens.size() - (int)m_tabs.size(); j++) {
-					m_tabs.push_back(1);
-				}
-			}
-			if (m_tabs.at(i) == 0) {
-				m_tabs.at(i) = 1;
-			}
-			for (int j=0; j<m_tabs.at(i); j++) {
-				iline += '\t';
-			}
+	if ((int)m_tabs.size() < (int)m_tokens.size()) {
+		m_tabs.resize(m_tokens.size(), 1);
+	}
+	for (int i=0; i<(int)m_tabs.size(); i++) {
+		if (m_tabs[i] == 0) {
+			m_tabs[i] = 1;
+		}
+	}
+	iline.clear();
+	appendTextFromTokens(iline);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::appendTextFromTokens -- Append the text of the line,
+//     generated from its tokens separated by tabs, to the output
+//     string.  This is the same text as createLineFromTokens() would
+//     store in the line, but the line is not changed, so files can be
+//     printed after editing tokens without rebuilding each line string
+//     first.  Lines without tokens append the line string.
+//
+
+void HumdrumLine::appendTextFromTokens(string& output) {
+	int count = (int)m_tokens.size();
+	if (count && (m_tokens.back() == NULL)) {
+		count--;
+	}
+	if (count == 0) {
+		if (m_tokens.empty()) {
+			output += *this;
+		}
+		return;
+	}
+	for (int i=0; i<count; i++) {
+		output += *m_tokens[i];
+		if (i < count - 1) {
+			int tabs = (i < (int)m_tabs.size()) ? m_tabs[i] : 1;
+			output.append(tabs > 0 ? tabs : 1, '\t');
 		}
 	}
 }
@@ -2239,12 +2264,12 @@ void HumdrumLine::clearTokenLinkInfo(void) {
 //
 
 ostream& operator<<(ostream& out, HumdrumLine& line) {
-	out << (string)line;
+	out << static_cast<const string&>(line);
 	return out;
 }
 
 ostream& operator<< (ostream& out, HLp line) {
-	out << (string)(*line);
+	out << static_cast<const string&>(*line);
 	return out;
 }
 
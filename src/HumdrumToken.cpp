@@ -47,7 +47,6 @@ namespace hum {
 //
 
 HumdrumToken::HumdrumToken(void) : string() {
-	m_rhycheck = 0;
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
@@ -56,7 +55,6 @@ HumdrumToken::HumdrumToken(void) : string() {
 
 
 HumdrumToken::HumdrumToken(const string& aString) : string(aString) {
-	m_rhycheck = 0;
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
@@ -65,7 +63,6 @@ HumdrumToken::HumdrumToken(const string& aString) : string(aString) {
 
 
 HumdrumToken::HumdrumToken(const char* aString) : string(aString) {
-	m_rhycheck = 0;
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
@@ -82,7 +79,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -99,7 +95,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -117,7 +112,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token, HLp owner) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -134,7 +128,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token, HLp owner) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -162,7 +155,6 @@ HumdrumToken& HumdrumToken::operator=(HumdrumToken& token) {
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -181,7 +173,6 @@ HumdrumToken& HumdrumToken::operator=(const string& token) {
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -200,7 +191,6 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -440,6 +430,14 @@ void HumdrumToken::setSpineInfo(const string& spineinfo) {
 	m_address.setSpineInfo(spineinfo);
 }
 
+//
+// Interned string version (see HumAddress::internSpineInfo()):
+//
+
+void HumdrumToken::setSpineInfo(const string* spineinfo) {
+	m_address.setSpineInfo(spineinfo);
+}
+
 
 
 //////////////////////////////
@@ -3001,17 +2999,6 @@ HLp HumdrumToken::getOwner(void) const {
 
 
 
-//////////////////////////////
-//
-// HumdrumToken::getState -- Returns the rhythm state variable.
-//
-
-int HumdrumToken::getState(void) const {
-	return m_rhycheck;
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumToken::getStrandIndex -- Returns the 1-D strand index
@@ -3111,19 +3098,6 @@ void  HumdrumToken::setStrandIndex(int index) {
 
 
 
-//////////////////////////////
-//
-// HumdrumToken::incrementState -- update the rhythm analysis state variable.
-//    This will prevent redundant recursive analysis in analyzeRhythm of
-//    the HumdrumFileStructure class.
-//
-
-void HumdrumToken::incrementState(void) {
-	m_rhycheck++;
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumToken::getNextTokenCount -- Returns the number of tokens in the
@@ -3784,6 +3758,115 @@ string HumdrumToken::getStropheLabel(void) {
 
 
 
+//////////////////////////////
+//
+// HumTokenLinks::HumTokenLinks -- Copy constructor.
+//
+
+HumTokenLinks::HumTokenLinks(const HumTokenLinks& links) {
+	*this = links;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::~HumTokenLinks -- Deconstructor.
+//
+
+HumTokenLinks::~HumTokenLinks() {
+	if (m_capacity) {
+		delete [] m_many;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::operator= -- Copy the links from another list.
+//
+
+HumTokenLinks& HumTokenLinks::operator=(const HumTokenLinks& links) {
+	if (this == &links) {
+		return *this;
+	}
+	m_size = 0;
+	if (links.m_size > 1) {
+		reserve(links.m_size);
+	}
+	for (int i=0; i<links.m_size; i++) {
+		(*this)[i] = links[i];
+	}
+	m_size = links.m_size;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::resize -- Change the number of links.  New links are
+//     set to NULL.
+//
+
+void HumTokenLinks::resize(int size) {
+	if (size < 0) {
+		size = 0;
+	}
+	if (size > 1) {
+		reserve(size);
+	}
+	for (int i=m_size; i<size; i++) {
+		(*this)[i] = NULL;
+	}
+	m_size = size;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::push_back -- Add a link to the end of the list.
+//
+
+void HumTokenLinks::push_back(HTp token) {
+	if (m_size >= 1) {
+		reserve(m_size + 1);
+	}
+	(*this)[m_size] = token;
+	m_size++;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::reserve -- Move the links into an array that can
+//     hold at least the given number of links.
+//
+
+void HumTokenLinks::reserve(int capacity) {
+	if ((capacity <= 1) || (capacity <= m_capacity)) {
+		return;
+	}
+	int newcapacity = m_capacity ? m_capacity * 2 : 2;
+	if (newcapacity < capacity) {
+		newcapacity = capacity;
+	}
+	HTp* newlinks = new HTp[newcapacity];
+	for (int i=0; i<m_size; i++) {
+		newlinks[i] = (*this)[i];
+	}
+	if (m_capacity) {
+		delete [] m_many;
+	}
+	m_many = newlinks;
+	m_capacity = newcapacity;
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
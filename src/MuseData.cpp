@@ -402,6 +402,64 @@ int MuseData::read(istream& input) {
 		}
 	}
 
+	return finishRead();
+}
+
+
+
+//////////////////////////////
+//
+// MuseData::read -- read a MuseData file from a range of lines which
+//   have already been split by getline() (such as a part segment found
+//   by MuseDataSet::read).  The lines are released after they are stored
+//   so that the full set of lines and the records are not both kept in
+//   memory.  Carriage returns are treated in the same way as when reading
+//   from an input stream.
+//
+
+int MuseData::read(vector<string>& lines, int startindex, int stopindex) {
+	m_error.clear();
+	if (stopindex >= (int)lines.size()) {
+		stopindex = (int)lines.size() - 1;
+	}
+	if (startindex < 0) {
+		startindex = 0;
+	}
+	if (stopindex >= startindex) {
+		m_data.reserve(m_data.size() + stopindex - startindex + 1);
+	}
+	string dataline;
+	for (int i=startindex; i<=stopindex; i++) {
+		string& line = lines[i];
+		size_t start = 0;
+		size_t cr = line.find((char)0x0d);
+		while (cr != string::npos) {
+			dataline.assign(line, start, cr - start);
+			MuseData::append(dataline);
+			start = cr + 1;
+			cr = line.find((char)0x0d, start);
+		}
+		if (start == 0) {
+			MuseData::append(line);
+		} else if (start < line.size()) {
+			dataline.assign(line, start, string::npos);
+			MuseData::append(dataline);
+		}
+		string().swap(line);
+	}
+
+	return finishRead();
+}
+
+
+
+//////////////////////////////
+//
+// MuseData::finishRead -- Number the lines and analyze the data after
+//    it has been read.
+//
+
+int MuseData::finishRead(void) {
 	for (int i=0; i<(int)m_data.size(); i++) {
 		m_data[i]->setLineIndex(i);
 	}
@@ -133,17 +133,13 @@ int MuseDataSet::read(istream& infile) {
 	vector<int> stopindex;
 	analyzePartSegments(startindex, stopindex, datalines);
 
-	stringstream *sstream;
+	// Parts are parsed directly from the lines, which are released as each
+	// part is stored.
 	MuseData* md;
 	for (int i=0; i<(int)startindex.size(); i++) {
-		sstream = new stringstream;
-		for (int j=startindex[i]; j<=stopindex[i]; j++) {
-			 (*sstream) << datalines[j] << '\n';
-		}
 		md = new MuseData;
-		md->read(*sstream);
+		md->read(datalines, startindex[i], stopindex[i]);
 		appendPart(md);
-		delete sstream;
 	}
 	return 1;
 }
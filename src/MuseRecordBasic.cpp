@@ -142,6 +142,15 @@ int MuseRecordBasic::isEmpty(void) {
 string MuseRecordBasic::extract(int start, int end) {
 	string output;
 	int count = end - start + 1;
+	int length = getLength();
+	if ((start >= 1) && (count > 0) && (length <= 180)) {
+		// copy the stored columns in one step and pad with spaces:
+		if (start <= length) {
+			output.assign(m_recordString, start - 1, count);
+		}
+		output.resize(count, ' ');
+		return output;
+	}
 	for (int i=0; i<count; i++) {
 		if (i+start <= getLength()) {
 			output += getColumn(i+start);
@@ -194,6 +203,11 @@ string MuseRecordBasic::getColumns(int startcol, int endcol) {
 	if (charcount <= 0) {
 		return output;
 	}
+	if ((startcol >= 1) && (endcol <= 180)) {
+		getColumn(endcol); // pad the record to endcol if necessary
+		output.assign(m_recordString, startcol - 1, charcount);
+		return output;
+	}
 	for (int i=startcol; i<=endcol; i++) {
 		output += getColumn(i);
 	}
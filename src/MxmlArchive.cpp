@@ -0,0 +1,745 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 22:31:40 UTC 2026
+// Last Modified: Fri Oct 16 22:31:40 UTC 2026
+// Filename:      MxmlArchive.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/MxmlArchive.cpp
+// Syntax:        C++11; humlib
+// vim:           ts=3 noexpandtab
+//
+// Description:   Reader for compressed MusicXML (.mxl) files, which are
+//                ZIP archives containing the MusicXML score and a
+//                META-INF/container.xml file that names it.  Files are
+//                extracted into memory; stored and deflated entries are
+//                supported (ZIP64 and encrypted archives are not).
+//
+// container.xml documentation:
+//    https://www.w3.org/2021/06/musicxml40/container-reference/
+//
+
+#include "MxmlArchive.h"
+
+#include "pugiconfig.hpp"
+#include "pugixml.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+using namespace pugi;
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+//////////////////////////////
+//
+// MxmlArchive::MxmlArchive -- Constructor.
+//
+
+MxmlArchive::MxmlArchive(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::clear -- Remove the archive contents.
+//
+
+void MxmlArchive::clear(void) {
+	m_data.clear();
+	m_entries.clear();
+	m_error.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::read -- Read an archive from a file or an input stream.
+//     Returns false if the input is not a readable ZIP archive.
+//
+
+bool MxmlArchive::read(const string& filename) {
+	clear();
+	ifstream input(filename.c_str(), ios::binary);
+	if (!input.is_open()) {
+		return setError("Cannot open file " + filename);
+	}
+	return read(input);
+}
+
+
+bool MxmlArchive::read(istream& input) {
+	clear();
+	m_data.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	return readDirectory();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::readBuffer -- Read an archive from memory.  The data
+//     is copied.
+//
+
+bool MxmlArchive::readBuffer(const char* data, size_t size) {
+	clear();
+	m_data.assign(data, data + size);
+	return readDirectory();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::isArchive -- Returns true if the data starts with
+//     a ZIP local file header.
+//
+
+bool MxmlArchive::isArchive(const char* data, size_t size) {
+	if (size < 4) {
+		return false;
+	}
+	return (data[0] == 'P') && (data[1] == 'K') && (data[2] == 3) && (data[3] == 4);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getFileCount -- Return the number of entries in the
+//     archive (including directories).
+//
+
+int MxmlArchive::getFileCount(void) const {
+	return (int)m_entries.size();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getFilename -- Return the name of an archive entry.
+//
+
+string MxmlArchive::getFilename(int index) const {
+	if ((index < 0) || (index >= (int)m_entries.size())) {
+		return "";
+	}
+	return m_entries[index].name;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getFile -- Extract the contents of an archive entry.
+//     Returns false if the entry does not exist or cannot be decoded.
+//
+
+bool MxmlArchive::getFile(const string& name, vector<char>& data) {
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		if (m_entries[i].name == name) {
+			return getFile(i, data);
+		}
+	}
+	data.clear();
+	return setError("Cannot find " + name + " in archive");
+}
+
+
+bool MxmlArchive::getFile(int index, vector<char>& data) {
+	data.clear();
+	if ((index < 0) || (index >= (int)m_entries.size())) {
+		return setError("Invalid archive entry");
+	}
+	MxmlArchiveEntry& entry = m_entries[index];
+	if (entry.flags & 0x01) {
+		return setError("Cannot read encrypted file " + entry.name);
+	}
+	size_t offset = entry.offset;
+	if ((offset + 30 > m_data.size()) || (getUint32(offset) != 0x04034b50)) {
+		return setError("Invalid local header for " + entry.name);
+	}
+	offset += 30 + getUint16(offset + 26) + getUint16(offset + 28);
+	if ((offset > m_data.size()) || (entry.compressed > m_data.size() - offset)) {
+		return setError("Truncated data for " + entry.name);
+	}
+	const char* contents = m_data.data() + offset;
+
+	if (entry.method == 0) {
+		data.assign(contents, contents + entry.compressed);
+	} else if (entry.method == 8) {
+		// The uncompressed size in the header is only trusted as far as
+		// 32 times the compressed size for the first allocation (the
+		// output can still grow past this), and as a hard output limit.
+		data.reserve(std::min((size_t)entry.size, (size_t)entry.compressed * 32));
+		if (!inflate((const unsigned char*)contents, entry.compressed, data,
+				entry.size)) {
+			data.clear();
+			return setError("Cannot decompress " + entry.name);
+		}
+	} else {
+		return setError("Unsupported compression method for " + entry.name);
+	}
+
+	if ((data.size() != entry.size) ||
+			(calculateCrc(data.data(), data.size()) != entry.crc)) {
+		data.clear();
+		return setError("Checksum error for " + entry.name);
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getRootFilename -- Return the name of the MusicXML score
+//     in the archive, given by the first rootfile element in
+//     META-INF/container.xml.  If there is no container file, the first
+//     .xml or .musicxml file outside of META-INF is used.
+//
+
+string MxmlArchive::getRootFilename(void) {
+	vector<char> container;
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		if (m_entries[i].name != "META-INF/container.xml") {
+			continue;
+		}
+		if (!getFile(i, container)) {
+			return "";
+		}
+		xml_document doc;
+		auto result = doc.load_buffer_inplace(container.data(),
+				container.size());
+		if (!result) {
+			setError("Cannot parse META-INF/container.xml");
+			return "";
+		}
+		xpath_node rootfile = doc.select_node("/container/rootfiles/rootfile");
+		string path = rootfile.node().attribute("full-path").value();
+		if (path.empty()) {
+			setError("No rootfile in META-INF/container.xml");
+		}
+		return path;
+	}
+
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		const string& name = m_entries[i].name;
+		if (name.compare(0, 9, "META-INF/") == 0) {
+			continue;
+		}
+		size_t dot = name.rfind('.');
+		if (dot == string::npos) {
+			continue;
+		}
+		string extension = name.substr(dot);
+		if ((extension == ".xml") || (extension == ".musicxml")) {
+			return name;
+		}
+	}
+	setError("No MusicXML file in archive");
+	return "";
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getRootFile -- Extract the MusicXML score from the archive.
+//
+
+bool MxmlArchive::getRootFile(vector<char>& data) {
+	data.clear();
+	string name = getRootFilename();
+	if (name.empty()) {
+		return false;
+	}
+	return getFile(name, data);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getError -- Return a description of the last error.
+//
+
+string MxmlArchive::getError(void) const {
+	return m_error;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::setError -- Store an error message and return false.
+//
+
+bool MxmlArchive::setError(const string& message) {
+	m_error = message;
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::readDirectory -- Read the list of entries in the archive
+//     from the central directory, which is located by the end of central
+//     directory record at the end of the archive.
+//
+
+bool MxmlArchive::readDirectory(void) {
+	m_entries.clear();
+	if (m_data.size() < 22) {
+		return setError("Input is not a ZIP archive");
+	}
+
+	// The end record is followed by a comment of up to 65535 bytes.
+	size_t end = m_data.size() - 22;
+	size_t limit = end > 0xffff ? end - 0xffff : 0;
+	bool found = false;
+	while (true) {
+		if (getUint32(end) == 0x06054b50) {
+			found = true;
+			break;
+		}
+		if (end == limit) {
+			break;
+		}
+		end--;
+	}
+	if (!found) {
+		return setError("Cannot find ZIP central directory");
+	}
+
+	size_t count = getUint16(end + 10);
+	size_t offset = getUint32(end + 16);
+	if ((count == 0xffff) || (offset == 0xffffffff)) {
+		return setError("ZIP64 archives are not supported");
+	}
+
+	m_entries.reserve(count);
+	for (size_t i=0; i<count; i++) {
+		if ((offset + 46 > m_data.size()) || (getUint32(offset) != 0x02014b50)) {
+			return setError("Invalid ZIP central directory");
+		}
+		MxmlArchiveEntry entry;
+		entry.flags      = getUint16(offset + 8);
+		entry.method     = getUint16(offset + 10);
+		entry.crc        = getUint32(offset + 16);
+		entry.compressed = getUint32(offset + 20);
+		entry.size       = getUint32(offset + 24);
+		entry.offset     = getUint32(offset + 42);
+		size_t namelen   = getUint16(offset + 28);
+		size_t extralen  = getUint16(offset + 30);
+		size_t commentlen = getUint16(offset + 32);
+		if (offset + 46 + namelen > m_data.size()) {
+			return setError("Invalid ZIP central directory");
+		}
+		entry.name.assign(m_data.data() + offset + 46, namelen);
+		if ((entry.compressed == 0xffffffff) || (entry.size == 0xffffffff) ||
+				(entry.offset == 0xffffffff)) {
+			return setError("ZIP64 archives are not supported");
+		}
+		m_entries.push_back(entry);
+		offset += 46 + namelen + extralen + commentlen;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getUint16 -- Read a little-endian 16-bit number.
+//
+
+uint32_t MxmlArchive::getUint16(size_t offset) const {
+	const unsigned char* p = (const unsigned char*)m_data.data() + offset;
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getUint32 -- Read a little-endian 32-bit number.
+//
+
+uint32_t MxmlArchive::getUint32(size_t offset) const {
+	const unsigned char* p = (const unsigned char*)m_data.data() + offset;
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+			((uint32_t)p[3] << 24);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::calculateCrc -- CRC-32 checksum used by ZIP files.
+//
+
+uint32_t MxmlArchive::calculateCrc(const char* data, size_t size) {
+	static const vector<uint32_t> table = []() {
+		vector<uint32_t> output(256);
+		for (uint32_t i=0; i<256; i++) {
+			uint32_t value = i;
+			for (int j=0; j<8; j++) {
+				value = (value & 1) ? (0xedb88320 ^ (value >> 1)) : (value >> 1);
+			}
+			output[i] = value;
+		}
+		return output;
+	}();
+
+	uint32_t crc = 0xffffffff;
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i=0; i<size; i++) {
+		crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffff;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::inflate -- Decompress raw deflate data (RFC 1951),
+//     appending to the output.  Returns false on invalid data, or as
+//     soon as the output would be longer than limit bytes.
+//
+
+bool MxmlArchive::inflate(const unsigned char* input, size_t size,
+		vector<char>& output, size_t limit) {
+	m_outlimit = output.size() + limit;
+	m_in = input;
+	m_insize = size;
+	m_inpos = 0;
+	m_bitbuf = 0;
+	m_bitcount = 0;
+	m_inerror = false;
+
+	bool status = true;
+	int last;
+	do {
+		last = getBits(1);
+		int type = getBits(2);
+		if (m_inerror) {
+			status = false;
+			break;
+		}
+		switch (type) {
+			case 0:  status = inflateStored(output);  break;
+			case 1:  status = inflateFixed(output);   break;
+			case 2:  status = inflateDynamic(output); break;
+			default: status = false;
+		}
+	} while (status && !last);
+
+	m_in = NULL;
+	return status && !m_inerror;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::getBits -- Read bits from the deflate input, least
+//     significant bit first.
+//
+
+int MxmlArchive::getBits(int count) {
+	uint32_t value = m_bitbuf;
+	while (m_bitcount < count) {
+		if (m_inpos >= m_insize) {
+			m_inerror = true;
+			return 0;
+		}
+		value |= (uint32_t)m_in[m_inpos++] << m_bitcount;
+		m_bitcount += 8;
+	}
+	m_bitbuf = value >> count;
+	m_bitcount -= count;
+	return (int)(value & ((1u << count) - 1));
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::inflateStored -- Copy an uncompressed block.
+//
+
+bool MxmlArchive::inflateStored(vector<char>& output) {
+	// discard bits up to the next byte boundary
+	m_bitbuf = 0;
+	m_bitcount = 0;
+	if (m_inpos + 4 > m_insize) {
+		return false;
+	}
+	size_t len = m_in[m_inpos] | (m_in[m_inpos + 1] << 8);
+	size_t nlen = m_in[m_inpos + 2] | (m_in[m_inpos + 3] << 8);
+	m_inpos += 4;
+	if ((len != (~nlen & 0xffff)) || (m_inpos + len > m_insize)) {
+		return false;
+	}
+	if (len > m_outlimit - output.size()) {
+		return false;
+	}
+	output.insert(output.end(), m_in + m_inpos, m_in + m_inpos + len);
+	m_inpos += len;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::inflateFixed -- Decode a block compressed with the
+//     fixed Huffman codes.
+//
+
+bool MxmlArchive::inflateFixed(vector<char>& output) {
+	short lengths[288];
+	for (int i=0; i<144; i++) { lengths[i] = 8; }
+	for (int i=144; i<256; i++) { lengths[i] = 9; }
+	for (int i=256; i<280; i++) { lengths[i] = 7; }
+	for (int i=280; i<288; i++) { lengths[i] = 8; }
+	vector<short> lcount;
+	vector<short> lsymbol;
+	buildHuffman(lcount, lsymbol, lengths, 288);
+
+	for (int i=0; i<30; i++) { lengths[i] = 5; }
+	vector<short> dcount;
+	vector<short> dsymbol;
+	buildHuffman(dcount, dsymbol, lengths, 30);
+
+	return inflateCodes(output, lcount, lsymbol, dcount, dsymbol);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::inflateDynamic -- Decode a block compressed with Huffman
+//     codes that are described at the start of the block.
+//
+
+bool MxmlArchive::inflateDynamic(vector<char>& output) {
+	static const short order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4,
+			12, 3, 13, 2, 14, 1, 15};
+
+	int nlen = getBits(5) + 257;
+	int ndist = getBits(5) + 1;
+	int ncode = getBits(4) + 4;
+	if (m_inerror || (nlen > 286) || (ndist > 30)) {
+		return false;
+	}
+
+	short lengths[286 + 30] = {0};
+	for (int i=0; i<ncode; i++) {
+		lengths[order[i]] = (short)getBits(3);
+	}
+	vector<short> count;
+	vector<short> symbol;
+	if (buildHuffman(count, symbol, lengths, 19) == false) {
+		return false;
+	}
+
+	// code lengths for the literal/length and distance codes:
+	int index = 0;
+	while (index < nlen + ndist) {
+		int sym = decodeSymbol(count, symbol);
+		if (sym < 0) {
+			return false;
+		}
+		if (sym < 16) {
+			lengths[index++] = (short)sym;
+			continue;
+		}
+		short len = 0;
+		int repeat;
+		if (sym == 16) {
+			if (index == 0) {
+				return false;
+			}
+			len = lengths[index - 1];
+			repeat = 3 + getBits(2);
+		} else if (sym == 17) {
+			repeat = 3 + getBits(3);
+		} else {
+			repeat = 11 + getBits(7);
+		}
+		if (m_inerror || (index + repeat > nlen + ndist)) {
+			return false;
+		}
+		while (repeat--) {
+			lengths[index++] = len;
+		}
+	}
+	if (lengths[256] == 0) {
+		// no end-of-block code
+		return false;
+	}
+
+	vector<short> lcount;
+	vector<short> lsymbol;
+	vector<short> dcount;
+	vector<short> dsymbol;
+	if (!buildHuffman(lcount, lsymbol, lengths, nlen)) {
+		return false;
+	}
+	if (!buildHuffman(dcount, dsymbol, lengths + nlen, ndist)) {
+		return false;
+	}
+	return inflateCodes(output, lcount, lsymbol, dcount, dsymbol);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::inflateCodes -- Decode literals and length/distance pairs
+//     until the end of the block.
+//
+
+bool MxmlArchive::inflateCodes(vector<char>& output,
+		const vector<short>& lencount, const vector<short>& lensymbol,
+		const vector<short>& distcount, const vector<short>& distsymbol) {
+	static const short lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17,
+			19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	static const short lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2,
+			2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	static const int dbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49,
+			65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+			6145, 8193, 12289, 16385, 24577};
+	static const short dext[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5,
+			6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+	while (true) {
+		int sym = decodeSymbol(lencount, lensymbol);
+		if (sym < 0) {
+			return false;
+		}
+		if (sym < 256) {
+			if (output.size() >= m_outlimit) {
+				return false;
+			}
+			output.push_back((char)sym);
+			continue;
+		}
+		if (sym == 256) {
+			return true;
+		}
+		sym -= 257;
+		if (sym >= 29) {
+			return false;
+		}
+		int len = lbase[sym] + getBits(lext[sym]);
+		int dsym = decodeSymbol(distcount, distsymbol);
+		if ((dsym < 0) || (dsym >= 30)) {
+			return false;
+		}
+		size_t dist = dbase[dsym] + getBits(dext[dsym]);
+		if (m_inerror || (dist > output.size())) {
+			return false;
+		}
+		if ((size_t)len > m_outlimit - output.size()) {
+			return false;
+		}
+		// copy byte by byte, since the source may overlap the output
+		size_t from = output.size() - dist;
+		for (int i=0; i<len; i++) {
+			output.push_back(output[from + i]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::buildHuffman -- Build a canonical Huffman decoding table
+//     from a list of code lengths: count[len] is the number of codes of
+//     each length, and symbol[] lists the symbols in code order.  Returns
+//     false if the lengths are over-subscribed.  Incomplete codes are
+//     allowed, since a single distance code is valid.
+//
+
+bool MxmlArchive::buildHuffman(vector<short>& count, vector<short>& symbol,
+		const short* lengths, int n) {
+	count.assign(16, 0);
+	symbol.assign(n, 0);
+	for (int i=0; i<n; i++) {
+		count[lengths[i]]++;
+	}
+	if (count[0] == n) {
+		return true;
+	}
+	int left = 1;
+	for (int len=1; len<16; len++) {
+		left <<= 1;
+		left -= count[len];
+		if (left < 0) {
+			return false;
+		}
+	}
+	short offsets[16];
+	offsets[1] = 0;
+	for (int len=1; len<15; len++) {
+		offsets[len + 1] = offsets[len] + count[len];
+	}
+	for (int i=0; i<n; i++) {
+		if (lengths[i] != 0) {
+			symbol[offsets[lengths[i]]++] = (short)i;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlArchive::decodeSymbol -- Decode one Huffman-coded symbol.  Codes
+//     are stored most-significant bit first.  Returns -1 on an error.
+//
+
+int MxmlArchive::decodeSymbol(const vector<short>& count,
+		const vector<short>& symbol) {
+	int code = 0;   // bits read so far
+	int first = 0;  // first code of the current length
+	int index = 0;  // index of first code of the current length in symbol
+	for (int len=1; len<16; len++) {
+		code |= getBits(1);
+		int number = count[len];
+		if (code - number < first) {
+			if (m_inerror) {
+				return -1;
+			}
+			return symbol[index + (code - first)];
+		}
+		index += number;
+		first += number;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
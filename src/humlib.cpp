@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Mon Sep 13 13:47:44 EDT 2021
+// Last Modified: Sat Oct 17 02:48:56 UTC 2026
 // Filename:      /include/humlib.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/humlib.cpp
 // Syntax:        C++11
@@ -3360,6 +3360,332 @@ int Convert::kernToStaffLocation(const string& token, const string& clef) {
 
 
 
+//////////////////////////////
+//
+// Convert::kernToPitchParts -- Extract the diatonic pitch class,
+//    accidental count and octave of the first subtoken in a **kern
+//    string in a single pass with a character lookup table.  The values
+//    (including the error values for rests and missing pitches) are the
+//    same as for kernToDiatonicPC(), kernToAccidentalCount() and
+//    kernToOctaveNumber().
+//
+
+void Convert::kernToPitchParts(const string& kerndata, int& diatonic,
+		int& accid, int& octave) {
+	// Character classes: 1-7 = lower-case C-B, 8-14 = upper-case C-B,
+	// 15 = sharp, 16 = flat, 17 = rest, 18 = subtoken separator.
+	static const vector<unsigned char> classes = []() {
+		vector<unsigned char> table(256, 0);
+		const string letters = "cdefgab";
+		for (int i=0; i<(int)letters.size(); i++) {
+			table[(unsigned char)letters[i]] = i + 1;
+			table[(unsigned char)toupper(letters[i])] = i + 8;
+		}
+		table['#'] = 15;
+		table['-'] = 16;
+		table['r'] = 17;
+		table[' '] = 18;
+		return table;
+	}();
+
+	diatonic = -2000;
+	accid = 0;
+	int uc = 0;
+	int lc = 0;
+	bool rest = false;
+	int size = (int)kerndata.size();
+	for (int i=0; i<size; i++) {
+		int cclass = classes[(unsigned char)kerndata[i]];
+		if (cclass == 0) {
+			continue;
+		}
+		if (cclass == 18) {
+			break;
+		}
+		if (cclass <= 14) {
+			int lower = cclass <= 7;
+			lc += lower;
+			uc += !lower;
+			if (diatonic == -2000) {
+				diatonic = lower ? cclass - 1 : cclass - 8;
+			}
+		} else if (cclass == 17) {
+			rest = true;
+			if (diatonic == -2000) {
+				diatonic = -1000;
+			}
+		} else {
+			accid += (cclass == 15) ? 1 : -1;
+		}
+	}
+
+	if (rest || ((uc > 0) && (lc > 0)) || ((size == 1) && (kerndata[0] == '.'))) {
+		octave = -1000;
+	} else if (uc > 0) {
+		octave = 4 - uc;
+	} else if (lc > 0) {
+		octave = 3 + lc;
+	} else {
+		octave = -1000;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToPitchArray -- Parse a list of **kern tokens (or
+//    subtokens) and store a value calculated from the pitch of each
+//    one in output.
+//
+
+template <class TOKEN, class FUNCTION>
+void Convert::kernToPitchArray(vector<int>& output,
+		const vector<TOKEN>& tokens, FUNCTION convert) {
+	output.resize(tokens.size());
+	int diatonic;
+	int accid;
+	int octave;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		kernToPitchParts(getPitchText(tokens[i]), diatonic, accid, octave);
+		output[i] = convert(diatonic, accid, octave);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToBase40 -- Convert a list of **kern tokens (or subtokens)
+//    into base-40 pitches.  Only the first subtoken in each token is
+//    considered.
+//
+
+void Convert::kernToBase40(vector<int>& output, const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToBase40);
+}
+
+
+void Convert::kernToBase40(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToBase40);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToBase12 -- Convert a list of **kern tokens (or subtokens)
+//    into base-12 pitches (middle C = 48).
+//
+
+void Convert::kernToBase12(vector<int>& output, const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToBase12);
+}
+
+
+void Convert::kernToBase12(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToBase12);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToBase7 -- Convert a list of **kern tokens (or subtokens)
+//    into base-7 pitches.
+//
+
+void Convert::kernToBase7(vector<int>& output, const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToBase7);
+}
+
+
+void Convert::kernToBase7(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToBase7);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToMidiNoteNumber -- Convert a list of **kern tokens (or
+//    subtokens) into MIDI note numbers (middle C = 60).
+//
+
+void Convert::kernToMidiNoteNumber(vector<int>& output,
+		const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToMidi);
+}
+
+
+void Convert::kernToMidiNoteNumber(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToMidi);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToOctaveNumber -- Convert a list of **kern tokens (or
+//    subtokens) into octave numbers.
+//
+
+void Convert::kernToOctaveNumber(vector<int>& output,
+		const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToOctave);
+}
+
+
+void Convert::kernToOctaveNumber(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToOctave);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::kernToAccidentalCount -- Convert a list of **kern tokens (or
+//    subtokens) into accidental counts (+1 = sharp, -1 = flat).
+//
+
+void Convert::kernToAccidentalCount(vector<int>& output,
+		const vector<HTp>& tokens) {
+	kernToPitchArray(output, tokens, pitchPartsToAccidental);
+}
+
+
+void Convert::kernToAccidentalCount(vector<int>& output,
+		const vector<string>& subtokens) {
+	kernToPitchArray(output, subtokens, pitchPartsToAccidental);
+}
+
+
+
+//////////////////////////////
+//
+// Convert::pitchPartsToBase40 -- Functions for combining the output
+//     of kernToPitchParts() in the same way as the single-token
+//     conversion functions.
+//
+
+int Convert::pitchPartsToBase40(int diatonic, int accid, int octave) {
+	static const int pcs[7] = {0, 6, 12, 17, 23, 29, 35};
+	if (diatonic < 0) {
+		return diatonic;
+	}
+	int pc = pcs[diatonic] + accid + 2;
+	if (pc < 0) {
+		return pc;
+	}
+	return pc + 40 * octave;
+}
+
+
+int Convert::pitchPartsToBase12(int diatonic, int accid, int octave) {
+	static const int pcs[7] = {0, 2, 4, 5, 7, 9, 11};
+	int pc = diatonic < 0 ? diatonic : pcs[diatonic] + accid;
+	return pc + 12 * octave;
+}
+
+
+int Convert::pitchPartsToBase7(int diatonic, int accid, int octave) {
+	if (diatonic < 0) {
+		return diatonic;
+	}
+	return diatonic + 7 * octave;
+}
+
+
+int Convert::pitchPartsToMidi(int diatonic, int accid, int octave) {
+	return pitchPartsToBase12(diatonic, accid, octave) + 12;
+}
+
+
+int Convert::pitchPartsToOctave(int diatonic, int accid, int octave) {
+	return octave;
+}
+
+
+int Convert::pitchPartsToAccidental(int diatonic, int accid, int octave) {
+	return accid;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::base40ToKern -- Convert a list of base-40 pitches into **kern
+//     pitches, which are stored one after another in buffer.  The pitch
+//     at index i in the list is stored in the buffer from offsets[i] to
+//     offsets[i+1].  The buffer is allocated once for all of the pitches.
+//     Negative base-40 values (such as rests) are converted to empty strings.
+//
+
+void Convert::base40ToKern(string& buffer, vector<int>& offsets,
+		const vector<int>& b40s) {
+	const vector<string>& table = getBase40KernTable();
+	int count = (int)b40s.size();
+	offsets.resize(count + 1);
+
+	// Names outside of the lookup table are rare, so calculate them separately:
+	vector<string> others;
+	vector<const string*> names(count);
+	int size = 0;
+	for (int i=0; i<count; i++) {
+		int b40 = b40s[i];
+		if (b40 < 0) {
+			names[i] = NULL;
+			continue;
+		}
+		if (b40 < (int)table.size()) {
+			names[i] = &table[b40];
+		} else {
+			if (others.empty()) {
+				others.reserve(count);
+			}
+			others.push_back(base40ToKern(b40));
+			names[i] = &others.back();
+		}
+		size += (int)names[i]->size();
+	}
+
+	buffer.resize(size);
+	int position = 0;
+	for (int i=0; i<count; i++) {
+		offsets[i] = position;
+		if (names[i]) {
+			std::copy(names[i]->begin(), names[i]->end(), buffer.begin() + position);
+			position += (int)names[i]->size();
+		}
+	}
+	offsets[count] = position;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::getBase40KernTable -- Return a lookup table of **kern pitch
+//     names for base-40 pitches in octaves 0 through 9.
+//
+
+const vector<string>& Convert::getBase40KernTable(void) {
+	static const vector<string> table = []() {
+		vector<string> names(40 * 10);
+		for (int i=0; i<(int)names.size(); i++) {
+			names[i] = Convert::base40ToKern(i);
+		}
+		return names;
+	}();
+	return table;
+}
+
+
 
 
 
@@ -4319,85 +4645,17 @@ HumNum Convert::recipToDuration(string* recip, HumNum scale,
 
 HumNum Convert::recipToDuration(const string& recip, HumNum scale,
 		const string& separator) {
-	size_t loc;
-	loc = recip.find(separator);
-	string subtok;
-	if (loc != string::npos) {
-		subtok = recip.substr(0, loc);
-	} else {
-		subtok = recip;
-	}
-
-	loc = recip.find('q');
-	if (loc != string::npos) {
+	if (recip.find('q') != string::npos) {
 		// grace note, ignore printed rhythm
 		HumNum zero(0);
 		return zero;
 	}
 
-	int dotcount = 0;
-	int i;
-	int numi = -1;
-	for (i=0; i<(int)subtok.size(); i++) {
-		if (subtok[i] == '.') {
-			dotcount++;
-		}
-		if ((numi < 0) && isdigit(subtok[i])) {
-			numi = i;
-		}
-	}
-	loc = subtok.find("%");
-	int numerator = 1;
-	int denominator = 1;
-	HumNum output;
-	if (loc != string::npos) {
-		// reciprocal rhythm
-		numerator = 1;
-		denominator = subtok[numi++] - '0';
-		while ((numi<(int)subtok.size()) && isdigit(subtok[numi])) {
-			denominator = denominator * 10 + (subtok[numi++] - '0');
-		}
-		if ((loc + 1 < subtok.size()) && isdigit(subtok[loc+1])) {
-			int xi = (int)loc + 1;
-			numerator = subtok[xi++] - '0';
-			while ((xi<(int)subtok.size()) && isdigit(subtok[xi])) {
-				numerator = numerator * 10 + (subtok[xi++] - '0');
-			}
-		}
-		output.setValue(numerator, denominator);
-	} else if (numi < 0) {
-		// no rhythm found
-		HumNum zero(0);
-		return zero;
-	} else if (subtok[numi] == '0') {
-		// 0-symbol
-		int zerocount = 1;
-		for (i=numi+1; i<(int)subtok.size(); i++) {
-			if (subtok[i] == '0') {
-				zerocount++;
-			} else {
-				break;
-			}
-		}
-		numerator = (int)pow(2, zerocount);
-		output.setValue(numerator, 1);
-	} else {
-		// plain rhythm
-		denominator = subtok[numi++] - '0';
-		while ((numi<(int)subtok.size()) && isdigit(subtok[numi])) {
-			denominator = denominator * 10 + (subtok[numi++] - '0');
-		}
-		output.setValue(1, denominator);
-	}
-
-	if (dotcount <= 0) {
-		return output * scale;
+	const HumRecipDuration& value = getRecipDuration(recip, separator);
+	if (scale == 4) {
+		return value.m_quarters;
 	}
-
-	int bot = (int)pow(2.0, dotcount);
-	int top = (int)pow(2.0, dotcount + 1) - 1;
-	HumNum factor(top, bot);
-	return output * factor * scale;
+	return value.m_duration * scale;
 }
 
 
@@ -4419,30 +4677,156 @@ HumNum Convert::recipToDurationIgnoreGrace(string* recip, HumNum scale,
 
 HumNum Convert::recipToDurationIgnoreGrace(const string& recip, HumNum scale,
 		const string& separator) {
-	size_t loc;
-	loc = recip.find(separator);
-	string subtok;
-	if (loc != string::npos) {
-		subtok = recip.substr(0, loc);
+	const HumRecipDuration& value = getRecipDuration(recip, separator);
+	if (scale == 4) {
+		return value.m_quarters;
+	}
+	return value.m_duration * scale;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::recipToDurationNoDots -- Same as recipToDuration(), but ignore
+//   any augmentation dots.
+//
+
+HumNum Convert::recipToDurationNoDots(string* recip, HumNum scale,
+		const string& separator) {
+	return Convert::recipToDurationNoDots(*recip, scale, separator);
+}
+
+
+HumNum Convert::recipToDurationNoDots(const string& recip, HumNum scale,
+		const string& separator) {
+	if (recip.find('q') != string::npos) {
+		// grace note, ignore printed rhythm
+		HumNum zero(0);
+		return zero;
+	}
+	return getRecipDuration(recip, separator).m_undotted * scale;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::getRecipDuration -- Return the parsed duration of the first
+//     subtoken of a **recip string.  Parsed durations are stored in a
+//     process-wide cache which is shared by all threads.  The cache is
+//     keyed by the rhythm characters of the subtoken (digits, dots and
+//     "%"), so that tokens such as "4c" and "(4d" share the same entry.
+//     Entries are never removed, so the returned reference stays valid.
+//     Each thread also keeps its own index of the entries which it has
+//     used, so that the shared cache only needs to be locked the first
+//     time that a thread uses a rhythm.
+//
+
+const HumRecipDuration& Convert::getRecipDuration(const string& recip,
+		const string& separator) {
+	static const int shardcount = 16;
+	static std::mutex locks[shardcount];
+	static std::unordered_map<string, HumRecipDuration> caches[shardcount];
+	// Per-thread indexes of the cache: keys of up to 8 characters are
+	// packed into an integer for faster lookups.
+	static thread_local std::unordered_map<uint64_t, const HumRecipDuration*> shortkeys;
+	static thread_local std::unordered_map<string, const HumRecipDuration*> longkeys;
+
+	size_t end = recip.find(separator);
+	if (end == string::npos) {
+		end = recip.size();
+	}
+
+	// Non-rhythm characters between rhythm characters are replaced by a
+	// single "_" since they separate numbers.
+	uint64_t packed = 0;
+	int length = 0;
+	string key;
+	auto append = [&](char value) {
+		if (length < 8) {
+			packed |= (uint64_t)(unsigned char)value << (8 * length);
+		} else {
+			key += value;
+		}
+		length++;
+	};
+	bool pending = false;
+	for (size_t i=0; i<end; i++) {
+		char ch = recip[i];
+		if ((('0' <= ch) && (ch <= '9')) || (ch == '.') || (ch == '%')) {
+			if (pending) {
+				append('_');
+				pending = false;
+			}
+			append(ch);
+		} else if (length > 0) {
+			pending = true;
+		}
+	}
+
+	if (length <= 8) {
+		auto found = shortkeys.find(packed);
+		if (found != shortkeys.end()) {
+			return *found->second;
+		}
 	} else {
-		subtok = recip;
+		auto found = longkeys.find(key);
+		if (found != longkeys.end()) {
+			return *found->second;
+		}
+	}
+	for (int i=std::min(length, 8) - 1; i>=0; i--) {
+		key.insert(key.begin(), (char)(packed >> (8 * i)));
 	}
+	const HumRecipDuration*& localentry = (length <= 8) ?
+			shortkeys[packed] : longkeys[key];
 
-	int dotcount = 0;
+	int shard = (int)(std::hash<string>()(key) % shardcount);
+	std::lock_guard<std::mutex> lock(locks[shard]);
+	auto it = caches[shard].find(key);
+	if (it != caches[shard].end()) {
+		localentry = &it->second;
+		return it->second;
+	}
+
+	HumRecipDuration& value = caches[shard][key];
+	localentry = &value;
+	parseRecip(key, value.m_undotted, value.m_dots);
+	value.m_duration = value.m_undotted;
+	if (value.m_dots > 0) {
+		int bot = (int)pow(2.0, value.m_dots);
+		int top = (int)pow(2.0, value.m_dots + 1) - 1;
+		HumNum factor(top, bot);
+		value.m_duration *= factor;
+	}
+	value.m_quarters = value.m_duration * 4;
+	return value;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::parseRecip -- Parse a **recip subtoken into its duration in
+//     whole notes without augmentation dots, and the number of dots.
+//
+
+void Convert::parseRecip(const string& subtok, HumNum& undotted, int& dots) {
+	dots = 0;
 	int i;
 	int numi = -1;
 	for (i=0; i<(int)subtok.size(); i++) {
 		if (subtok[i] == '.') {
-			dotcount++;
+			dots++;
 		}
 		if ((numi < 0) && isdigit(subtok[i])) {
 			numi = i;
 		}
 	}
-	loc = subtok.find("%");
+	size_t loc = subtok.find("%");
 	int numerator = 1;
 	int denominator = 1;
-	HumNum output;
 	if (loc != string::npos) {
 		// reciprocal rhythm
 		numerator = 1;
@@ -4457,11 +4841,11 @@ HumNum Convert::recipToDurationIgnoreGrace(const string& recip, HumNum scale,
 				numerator = numerator * 10 + (subtok[xi++] - '0');
 			}
 		}
-		output.setValue(numerator, denominator);
+		undotted.setValue(numerator, denominator);
 	} else if (numi < 0) {
 		// no rhythm found
-		HumNum zero(0);
-		return zero;
+		undotted = 0;
+		dots = 0;
 	} else if (subtok[numi] == '0') {
 		// 0-symbol
 		int zerocount = 1;
@@ -4473,45 +4857,15 @@ HumNum Convert::recipToDurationIgnoreGrace(const string& recip, HumNum scale,
 			}
 		}
 		numerator = (int)pow(2, zerocount);
-		output.setValue(numerator, 1);
+		undotted.setValue(numerator, 1);
 	} else {
 		// plain rhythm
 		denominator = subtok[numi++] - '0';
 		while ((numi<(int)subtok.size()) && isdigit(subtok[numi])) {
 			denominator = denominator * 10 + (subtok[numi++] - '0');
 		}
-		output.setValue(1, denominator);
-	}
-
-	if (dotcount <= 0) {
-		return output * scale;
+		undotted.setValue(1, denominator);
 	}
-
-	int bot = (int)pow(2.0, dotcount);
-	int top = (int)pow(2.0, dotcount + 1) - 1;
-	HumNum factor(top, bot);
-	return output * factor * scale;
-}
-
-
-
-//////////////////////////////
-//
-// Convert::recipToDurationNoDots -- Same as recipToDuration(), but ignore
-//   any augmentation dots.
-//
-
-HumNum Convert::recipToDurationNoDots(string* recip, HumNum scale,
-		const string& separator) {
-	return Convert::recipToDurationNoDots(*recip, scale, separator);
-}
-
-
-HumNum Convert::recipToDurationNoDots(const string& recip, HumNum scale,
-		const string& separator) {
-	string temp = recip;
-	std::replace(temp.begin(), temp.end(), '.', 'Z');
-	return Convert::recipToDuration(temp, scale, separator);
 }
 
 
@@ -8810,6 +9164,7 @@ ostream& operator<<(ostream& output, GridVoice& voice) {
 //
 
 HumAddress::HumAddress(void) {
+	m_spining       = NULL;
 	m_track         = -1;
 	m_subtrack      = -1;
 	m_subtrackcount = 0;
@@ -8933,7 +9288,8 @@ const HumdrumToken& HumAddress::getDataType(void) const {
 //
 
 const string& HumAddress::getSpineInfo(void) const {
-	return m_spining;
+	static const string empty;
+	return m_spining ? *m_spining : empty;
 }
 
 
@@ -9074,11 +9430,37 @@ void HumAddress::setFieldIndex(int index) {
 //
 
 void HumAddress::setSpineInfo(const string& spineinfo) {
+	m_spining = internSpineInfo(spineinfo);
+}
+
+//
+// Interned string version:
+//
+
+void HumAddress::setSpineInfo(const string* spineinfo) {
 	m_spining = spineinfo;
 }
 
 
 
+//////////////////////////////
+//
+// HumAddress::internSpineInfo -- Return a shared copy of the spine info
+//     string.  Spine info strings are stored once for the whole program
+//     and never deleted, so tokens only need to store a pointer to
+//     them, and tokens with the same spine info can be compared by
+//     pointer.
+//
+
+const string* HumAddress::internSpineInfo(const string& spineinfo) {
+	static std::mutex tablemutex;
+	static std::unordered_set<string> table;
+	std::lock_guard<std::mutex> lock(tablemutex);
+	return &*table.insert(spineinfo).first;
+}
+
+
+
 //////////////////////////////
 //
 // HumAddress::setTrack -- Set the track number of the associated token.
@@ -9141,6 +9523,279 @@ void HumAddress::setSubtrackCount(int count) {
 
 
 
+//////////////////////////////
+//
+// HumBatch::HumBatch -- Constructor.
+//
+
+HumBatch::HumBatch(void) {
+	setThreadCount(0);
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::setThreadCount -- Set the number of worker threads.  A
+//     value of 0 uses one thread for each hardware thread.
+//
+
+void HumBatch::setThreadCount(int count) {
+	if (count <= 0) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	if (count <= 0) {
+		count = 1;
+	}
+	m_threads = count;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::getThreadCount -- Return the number of worker threads.
+//
+
+int HumBatch::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::setExtension -- Set the extension of output files which
+//     are named after their input files.
+//
+
+void HumBatch::setExtension(const string& extension) {
+	m_extension = extension;
+	if (!m_extension.empty() && (m_extension[0] != '.')) {
+		m_extension = "." + m_extension;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::run -- Convert the files in the requests as they are read,
+//     and return false if any conversion failed.
+//
+
+bool HumBatch::run(istream& requests, ostream& report, Converter converter) {
+	m_jobs.clear();
+	m_finished = false;
+	m_count = 0;
+	m_failures = 0;
+	auto starttime = std::chrono::steady_clock::now();
+
+	vector<std::thread> workers;
+	for (int i=0; i<m_threads; i++) {
+		workers.emplace_back(&HumBatch::processJobs, this, i, std::ref(converter),
+				std::ref(report));
+	}
+
+	string line;
+	string input;
+	string output;
+	while (getline(requests, line)) {
+		if (!parseRequest(line, input, output)) {
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_jobmutex);
+			m_jobs.emplace_back(input, output);
+		}
+		m_jobready.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobmutex);
+		m_finished = true;
+	}
+	m_jobready.notify_all();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - starttime;
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.3f", elapsed.count());
+	report << "{\"files\":" << m_count << ",\"failed\":" << m_failures
+	       << ",\"ms\":" << buffer << "}" << endl;
+
+	return m_failures == 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::parseRequest -- Extract the input and output filenames from
+//     a line of the requests.  Returns false if the line has no request.
+//
+
+bool HumBatch::parseRequest(const string& line, string& input, string& output) {
+	string request = line;
+	if (!request.empty() && (request.back() == '\r')) {
+		request.pop_back();
+	}
+	if (request.empty() || (request[0] == '#')) {
+		return false;
+	}
+
+	size_t tab = request.find('\t');
+	if (tab == string::npos) {
+		input = request;
+		output.clear();
+	} else {
+		input = request.substr(0, tab);
+		output = request.substr(tab + 1);
+	}
+	if (input.empty()) {
+		return false;
+	}
+
+	if (output.empty()) {
+		size_t slash = input.rfind('/');
+		size_t dot = input.rfind('.');
+		if ((dot == string::npos) || ((slash != string::npos) && (dot < slash))) {
+			output = input + m_extension;
+		} else {
+			output = input.substr(0, dot) + m_extension;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::processJobs -- Worker thread loop: convert queued files until
+//     the requests have ended and the queue is empty.
+//
+
+void HumBatch::processJobs(int worker, Converter& converter, ostream& report) {
+	while (true) {
+		pair<string, string> job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobmutex);
+			m_jobready.wait(lock, [this]() { return m_finished || !m_jobs.empty(); });
+			if (m_jobs.empty()) {
+				return;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+		convertJob(worker, converter, job.first, job.second, report);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::convertJob -- Convert one file, write the output file and
+//     add the result to the report.
+//
+
+void HumBatch::convertJob(int worker, Converter& converter, const string& input,
+		const string& output, ostream& report) {
+	auto starttime = std::chrono::steady_clock::now();
+	stringstream out;
+	stringstream error;
+	bool status = false;
+	size_t bytes = 0;
+
+	ifstream testfile(input.c_str());
+	if (!testfile.is_open()) {
+		error << "Cannot read input file";
+	} else {
+		testfile.close();
+		try {
+			status = converter(worker, input, out, error);
+		} catch (const std::exception& e) {
+			error << e.what();
+			status = false;
+		}
+	}
+
+	if (status) {
+		string contents = out.str();
+		ofstream outfile(output.c_str(), ios::binary);
+		if (!outfile.is_open()) {
+			error << "Cannot write output file";
+			status = false;
+		} else {
+			outfile << contents;
+			bytes = contents.size();
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - starttime;
+	string message = error.str();
+	while (!message.empty() && isspace((unsigned char)message.back())) {
+		message.pop_back();
+	}
+	if (!status && message.empty()) {
+		message = "Conversion failed";
+	}
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.3f", elapsed.count());
+
+	std::lock_guard<std::mutex> lock(m_reportmutex);
+	m_count++;
+	if (!status) {
+		m_failures++;
+	}
+	report << "{\"input\":\"" << escapeJson(input) << "\""
+	       << ",\"output\":\"" << escapeJson(output) << "\""
+	       << ",\"worker\":" << worker
+	       << ",\"status\":\"" << (status ? "ok" : "error") << "\""
+	       << ",\"ms\":" << buffer
+	       << ",\"bytes\":" << bytes
+	       << ",\"error\":\"" << escapeJson(message) << "\"}" << endl;
+}
+
+
+
+//////////////////////////////
+//
+// HumBatch::escapeJson -- Escape a string for use in a JSON string value.
+//
+
+string HumBatch::escapeJson(const string& value) {
+	string output;
+	output.reserve(value.size());
+	for (int i=0; i<(int)value.size(); i++) {
+		unsigned char ch = (unsigned char)value[i];
+		switch (ch) {
+			case '"':  output += "\\\""; break;
+			case '\\': output += "\\\\"; break;
+			case '\n': output += "\\n";  break;
+			case '\r': output += "\\r";  break;
+			case '\t': output += "\\t";  break;
+			default:
+				if (ch < 0x20) {
+					char buffer[8];
+					snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+					output += buffer;
+				} else {
+					output += (char)ch;
+				}
+		}
+	}
+	return output;
+}
+
+
+
+
 //////////////////////////////
 //
 // HumGrid::HumGrid -- Constructor.
@@ -16683,9 +17338,9 @@ bool HumTool::hasAnyText(void) {
 	if (m_suppress) {
 		return true;
 	}
-	return ((!m_humdrum_text.str().empty())
-			|| (!m_free_text.str().empty())
-			|| (!m_json_text.str().empty()));
+	return ((!isEmpty(m_humdrum_text))
+			|| (!isEmpty(m_free_text))
+			|| (!isEmpty(m_json_text)));
 }
 
 
@@ -16707,9 +17362,9 @@ string HumTool::getAllText(void) {
 //
 
 ostream& HumTool::getAllText(ostream& out) {
-	out << m_humdrum_text.str();
-	out << m_json_text.str();
-	out << m_free_text.str();
+	printStream(out, m_humdrum_text);
+	printStream(out, m_json_text);
+	printStream(out, m_free_text);
 	return out;
 }
 
@@ -16733,7 +17388,7 @@ void HumTool::suppressHumdrumFileOutput(void) {
 //
 
 bool HumTool::hasHumdrumText(void) {
-	return m_humdrum_text.str().empty() ? false : true;
+	return isEmpty(m_humdrum_text) ? false : true;
 }
 
 
@@ -16753,7 +17408,7 @@ string HumTool::getHumdrumText(void) {
 //
 
 ostream& HumTool::getHumdrumText(ostream& out) {
-	out << m_humdrum_text.str();
+	printStream(out, m_humdrum_text);
 	return out;
 }
 
@@ -16765,7 +17420,7 @@ ostream& HumTool::getHumdrumText(ostream& out) {
 //
 
 bool HumTool::hasFreeText(void) {
-	return m_free_text.str().empty() ? false : true;
+	return isEmpty(m_free_text) ? false : true;
 }
 
 
@@ -16785,7 +17440,7 @@ string HumTool::getFreeText(void) {
 //
 
 ostream& HumTool::getFreeText(ostream& out) {
-	out << m_free_text.str();
+	printStream(out, m_free_text);
 	return out;
 }
 
@@ -16797,7 +17452,7 @@ ostream& HumTool::getFreeText(ostream& out) {
 //
 
 bool HumTool::hasJsonText(void) {
-	return m_json_text.str().empty() ? false : true;
+	return isEmpty(m_json_text) ? false : true;
 }
 
 
@@ -16817,7 +17472,7 @@ string HumTool::getJsonText(void) {
 //
 
 ostream& HumTool::getJsonText(ostream& out) {
-	out << m_json_text.str();
+	printStream(out, m_json_text);
 	return out;
 }
 
@@ -16829,7 +17484,7 @@ ostream& HumTool::getJsonText(ostream& out) {
 //
 
 bool HumTool::hasWarning(void) {
-	return m_warning_text.str().empty() ? false : true;
+	return isEmpty(m_warning_text) ? false : true;
 }
 
 
@@ -16849,7 +17504,7 @@ string HumTool::getWarning(void) {
 //
 
 ostream& HumTool::getWarning(ostream& out) {
-	out << m_warning_text.str();
+	printStream(out, m_warning_text);
 	return out;
 }
 
@@ -16865,7 +17520,7 @@ bool HumTool::hasError(void) {
 	if (hasParseError()) {
 		return true;
 	}
-	return m_error_text.str().empty() ? false : true;
+	return isEmpty(m_error_text) ? false : true;
 }
 
 
@@ -16889,7 +17544,7 @@ string HumTool::getError(void) {
 
 ostream& HumTool::getError(ostream& out) {
 	out << getParseError();
-	out << m_error_text.str();
+	printStream(out, m_error_text);
 	return out;
 }
 
@@ -16921,6 +17576,37 @@ void HumTool::setError(const string& message) {
 
 
 
+//////////////////////////////
+//
+// HumTool::isEmpty -- Returns true if nothing has been written to the
+//     output stream.  This avoids copying the contents of the stream
+//     just to check its size.
+//
+
+bool HumTool::isEmpty(std::stringstream& stream) {
+	return stream.rdbuf()->pubseekoff(0, ios::cur, ios::out) <= 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumTool::printStream -- Copy the contents of the output stream into
+//     another stream without making a temporary copy of the contents.
+//     The contents of the stream are not changed, so it can be printed
+//     more than once.
+//
+
+ostream& HumTool::printStream(ostream& out, std::stringstream& stream) {
+	if (isEmpty(stream)) {
+		return out;
+	}
+	stream.rdbuf()->pubseekpos(0, ios::in);
+	out << stream.rdbuf();
+	return out;
+}
+
+
 
 
 
@@ -19386,6 +20072,568 @@ int HumdrumFileBase::open_network_socket(const string& hostname,
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::getLineAtTime -- Return the index of the first line
+//    which starts at the given timestamp (in quarter notes from the
+//    start of the file).  If no line starts at the timestamp, then
+//    return the last line starting before it.  Returns -1 if the
+//    timestamp is before the start of the file.
+//
+
+int HumdrumFileBase::getLineAtTime(HumNum timestamp) {
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return -1;
+	}
+	if (exact) {
+		return m_timeline[index].m_firstline;
+	}
+	return m_timeline[index].m_lastline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getDataLineAtTime -- Return the index of the first data
+//    line which starts at the given timestamp.  If no data line starts at
+//    the timestamp, then return the last data line starting before it.
+//    Returns -1 if there is no data line at or before the timestamp.
+//
+
+int HumdrumFileBase::getDataLineAtTime(HumNum timestamp) {
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return -1;
+	}
+	if (exact && (m_timeline[index].m_firstdata >= 0)) {
+		return m_timeline[index].m_firstdata;
+	}
+	return m_timeline[index].m_lastdata;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getMeasureAtTime -- Return the index of the barline
+//    (see getBarline()) starting the measure which contains the given
+//    timestamp.  Returns -1 if the timestamp is before the first barline,
+//    or if the rhythm of the file has not been analyzed.
+//
+
+int HumdrumFileBase::getMeasureAtTime(HumNum timestamp) {
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return -1;
+	}
+	return m_timeline[index].m_measure;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getLineRangeAtTimes -- Return the range of lines which
+//    start at or after starttime and before endtime.  Returns false if
+//    there are no lines in the time range.
+//
+
+bool HumdrumFileBase::getLineRangeAtTimes(int& startline, int& endline,
+		HumNum starttime, HumNum endtime) {
+	startline = -1;
+	endline = -1;
+	if (endtime <= starttime) {
+		return false;
+	}
+	bool exact = false;
+	int startindex = getTimelineIndex(starttime, exact);
+	if (!exact) {
+		// first entry after the start time:
+		startindex++;
+	}
+	int endindex = getTimelineIndex(endtime, exact);
+	if (exact) {
+		// last entry before the end time:
+		endindex--;
+	}
+	if ((startindex >= (int)m_timeline.size()) || (endindex < startindex)) {
+		return false;
+	}
+	startline = m_timeline[startindex].m_firstline;
+	endline = m_timeline[endindex].m_lastline;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimelineTpq -- Return the number of ticks per
+//    quarter note used in the timeline, which is the smallest value
+//    that gives an integer tick position for every line in the file.
+//    Returns 0 if the ticks would not fit into 64 bits, in which case
+//    the timeline entries are ordered by their timestamps only.
+//
+
+int64_t HumdrumFileBase::getTimelineTpq(void) {
+	if (m_timeline.empty()) {
+		analyzeTimeline();
+	}
+	return m_timelinetpq;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimeline -- Return the index of the lines in
+//    the file by timestamp.  The entries are sorted by time, and there
+//    is one entry for each timestamp.
+//
+
+const vector<HumTimelineEntry>& HumdrumFileBase::getTimeline(void) {
+	if (m_timeline.empty()) {
+		analyzeTimeline();
+	}
+	return m_timeline;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimelineIndex -- Return the index of the last
+//    timeline entry at or before the given timestamp, or -1 if the
+//    timestamp is before the first entry.  exact is set to true if
+//    the entry is at the timestamp.
+//
+
+int HumdrumFileBase::getTimelineIndex(HumNum timestamp, bool& exact) {
+	exact = false;
+	if (m_timeline.empty()) {
+		analyzeTimeline();
+	}
+	if (m_timeline.empty()) {
+		return -1;
+	}
+	int index;
+	int64_t ticks = 0;
+	bool tickexact = false;
+	if (getTimelineTicks(timestamp, ticks, tickexact)) {
+		auto it = upper_bound(m_timeline.begin(), m_timeline.end(), ticks,
+				[](int64_t value, const HumTimelineEntry& entry) {
+					return value < entry.m_ticks;
+				});
+		index = (int)(it - m_timeline.begin()) - 1;
+		if (index < 0) {
+			return -1;
+		}
+		exact = tickexact && (m_timeline[index].m_ticks == ticks);
+	} else {
+		// The timestamp cannot be expressed in ticks, so compare
+		// the timestamps directly:
+		auto it = upper_bound(m_timeline.begin(), m_timeline.end(), timestamp,
+				[this](const HumNum& value, const HumTimelineEntry& entry) {
+					return compareTimelineTimes(value, entry.m_timestamp) < 0;
+				});
+		index = (int)(it - m_timeline.begin()) - 1;
+		if (index < 0) {
+			return -1;
+		}
+		exact = compareTimelineTimes(timestamp, m_timeline[index].m_timestamp) == 0;
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTimelineTicks -- Convert a timestamp into timeline
+//    ticks, rounding down if the timestamp falls between ticks (exact is
+//    set to false in that case).  Returns false if the timeline does not
+//    use ticks, or if the timestamp is too large to be expressed in ticks.
+//
+
+bool HumdrumFileBase::getTimelineTicks(HumNum timestamp, int64_t& ticks,
+		bool& exact) {
+	ticks = 0;
+	exact = false;
+	if (m_timelinetpq <= 0) {
+		return false;
+	}
+	int64_t numerator = timestamp.getNumerator();
+	int64_t denominator = timestamp.getDenominator();
+	if (denominator <= 0) {
+		return false;
+	}
+	if ((numerator > INT64_MAX / m_timelinetpq) ||
+			(numerator < -(INT64_MAX / m_timelinetpq))) {
+		return false;
+	}
+	int64_t scaled = numerator * m_timelinetpq;
+	ticks = scaled / denominator;
+	exact = (scaled % denominator) == 0;
+	if (!exact && (scaled < 0)) {
+		// round down for negative timestamps
+		ticks--;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::compareTimelineTimes -- Compare two timestamps without
+//    rounding.  Returns a negative number if time1 is before time2, zero
+//    if they are the same, or a positive number if time1 is after time2.
+//
+
+int HumdrumFileBase::compareTimelineTimes(HumNum time1, HumNum time2) {
+	int64_t value1 = (int64_t)time1.getNumerator() * time2.getDenominator();
+	int64_t value2 = (int64_t)time2.getNumerator() * time1.getDenominator();
+	if (value1 < value2) {
+		return -1;
+	}
+	if (value1 > value2) {
+		return 1;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::analyzeTimeline -- Index the lines in the file by
+//    their starting times.  Lines are expected to be in time order
+//    (after rhythmic analysis).  A line which starts before the
+//    previous line is indexed with the previous line's time.  If the
+//    timestamps of the file cannot all be expressed as 64-bit ticks,
+//    then the timeline ticks per quarter note is set to 0, and the
+//    timestamps are compared directly instead.
+//
+
+void HumdrumFileBase::analyzeTimeline(void) {
+	m_timeline.clear();
+	m_timelinetpq = 1;
+	int linecount = getLineCount();
+	if (linecount == 0) {
+		return;
+	}
+
+	// Ticks per quarter note is the least common multiple of the
+	// timestamp denominators.
+	for (int i=0; i<linecount; i++) {
+		int64_t denominator = m_lines[i]->getDurationFromStart().getDenominator();
+		if (denominator <= 0) {
+			m_timelinetpq = 0;
+			break;
+		}
+		if (m_timelinetpq % denominator == 0) {
+			continue;
+		}
+		int64_t a = m_timelinetpq;
+		int64_t b = denominator;
+		while (b) {
+			int64_t t = a % b;
+			a = b;
+			b = t;
+		}
+		if (m_timelinetpq / a > INT64_MAX / denominator) {
+			// overflow
+			m_timelinetpq = 0;
+			break;
+		}
+		m_timelinetpq = m_timelinetpq / a * denominator;
+	}
+
+	int barindex = 0;
+	int measure = -1;
+	int lastdata = -1;
+	for (int i=0; i<linecount; i++) {
+		HumNum timestamp = m_lines[i]->getDurationFromStart();
+		int64_t ticks = 0;
+		bool exact = false;
+		if ((m_timelinetpq > 0) && !getTimelineTicks(timestamp, ticks, exact)) {
+			// Too large for ticks, so compare timestamps from now on.
+			m_timelinetpq = 0;
+		}
+		bool newentry;
+		if (m_timeline.empty()) {
+			newentry = true;
+		} else if (m_timelinetpq > 0) {
+			newentry = ticks > m_timeline.back().m_ticks;
+		} else {
+			newentry = compareTimelineTimes(timestamp, m_timeline.back().m_timestamp) > 0;
+		}
+		if (newentry) {
+			m_timeline.resize(m_timeline.size() + 1);
+			m_timeline.back().m_ticks = ticks;
+			m_timeline.back().m_timestamp = timestamp;
+			m_timeline.back().m_firstline = i;
+			m_timeline.back().m_lastdata = lastdata;
+		}
+		HumTimelineEntry& entry = m_timeline.back();
+		entry.m_lastline = i;
+		if (m_lines[i]->isData()) {
+			if (entry.m_firstdata < 0) {
+				entry.m_firstdata = i;
+			}
+			lastdata = i;
+			entry.m_lastdata = i;
+		}
+		while ((barindex < (int)m_barlines.size()) &&
+				(m_barlines[barindex]->getLineIndex() <= i)) {
+			measure = barindex++;
+		}
+		entry.m_measure = measure;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::updateTimeIndexesForInsert -- Add a line which has been
+//    inserted into the file at the given index to the timeline.  The line's
+//    timestamp should be set before it is inserted.  The timeline is
+//    cleared if the new line does not fit into the existing index, in
+//    which case it will be rebuilt when next needed.
+//
+
+void HumdrumFileBase::updateTimeIndexesForInsert(int index) {
+	m_metricgrids.clear();
+	if (m_timeline.empty()) {
+		return;
+	}
+	if (!m_lines[index]->m_rhythm_analyzed) {
+		// The line has no timestamp (such as a line inserted as a string).
+		clearTimeIndexes();
+		return;
+	}
+	HumNum timestamp = m_lines[index]->m_durationFromStart;
+	int64_t ticks = 0;
+	if (m_timelinetpq > 0) {
+		bool exact = false;
+		if (!getTimelineTicks(timestamp, ticks, exact) || !exact) {
+			clearTimeIndexes();
+			return;
+		}
+	}
+
+	// Move the following lines down by one:
+	for (int i=0; i<(int)m_timeline.size(); i++) {
+		HumTimelineEntry& entry = m_timeline[i];
+		if (entry.m_firstline >= index) {
+			entry.m_firstline++;
+		}
+		if (entry.m_lastline >= index) {
+			entry.m_lastline++;
+		}
+		if (entry.m_firstdata >= index) {
+			entry.m_firstdata++;
+		}
+		if (entry.m_lastdata >= index) {
+			entry.m_lastdata++;
+		}
+	}
+
+	// previous == entry containing the line before the new line.
+	int previous = -1;
+	if (index > 0) {
+		auto it = upper_bound(m_timeline.begin(), m_timeline.end(), index - 1,
+				[](int value, const HumTimelineEntry& entry) {
+					return value < entry.m_firstline;
+				});
+		previous = (int)(it - m_timeline.begin()) - 1;
+	}
+	// next == entry containing the line after the new line.
+	int next = previous + 1;
+	if ((previous >= 0) && (m_timeline[previous].m_lastline > index)) {
+		next = previous;
+	}
+
+	// target == entry which the new line is added to.
+	int target = -1;
+	if ((previous >= 0) &&
+			(compareTimelineTimes(timestamp, m_timeline[previous].m_timestamp) <= 0)) {
+		// A line which starts before the previous line is indexed
+		// with the previous line's time.
+		target = previous;
+		HumTimelineEntry& entry = m_timeline[target];
+		entry.m_lastline = std::max(entry.m_lastline, index);
+	} else if (next == previous) {
+		// The following lines in the entry would start before the new line.
+		clearTimeIndexes();
+		return;
+	} else if ((next < (int)m_timeline.size()) &&
+			(compareTimelineTimes(timestamp, m_timeline[next].m_timestamp) >= 0)) {
+		if (compareTimelineTimes(timestamp, m_timeline[next].m_timestamp) > 0) {
+			// The following lines would start before the new line.
+			clearTimeIndexes();
+			return;
+		}
+		target = next;
+		m_timeline[target].m_firstline = index;
+	} else {
+		target = next;
+		HumTimelineEntry newentry;
+		newentry.m_ticks = ticks;
+		newentry.m_timestamp = timestamp;
+		newentry.m_firstline = index;
+		newentry.m_lastline = index;
+		if (previous >= 0) {
+			newentry.m_lastdata = m_timeline[previous].m_lastdata;
+			newentry.m_measure = m_timeline[previous].m_measure;
+		}
+		m_timeline.insert(m_timeline.begin() + target, newentry);
+	}
+
+	if (!m_lines[index]->isData()) {
+		return;
+	}
+	HumTimelineEntry& entry = m_timeline[target];
+	if ((entry.m_firstdata < 0) || (entry.m_firstdata > index)) {
+		entry.m_firstdata = index;
+	}
+	// The new line is the last data line for following entries which
+	// have no data lines of their own:
+	for (int i=target; i<(int)m_timeline.size(); i++) {
+		if ((i > target) && (m_timeline[i].m_firstdata >= 0)) {
+			break;
+		}
+		if (m_timeline[i].m_lastdata < index) {
+			m_timeline[i].m_lastdata = index;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::updateTimeIndexesForDelete -- Remove a line from the
+//    timeline before it is deleted from the file.  The timeline is
+//    cleared if the index cannot be updated, in which case it will be
+//    rebuilt when next needed.
+//
+
+void HumdrumFileBase::updateTimeIndexesForDelete(int index) {
+	m_metricgrids.clear();
+	if (m_timeline.empty()) {
+		return;
+	}
+	HLp line = m_lines[index];
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		if (m_barlines[i] == line) {
+			// measure indexes will change
+			clearTimeIndexes();
+			return;
+		}
+	}
+
+	auto it = upper_bound(m_timeline.begin(), m_timeline.end(), index,
+			[](int value, const HumTimelineEntry& entry) {
+				return value < entry.m_firstline;
+			});
+	int target = (int)(it - m_timeline.begin()) - 1;
+	if (target < 0) {
+		clearTimeIndexes();
+		return;
+	}
+	HumTimelineEntry& entry = m_timeline[target];
+	bool removeQ = (entry.m_firstline == index) && (entry.m_lastline == index);
+	if ((entry.m_firstline == index) && !removeQ &&
+			(compareTimelineTimes(m_lines[index+1]->getDurationFromStart(),
+			entry.m_timestamp) != 0)) {
+		// The next line is indexed with the deleted line's time.
+		clearTimeIndexes();
+		return;
+	}
+
+	if (line->isData()) {
+		if (entry.m_firstdata == index) {
+			entry.m_firstdata = -1;
+			for (int i=index+1; i<=entry.m_lastline; i++) {
+				if (m_lines[i]->isData()) {
+					entry.m_firstdata = i;
+					break;
+				}
+			}
+		}
+		if (entry.m_lastdata == index) {
+			// The data line before the deleted one replaces it:
+			int lastdata = -1;
+			for (int i=index-1; i>=entry.m_firstline; i--) {
+				if (m_lines[i]->isData()) {
+					lastdata = i;
+					break;
+				}
+			}
+			if ((lastdata < 0) && (target > 0)) {
+				lastdata = m_timeline[target-1].m_lastdata;
+			}
+			for (int i=target; i<(int)m_timeline.size(); i++) {
+				if (m_timeline[i].m_lastdata != index) {
+					break;
+				}
+				m_timeline[i].m_lastdata = lastdata;
+			}
+		}
+	}
+
+	if (removeQ) {
+		m_timeline.erase(m_timeline.begin() + target);
+	} else if (entry.m_lastline == index) {
+		entry.m_lastline--;
+	}
+
+	// Move the following lines up by one:
+	for (int i=0; i<(int)m_timeline.size(); i++) {
+		HumTimelineEntry& tentry = m_timeline[i];
+		if (tentry.m_firstline > index) {
+			tentry.m_firstline--;
+		}
+		if (tentry.m_lastline > index) {
+			tentry.m_lastline--;
+		}
+		if (tentry.m_firstdata > index) {
+			tentry.m_firstdata--;
+		}
+		if (tentry.m_lastdata > index) {
+			tentry.m_lastdata--;
+		}
+	}
+	if (m_timeline.empty()) {
+		m_timelinetpq = 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::clearTimeIndexes -- Clear the timeline and the other
+//    analyses which index lines by time, so that they will be rebuilt
+//    when next needed.  Called when lines are added or removed, or when
+//    the rhythm is reanalyzed.
+//
+
+void HumdrumFileBase::clearTimeIndexes(void) {
+	m_timeline.clear();
+	m_metricgrids.clear();
+}
+
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::HumdrumFileBase -- HumdrumFileBase constructor.
@@ -19433,6 +20681,7 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_strand2d.clear();
 	m_strophes1d.clear();
 	m_strophes2d.clear();
+	clearTimeIndexes();
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
@@ -19471,6 +20720,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_strand2d.clear();
 	m_strophes1d.clear();
 	m_strophes2d.clear();
+	clearTimeIndexes();
 	m_quietParse = infile.m_quietParse;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
@@ -19526,6 +20776,7 @@ void HumdrumFileBase::clear(void) {
 	m_filename.clear();
 	m_segmentlevel = 0;
 	m_analyses.clear();
+	clearTimeIndexes();
 }
 
 
@@ -20176,6 +21427,69 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::getText -- Return the contents of the file as a single
+//     string, with a newline after each line.  The text is collected
+//     from the line strings into one buffer sized for the whole file.
+//
+
+string HumdrumFileBase::getText(void) {
+	size_t size = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		size += m_lines[i]->size() + 1;
+	}
+	string output;
+	output.reserve(size);
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		output += *m_lines[i];
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getTextFromTokens -- Return the contents of the file
+//     as a single string, with each line generated from its tokens.  The
+//     output is the same as calling createLinesFromTokens() and then
+//     printing the file, but the line strings are not rebuilt, so the
+//     lines in the file are not changed.  Line strings are used to
+//     estimate the size of the buffer.
+//
+
+string HumdrumFileBase::getTextFromTokens(void) {
+	size_t size = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		size += m_lines[i]->size() + 1;
+	}
+	string output;
+	output.reserve(size + size / 8);
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->appendTextFromTokens(output);
+		output += '\n';
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::printFromTokens -- Print the file with each line
+//     generated from its tokens (see getTextFromTokens()).
+//
+
+ostream& HumdrumFileBase::printFromTokens(ostream& out) {
+	string output = getTextFromTokens();
+	out.write(output.data(), output.size());
+	return out;
+}
+
+
+
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
@@ -20185,12 +21499,14 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 void HumdrumFileBase::appendLine(const string& line) {
 	HLp s = new HumdrumLine(line);
 	m_lines.push_back(s);
+	updateTimeIndexesForInsert((int)m_lines.size() - 1);
 }
 
 
 void HumdrumFileBase::appendLine(HLp line) {
 	// deletion will be handled by class.
 	m_lines.push_back(line);
+	updateTimeIndexesForInsert((int)m_lines.size() - 1);
 }
 
 
@@ -20209,6 +21525,7 @@ void HumdrumFileBase::insertLine(int index, const string& line) {
 	for (int i=index; i<(int)m_lines.size(); i++) {
 		m_lines[i]->setLineIndex(i);
 	}
+	updateTimeIndexesForInsert(index);
 }
 
 
@@ -20220,6 +21537,7 @@ void HumdrumFileBase::insertLine(int index, HLp line) {
 	for (int i=index; i<(int)m_lines.size(); i++) {
 		m_lines[i]->setLineIndex(i);
 	}
+	updateTimeIndexesForInsert(index);
 }
 
 
@@ -20239,9 +21557,11 @@ void HumdrumFileBase::deleteLine(int index) {
 	if (index < 0) {
 		return;
 	}
+	updateTimeIndexesForDelete(index);
 	delete m_lines[index];
 	for (int i=index+1; i<(int)m_lines.size(); i++) {
 		m_lines[i-1] = m_lines[i];
+		m_lines[i-1]->setLineIndex(i-1);
 	}
 	m_lines.resize(m_lines.size() - 1);
 }
@@ -20979,6 +22299,7 @@ bool HumdrumFileBase::stitchLinesTogether(HumdrumLine& previous,
 bool HumdrumFileBase::analyzeSpines(void) {
 	vector<string> datatype;
 	vector<string> sinfo;
+	vector<const string*> sinfoid;  // interned copies of sinfo
 	vector<vector<HTp> > lastspine;
 	m_trackstarts.resize(0);
 	m_trackends.resize(0);
@@ -21003,12 +22324,14 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			init = true;
 			datatype.resize(m_lines[i]->getTokenCount());
 			sinfo.resize(m_lines[i]->getTokenCount());
+			sinfoid.resize(m_lines[i]->getTokenCount());
 			lastspine.resize(m_lines[i]->getTokenCount());
 			for (j=0; j<m_lines[i]->getTokenCount(); j++) {
 				datatype[j] = m_lines[i]->getTokenString(j);
 				addToTrackStarts(m_lines[i]->token(j));
 				sinfo[j]    = to_string(j+1);
-				m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+				sinfoid[j]  = HumAddress::internSpineInfo(sinfo[j]);
+				m_lines[i]->token(j)->setSpineInfo(sinfoid[j]);
 				m_lines[i]->token(j)->setFieldIndex(j);
 				lastspine[j].push_back(m_lines[i]->token(j));
 			}
@@ -21026,13 +22349,17 @@ bool HumdrumFileBase::analyzeSpines(void) {
 			return setParseError(err);
 		}
 		for (j=0; j<m_lines[i]->getTokenCount(); j++) {
-			m_lines[i]->token(j)->setSpineInfo(sinfo[j]);
+			m_lines[i]->token(j)->setSpineInfo(sinfoid[j]);
 			m_lines[i]->token(j)->setFieldIndex(j);
 		}
 		if (!m_lines[i]->isManipulator()) {
 			continue;
 		}
 		if (!adjustSpines(*m_lines[i], datatype, sinfo)) { return isValid(); }
+		sinfoid.resize(sinfo.size());
+		for (j=0; j<(int)sinfo.size(); j++) {
+			sinfoid[j] = HumAddress::internSpineInfo(sinfo[j]);
+		}
 	}
 	return isValid();
 }
@@ -21425,7 +22752,7 @@ bool HumdrumFileBase::processNonNullDataTokensForTrackForward(HTp starttoken,
 //    variable in HumdrumTokens)
 //
 
-void HumdrumFileBase::addUniqueTokens(vector<HTp>& target,
+void HumdrumFileBase::addUniqueTokens(HumTokenLinks& target,
 		vector<HTp>& source) {
 	int i, j;
 	bool found;
@@ -21655,9 +22982,8 @@ void HumdrumFileBase::fixMerges(int linei) {
 //
 
 ostream& operator<<(ostream& out, HumdrumFileBase& infile) {
-	for (int i=0; i<infile.getLineCount(); i++) {
-		out << infile[i] << '\n';
-	}
+	string output = infile.getText();
+	out.write(output.data(), output.size());
 	return out;
 }
 
@@ -21799,41 +23125,27 @@ std::string HumdrumFileBase::getReferenceRecord(const std::string& key) {
 //
 
 HLp HumdrumFileBase::insertNullDataLine(HumNum timestamp) {
-	// for now do a linear search for the insertion point, but later
-	// do something more efficient.
 	HumdrumFileBase& infile = *this;
-	HumNum beforet(-1);
-	HumNum aftert(-1);
-	int beforei = -1;
-	// int afteri = -1;
-	HumNum current;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		current = infile[i].getDurationFromStart();
-		if (current == timestamp) {
-			return &infile[i];
-		} else if (current < timestamp) {
-			beforet = current;
-			beforei = i;
-		} else if (current > timestamp) {
-			aftert = current;
-			// afteri = i;
-			break;
-		}
+	bool exact = false;
+	int index = getTimelineIndex(timestamp, exact);
+	if (index < 0) {
+		return NULL;
 	}
-
+	const HumTimelineEntry& entry = m_timeline[index];
+	if (exact && (entry.m_firstdata >= 0)) {
+		return &infile[entry.m_firstdata];
+	}
+	int beforei = entry.m_lastdata;
 	if (beforei < 0) {
 		return NULL;
 	}
+	HumNum beforet = infile[beforei].getDurationFromStart();
 	HLp newline = new HumdrumLine;
 	// copyStructure will add null tokens automatically
 	newline->copyStructure(&infile[beforei], ".");
 
-	infile.insertLine(beforei+1, newline);
-
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum delta = timestamp - beforet;
 	HumNum durationFromStart = infile[beforei].getDurationFromStart() + delta;
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline() + delta;
@@ -21846,6 +23158,8 @@ HLp HumdrumFileBase::insertNullDataLine(HumNum timestamp) {
 	newline->m_duration = infile[beforei].m_duration - delta;
 	infile[beforei].m_duration = delta;
 
+	infile.insertLine(beforei+1, newline);
+
 	for (int i=0; i<infile[beforei].getFieldCount(); i++) {
 		HTp token = infile.token(beforei, i);
 		HTp newtoken = newline->token(i);
@@ -21867,32 +23181,8 @@ HLp HumdrumFileBase::insertNullDataLine(HumNum timestamp) {
 //
 
 HLp HumdrumFileBase::insertNullInterpretationLine(HumNum timestamp) {
-	// for now do a linear search for the insertion point, but later
-	// do something more efficient.
 	HumdrumFileBase& infile = *this;
-	HumNum beforet(-1);
-	HumNum aftert(-1);
-	int beforei = -1;
-	// int afteri = -1;
-	HumNum current;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isData()) {
-			continue;
-		}
-		current = infile[i].getDurationFromStart();
-		if (current == timestamp) {
-			beforei = i;
-			break;
-		} else if (current < timestamp) {
-			beforet = current;
-			beforei = i;
-		} else if (current > timestamp) {
-			aftert = current;
-			// afteri = i;
-			break;
-		}
-	}
-
+	int beforei = getDataLineAtTime(timestamp);
 	if (beforei < 0) {
 		return NULL;
 	}
@@ -21905,15 +23195,8 @@ HLp HumdrumFileBase::insertNullInterpretationLine(HumNum timestamp) {
 
 	int targeti = target->getLineIndex();
 
-	// There will be problems with linking to previous line if it is
-	// a manipulator.
-	// infile.insertLine(targeti-1, newline);
-	infile.insertLine(targeti, newline);
-
-	// inserted line will increment beforei by one:
-	beforei++;
-
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum durationFromStart = infile[beforei].getDurationFromStart();
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline();
 	HumNum durationToBarline = infile[beforei].getDurationToBarline();
@@ -21924,6 +23207,11 @@ HLp HumdrumFileBase::insertNullInterpretationLine(HumNum timestamp) {
 
 	newline->m_duration = 0;
 
+	// There will be problems with linking to previous line if it is
+	// a manipulator.
+	// infile.insertLine(targeti-1, newline);
+	infile.insertLine(targeti, newline);
+
 	// Problems here if targeti line is a manipulator.
 	for (int i=0; i<infile[targeti].getFieldCount(); i++) {
 		HTp token = infile.token(targeti, i);
@@ -21959,15 +23247,10 @@ HLp HumdrumFileBase::insertNullInterpretationLineAboveIndex(int index) {
 
 	int targeti = target->getLineIndex();
 
-	// There will be problems with linking to previous line if it is
-	// a manipulator.
-	// infile.insertLine(targeti-1, newline);
-	infile.insertLine(targeti, newline);
-
-	// inserted line will increment insertion line by one:
-	int beforei = index + 1;
+	int beforei = index;
 
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum durationFromStart = infile[beforei].getDurationFromStart();
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline();
 	HumNum durationToBarline = infile[beforei].getDurationToBarline();
@@ -21978,6 +23261,11 @@ HLp HumdrumFileBase::insertNullInterpretationLineAboveIndex(int index) {
 
 	newline->m_duration = 0;
 
+	// There will be problems with linking to previous line if it is
+	// a manipulator.
+	// infile.insertLine(targeti-1, newline);
+	infile.insertLine(targeti, newline);
+
 	// Problems here if targeti line is a manipulator.
 	for (int i=0; i<infile[targeti].getFieldCount(); i++) {
 		HTp token = infile.token(targeti, i);
@@ -21999,29 +23287,8 @@ HLp HumdrumFileBase::insertNullInterpretationLineAboveIndex(int index) {
 //
 
 HLp HumdrumFileBase::insertNullInterpretationLineAbove(HumNum timestamp) {
-	// for now do a linear search for the insertion point, but later
-	// do something more efficient.
 	HumdrumFileBase& infile = *this;
-	HumNum beforet(-1);
-	HumNum aftert(-1);
-	int beforei = -1;
-	// int afteri = -1;
-	HumNum current;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		current = infile[i].getDurationFromStart();
-		if (current == timestamp) {
-			beforei = i;
-			break;
-		} else if (current < timestamp) {
-			beforet = current;
-			beforei = i;
-		} else if (current > timestamp) {
-			aftert = current;
-			// afteri = i;
-			break;
-		}
-	}
-
+	int beforei = getLineAtTime(timestamp);
 	if (beforei < 0) {
 		return NULL;
 	}
@@ -22034,15 +23301,8 @@ HLp HumdrumFileBase::insertNullInterpretationLineAbove(HumNum timestamp) {
 
 	int targeti = target->getLineIndex();
 
-	// There will be problems with linking to previous line if it is
-	// a manipulator.
-	// infile.insertLine(targeti-1, newline);
-	infile.insertLine(targeti, newline);
-
-	// inserted line will increment beforei by one:
-	beforei++;
-
-	// Set the timestamp information for inserted line:
+	// Set the timestamp information for inserted line (before inserting
+	// it so that the timeline can be updated):
 	HumNum durationFromStart = infile[beforei].getDurationFromStart();
 	HumNum durationFromBarline = infile[beforei].getDurationFromBarline();
 	HumNum durationToBarline = infile[beforei].getDurationToBarline();
@@ -22053,6 +23313,11 @@ HLp HumdrumFileBase::insertNullInterpretationLineAbove(HumNum timestamp) {
 
 	newline->m_duration = 0;
 
+	// There will be problems with linking to previous line if it is
+	// a manipulator.
+	// infile.insertLine(targeti-1, newline);
+	infile.insertLine(targeti, newline);
+
 	// Problems here if targeti line is a manipulator.
 	for (int i=0; i<infile[targeti].getFieldCount(); i++) {
 		HTp token = infile.token(targeti, i);
@@ -22159,6 +23424,26 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 	// ottava marks must be analyzed first:
 	this->analyzeOttavas();
 
+	bool status = analyzeKernAccidentals(0);
+
+	// Indicate that the accidental analysis has been done:
+	this->setValue("auto", "accidentalAnalysis", "true");
+
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeKernAccidentals -- Identify accidentals in
+//    a single **kern track, or in all **kern tracks if onlytrack is 0.
+//    Only tokens in the given track are modified, so separate tracks can
+//    be analyzed at the same time (see analyzeAllContent()).  Ottavas
+//    must be analyzed before calling this function.
+//
+
+bool HumdrumFileContent::analyzeKernAccidentals(int onlytrack) {
 	HumdrumFileContent& infile = *this;
 	int i, j, k;
 	int kindex;
@@ -22224,6 +23509,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 				}
 				if (infile[i].token(j)->compare(0, 3, "*k[") == 0) {
 					track = infile[i].token(j)->getTrack();
+					if (onlytrack && (track != onlytrack)) {
+						continue;
+					}
 					kindex = rtracks[track];
 					fillKeySignature(keysigs[kindex], *infile[i].token(j));
 					// resetting key states of current measure.  What to do if this
@@ -22244,6 +23532,9 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 				}
 				std::fill(firstinbar.begin(), firstinbar.end(), 1);
 				track = infile[i].token(j)->getTrack();
+				if (onlytrack && (track != onlytrack)) {
+					continue;
+				}
 				kindex = rtracks[track];
 				// reset the accidental states in dstates to match keysigs.
 				resetDiatonicStatesWithKeySignature(dstates[kindex],
@@ -22271,8 +23562,11 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 				continue;
 			}
 
-			int subcount = infile[i].token(j)->getSubtokenCount();
 			track = infile[i].token(j)->getTrack();
+			if (onlytrack && (track != onlytrack)) {
+				continue;
+			}
+			int subcount = infile[i].token(j)->getSubtokenCount();
 
 			if (lasttrack != track) {
 				fill(concurrentstate.begin(), concurrentstate.end(), 0);
@@ -22580,9 +23874,6 @@ bool HumdrumFileContent::analyzeKernAccidentals(void) {
 		std::fill(firstinbar.begin(), firstinbar.end(), 0);
 	}
 
-	// Indicate that the accidental analysis has been done:
-	infile.setValue("auto", "accidentalAnalysis", "true");
-
 	return true;
 }
 
@@ -22730,7 +24021,7 @@ bool HumdrumFileContent::hasDifferentBarlines(void) {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::getMetricLevels -- Each line in the output
+// HumdrumFileContent::getMetricLevels -- Each line in the output
 //     vector matches to the line of the metric analysis data.
 //     undefined is the value to represent undefined analysis data
 //     (for non-data spines).
@@ -22744,18 +24035,71 @@ bool HumdrumFileContent::hasDifferentBarlines(void) {
 
 void HumdrumFileContent::getMetricLevels(vector<double>& output,
 		int track, double undefined) {
+	const vector<double>& levels = getMetricGrid(track).m_level;
+	output = levels;
+	if (!std::isnan(undefined)) {
+		for (int i=0; i<(int)output.size(); i++) {
+			if (std::isnan(output[i])) {
+				output[i] = undefined;
+			}
+		}
+	}
+}
 
-	HumdrumFileStructure& infile = *this;
-	int lineCount = infile.getLineCount();
-	output.resize(lineCount);
-	fill(output.begin(), output.end(), undefined);
-	vector<HTp> kernspines = infile.getKernSpineStartList();
-	if ((track == 0) && (kernspines.size() > 0)) {
-		track = kernspines[0]->getTrack();
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::getMetricGrid -- Return the metric analysis of
+//     each line in the file, using the time signatures of the given
+//     track (0 means the first **kern track, as in getMetricLevels()).
+//     The analysis is calculated the first time it is needed for a
+//     track, and then shared by all later calls until the lines or
+//     rhythm of the file change.
+//
+
+const HumMetricGrid& HumdrumFileContent::getMetricGrid(int track) {
+	if (track == 0) {
+		vector<HTp> kernspines = getKernSpineStartList();
+		if (kernspines.size() > 0) {
+			track = kernspines[0]->getTrack();
+		}
 	}
 	if (track == 0) {
 		track = 1;
 	}
+	auto it = m_metricgrids.find(track);
+	if (it != m_metricgrids.end()) {
+		return it->second;
+	}
+	// Fill the grid before storing it, since line access may trigger
+	// a rhythm analysis that clears the stored grids:
+	HumMetricGrid grid;
+	fillMetricGrid(grid, track);
+	HumMetricGrid& output = m_metricgrids[track];
+	output = std::move(grid);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileContent::fillMetricGrid -- Calculate the metric analysis
+//     for the given track.  Beat levels are calculated from the position
+//     of each data line in its measure and the time signature in effect.
+//
+
+void HumdrumFileContent::fillMetricGrid(HumMetricGrid& grid, int track) {
+	HumdrumFileStructure& infile = *this;
+	int lineCount = infile.getLineCount();
+	grid.m_track = track;
+	grid.m_level.assign(lineCount, NAN);
+	grid.m_position.assign(lineCount, 0);
+	grid.m_beat.assign(lineCount, 0);
+	grid.m_measure.assign(lineCount, -1);
+	grid.m_metertop.assign(lineCount, 0);
+	grid.m_meterbottom.assign(lineCount, 0);
 
 	int top = 1;                // top number of time signature (0 for no meter)
 	int bot = 4;                // bottom number of time signature
@@ -22765,6 +24109,13 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 	HumNum combeatdur;          // for adjusting beat level in compound meters
 	HumNum commeasurepos;       // for adjusting beat level in compound meters
 
+	// Beat durations at each line, stored until the ticks per quarter
+	// note are known:
+	vector<HumNum> beatdurs(lineCount);
+	vector<int> dems;
+	dems.push_back(infile.tpq());
+
+	int measure = -1;
 	for (int i=0; i<lineCount; i++) {
 		if (infile[i].isInterpretation()) {
 			// check for time signature:
@@ -22784,10 +24135,20 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 					} else {
 						compoundQ = false;
 					}
+					dems.push_back(beatdur.getDenominator());
 					break;
 				}
 			}
 		}
+		while ((measure + 1 < (int)m_barlines.size()) &&
+				(m_barlines[measure + 1]->getLineIndex() <= i)) {
+			measure++;
+		}
+		grid.m_measure[i] = measure;
+		grid.m_metertop[i] = top;
+		grid.m_meterbottom[i] = bot;
+		beatdurs[i] = beatdur;
+
 		if (!infile[i].isData()) {
 				continue;
 		}
@@ -22798,8 +24159,8 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 		measurepos /= beatdur;
 		int denominator = measurepos.getDenominator();
 		if (compoundQ) {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(3.0));
-			if ((output[i] != 0.0) && (output[i] != 1.0)) {
+			grid.m_level[i] = Convert::nearIntQuantize(log(denominator) / log(3.0));
+			if ((grid.m_level[i] != 0.0) && (grid.m_level[i] != 1.0)) {
 				// if not the beat or first level, then calculate
 				// levels above level 1.  In 6/8 this means
 				// to move the 8th note level to be the "beat"
@@ -22808,12 +24169,20 @@ void HumdrumFileContent::getMetricLevels(vector<double>& output,
 				combeatdur.setValue(4,bot);
 				commeasurepos = infile[i].getDurationFromBarline() / combeatdur;
 				denominator = commeasurepos.getDenominator();
-				output[i] = 1.0 + log(denominator)/log(2.0);
+				grid.m_level[i] = 1.0 + log(denominator)/log(2.0);
 			}
 		} else {
-			output[i] = Convert::nearIntQuantize(log(denominator) / log(2.0));
+			grid.m_level[i] = Convert::nearIntQuantize(log(denominator) / log(2.0));
 		}
 	}
+
+	grid.m_tpq = Convert::getLcm(dems);
+	for (int i=0; i<lineCount; i++) {
+		HumNum position = infile[i].getDurationFromBarline() * grid.m_tpq;
+		HumNum beat = beatdurs[i] * grid.m_tpq;
+		grid.m_position[i] = position.getNumerator() / position.getDenominator();
+		grid.m_beat[i] = beat.getNumerator() / beat.getDenominator();
+	}
 }
 
 
@@ -23214,6 +24583,153 @@ void HumdrumFileContent::analyzeOttavas(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::analyzeAllContent -- Analyze accidentals, slurs,
+//    phrases, ties, rest positions and stem lengths.  Each **kern track
+//    is a separate job, and jobs are taken by the worker threads as they
+//    become free.  A job runs the analyses for its track one after
+//    another, and only modifies tokens in that track.  Analyses which
+//    link tokens across tracks (ties and linked slurs/phrases) are done
+//    after the jobs have finished.  The results are the same as running
+//    each analysis separately.  A thread count of 0 uses one thread for
+//    each hardware thread.  Slurs, phrases and accidentals are skipped if
+//    they have already been analyzed.
+//
+
+bool HumdrumFileContent::analyzeAllContent(int threads) {
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	if (threads <= 0) {
+		threads = 1;
+	}
+
+	// Analyses done on demand by the jobs must be done before they start:
+	if (!isRhythmAnalyzed()) {
+		analyzeRhythmStructure();
+	}
+	resolveNullTokens();
+
+	bool slursQ = !m_analyses.m_slurs_analyzed;
+	bool phrasesQ = !m_analyses.m_phrases_analyzed;
+	bool accidentalsQ = !getValueBool("auto", "accidentalAnalysis");
+	m_analyses.m_slurs_analyzed = true;
+	m_analyses.m_phrases_analyzed = true;
+	if (accidentalsQ) {
+		analyzeOttavas();
+	}
+
+	vector<pair<HTp, HTp>> labels;
+	vector<int> endings;
+	if (slursQ || phrasesQ) {
+		getLabelSequence(labels, endings);
+	}
+	string linkSignifier = m_signifiers.getKernLinkSignifier();
+
+	vector<vector<int>> centerlines;
+	getBaselines(centerlines);
+
+	vector<HTp> kernstarts = getKernSpineStartList();
+	int jobcount = (int)kernstarts.size();
+	vector<int> jobindex(getMaxTrack() + 1, -1);
+	for (int i=0; i<jobcount; i++) {
+		jobindex[kernstarts[i]->getTrack()] = i;
+	}
+
+	// strands == the strands in each job, for stem-length analysis.
+	vector<vector<pair<HTp, HTp>>> strands(jobcount);
+	for (int i=0; i<getStrandCount(); i++) {
+		HTp sstart = getStrandStart(i);
+		if (!sstart->isKern()) {
+			continue;
+		}
+		strands[jobindex[sstart->getTrack()]].emplace_back(sstart, getStrandEnd(i));
+	}
+
+	// Linked slurs and phrases are collected for each job, then
+	// joined in spine order.
+	vector<vector<HTp>> slurstarts(jobcount);
+	vector<vector<HTp>> slurends(jobcount);
+	vector<vector<HTp>> phrasestarts(jobcount);
+	vector<vector<HTp>> phraseends(jobcount);
+	vector<char> status(jobcount, 1);
+
+	std::atomic<int> nextjob(0);
+	auto processJobs = [&]() {
+		int job;
+		while ((job = nextjob++) < jobcount) {
+			HTp kernstart = kernstarts[job];
+			bool output = true;
+			if (accidentalsQ) {
+				output &= analyzeKernAccidentals(kernstart->getTrack());
+			}
+			if (slursQ) {
+				output &= analyzeKernSlurs(kernstart, slurstarts[job],
+						slurends[job], labels, endings, linkSignifier);
+			}
+			if (phrasesQ) {
+				output &= analyzeKernPhrasings(kernstart, phrasestarts[job],
+						phraseends[job], labels, endings, linkSignifier);
+			}
+			assignImplicitVerticalRestPositions(kernstart);
+			for (int i=0; i<(int)strands[job].size(); i++) {
+				output &= analyzeKernStemLengths(strands[job][i].first,
+						strands[job][i].second, centerlines);
+			}
+			status[job] = output;
+		}
+	};
+
+	threads = std::min(threads, jobcount);
+	if (threads <= 1) {
+		processJobs();
+	} else {
+		vector<std::thread> workers;
+		for (int i=0; i<threads; i++) {
+			workers.emplace_back(processJobs);
+		}
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	bool output = true;
+	for (int i=0; i<jobcount; i++) {
+		output &= (bool)status[i];
+	}
+
+	if (slursQ) {
+		vector<HTp> linkstarts;
+		vector<HTp> linkends;
+		for (int i=0; i<jobcount; i++) {
+			linkstarts.insert(linkstarts.end(), slurstarts[i].begin(), slurstarts[i].end());
+			linkends.insert(linkends.end(), slurends[i].begin(), slurends[i].end());
+		}
+		createLinkedSlurs(linkstarts, linkends);
+		output &= analyzeMensSlurs();
+	}
+	if (phrasesQ) {
+		vector<HTp> linkstarts;
+		vector<HTp> linkends;
+		for (int i=0; i<jobcount; i++) {
+			linkstarts.insert(linkstarts.end(), phrasestarts[i].begin(), phrasestarts[i].end());
+			linkends.insert(linkends.end(), phraseends[i].begin(), phraseends[i].end());
+		}
+		createLinkedPhrasings(linkstarts, linkends);
+	}
+	if (accidentalsQ) {
+		setValue("auto", "accidentalAnalysis", "true");
+	}
+	output &= analyzeKernTies();
+	checkForExplicitVerticalRestPositions();
+
+	return output;
+}
+
+
+
+
 
 //////////////////////////////
 //
@@ -23243,53 +24759,9 @@ bool HumdrumFileContent::analyzeKernPhrasings(void) {
 	vector<HTp> phrasestarts;
 	vector<HTp> phraseends;
 
-	vector<HTp> l;
 	vector<pair<HTp, HTp>> labels; // first is previous label, second is next label
-	HumdrumFileBase& infile = *this;
-	labels.resize(infile.getLineCount());
-	l.resize(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		labels[i].first = NULL;
-		labels[i].second = NULL;
-		l[i] = NULL;
-	}
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		HTp token = infile.token(i, 0);
-		if ((token->compare(0, 2, "*>") == 0) && (token->find("[") == std::string::npos)) {
-			l[i] = token;
-		}
-	}
-	HTp current = NULL;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (l[i] != NULL) {
-			current = l[i];
-		}
-		labels[i].first = current;
-	}
-	current = NULL;
-	for (int i=infile.getLineCount() - 1; i>=0; i--) {
-		if (l[i] != NULL) {
-			current = l[i];
-		}
-		labels[i].second = current;
-	}
-
-	vector<int> endings(infile.getLineCount(), 0);
-	int ending = 0;
-	for (int i=0; i<(int)endings.size(); i++) {
-		if (l[i]) {
-			char lastchar = l[i]->back();
-			if (isdigit(lastchar)) {
-				ending = lastchar - '0';
-			} else {
-				ending = 0;
-			}
-		}
-		endings[i] = ending;
-	}
+	vector<int> endings;
+	getLabelSequence(labels, endings);
 
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
@@ -24304,53 +25776,9 @@ bool HumdrumFileContent::analyzeMensSlurs(void) {
 	vector<HTp> slurstarts;
 	vector<HTp> slurends;
 
-	vector<HTp> l;
 	vector<pair<HTp, HTp>> labels; // first is previous label, second is next label
-	HumdrumFileBase& infile = *this;
-	labels.resize(infile.getLineCount());
-	l.resize(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		labels[i].first = NULL;
-		labels[i].second = NULL;
-		l[i] = NULL;
-	}
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		HTp token = infile.token(i, 0);
-		if ((token->compare(0, 2, "*>") == 0) && (token->find("[") == std::string::npos)) {
-			l[i] = token;
-		}
-	}
-	HTp current = NULL;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (l[i] != NULL) {
-			current = l[i];
-		}
-		labels[i].first = current;
-	}
-	current = NULL;
-	for (int i=infile.getLineCount() - 1; i>=0; i--) {
-		if (l[i] != NULL) {
-			current = l[i];
-		}
-		labels[i].second = current;
-	}
-
-	vector<int> endings(infile.getLineCount(), 0);
-	int ending = 0;
-	for (int i=0; i<(int)endings.size(); i++) {
-		if (l[i]) {
-			char lastchar = l[i]->back();
-			if (isdigit(lastchar)) {
-				ending = lastchar - '0';
-			} else {
-				ending = 0;
-			}
-		}
-		endings[i] = ending;
-	}
+	vector<int> endings;
+	getLabelSequence(labels, endings);
 
 	vector<HTp> mensspines;
 	getSpineStartList(mensspines, "**mens");
@@ -24375,53 +25803,9 @@ bool HumdrumFileContent::analyzeKernSlurs(void) {
 	vector<HTp> slurstarts;
 	vector<HTp> slurends;
 
-	vector<HTp> l;
 	vector<pair<HTp, HTp>> labels; // first is previous label, second is next label
-	HumdrumFileBase& infile = *this;
-	labels.resize(infile.getLineCount());
-	l.resize(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		labels[i].first = NULL;
-		labels[i].second = NULL;
-		l[i] = NULL;
-	}
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].isInterpretation()) {
-			continue;
-		}
-		HTp token = infile.token(i, 0);
-		if ((token->compare(0, 2, "*>") == 0) && (token->find("[") == std::string::npos)) {
-			l[i] = token;
-		}
-	}
-	HTp current = NULL;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (l[i] != NULL) {
-			current = l[i];
-		}
-		labels[i].first = current;
-	}
-	current = NULL;
-	for (int i=infile.getLineCount() - 1; i>=0; i--) {
-		if (l[i] != NULL) {
-			current = l[i];
-		}
-		labels[i].second = current;
-	}
-
-	vector<int> endings(infile.getLineCount(), 0);
-	int ending = 0;
-	for (int i=0; i<(int)endings.size(); i++) {
-		if (l[i]) {
-			char lastchar = l[i]->back();
-			if (isdigit(lastchar)) {
-				ending = lastchar - '0';
-			} else {
-				ending = 0;
-			}
-		}
-		endings[i] = ending;
-	}
+	vector<int> endings;
+	getLabelSequence(labels, endings);
 
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
@@ -24707,6 +26091,62 @@ void HumdrumFileContent::linkSlurEndpoints(HTp slurstart, HTp slurend) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileContent::getLabelSequence -- For each line, store the
+//    previous and next expansion label in labels, and the number of the
+//    repeat ending that the line is in (or 0 if none) in endings.
+//
+
+void HumdrumFileContent::getLabelSequence(vector<pair<HTp, HTp>>& labels,
+		vector<int>& endings) {
+	HumdrumFileBase& infile = *this;
+	int linecount = infile.getLineCount();
+	vector<HTp> l(linecount, NULL);
+	for (int i=0; i<linecount; i++) {
+		if (!infile[i].isInterpretation()) {
+			continue;
+		}
+		HTp token = infile.token(i, 0);
+		if ((token->compare(0, 2, "*>") == 0) && (token->find("[") == std::string::npos)) {
+			l[i] = token;
+		}
+	}
+
+	labels.resize(linecount);
+	HTp current = NULL;
+	for (int i=0; i<linecount; i++) {
+		if (l[i] != NULL) {
+			current = l[i];
+		}
+		labels[i].first = current;
+	}
+	current = NULL;
+	for (int i=linecount - 1; i>=0; i--) {
+		if (l[i] != NULL) {
+			current = l[i];
+		}
+		labels[i].second = current;
+	}
+
+	endings.resize(linecount);
+	int ending = 0;
+	for (int i=0; i<linecount; i++) {
+		if (l[i]) {
+			char lastchar = l[i]->back();
+			if (isdigit(lastchar)) {
+				ending = lastchar - '0';
+			} else {
+				ending = 0;
+			}
+		}
+		endings[i] = ending;
+	}
+}
+
+
+
+
 
 
 //////////////////////////////
@@ -26193,6 +27633,98 @@ void HumdrumFileStream::fillUrlBuffer(stringstream& uribuffer,
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::getMeasure -- Return a description of the
+//    measure starting at the given barline index.  Negative index
+//    accesses from the end of the list.  Returns an empty description
+//    (with m_index set to -1) if the index is out of range.
+//
+
+HumMeasureInfo HumdrumFileStructure::getMeasure(int index) const {
+	HumMeasureInfo output;
+	if (index < 0) {
+		index += (int)m_barlines.size();
+	}
+	if ((index < 0) || (index >= (int)m_barlines.size())) {
+		return output;
+	}
+
+	HLp startline = m_barlines[index];
+	HLp nextbar = NULL;
+	if (index + 1 < (int)m_barlines.size()) {
+		nextbar = m_barlines[index+1];
+	}
+
+	output.m_index = index;
+	output.m_startline = startline->getLineIndex();
+	if (nextbar) {
+		output.m_endline = nextbar->getLineIndex() - 1;
+	} else {
+		output.m_endline = getLineCount() - 1;
+	}
+	output.m_durationFromStart = startline->getDurationFromStart();
+	if (nextbar) {
+		output.m_duration = nextbar->getDurationFromStart() - output.m_durationFromStart;
+	} else {
+		output.m_duration = getScoreDuration() - output.m_durationFromStart;
+	}
+
+	if (startline->isBarline() && (startline->getFieldCount() > 0)) {
+		output.m_barline = startline->token(0);
+		output.m_number = startline->getBarNumber();
+		const string& bar = *output.m_barline;
+		output.m_repeatstart = (bar.find("|:") != string::npos) ||
+				(bar.find("!:") != string::npos);
+	}
+	if (nextbar && nextbar->isBarline() && (nextbar->getFieldCount() > 0)) {
+		const string& bar = *nextbar->token(0);
+		output.m_repeatend = (bar.find(":|") != string::npos) ||
+				(bar.find(":!") != string::npos);
+	}
+
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getMeasures -- Return a description of every
+//    measure in the file.
+//
+
+vector<HumMeasureInfo> HumdrumFileStructure::getMeasures(void) const {
+	vector<HumMeasureInfo> output(m_barlines.size());
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		output[i] = getMeasure(i);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::getMeasureIndex -- Return the index of the
+//    measure which contains the given line.  Returns -1 if the line
+//    is before the first measure or is not a line in the file.
+//
+
+int HumdrumFileStructure::getMeasureIndex(int lineindex) const {
+	if ((lineindex < 0) || (lineindex >= getLineCount())) {
+		return -1;
+	}
+	auto it = upper_bound(m_barlines.begin(), m_barlines.end(), lineindex,
+			[](int value, HLp line) {
+				return value < line->getLineIndex();
+			});
+	return (int)(it - m_barlines.begin()) - 1;
+}
+
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeStropheMarkers -- Merge this
@@ -26618,6 +28150,49 @@ bool HumdrumFileStructure::analyzeStructure(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeStructureFromTokens -- Analyze content
+//    which was built or edited at the token level (such as the output of
+//    HumGrid::transferTokens()) without printing and reparsing it.  Line
+//    text is regenerated from the tokens, and a line is only re-tokenized
+//    when a reparse would split its tokens differently.
+//
+
+bool HumdrumFileStructure::analyzeStructureFromTokens(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		line.setOwner(this);
+		line.createLineFromTokens();
+		bool retokenize = (line.getTokenCount() > 1) && (line.compare(0, 2, "!!") == 0);
+		for (int j=0; j<line.getTokenCount(); j++) {
+			line.token(j)->setOwner(&line);
+			if (line.token(j)->find('\t') != string::npos) {
+				retokenize = true;
+			}
+		}
+		if (retokenize) {
+			line.createTokensFromLine();
+		}
+	}
+
+	m_barlines.clear();
+	m_ticksperquarternote = -1;
+	m_strand1d.clear();
+	m_strand2d.clear();
+	m_strophes1d.clear();
+	m_strophes2d.clear();
+	m_analyses.clear();
+
+	m_displayError = false;
+	if (!analyzeBaseFromTokens()) {
+		return isValid();
+	}
+	return analyzeStructure();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze global/local
@@ -26645,6 +28220,8 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 
 bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 	m_analyses.m_rhythm_analyzed = true;
+	// line timestamps will change, so rebuild timeline when needed:
+	clearTimeIndexes();
 	setLineRhythmAnalyzed();
 	if (!isStructureAnalyzed()) {
 		if (!analyzeStructureNoRhythm()) { return isValid(); }
@@ -27013,44 +28590,8 @@ bool HumdrumFileStructure::analyzeRhythm(void) {
 	if (getMaxTrack() == 0) {
 		return true;
 	}
-	int startline = getTrackStart(1)->getLineIndex();
-	int testline;
-	HumNum zero(0);
-
-	int i;
-	for (int i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
-			continue;
-		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline == startline) {
-			if (!assignDurationsToTrack(getTrackStart(i), zero)) {
-				return false;
-			}
-		} else {
-			// Spine does not start at beginning of data, so
-			// the starting position of the spine has to be
-			// determined before continuing.  Search for a token
-			// which is on a line with assigned duration, then work
-			// outwards from that position.
-			continue;
-		}
-	}
-
-	// Go back and analyze spines that do not start at the
-	// beginning of the data stream.
-	for (i=1; i<=getMaxTrack(); i++) {
-		if (!getTrackStart(i)->hasRhythm()) {
-			// Can't analyze rhythm of spines that do not have rhythm.
-			continue;
-		}
-		testline = getTrackStart(i)->getLineIndex();
-		if (testline > startline) {
-			if (!analyzeRhythmOfFloatingSpine(getTrackStart(i))) { return false; }
-		}
-	}
 
+	if (!assignDurationsFromStart()) { return false; }
 	if (!analyzeNullLineRhythms()) { return false; }
 	fillInNegativeStartTimes();
 	assignLineDurations();
@@ -27403,81 +28944,133 @@ bool HumdrumFileStructure::decrementDurStates(vector<HumNum>& durs,
 
 //////////////////////////////
 //
-// HumdrumFileStructure::assignDurationsToTrack -- Assign duration from starts
-//    for each rhythmic spine in the file.  Analysis is done recursively, one
-//    sub-spine at a time.  Duplicate analyses are prevented by the state
-//    variable in the HumdrumToken (currently called rhycheck because it is only
-//    used in this function).  After the durationFromStarts have been assigned
-//    for the rhythmic analysis of non-data tokens and non-rhythmic spines is
-//    done elsewhere.
+// HumdrumFileStructure::assignDurationsFromStart -- Assign the
+//    durationFromStart of lines from the rhythms of the tokens in the
+//    rhythmic spines.  The file is processed once from top to bottom:
+//    the start of each token is the end of the token before it in the
+//    spine (the leftmost rhythmic one after a merge), and the end times
+//    of the tokens on the last line with spines are kept in a state array.
+//    Spines which start after the beginning of the data (after *+) are
+//    timed relative to their start until one of their notes is on a line
+//    which has a known time, and then their earlier notes are placed in
+//    the score.  After the durationFromStarts have been assigned, the
+//    rhythmic analysis of non-data tokens and non-rhythmic spines is done
+//    elsewhere.
 //
 
-bool HumdrumFileStructure::assignDurationsToTrack(HTp starttoken,
-		HumNum startdur) {
-	if (!starttoken->hasRhythm()) {
-		return isValid();
-	}
-	int state = starttoken->getState();
-	if (!prepareDurations(starttoken, state, startdur)) {
-		return isValid();
-	}
-	return isValid();
-}
-
-
-
-//////////////////////////////
-//
-// HumdrumFileStructure::prepareDurations -- Helper function for
-//     HumdrumFileStructure::assignDurationsToTrack() which does all of the
-//     work for assigning durationFromStart values.
-//
-
-bool HumdrumFileStructure::prepareDurations(HTp token, int state,
-		HumNum startdur) {
-	if (state != token->getState()) {
-		return isValid();
-	}
+bool HumdrumFileStructure::assignDurationsFromStart(void) {
+	// state == end times of the tokens on the previous line with spines.
+	// group == 0 for times from the start of the score, -1 for tokens
+	// in non-rhythmic spines, or the index of a floating spine for
+	// times which are relative to the start of the floating spine.
+	vector<HumNum> laststate;
+	vector<int>    lastgroup;
+	vector<HumNum> state;
+	vector<int>    group;
 
-	HumNum dursum = startdur;
-	token->incrementState();
+	// floatstart == start time of each floating spine in the score, or
+	// negative if not known yet.  floattokens == tokens in the floating
+	// spine which are waiting for its start time.
+	vector<HumNum> floatstart(1, 0);
+	vector<vector<pair<HTp, HumNum>>> floattokens(1);
 
-	if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-	if (token->getDuration().isPositive()) {
-		dursum += token->getDuration();
-	}
-	int tcount = token->getNextTokenCount();
+	bool firstline = true;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (!line.hasSpines()) {
+			continue;
+		}
+		int fieldcount = line.getFieldCount();
+		state.assign(fieldcount, HumNum(-1));
+		group.assign(fieldcount, -1);
 
-	vector<HTp> reservoir;
-	vector<HumNum> startdurs;
+		for (int j=0; j<fieldcount; j++) {
+			HTp token = line.token(j);
+			int pcount = token->getPreviousTokenCount();
+			if (pcount == 0) {
+				if (!token->hasRhythm()) {
+					continue;
+				}
+				state[j] = 0;
+				if (firstline) {
+					group[j] = 0;
+				} else {
+					group[j] = (int)floatstart.size();
+					floatstart.push_back(-1);
+					floattokens.resize(floattokens.size() + 1);
+				}
+				continue;
+			}
+			for (int k=0; k<pcount; k++) {
+				int index = token->getPreviousToken(k)->getFieldIndex();
+				if ((index < (int)lastgroup.size()) && (lastgroup[index] >= 0)) {
+					state[j] = laststate[index];
+					group[j] = lastgroup[index];
+					break;
+				}
+			}
+			if ((group[j] > 0) && floatstart[group[j]].isNonNegative()) {
+				state[j] += floatstart[group[j]];
+				group[j] = 0;
+			}
+		}
 
-	// Assign line durationFromStarts for primary track first.
-	while (tcount > 0) {
-		for (int t=1; t<tcount; t++) {
-			reservoir.push_back(token->getNextToken(t));
-			startdurs.push_back(dursum);
+		// Tokens with times from the start of the score set the line time:
+		for (int j=0; j<fieldcount; j++) {
+			if (group[j] == 0) {
+				if (!setLineDurationFromStart(line.token(j), state[j])) { return isValid(); }
+			}
 		}
-		token = token->getNextToken(0);
-		if (state != token->getState()) {
-			break;
+
+		// Place floating spines which have a note on a line with a known time:
+		HumNum linestart = line.getDurationFromStart();
+		for (int j=0; j<fieldcount; j++) {
+			if (group[j] <= 0) {
+				continue;
+			}
+			HTp token = line.token(j);
+			bool timedQ = token->isTerminateInterpretation() ||
+					!token->getDuration().isNegative();
+			if (timedQ && linestart.isNonNegative() &&
+					floatstart[group[j]].isNegative()) {
+				HumNum offset = linestart - state[j];
+				floatstart[group[j]] = offset;
+				vector<pair<HTp, HumNum>>& waiting = floattokens[group[j]];
+				for (int k=0; k<(int)waiting.size(); k++) {
+					if (!setLineDurationFromStart(waiting[k].first, waiting[k].second + offset)) {
+						return isValid();
+					}
+				}
+				waiting.clear();
+			}
+			if (floatstart[group[j]].isNonNegative()) {
+				state[j] += floatstart[group[j]];
+				group[j] = 0;
+				if (!setLineDurationFromStart(token, state[j])) { return isValid(); }
+			} else if (timedQ) {
+				floattokens[group[j]].emplace_back(token, state[j]);
+			}
 		}
-		token->incrementState();
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
-		if (token->getDuration().isPositive()) {
-			dursum += token->getDuration();
+
+		for (int j=0; j<fieldcount; j++) {
+			if (group[j] < 0) {
+				continue;
+			}
+			HumNum duration = line.token(j)->getDuration();
+			if (duration.isPositive()) {
+				state[j] += duration;
+			}
 		}
-		tcount = token->getNextTokenCount();
-	}
 
-	if ((tcount == 0) && (token->isTerminateInterpretation())) {
-		if (!setLineDurationFromStart(token, dursum)) { return isValid(); }
+		laststate.swap(state);
+		lastgroup.swap(group);
+		firstline = false;
 	}
 
-	// Process secondary tracks next:
-	int newstate = state;
-
-	for (int i=(int)reservoir.size()-1; i>=0; i--) {
-		prepareDurations(reservoir[i], newstate, startdurs[i]);
+	for (int i=1; i<(int)floatstart.size(); i++) {
+		if (floatstart[i].isNegative()) {
+			return setParseError("Error cannot link floating spine to score.");
+		}
 	}
 
 	return isValid();
@@ -27516,54 +29109,6 @@ bool HumdrumFileStructure::setLineDurationFromStart(HTp token,
 
 
 
-//////////////////////////////
-//
-// HumdrumFileStructure::analyzeRhythmOfFloatingSpine --  This analysis
-//    function is used to analyze the rhythm of spines which do not start at
-//    the beginning of the data.  The function searches for the first line
-//    which has an assigned durationFromStart value, and then uses that
-//    as the basis for assigning the initial durationFromStart position
-//    for the spine.
-//
-
-bool HumdrumFileStructure::analyzeRhythmOfFloatingSpine(
-		HTp spinestart) {
-	HumNum dursum = 0;
-	HumNum founddur = 0;
-	HTp token = spinestart;
-	int tcount = token->getNextTokenCount();
-
-	// Find a known durationFromStart for a line in the Humdrum file, then
-	// use that to calculate the starting duration of the floating spine.
-	if (token->getDurationFromStart().isNonNegative()) {
-		founddur = token->getLine()->getDurationFromStart();
-	} else {
-		tcount = token->getNextTokenCount();
-		while (tcount > 0) {
-			if (token->getDurationFromStart().isNonNegative()) {
-				founddur = token->getLine()->getDurationFromStart();
-				break;
-			}
-			if (token->getDuration().isPositive()) {
-				dursum += token->getDuration();
-			}
-			token = token->getNextToken(0);
-		}
-	}
-
-	if (founddur.isZero()) {
-		return setParseError("Error cannot link floating spine to score.");
-	}
-
-	if (!assignDurationsToTrack(spinestart, founddur - dursum)) {
-		return isValid();
-	}
-
-	return isValid();
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumFileStructure::analyzeNullLineRhythms -- When a series of null-token
@@ -29495,27 +31040,52 @@ int HumdrumLine::createTokensFromLine(void) {
 
 void HumdrumLine::createLineFromTokens(void) {
 	string& iline = *this;
-	iline = "";
 	// needed for empty lines for some reason:
 	if (m_tokens.size()) {
 		if (m_tokens.back() == NULL) {
 			m_tokens.resize(m_tokens.size() - 1);
 		}
 	}
-	for (int i=0; i<(int)m_tokens.size(); i++) {
-		iline += (string)(*m_tokens.at(i));
-		if (i < (int)m_tokens.size() - 1) {
-			if ((int)m_tabs.size() <= i) {
-				for (int j=0; j<(int)m_tokens.size() - (int)m_tabs.size(); j++) {
-					m_tabs.push_back(1);
-				}
-			}
-			if (m_tabs.at(i) == 0) {
-				m_tabs.at(i) = 1;
-			}
-			for (int j=0; j<m_tabs.at(i); j++) {
-				iline += '\t';
-			}
+	if ((int)m_tabs.size() < (int)m_tokens.size()) {
+		m_tabs.resize(m_tokens.size(), 1);
+	}
+	for (int i=0; i<(int)m_tabs.size(); i++) {
+		if (m_tabs[i] == 0) {
+			m_tabs[i] = 1;
+		}
+	}
+	iline.clear();
+	appendTextFromTokens(iline);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::appendTextFromTokens -- Append the text of the line,
+//     generated from its tokens separated by tabs, to the output
+//     string.  This is the same text as createLineFromTokens() would
+//     store in the line, but the line is not changed, so files can be
+//     printed after editing tokens without rebuilding each line string
+//     first.  Lines without tokens append the line string.
+//
+
+void HumdrumLine::appendTextFromTokens(string& output) {
+	int count = (int)m_tokens.size();
+	if (count && (m_tokens.back() == NULL)) {
+		count--;
+	}
+	if (count == 0) {
+		if (m_tokens.empty()) {
+			output += *this;
+		}
+		return;
+	}
+	for (int i=0; i<count; i++) {
+		output += *m_tokens[i];
+		if (i < count - 1) {
+			int tabs = (i < (int)m_tabs.size()) ? m_tabs[i] : 1;
+			output.append(tabs > 0 ? tabs : 1, '\t');
 		}
 	}
 }
@@ -30399,12 +31969,12 @@ void HumdrumLine::clearTokenLinkInfo(void) {
 //
 
 ostream& operator<<(ostream& out, HumdrumLine& line) {
-	out << (string)line;
+	out << static_cast<const string&>(line);
 	return out;
 }
 
 ostream& operator<< (ostream& out, HLp line) {
-	out << (string)(*line);
+	out << static_cast<const string&>(*line);
 	return out;
 }
 
@@ -30432,7 +32002,6 @@ ostream& operator<< (ostream& out, HLp line) {
 //
 
 HumdrumToken::HumdrumToken(void) : string() {
-	m_rhycheck = 0;
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
@@ -30441,7 +32010,6 @@ HumdrumToken::HumdrumToken(void) : string() {
 
 
 HumdrumToken::HumdrumToken(const string& aString) : string(aString) {
-	m_rhycheck = 0;
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
@@ -30450,7 +32018,6 @@ HumdrumToken::HumdrumToken(const string& aString) : string(aString) {
 
 
 HumdrumToken::HumdrumToken(const char* aString) : string(aString) {
-	m_rhycheck = 0;
 	setPrefix("!");
 	m_strand = -1;
 	m_nullresolve = NULL;
@@ -30467,7 +32034,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30484,7 +32050,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30502,7 +32067,6 @@ HumdrumToken::HumdrumToken(const HumdrumToken& token, HLp owner) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30519,7 +32083,6 @@ HumdrumToken::HumdrumToken(HumdrumToken* token, HLp owner) :
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token->m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30547,7 +32110,6 @@ HumdrumToken& HumdrumToken::operator=(HumdrumToken& token) {
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = token.m_rhycheck;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30566,7 +32128,6 @@ HumdrumToken& HumdrumToken::operator=(const string& token) {
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30585,7 +32146,6 @@ HumdrumToken& HumdrumToken::operator=(const char* token) {
 	m_previousTokens.clear();
 	m_nextNonNullTokens.clear();
 	m_previousNonNullTokens.clear();
-	m_rhycheck        = -1;
 	m_strand          = -1;
 	m_nullresolve     = NULL;
 	m_strophe         = NULL;
@@ -30825,6 +32385,14 @@ void HumdrumToken::setSpineInfo(const string& spineinfo) {
 	m_address.setSpineInfo(spineinfo);
 }
 
+//
+// Interned string version (see HumAddress::internSpineInfo()):
+//
+
+void HumdrumToken::setSpineInfo(const string* spineinfo) {
+	m_address.setSpineInfo(spineinfo);
+}
+
 
 
 //////////////////////////////
@@ -33386,17 +34954,6 @@ HLp HumdrumToken::getOwner(void) const {
 
 
 
-//////////////////////////////
-//
-// HumdrumToken::getState -- Returns the rhythm state variable.
-//
-
-int HumdrumToken::getState(void) const {
-	return m_rhycheck;
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumToken::getStrandIndex -- Returns the 1-D strand index
@@ -33496,19 +35053,6 @@ void  HumdrumToken::setStrandIndex(int index) {
 
 
 
-//////////////////////////////
-//
-// HumdrumToken::incrementState -- update the rhythm analysis state variable.
-//    This will prevent redundant recursive analysis in analyzeRhythm of
-//    the HumdrumFileStructure class.
-//
-
-void HumdrumToken::incrementState(void) {
-	m_rhycheck++;
-}
-
-
-
 //////////////////////////////
 //
 // HumdrumToken::getNextTokenCount -- Returns the number of tokens in the
@@ -34169,6 +35713,115 @@ string HumdrumToken::getStropheLabel(void) {
 
 
 
+//////////////////////////////
+//
+// HumTokenLinks::HumTokenLinks -- Copy constructor.
+//
+
+HumTokenLinks::HumTokenLinks(const HumTokenLinks& links) {
+	*this = links;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::~HumTokenLinks -- Deconstructor.
+//
+
+HumTokenLinks::~HumTokenLinks() {
+	if (m_capacity) {
+		delete [] m_many;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::operator= -- Copy the links from another list.
+//
+
+HumTokenLinks& HumTokenLinks::operator=(const HumTokenLinks& links) {
+	if (this == &links) {
+		return *this;
+	}
+	m_size = 0;
+	if (links.m_size > 1) {
+		reserve(links.m_size);
+	}
+	for (int i=0; i<links.m_size; i++) {
+		(*this)[i] = links[i];
+	}
+	m_size = links.m_size;
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::resize -- Change the number of links.  New links are
+//     set to NULL.
+//
+
+void HumTokenLinks::resize(int size) {
+	if (size < 0) {
+		size = 0;
+	}
+	if (size > 1) {
+		reserve(size);
+	}
+	for (int i=m_size; i<size; i++) {
+		(*this)[i] = NULL;
+	}
+	m_size = size;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::push_back -- Add a link to the end of the list.
+//
+
+void HumTokenLinks::push_back(HTp token) {
+	if (m_size >= 1) {
+		reserve(m_size + 1);
+	}
+	(*this)[m_size] = token;
+	m_size++;
+}
+
+
+
+//////////////////////////////
+//
+// HumTokenLinks::reserve -- Move the links into an array that can
+//     hold at least the given number of links.
+//
+
+void HumTokenLinks::reserve(int capacity) {
+	if ((capacity <= 1) || (capacity <= m_capacity)) {
+		return;
+	}
+	int newcapacity = m_capacity ? m_capacity * 2 : 2;
+	if (newcapacity < capacity) {
+		newcapacity = capacity;
+	}
+	HTp* newlinks = new HTp[newcapacity];
+	for (int i=0; i<m_size; i++) {
+		newlinks[i] = (*this)[i];
+	}
+	if (m_capacity) {
+		delete [] m_many;
+	}
+	m_many = newlinks;
+	m_capacity = newcapacity;
+}
+
+
+
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -34546,6 +36199,64 @@ int MuseData::read(istream& input) {
 		}
 	}
 
+	return finishRead();
+}
+
+
+
+//////////////////////////////
+//
+// MuseData::read -- read a MuseData file from a range of lines which
+//   have already been split by getline() (such as a part segment found
+//   by MuseDataSet::read).  The lines are released after they are stored
+//   so that the full set of lines and the records are not both kept in
+//   memory.  Carriage returns are treated in the same way as when reading
+//   from an input stream.
+//
+
+int MuseData::read(vector<string>& lines, int startindex, int stopindex) {
+	m_error.clear();
+	if (stopindex >= (int)lines.size()) {
+		stopindex = (int)lines.size() - 1;
+	}
+	if (startindex < 0) {
+		startindex = 0;
+	}
+	if (stopindex >= startindex) {
+		m_data.reserve(m_data.size() + stopindex - startindex + 1);
+	}
+	string dataline;
+	for (int i=startindex; i<=stopindex; i++) {
+		string& line = lines[i];
+		size_t start = 0;
+		size_t cr = line.find((char)0x0d);
+		while (cr != string::npos) {
+			dataline.assign(line, start, cr - start);
+			MuseData::append(dataline);
+			start = cr + 1;
+			cr = line.find((char)0x0d, start);
+		}
+		if (start == 0) {
+			MuseData::append(line);
+		} else if (start < line.size()) {
+			dataline.assign(line, start, string::npos);
+			MuseData::append(dataline);
+		}
+		string().swap(line);
+	}
+
+	return finishRead();
+}
+
+
+
+//////////////////////////////
+//
+// MuseData::finishRead -- Number the lines and analyze the data after
+//    it has been read.
+//
+
+int MuseData::finishRead(void) {
 	for (int i=0; i<(int)m_data.size(); i++) {
 		m_data[i]->setLineIndex(i);
 	}
@@ -36311,17 +38022,13 @@ int MuseDataSet::read(istream& infile) {
 	vector<int> stopindex;
 	analyzePartSegments(startindex, stopindex, datalines);
 
-	stringstream *sstream;
+	// Parts are parsed directly from the lines, which are released as each
+	// part is stored.
 	MuseData* md;
 	for (int i=0; i<(int)startindex.size(); i++) {
-		sstream = new stringstream;
-		for (int j=startindex[i]; j<=stopindex[i]; j++) {
-			 (*sstream) << datalines[j] << '\n';
-		}
 		md = new MuseData;
-		md->read(*sstream);
+		md->read(datalines, startindex[i], stopindex[i]);
 		appendPart(md);
-		delete sstream;
 	}
 	return 1;
 }
@@ -40815,6 +42522,15 @@ int MuseRecordBasic::isEmpty(void) {
 string MuseRecordBasic::extract(int start, int end) {
 	string output;
 	int count = end - start + 1;
+	int length = getLength();
+	if ((start >= 1) && (count > 0) && (length <= 180)) {
+		// copy the stored columns in one step and pad with spaces:
+		if (start <= length) {
+			output.assign(m_recordString, start - 1, count);
+		}
+		output.resize(count, ' ');
+		return output;
+	}
 	for (int i=0; i<count; i++) {
 		if (i+start <= getLength()) {
 			output += getColumn(i+start);
@@ -40867,6 +42583,11 @@ string MuseRecordBasic::getColumns(int startcol, int endcol) {
 	if (charcount <= 0) {
 		return output;
 	}
+	if ((startcol >= 1) && (endcol <= 180)) {
+		getColumn(endcol); // pad the record to endcol if necessary
+		output.assign(m_recordString, startcol - 1, charcount);
+		return output;
+	}
 	for (int i=startcol; i<=endcol; i++) {
 		output += getColumn(i);
 	}
@@ -42128,415 +43849,1119 @@ ostream& operator<<(ostream& out, MuseRecordBasic* aRecord) {
 
 
 
-class MxmlMeasure;
-class MxmlPart;
-
-int MxmlEvent::m_counter = 0;
-
-////////////////////////////////////////////////////////////////////////////
-
-
 //////////////////////////////
 //
-// MxmlEvent::MxmlEvent -- Constructor.
+// MxmlArchive::MxmlArchive -- Constructor.
 //
 
-MxmlEvent::MxmlEvent(MxmlMeasure* measure) {
-	clear();
-	m_owner = measure;
-	m_sequence = m_counter++;
-	m_stems = false;
+MxmlArchive::MxmlArchive(void) {
+	// do nothing
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::~MxmlEvent -- Destructor.
+// MxmlArchive::clear -- Remove the archive contents.
 //
 
-MxmlEvent::~MxmlEvent() {
-	clear();
+void MxmlArchive::clear(void) {
+	m_data.clear();
+	m_entries.clear();
+	m_error.clear();
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::clear -- Clear any previous contents of the object.
+// MxmlArchive::read -- Read an archive from a file or an input stream.
+//     Returns false if the input is not a readable ZIP archive.
 //
 
-void MxmlEvent::clear(void) {
-	m_starttime = m_duration = 0;
-	m_modification = 1;
-	m_eventtype = mevent_unknown;
-	m_owner = NULL;
-	m_linked = false;
-	m_voice = -1;
-	m_staff = 0;
-	m_invisible = false;
-	m_voiceindex = -1;
-	m_sequence = -1;
-	for (int i=0; i<(int)m_links.size(); i++) {
-		delete m_links[i];
-		m_links[i] = NULL;
+bool MxmlArchive::read(const string& filename) {
+	clear();
+	ifstream input(filename.c_str(), ios::binary);
+	if (!input.is_open()) {
+		return setError("Cannot open file " + filename);
 	}
-	m_links.resize(0);
+	return read(input);
+}
+
+
+bool MxmlArchive::read(istream& input) {
+	clear();
+	m_data.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	return readDirectory();
 }
 
 
 
-///////////////////////////////
+//////////////////////////////
 //
-// MxmlEvent::enableStems --
+// MxmlArchive::readBuffer -- Read an archive from memory.  The data
+//     is copied.
 //
 
-void MxmlEvent::enableStems(void) {
-	m_stems = true;
+bool MxmlArchive::readBuffer(const char* data, size_t size) {
+	clear();
+	m_data.assign(data, data + size);
+	return readDirectory();
 }
 
 
 
-///////////////////////////////
+//////////////////////////////
 //
-// MxmlEvent::makeDummyRest --
-//   default values:
-//     staffindex = 0;
-//     voiceindex = 0;
+// MxmlArchive::isArchive -- Returns true if the data starts with
+//     a ZIP local file header.
 //
 
-void MxmlEvent::makeDummyRest(MxmlMeasure* owner, HumNum starttime,
-		HumNum duration, int staffindex, int voiceindex) {
-	m_starttime = starttime;
-	m_duration = duration;
-	m_eventtype = mevent_forward;  // not a real rest (will be invisible)
-	// m_node remains null
-	// m_links remains empty
-	m_linked = false;
-	m_sequence = -m_counter;
-	m_counter++;
-	m_voice = 1;  // don't know what the original voice number is
-	m_voiceindex = voiceindex;
-	m_staff = staffindex + 1;
-	m_maxstaff = m_staff;  // how is this used/set?
-	//	m_hnode remains null
+bool MxmlArchive::isArchive(const char* data, size_t size) {
+	if (size < 4) {
+		return false;
+	}
+	return (data[0] == 'P') && (data[1] == 'K') && (data[2] == 3) && (data[3] == 4);
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::setStartTime -- Set the starting timestamp of the event
-//    in terms of quater notes since the start of the music.
+// MxmlArchive::getFileCount -- Return the number of entries in the
+//     archive (including directories).
 //
 
-void MxmlEvent::setStartTime(HumNum value) {
-	m_starttime = value;
+int MxmlArchive::getFileCount(void) const {
+	return (int)m_entries.size();
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::setDuration -- Set the duration of the event in terms
-//   of quarter note durations.
+// MxmlArchive::getFilename -- Return the name of an archive entry.
 //
 
-void MxmlEvent::setDuration(HumNum value) {
-	m_duration = value;
+string MxmlArchive::getFilename(int index) const {
+	if ((index < 0) || (index >= (int)m_entries.size())) {
+		return "";
+	}
+	return m_entries[index].name;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getModification -- Get the tuplet scaling of the note's duration.
+// MxmlArchive::getFile -- Extract the contents of an archive entry.
+//     Returns false if the entry does not exist or cannot be decoded.
 //
 
-HumNum MxmlEvent::getModification(void) const {
-	return m_modification;
+bool MxmlArchive::getFile(const string& name, vector<char>& data) {
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		if (m_entries[i].name == name) {
+			return getFile(i, data);
+		}
+	}
+	data.clear();
+	return setError("Cannot find " + name + " in archive");
 }
 
 
+bool MxmlArchive::getFile(int index, vector<char>& data) {
+	data.clear();
+	if ((index < 0) || (index >= (int)m_entries.size())) {
+		return setError("Invalid archive entry");
+	}
+	MxmlArchiveEntry& entry = m_entries[index];
+	if (entry.flags & 0x01) {
+		return setError("Cannot read encrypted file " + entry.name);
+	}
+	size_t offset = entry.offset;
+	if ((offset + 30 > m_data.size()) || (getUint32(offset) != 0x04034b50)) {
+		return setError("Invalid local header for " + entry.name);
+	}
+	offset += 30 + getUint16(offset + 26) + getUint16(offset + 28);
+	if ((offset > m_data.size()) || (entry.compressed > m_data.size() - offset)) {
+		return setError("Truncated data for " + entry.name);
+	}
+	const char* contents = m_data.data() + offset;
 
-//////////////////////////////
-//
-// MxmlEvent::setModification -- Set the tuplet scaling of the note's duration.
-//
+	if (entry.method == 0) {
+		data.assign(contents, contents + entry.compressed);
+	} else if (entry.method == 8) {
+		// The uncompressed size in the header is only trusted as far as
+		// 32 times the compressed size for the first allocation (the
+		// output can still grow past this), and as a hard output limit.
+		data.reserve(std::min((size_t)entry.size, (size_t)entry.compressed * 32));
+		if (!inflate((const unsigned char*)contents, entry.compressed, data,
+				entry.size)) {
+			data.clear();
+			return setError("Cannot decompress " + entry.name);
+		}
+	} else {
+		return setError("Unsupported compression method for " + entry.name);
+	}
 
-void MxmlEvent::setModification(HumNum value) {
-	m_modification = value;
+	if ((data.size() != entry.size) ||
+			(calculateCrc(data.data(), data.size()) != entry.crc)) {
+		data.clear();
+		return setError("Checksum error for " + entry.name);
+	}
+	return true;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getStartTime -- Return the start time of the event in terms
-//      of quarter notes since the start of the music.
+// MxmlArchive::getRootFilename -- Return the name of the MusicXML score
+//     in the archive, given by the first rootfile element in
+//     META-INF/container.xml.  If there is no container file, the first
+//     .xml or .musicxml file outside of META-INF is used.
 //
 
-HumNum MxmlEvent::getStartTime(void) const {
-	return m_starttime;
+string MxmlArchive::getRootFilename(void) {
+	vector<char> container;
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		if (m_entries[i].name != "META-INF/container.xml") {
+			continue;
+		}
+		if (!getFile(i, container)) {
+			return "";
+		}
+		xml_document doc;
+		auto result = doc.load_buffer_inplace(container.data(),
+				container.size());
+		if (!result) {
+			setError("Cannot parse META-INF/container.xml");
+			return "";
+		}
+		xpath_node rootfile = doc.select_node("/container/rootfiles/rootfile");
+		string path = rootfile.node().attribute("full-path").value();
+		if (path.empty()) {
+			setError("No rootfile in META-INF/container.xml");
+		}
+		return path;
+	}
+
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		const string& name = m_entries[i].name;
+		if (name.compare(0, 9, "META-INF/") == 0) {
+			continue;
+		}
+		size_t dot = name.rfind('.');
+		if (dot == string::npos) {
+			continue;
+		}
+		string extension = name.substr(dot);
+		if ((extension == ".xml") || (extension == ".musicxml")) {
+			return name;
+		}
+	}
+	setError("No MusicXML file in archive");
+	return "";
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getDuration -- Return the duration of the event in terms
-//      of quarter note durations.
+// MxmlArchive::getRootFile -- Extract the MusicXML score from the archive.
 //
 
-HumNum MxmlEvent::getDuration(void) const {
-	return m_duration;
+bool MxmlArchive::getRootFile(vector<char>& data) {
+	data.clear();
+	string name = getRootFilename();
+	if (name.empty()) {
+		return false;
+	}
+	return getFile(name, data);
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::setOwner -- Indicate which measure the event belongs to.
+// MxmlArchive::getError -- Return a description of the last error.
 //
 
-void MxmlEvent::setOwner(MxmlMeasure* measure) {
-	m_owner = measure;
+string MxmlArchive::getError(void) const {
+	return m_error;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getOwner -- Return the measure object that contains this
-//     event.  If there is no owner, then returns NULL.
+// MxmlArchive::setError -- Store an error message and return false.
 //
 
-MxmlMeasure* MxmlEvent::getOwner(void) const {
-	return m_owner;
+bool MxmlArchive::setError(const string& message) {
+	m_error = message;
+	return false;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportVerseCountToOwner --
+// MxmlArchive::readDirectory -- Read the list of entries in the archive
+//     from the central directory, which is located by the end of central
+//     directory record at the end of the archive.
 //
 
-void MxmlEvent::reportVerseCountToOwner(int count) {
-	if (!m_owner) {
-		return;
+bool MxmlArchive::readDirectory(void) {
+	m_entries.clear();
+	if (m_data.size() < 22) {
+		return setError("Input is not a ZIP archive");
 	}
-	m_owner->reportVerseCountToOwner(count);
-}
 
+	// The end record is followed by a comment of up to 65535 bytes.
+	size_t end = m_data.size() - 22;
+	size_t limit = end > 0xffff ? end - 0xffff : 0;
+	bool found = false;
+	while (true) {
+		if (getUint32(end) == 0x06054b50) {
+			found = true;
+			break;
+		}
+		if (end == limit) {
+			break;
+		}
+		end--;
+	}
+	if (!found) {
+		return setError("Cannot find ZIP central directory");
+	}
 
-void MxmlEvent::reportVerseCountToOwner(int staffindex, int count) {
-	if (!m_owner) {
-		return;
+	size_t count = getUint16(end + 10);
+	size_t offset = getUint32(end + 16);
+	if ((count == 0xffff) || (offset == 0xffffffff)) {
+		return setError("ZIP64 archives are not supported");
 	}
-	m_owner->reportVerseCountToOwner(staffindex, count);
+
+	m_entries.reserve(count);
+	for (size_t i=0; i<count; i++) {
+		if ((offset + 46 > m_data.size()) || (getUint32(offset) != 0x02014b50)) {
+			return setError("Invalid ZIP central directory");
+		}
+		MxmlArchiveEntry entry;
+		entry.flags      = getUint16(offset + 8);
+		entry.method     = getUint16(offset + 10);
+		entry.crc        = getUint32(offset + 16);
+		entry.compressed = getUint32(offset + 20);
+		entry.size       = getUint32(offset + 24);
+		entry.offset     = getUint32(offset + 42);
+		size_t namelen   = getUint16(offset + 28);
+		size_t extralen  = getUint16(offset + 30);
+		size_t commentlen = getUint16(offset + 32);
+		if (offset + 46 + namelen > m_data.size()) {
+			return setError("Invalid ZIP central directory");
+		}
+		entry.name.assign(m_data.data() + offset + 46, namelen);
+		if ((entry.compressed == 0xffffffff) || (entry.size == 0xffffffff) ||
+				(entry.offset == 0xffffffff)) {
+			return setError("ZIP64 archives are not supported");
+		}
+		m_entries.push_back(entry);
+		offset += 46 + namelen + extralen + commentlen;
+	}
+	return true;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportDynamicToOwner -- inform the owner that there is a dynamic
-//    that needs a spine to store it in.
+// MxmlArchive::getUint16 -- Read a little-endian 16-bit number.
 //
 
-void MxmlEvent::reportDynamicToOwner(void) {
-	m_owner->reportDynamicToOwner();
+uint32_t MxmlArchive::getUint16(size_t offset) const {
+	const unsigned char* p = (const unsigned char*)m_data.data() + offset;
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportFiguredBassToOwner -- inform the owner that there is a dynamic
-//    that needs a spine to store it in.
+// MxmlArchive::getUint32 -- Read a little-endian 32-bit number.
 //
 
-void MxmlEvent::reportFiguredBassToOwner(void) {
-	m_owner->reportFiguredBassToOwner();
+uint32_t MxmlArchive::getUint32(size_t offset) const {
+	const unsigned char* p = (const unsigned char*)m_data.data() + offset;
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+			((uint32_t)p[3] << 24);
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportCaesuraToOwner -- inform the owner that there is a caesura
-//    that needs an RDF marker.
-// default value: letter = "Z"
+// MxmlArchive::calculateCrc -- CRC-32 checksum used by ZIP files.
 //
 
-void MxmlEvent::reportCaesuraToOwner(const string& letter) const {
-	m_owner->reportCaesuraToOwner(letter);
+uint32_t MxmlArchive::calculateCrc(const char* data, size_t size) {
+	static const vector<uint32_t> table = []() {
+		vector<uint32_t> output(256);
+		for (uint32_t i=0; i<256; i++) {
+			uint32_t value = i;
+			for (int j=0; j<8; j++) {
+				value = (value & 1) ? (0xedb88320 ^ (value >> 1)) : (value >> 1);
+			}
+			output[i] = value;
+		}
+		return output;
+	}();
+
+	uint32_t crc = 0xffffffff;
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i=0; i<size; i++) {
+		crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffff;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportOrnamentToOwner --
+// MxmlArchive::inflate -- Decompress raw deflate data (RFC 1951),
+//     appending to the output.  Returns false on invalid data, or as
+//     soon as the output would be longer than limit bytes.
 //
 
-void MxmlEvent::reportOrnamentToOwner(void) const {
-	m_owner->reportOrnamentToOwner();
+bool MxmlArchive::inflate(const unsigned char* input, size_t size,
+		vector<char>& output, size_t limit) {
+	m_outlimit = output.size() + limit;
+	m_in = input;
+	m_insize = size;
+	m_inpos = 0;
+	m_bitbuf = 0;
+	m_bitcount = 0;
+	m_inerror = false;
+
+	bool status = true;
+	int last;
+	do {
+		last = getBits(1);
+		int type = getBits(2);
+		if (m_inerror) {
+			status = false;
+			break;
+		}
+		switch (type) {
+			case 0:  status = inflateStored(output);  break;
+			case 1:  status = inflateFixed(output);   break;
+			case 2:  status = inflateDynamic(output); break;
+			default: status = false;
+		}
+	} while (status && !last);
+
+	m_in = NULL;
+	return status && !m_inerror;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportHarmonyCountToOwner --
+// MxmlArchive::getBits -- Read bits from the deflate input, least
+//     significant bit first.
 //
 
-void MxmlEvent::reportHarmonyCountToOwner(int count) {
-	if (!m_owner) {
-		return;
+int MxmlArchive::getBits(int count) {
+	uint32_t value = m_bitbuf;
+	while (m_bitcount < count) {
+		if (m_inpos >= m_insize) {
+			m_inerror = true;
+			return 0;
+		}
+		value |= (uint32_t)m_in[m_inpos++] << m_bitcount;
+		m_bitcount += 8;
 	}
-	m_owner->reportHarmonyCountToOwner(count);
+	m_bitbuf = value >> count;
+	m_bitcount -= count;
+	return (int)(value & ((1u << count) - 1));
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportMeasureStyleToOwner --
+// MxmlArchive::inflateStored -- Copy an uncompressed block.
 //
 
-void MxmlEvent::reportMeasureStyleToOwner (MeasureStyle style) {
-	if (!m_owner) {
-		return;
+bool MxmlArchive::inflateStored(vector<char>& output) {
+	// discard bits up to the next byte boundary
+	m_bitbuf = 0;
+	m_bitcount = 0;
+	if (m_inpos + 4 > m_insize) {
+		return false;
 	}
-	m_owner->receiveMeasureStyleFromChild(style);
+	size_t len = m_in[m_inpos] | (m_in[m_inpos + 1] << 8);
+	size_t nlen = m_in[m_inpos + 2] | (m_in[m_inpos + 3] << 8);
+	m_inpos += 4;
+	if ((len != (~nlen & 0xffff)) || (m_inpos + len > m_insize)) {
+		return false;
+	}
+	if (len > m_outlimit - output.size()) {
+		return false;
+	}
+	output.insert(output.end(), m_in + m_inpos, m_in + m_inpos + len);
+	m_inpos += len;
+	return true;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::reportEditorialAccidentalToOwner --
+// MxmlArchive::inflateFixed -- Decode a block compressed with the
+//     fixed Huffman codes.
 //
 
-void MxmlEvent::reportEditorialAccidentalToOwner(void) {
-	if (!m_owner) {
-		return;
-	}
-	m_owner->receiveEditorialAccidentalFromChild();
+bool MxmlArchive::inflateFixed(vector<char>& output) {
+	short lengths[288];
+	for (int i=0; i<144; i++) { lengths[i] = 8; }
+	for (int i=144; i<256; i++) { lengths[i] = 9; }
+	for (int i=256; i<280; i++) { lengths[i] = 7; }
+	for (int i=280; i<288; i++) { lengths[i] = 8; }
+	vector<short> lcount;
+	vector<short> lsymbol;
+	buildHuffman(lcount, lsymbol, lengths, 288);
+
+	for (int i=0; i<30; i++) { lengths[i] = 5; }
+	vector<short> dcount;
+	vector<short> dsymbol;
+	buildHuffman(dcount, dsymbol, lengths, 30);
+
+	return inflateCodes(output, lcount, lsymbol, dcount, dsymbol);
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getPartNumber --
+// MxmlArchive::inflateDynamic -- Decode a block compressed with Huffman
+//     codes that are described at the start of the block.
 //
 
-int MxmlEvent::getPartNumber(void) const {
-	if (!m_owner) {
-		return 0;
+bool MxmlArchive::inflateDynamic(vector<char>& output) {
+	static const short order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4,
+			12, 3, 13, 2, 14, 1, 15};
+
+	int nlen = getBits(5) + 257;
+	int ndist = getBits(5) + 1;
+	int ncode = getBits(4) + 4;
+	if (m_inerror || (nlen > 286) || (ndist > 30)) {
+		return false;
 	}
-	return m_owner->getPartNumber();
+
+	short lengths[286 + 30] = {0};
+	for (int i=0; i<ncode; i++) {
+		lengths[order[i]] = (short)getBits(3);
+	}
+	vector<short> count;
+	vector<short> symbol;
+	if (buildHuffman(count, symbol, lengths, 19) == false) {
+		return false;
+	}
+
+	// code lengths for the literal/length and distance codes:
+	int index = 0;
+	while (index < nlen + ndist) {
+		int sym = decodeSymbol(count, symbol);
+		if (sym < 0) {
+			return false;
+		}
+		if (sym < 16) {
+			lengths[index++] = (short)sym;
+			continue;
+		}
+		short len = 0;
+		int repeat;
+		if (sym == 16) {
+			if (index == 0) {
+				return false;
+			}
+			len = lengths[index - 1];
+			repeat = 3 + getBits(2);
+		} else if (sym == 17) {
+			repeat = 3 + getBits(3);
+		} else {
+			repeat = 11 + getBits(7);
+		}
+		if (m_inerror || (index + repeat > nlen + ndist)) {
+			return false;
+		}
+		while (repeat--) {
+			lengths[index++] = len;
+		}
+	}
+	if (lengths[256] == 0) {
+		// no end-of-block code
+		return false;
+	}
+
+	vector<short> lcount;
+	vector<short> lsymbol;
+	vector<short> dcount;
+	vector<short> dsymbol;
+	if (!buildHuffman(lcount, lsymbol, lengths, nlen)) {
+		return false;
+	}
+	if (!buildHuffman(dcount, dsymbol, lengths + nlen, ndist)) {
+		return false;
+	}
+	return inflateCodes(output, lcount, lsymbol, dcount, dsymbol);
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getPartIndex --
+// MxmlArchive::inflateCodes -- Decode literals and length/distance pairs
+//     until the end of the block.
 //
 
-int MxmlEvent::getPartIndex(void) const {
-	if (!m_owner) {
-		return 0;
+bool MxmlArchive::inflateCodes(vector<char>& output,
+		const vector<short>& lencount, const vector<short>& lensymbol,
+		const vector<short>& distcount, const vector<short>& distsymbol) {
+	static const short lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17,
+			19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+	static const short lext[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2,
+			2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+	static const int dbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49,
+			65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+			6145, 8193, 12289, 16385, 24577};
+	static const short dext[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5,
+			6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+	while (true) {
+		int sym = decodeSymbol(lencount, lensymbol);
+		if (sym < 0) {
+			return false;
+		}
+		if (sym < 256) {
+			if (output.size() >= m_outlimit) {
+				return false;
+			}
+			output.push_back((char)sym);
+			continue;
+		}
+		if (sym == 256) {
+			return true;
+		}
+		sym -= 257;
+		if (sym >= 29) {
+			return false;
+		}
+		int len = lbase[sym] + getBits(lext[sym]);
+		int dsym = decodeSymbol(distcount, distsymbol);
+		if ((dsym < 0) || (dsym >= 30)) {
+			return false;
+		}
+		size_t dist = dbase[dsym] + getBits(dext[dsym]);
+		if (m_inerror || (dist > output.size())) {
+			return false;
+		}
+		if ((size_t)len > m_outlimit - output.size()) {
+			return false;
+		}
+		// copy byte by byte, since the source may overlap the output
+		size_t from = output.size() - dist;
+		for (int i=0; i<len; i++) {
+			output.push_back(output[from + i]);
+		}
 	}
-	return m_owner->getPartIndex();
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getName --
+// MxmlArchive::buildHuffman -- Build a canonical Huffman decoding table
+//     from a list of code lengths: count[len] is the number of codes of
+//     each length, and symbol[] lists the symbols in code order.  Returns
+//     false if the lengths are over-subscribed.  Incomplete codes are
+//     allowed, since a single distance code is valid.
 //
 
-const char* MxmlEvent::getName(void) const {
-	return m_node.name();
+bool MxmlArchive::buildHuffman(vector<short>& count, vector<short>& symbol,
+		const short* lengths, int n) {
+	count.assign(16, 0);
+	symbol.assign(n, 0);
+	for (int i=0; i<n; i++) {
+		count[lengths[i]]++;
+	}
+	if (count[0] == n) {
+		return true;
+	}
+	int left = 1;
+	for (int len=1; len<16; len++) {
+		left <<= 1;
+		left -= count[len];
+		if (left < 0) {
+			return false;
+		}
+	}
+	short offsets[16];
+	offsets[1] = 0;
+	for (int len=1; len<15; len++) {
+		offsets[len + 1] = offsets[len] + count[len];
+	}
+	for (int i=0; i<n; i++) {
+		if (lengths[i] != 0) {
+			symbol[offsets[lengths[i]]++] = (short)i;
+		}
+	}
+	return true;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::setQTicks -- Set the number of ticks per quarter note.
-//     Returns the number of times that the ticks has been set.
-//     Returns 0 if the tick count is invalid.
+// MxmlArchive::decodeSymbol -- Decode one Huffman-coded symbol.  Codes
+//     are stored most-significant bit first.  Returns -1 on an error.
 //
 
-int MxmlEvent::setQTicks(long value) {
-	if (value <= 0) {
-		return 0;
-	}
-	if (m_owner) {
-		return m_owner->setQTicks(value);
-	} else {
-		return 0;
+int MxmlArchive::decodeSymbol(const vector<short>& count,
+		const vector<short>& symbol) {
+	int code = 0;   // bits read so far
+	int first = 0;  // first code of the current length
+	int index = 0;  // index of first code of the current length in symbol
+	for (int len=1; len<16; len++) {
+		code |= getBits(1);
+		int number = count[len];
+		if (code - number < first) {
+			if (m_inerror) {
+				return -1;
+			}
+			return symbol[index + (code - first)];
+		}
+		index += number;
+		first += number;
+		first <<= 1;
+		code <<= 1;
 	}
+	return -1;
 }
 
 
 
+
+class MxmlMeasure;
+class MxmlPart;
+
+std::atomic<int> MxmlEvent::m_counter(0);
+
+////////////////////////////////////////////////////////////////////////////
+
+
 //////////////////////////////
 //
-// MxmlEvent::getQTicks -- Get the number of ticks per quarter note.
+// MxmlEvent::MxmlEvent -- Constructor.
 //
 
-long MxmlEvent::getQTicks(void) const {
-	if (m_owner) {
-		return m_owner->getQTicks();
-	} else {
-		return 0;
-	}
+MxmlEvent::MxmlEvent(MxmlMeasure* measure) {
+	clear();
+	m_owner = measure;
+	m_sequence = m_counter++;
+	m_stems = false;
 }
 
 
 
 //////////////////////////////
 //
-// MxmlEvent::getIntValue -- Convenience function for an XPath query,
-//    where the child text of the element should be interpreted as
-//    an integer.
+// MxmlEvent::~MxmlEvent -- Destructor.
 //
 
-long MxmlEvent::getIntValue(const char* query) const {
-	const char* val = m_node.select_node(query).node().child_value();
-	if (strcmp(val, "") == 0) {
-		return 0;
-	} else {
-		return atoi(val);
-	}
+MxmlEvent::~MxmlEvent() {
+	clear();
 }
 
 
 
 //////////////////////////////
 //
-// Mxmlvent::setDurationByTicks -- Given a <duration> element tick
-//    count, set the duration by dividing by the current quarter-note
-//    duration tick count (from a prevailing attribute setting for
-//    <divisions>).
+// MxmlEvent::clear -- Clear any previous contents of the object.
 //
 
-void MxmlEvent::setDurationByTicks(long value, xml_node el) {
-	long ticks = getQTicks();
-	if (ticks == 0) {
-		setDuration(0);
-		return;
-	}
-
-	if (isGrace()) {
+void MxmlEvent::clear(void) {
+	m_starttime = m_duration = 0;
+	m_modification = 1;
+	m_eventtype = mevent_unknown;
+	m_owner = NULL;
+	m_linked = false;
+	m_voice = -1;
+	m_staff = 0;
+	m_invisible = false;
+	m_voiceindex = -1;
+	m_sequence = -1;
+	for (int i=0; i<(int)m_links.size(); i++) {
+		delete m_links[i];
+		m_links[i] = NULL;
+	}
+	m_links.resize(0);
+}
+
+
+
+///////////////////////////////
+//
+// MxmlEvent::enableStems --
+//
+
+void MxmlEvent::enableStems(void) {
+	m_stems = true;
+}
+
+
+
+///////////////////////////////
+//
+// MxmlEvent::makeDummyRest --
+//   default values:
+//     staffindex = 0;
+//     voiceindex = 0;
+//
+
+void MxmlEvent::makeDummyRest(MxmlMeasure* owner, HumNum starttime,
+		HumNum duration, int staffindex, int voiceindex) {
+	m_starttime = starttime;
+	m_duration = duration;
+	m_eventtype = mevent_forward;  // not a real rest (will be invisible)
+	// m_node remains null
+	// m_links remains empty
+	m_linked = false;
+	m_sequence = -(m_counter++);
+	m_voice = 1;  // don't know what the original voice number is
+	m_voiceindex = voiceindex;
+	m_staff = staffindex + 1;
+	m_maxstaff = m_staff;  // how is this used/set?
+	//	m_hnode remains null
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::setStartTime -- Set the starting timestamp of the event
+//    in terms of quater notes since the start of the music.
+//
+
+void MxmlEvent::setStartTime(HumNum value) {
+	m_starttime = value;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::setDuration -- Set the duration of the event in terms
+//   of quarter note durations.
+//
+
+void MxmlEvent::setDuration(HumNum value) {
+	m_duration = value;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getModification -- Get the tuplet scaling of the note's duration.
+//
+
+HumNum MxmlEvent::getModification(void) const {
+	return m_modification;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::setModification -- Set the tuplet scaling of the note's duration.
+//
+
+void MxmlEvent::setModification(HumNum value) {
+	m_modification = value;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getStartTime -- Return the start time of the event in terms
+//      of quarter notes since the start of the music.
+//
+
+HumNum MxmlEvent::getStartTime(void) const {
+	return m_starttime;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getDuration -- Return the duration of the event in terms
+//      of quarter note durations.
+//
+
+HumNum MxmlEvent::getDuration(void) const {
+	return m_duration;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::setOwner -- Indicate which measure the event belongs to.
+//
+
+void MxmlEvent::setOwner(MxmlMeasure* measure) {
+	m_owner = measure;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getOwner -- Return the measure object that contains this
+//     event.  If there is no owner, then returns NULL.
+//
+
+MxmlMeasure* MxmlEvent::getOwner(void) const {
+	return m_owner;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportVerseCountToOwner --
+//
+
+void MxmlEvent::reportVerseCountToOwner(int count) {
+	if (!m_owner) {
+		return;
+	}
+	m_owner->reportVerseCountToOwner(count);
+}
+
+
+void MxmlEvent::reportVerseCountToOwner(int staffindex, int count) {
+	if (!m_owner) {
+		return;
+	}
+	m_owner->reportVerseCountToOwner(staffindex, count);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportDynamicToOwner -- inform the owner that there is a dynamic
+//    that needs a spine to store it in.
+//
+
+void MxmlEvent::reportDynamicToOwner(void) {
+	m_owner->reportDynamicToOwner();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportFiguredBassToOwner -- inform the owner that there is a dynamic
+//    that needs a spine to store it in.
+//
+
+void MxmlEvent::reportFiguredBassToOwner(void) {
+	m_owner->reportFiguredBassToOwner();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportCaesuraToOwner -- inform the owner that there is a caesura
+//    that needs an RDF marker.
+// default value: letter = "Z"
+//
+
+void MxmlEvent::reportCaesuraToOwner(const string& letter) const {
+	m_owner->reportCaesuraToOwner(letter);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportOrnamentToOwner --
+//
+
+void MxmlEvent::reportOrnamentToOwner(void) const {
+	m_owner->reportOrnamentToOwner();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportHarmonyCountToOwner --
+//
+
+void MxmlEvent::reportHarmonyCountToOwner(int count) {
+	if (!m_owner) {
+		return;
+	}
+	m_owner->reportHarmonyCountToOwner(count);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportMeasureStyleToOwner --
+//
+
+void MxmlEvent::reportMeasureStyleToOwner (MeasureStyle style) {
+	if (!m_owner) {
+		return;
+	}
+	m_owner->receiveMeasureStyleFromChild(style);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::reportEditorialAccidentalToOwner --
+//
+
+void MxmlEvent::reportEditorialAccidentalToOwner(void) {
+	if (!m_owner) {
+		return;
+	}
+	m_owner->receiveEditorialAccidentalFromChild();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getPartNumber --
+//
+
+int MxmlEvent::getPartNumber(void) const {
+	if (!m_owner) {
+		return 0;
+	}
+	return m_owner->getPartNumber();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getPartIndex --
+//
+
+int MxmlEvent::getPartIndex(void) const {
+	if (!m_owner) {
+		return 0;
+	}
+	return m_owner->getPartIndex();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getName --
+//
+
+const char* MxmlEvent::getName(void) const {
+	return m_node.name();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::setQTicks -- Set the number of ticks per quarter note.
+//     Returns the number of times that the ticks has been set.
+//     Returns 0 if the tick count is invalid.
+//
+
+int MxmlEvent::setQTicks(long value) {
+	if (value <= 0) {
+		return 0;
+	}
+	if (m_owner) {
+		return m_owner->setQTicks(value);
+	} else {
+		return 0;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getQTicks -- Get the number of ticks per quarter note.
+//
+
+long MxmlEvent::getQTicks(void) const {
+	if (m_owner) {
+		return m_owner->getQTicks();
+	} else {
+		return 0;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MxmlEvent::getIntValue -- Convenience function for an XPath query,
+//    where the child text of the element should be interpreted as
+//    an integer.
+//
+
+long MxmlEvent::getIntValue(const char* query) const {
+	const char* val = m_node.select_node(query).node().child_value();
+	if (strcmp(val, "") == 0) {
+		return 0;
+	} else {
+		return atoi(val);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Mxmlvent::setDurationByTicks -- Given a <duration> element tick
+//    count, set the duration by dividing by the current quarter-note
+//    duration tick count (from a prevailing attribute setting for
+//    <divisions>).
+//
+
+void MxmlEvent::setDurationByTicks(long value, xml_node el) {
+	long ticks = getQTicks();
+	if (ticks == 0) {
+		setDuration(0);
+		return;
+	}
+
+	if (isGrace()) {
 		setDuration(0);
 		return;
 	}
@@ -46976,14 +49401,9 @@ double NoteGrid::getMetricLevel(int sindex) {
 	if ((getSliceCount() == 0) || (getVoiceCount() == 0)) {
 		return NAN;
 	}
-	if (m_metriclevels.empty()) {
-		int track = 0;
-		if ((getVoiceCount() > 0) && (getSliceCount() > 0)) {
-			track = cell(0, 0)->getToken()->getTrack();
-		}
-		m_infile->getMetricLevels(m_metriclevels, track, NAN);
-	}
-	return m_metriclevels[sindex];
+	int track = cell(0, 0)->getToken()->getTrack();
+	// The metric analysis is shared with other users of the file:
+	return m_infile->getMetricGrid(track).m_level[sindex];
 }
 
 
@@ -61865,10 +64285,14 @@ Tool_esac2hum::Tool_esac2hum(void) {
 	define("s|split=s:file",     "Split song info into separate files");
 	define("x|extension=s:.krn", "Split filename extension");
 	define("f|first=i:1",        "Number of first split filename");
+	define("threads=i:1",        "number of threads for converting songs (0 = all cores)");
+	define("segment=b",          "start each song with a !!!!SEGMENT record");
 	define("author=b",           "author of program");
 	define("version=b",          "compilation info");
 	define("example=b",          "example usages");
 	define("help=b",             "short description");
+
+	chartable.resize(256, 0);
 }
 
 
@@ -61953,6 +64377,14 @@ bool Tool_esac2hum::initialize(void) {
 	namebase = getString("split");
 	fileextension = getString("extension");
 	firstfilenum = getInteger("first");
+	segmentQ = getBoolean("segment");
+	threadcount = getInteger("threads");
+	if (threadcount <= 0) {
+		threadcount = (int)std::thread::hardware_concurrency();
+	}
+	if (threadcount <= 0) {
+		threadcount = 1;
+	}
 	return true;
 }
 
@@ -61968,6 +64400,10 @@ bool Tool_esac2hum::initialize(void) {
 
 void Tool_esac2hum::convertEsacToHumdrum(ostream& output, istream& infile) {
 	initialize();
+	if ((threadcount > 1) || splitQ || segmentQ) {
+		convertCollection(output, infile);
+		return;
+	}
 	vector<string> song;
 	song.reserve(400);
 	int init = 0;
@@ -62019,6 +64455,145 @@ void Tool_esac2hum::convertEsacToHumdrum(ostream& output, istream& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_esac2hum::convertCollection -- Find all of the songs in the input
+//     and then convert them on multiple threads.  The songs are printed in
+//     their original order, either to the output stream (optionally
+//     separated by !!!!SEGMENT records) or to separate files with the -s
+//     option.  Errors are reported for each song after the conversions,
+//     and a song which cannot be converted does not stop the conversion
+//     of the rest of the collection.
+//
+
+void Tool_esac2hum::convertCollection(ostream& output, istream& infile) {
+	vector<vector<string>> songs;
+	vector<int> songlines;
+	vector<string> song;
+	song.reserve(400);
+	int init = 0;
+	while (!infile.eof()) {
+		songlines.push_back(inputline);
+		getSong(song, infile, init);
+		init = 1;
+		songs.push_back(song);
+	}
+
+	int songcount = (int)songs.size();
+	vector<string> outputs(songcount);
+	vector<string> errors(songcount);
+
+	// Song conversion stores state in the tool (special character counts),
+	// so each thread uses its own converter.
+	int workercount = std::max(1, std::min(threadcount, songcount));
+	vector<Tool_esac2hum> converters(workercount);
+	for (int i=0; i<workercount; i++) {
+		converters[i].debugQ   = debugQ;
+		converters[i].verboseQ = verboseQ;
+		converters[i].header   = header;
+		converters[i].trailer  = trailer;
+	}
+
+	auto convertIndex = [&](Tool_esac2hum& converter, int index) {
+		stringstream out;
+		stringstream err;
+		converter.errorstream = &err;
+		converter.inputline = songlines[index];
+		try {
+			converter.convertSong(songs[index], out);
+			outputs[index] = out.str();
+		} catch (const std::exception& e) {
+			err << "Error: " << e.what() << endl;
+		}
+		errors[index] = err.str();
+	};
+
+	if (workercount == 1) {
+		for (int i=0; i<songcount; i++) {
+			convertIndex(converters[0], i);
+		}
+	} else {
+		std::atomic<int> next(0);
+		vector<std::thread> workers;
+		for (int i=0; i<workercount; i++) {
+			workers.emplace_back([&, i]() {
+				int index;
+				while ((index = next++) < songcount) {
+					convertIndex(converters[i], index);
+				}
+			});
+		}
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	for (int i=0; i<songcount; i++) {
+		if (outputs[i].empty()) {
+			continue;
+		}
+		if (splitQ) {
+			string filename = getSplitFilename(i);
+			ofstream outfile(filename);
+			if (!outfile.is_open()) {
+				errors[i] += "Error: cannot write to file: " + filename + "\n";
+				continue;
+			}
+			outfile << outputs[i];
+		} else {
+			if (segmentQ) {
+				output << "!!!!SEGMENT: " << getSplitFilename(i) << "\n";
+			}
+			output << outputs[i];
+		}
+	}
+
+	for (int i=0; i<songcount; i++) {
+		if (!errors[i].empty()) {
+			cerr << "Song " << i + 1;
+			string key = getSongKey(songs[i]);
+			if (!key.empty()) {
+				cerr << " (KEY " << key << ")";
+			}
+			cerr << ":\n" << errors[i];
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_esac2hum::getSplitFilename -- Return the filename for a song
+//     in the collection (index 0 is the first song).
+//
+
+string Tool_esac2hum::getSplitFilename(int index) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%04d", firstfilenum + index);
+	return namebase + buffer + fileextension;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_esac2hum::getSongKey -- Return the song identifier from the
+//     KEY[] field of a song.
+//
+
+string Tool_esac2hum::getSongKey(vector<string>& song) {
+	for (int i=0; i<(int)song.size(); i++) {
+		if (song[i].compare(0, 4, "KEY[") == 0) {
+			size_t end = song[i].find_first_of(" ]", 4);
+			return song[i].substr(4, end == string::npos ? string::npos : end - 4);
+		}
+	}
+	return "";
+}
+
+
+
 //////////////////////////////
 //
 // Tool_esac2hum::getSong -- get a song from the ESac file
@@ -62281,7 +64856,7 @@ bool Tool_esac2hum::placeLyrics(vector<string>& song, vector<NoteData>& songdata
 	string buffer;
 	for (line=0; line<=stop-start; line++) {
 		if (song[line+start].size() <= 4) {
-			cerr << "Error: lyric line is too short!: "
+			*errorstream << "Error: lyric line is too short!: "
 				  << song[line+start] << endl;
 			return false;
 		}
@@ -62441,8 +65016,8 @@ bool Tool_esac2hum::placeLyricPhrase(vector<NoteData>& songdata, vector<string>&
 	start = i;
 
 	if (!found) {
-		cerr << "Error: cannot find music for lyrics line " << line << endl;
-		cerr << "Error near input data line: " << inputline << endl;
+		*errorstream << "Error: cannot find music for lyrics line " << line << endl;
+		*errorstream << "Error near input data line: " << inputline << endl;
 		return false;
 	}
 
@@ -62571,7 +65146,7 @@ bool Tool_esac2hum::printTitleInfo(vector<string>& song, ostream& out) {
 	int stop = -1;
 	getLineRange(song, "CUT", start, stop);
 	if (start == -1) {
-		cerr << "Error: cannot find CUT[] field in song: " << song[0] << endl;
+		*errorstream << "Error: cannot find CUT[] field in song: " << song[0] << endl;
 		return false;
 	}
 
@@ -62980,15 +65555,18 @@ void Tool_esac2hum::postProcessSongData(vector<NoteData>& songdata, vector<int>&
 
 void Tool_esac2hum::getMeterInfo(string& meter, vector<int>& numerator,
 		vector<int>& denominator) {
-	char buffer[256] = {0};
-	strcpy(buffer, meter.c_str());
 	numerator.resize(0);
 	denominator.resize(0);
 	int num = -1;
 	int denom = -1;
-	char* ptr;
-	ptr = strtok(buffer, " \t\n");
-	while (ptr != NULL) {
+	// split into words (not with strtok() so that songs can be converted
+	// in parallel):
+	size_t start = meter.find_first_not_of(" \t\n");
+	while (start != string::npos) {
+		size_t end = meter.find_first_of(" \t\n", start);
+		string word = meter.substr(start, end == string::npos ? string::npos : end - start);
+		start = meter.find_first_not_of(" \t\n", end);
+		const char* ptr = word.c_str();
 		if (strcmp(ptr, "frei") == 0 || strcmp(ptr, "Frei") == 0) {
 			num = -1;
 			denom = -1;
@@ -63008,7 +65586,6 @@ void Tool_esac2hum::getMeterInfo(string& meter, vector<int>& numerator,
 				denominator.push_back(denom);
 			}
 		}
-		ptr = strtok(NULL, " \t\n");
 	}
 
 }
@@ -63077,7 +65654,7 @@ bool Tool_esac2hum::getNoteList(vector<string>& song, vector<NoteData>& songdata
 
 	for (i=melstart; i<=melstop; i++) {
 		if (song[i].size() < 4) {
-			cerr << "Error: invalid line in MEL[]: " << song[i] << endl;
+			*errorstream << "Error: invalid line in MEL[]: " << song[i] << endl;
 			return false;
 		}
 		j = 4;
@@ -63139,7 +65716,7 @@ bool Tool_esac2hum::getNoteList(vector<string>& song, vector<NoteData>& songdata
 //            case '>':                     break;   // unknown marker
 //            case '<':                     break;   //
 				case '^': tie = 1; state = STATE_NOTE; break;
-				default : cerr << "Error: unknown character " << song[i][j]
+				default : *errorstream << "Error: unknown character " << song[i][j]
 							      << " on the line: " << song[i] << endl;
 							 return false;
 			}
@@ -63391,15 +65968,15 @@ bool Tool_esac2hum::getKeyInfo(vector<string>& song, string& key, double& mindur
 
 			tonic = Convert::kernToBase40(tonicstr);
 			if (tonic <= 0) {
-				cerr << "Error: invalid tonic on line: " << song[i] << endl;
+				*errorstream << "Error: invalid tonic on line: " << song[i] << endl;
 				return false;
 			}
 			tonic = tonic % 40;
 			meter = song[i].substr(17);
 			if (meter.back() != ']') {
-				cerr << "Error with meter on line: " << song[i] << endl;
-				cerr << "Meter area: " << meter << endl;
-				cerr << "Expected ] as last character but found " << meter.back() << endl;
+				*errorstream << "Error with meter on line: " << song[i] << endl;
+				*errorstream << "Meter area: " << meter << endl;
+				*errorstream << "Expected ] as last character but found " << meter.back() << endl;
 				return false;
 			} else {
 				meter.resize((int)meter.size() - 1);
@@ -63407,7 +65984,7 @@ bool Tool_esac2hum::getKeyInfo(vector<string>& song, string& key, double& mindur
 			return true;
 		}
 	}
-	cerr << "Error: did not find a KEY field" << endl;
+	*errorstream << "Error: did not find a KEY field" << endl;
 	return false;
 }
 
@@ -66147,6 +68724,458 @@ void Tool_filter::initialize(HumdrumFile& infile) {
 
 
 
+/////////////////////////////////
+//
+// Tool_fingerprint::Tool_fingerprint -- Set the recognized options for the tool.
+//
+
+Tool_fingerprint::Tool_fingerprint(void) {
+	define("s|shingle=i:4",    "number of intervals in each shingle");
+	define("k|hashes=i:64",    "number of MinHash values in each signature");
+	define("b|bands=i:16",     "number of LSH bands (must divide hashes)");
+	define("t|threshold=d:0.5", "minimum estimated similarity for duplicates");
+	define("g|group=s",        "combine movements having same reference record (such as OPR)");
+	define("p|print=b",        "print signatures rather than duplicate clusters");
+}
+
+
+
+/////////////////////////////////
+//
+// Tool_fingerprint::run -- Do the main work of the tool.
+//
+
+bool Tool_fingerprint::run(HumdrumFileSet& infiles) {
+	if (!initialize()) {
+		return false;
+	}
+	for (int i=0; i<infiles.getCount(); i++) {
+		processFile(infiles[i]);
+	}
+	finish();
+	return true;
+}
+
+
+bool Tool_fingerprint::run(const string& indata, ostream& out) {
+	HumdrumFile infile(indata);
+	bool status = run(infile);
+	if (hasAnyText()) {
+		getAllText(out);
+	}
+	return status;
+}
+
+
+bool Tool_fingerprint::run(HumdrumFile& infile, ostream& out) {
+	bool status = run(infile);
+	if (hasAnyText()) {
+		getAllText(out);
+	}
+	return status;
+}
+
+
+bool Tool_fingerprint::run(HumdrumFile& infile) {
+	if (!initialize()) {
+		return false;
+	}
+	processFile(infile);
+	finish();
+	return true;
+}
+
+//
+// Streaming interface: only the signatures of the scores are kept in memory,
+// and each score is released after its signature has been calculated.
+//
+
+bool Tool_fingerprint::run(HumdrumFileStream& instream) {
+	if (!initialize()) {
+		return false;
+	}
+	HumdrumFileSet infiles;
+	while (instream.readSingleSegment(infiles)) {
+		if (infiles.getCount() > 0) {
+			processFile(infiles[0]);
+		}
+	}
+	finish();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::initialize -- Returns false if the number of bands
+//     does not divide the number of hashes, since each band must have
+//     the same number of rows and every hash must be in a band.
+//
+
+bool Tool_fingerprint::initialize(void) {
+	m_shingle   = getInteger("shingle");
+	m_hashcount = getInteger("hashes");
+	m_bands     = getInteger("bands");
+	m_threshold = getDouble("threshold");
+	m_group     = getString("group");
+	if (m_shingle < 1) {
+		m_shingle = 1;
+	}
+	if (m_hashcount < 1) {
+		m_hashcount = 1;
+	}
+	if ((m_bands < 1) || (m_hashcount % m_bands != 0)) {
+		m_error_text << "Error: the number of bands (" << m_bands
+		             << ") must divide the number of hashes ("
+		             << m_hashcount << ")" << endl;
+		return false;
+	}
+	m_rows = m_hashcount / m_bands;
+
+	m_seeds.resize(m_hashcount);
+	for (int i=0; i<m_hashcount; i++) {
+		m_seeds[i] = mixHash(0x9e3779b97f4a7c15ULL * (i + 1));
+	}
+
+	m_count = 0;
+	m_names.clear();
+	m_signatures.clear();
+	m_parent.clear();
+	m_buckets.clear();
+	m_buckets.resize(m_bands);
+	m_groups.clear();
+	m_grouporder.clear();
+	m_initialized = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::processFile -- Calculate the signature of a score and
+//     add it to the LSH tables (or to its movement group).
+//
+
+void Tool_fingerprint::processFile(HumdrumFile& infile) {
+	if (!m_initialized && !initialize()) {
+		return;
+	}
+	m_count++;
+	vector<uint64_t> shingles;
+	getShingles(shingles, infile);
+
+	string name = infile.getFilename();
+	if (name.empty()) {
+		name = "#" + to_string(m_count);
+	}
+
+	vector<uint64_t> signature;
+	getSignature(signature, shingles);
+
+	if (!m_group.empty()) {
+		string key = infile.getReferenceRecord(m_group);
+		if (key.empty()) {
+			key = name;
+		}
+		auto it = m_groups.find(key);
+		if (it == m_groups.end()) {
+			m_groups[key] = signature;
+			m_grouporder.push_back(key);
+		} else {
+			// The MinHash of a union is the minimum of the MinHashes.
+			for (int i=0; i<(int)signature.size(); i++) {
+				it->second[i] = std::min(it->second[i], signature[i]);
+			}
+		}
+		return;
+	}
+
+	if (getBoolean("print")) {
+		printSignature(name, (int)shingles.size(), signature);
+		return;
+	}
+	if (shingles.empty()) {
+		// Scores without melodic content cannot be compared.
+		return;
+	}
+	addSignature(name, signature);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::finish -- Add movement groups to the LSH tables, then
+//     print the duplicate clusters.
+//
+
+void Tool_fingerprint::finish(void) {
+	for (int i=0; i<(int)m_grouporder.size(); i++) {
+		vector<uint64_t>& signature = m_groups[m_grouporder[i]];
+		if (getBoolean("print")) {
+			printSignature(m_grouporder[i], -1, signature);
+			continue;
+		}
+		if (signature.empty() || (signature[0] == FINGERPRINT_EMPTY)) {
+			continue;
+		}
+		addSignature(m_grouporder[i], signature);
+	}
+	m_groups.clear();
+	m_grouporder.clear();
+
+	if (!getBoolean("print")) {
+		printClusters();
+	}
+	m_initialized = false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::getShingles -- Extract the shingles of a score.  Each
+//     shingle is a hash of m_shingle consecutive base-40 intervals between
+//     note attacks in a voice, together with the ratio of the durations of
+//     the two notes forming each interval.  Rests are skipped.
+//
+
+void Tool_fingerprint::getShingles(vector<uint64_t>& shingles, HumdrumFile& infile) {
+	shingles.clear();
+	NoteGrid grid(infile);
+	vector<NoteCell*> attacks;
+	vector<uint64_t> steps;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		steps.clear();
+		int lastpitch = -1;
+		HumNum lastdur = 0;
+		for (int i=0; i<(int)attacks.size(); i++) {
+			if (attacks[i]->isRest()) {
+				continue;
+			}
+			int pitch = (int)attacks[i]->getAbsBase40Pitch();
+			HumNum duration = attacks[i]->getDuration();
+			if (duration <= 0) {
+				continue;
+			}
+			if (lastpitch >= 0) {
+				HumNum ratio = duration / lastdur;
+				uint64_t step = (uint64_t)(int64_t)(pitch - lastpitch);
+				step = step * 1000003 + (uint64_t)ratio.getNumerator();
+				step = step * 1000003 + (uint64_t)ratio.getDenominator();
+				steps.push_back(mixHash(step));
+			}
+			lastpitch = pitch;
+			lastdur = duration;
+		}
+		for (int i=0; i+m_shingle<=(int)steps.size(); i++) {
+			uint64_t value = 0;
+			for (int j=0; j<m_shingle; j++) {
+				value = mixHash(value ^ steps[i+j]);
+			}
+			shingles.push_back(value);
+		}
+	}
+	std::sort(shingles.begin(), shingles.end());
+	shingles.erase(std::unique(shingles.begin(), shingles.end()), shingles.end());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::getSignature -- Calculate the MinHash signature of a
+//     shingle set.  An empty set has all values set to FINGERPRINT_EMPTY.
+//
+
+void Tool_fingerprint::getSignature(vector<uint64_t>& signature,
+		vector<uint64_t>& shingles) {
+	signature.assign(m_hashcount, FINGERPRINT_EMPTY);
+	for (int i=0; i<(int)shingles.size(); i++) {
+		for (int j=0; j<m_hashcount; j++) {
+			uint64_t value = mixHash(shingles[i] ^ m_seeds[j]);
+			if (value < signature[j]) {
+				signature[j] = value;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::addSignature -- Store a signature and compare it to
+//     previous signatures which share at least one LSH band with it.
+//     Signatures that are similar enough are joined into the same cluster.
+//
+
+void Tool_fingerprint::addSignature(const string& name, vector<uint64_t>& signature) {
+	int index = (int)m_signatures.size();
+	m_names.push_back(name);
+	m_signatures.push_back(signature);
+	m_parent.push_back(index);
+
+	for (int b=0; b<m_bands; b++) {
+		uint64_t key = b;
+		for (int r=0; r<m_rows; r++) {
+			key = mixHash(key ^ signature[b * m_rows + r]);
+		}
+		vector<int>& bucket = m_buckets[b][key];
+		for (int i=0; i<(int)bucket.size(); i++) {
+			if (findCluster(bucket[i]) == findCluster(index)) {
+				continue;
+			}
+			if (getSimilarity(bucket[i], index) >= m_threshold) {
+				joinClusters(bucket[i], index);
+			}
+		}
+		bucket.push_back(index);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::getSimilarity -- Estimate the Jaccard similarity of
+//     two shingle sets from the fraction of equal MinHash values.
+//
+
+double Tool_fingerprint::getSimilarity(int index1, int index2) {
+	vector<uint64_t>& sig1 = m_signatures[index1];
+	vector<uint64_t>& sig2 = m_signatures[index2];
+	int same = 0;
+	for (int i=0; i<m_hashcount; i++) {
+		if (sig1[i] == sig2[i]) {
+			same++;
+		}
+	}
+	return (double)same / m_hashcount;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::findCluster -- Return the root of the union-find tree
+//     for a signature (with path halving).
+//
+
+int Tool_fingerprint::findCluster(int index) {
+	while (m_parent[index] != index) {
+		m_parent[index] = m_parent[m_parent[index]];
+		index = m_parent[index];
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::joinClusters -- Merge the clusters of two signatures,
+//     keeping the earliest signature as the root.
+//
+
+void Tool_fingerprint::joinClusters(int index1, int index2) {
+	int root1 = findCluster(index1);
+	int root2 = findCluster(index2);
+	if (root1 == root2) {
+		return;
+	}
+	if (root1 < root2) {
+		m_parent[root2] = root1;
+	} else {
+		m_parent[root1] = root2;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::printSignature --
+//
+
+void Tool_fingerprint::printSignature(const string& name, int shinglecount,
+		vector<uint64_t>& signature) {
+	m_free_text << name << "\t";
+	if (shinglecount >= 0) {
+		m_free_text << shinglecount;
+	} else {
+		m_free_text << ".";
+	}
+	m_free_text << "\t";
+	char buffer[32];
+	for (int i=0; i<(int)signature.size(); i++) {
+		if (i > 0) {
+			m_free_text << " ";
+		}
+		snprintf(buffer, 32, "%016llx", (unsigned long long)signature[i]);
+		m_free_text << buffer;
+	}
+	m_free_text << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::printClusters -- Print all clusters of two or more
+//     scores as Humdrum data.  The similarity is estimated relative to the
+//     first score in the cluster.
+//
+
+void Tool_fingerprint::printClusters(void) {
+	int count = (int)m_signatures.size();
+	vector<vector<int>> clusters(count);
+	for (int i=0; i<count; i++) {
+		clusters[findCluster(i)].push_back(i);
+	}
+
+	m_free_text << "!!!scores: " << count << endl;
+	m_free_text << "**cluster\t**similarity\t**file" << endl;
+	int number = 0;
+	for (int i=0; i<count; i++) {
+		if (clusters[i].size() < 2) {
+			continue;
+		}
+		number++;
+		for (int j=0; j<(int)clusters[i].size(); j++) {
+			int index = clusters[i][j];
+			double similarity = getSimilarity(clusters[i][0], index);
+			m_free_text << number << "\t";
+			m_free_text << int(similarity * 1000.0 + 0.5) / 1000.0 << "\t";
+			m_free_text << m_names[index] << endl;
+		}
+	}
+	m_free_text << "*-\t*-\t*-" << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::mixHash -- Scramble the bits of a 64-bit value
+//     (MurmurHash3 finalizer).
+//
+
+uint64_t Tool_fingerprint::mixHash(uint64_t value) {
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+
+
+
 /////////////////////////////////
 //
 // Tool_fixps::Tool_fixps -- Set the recognized options for the tool.
@@ -69368,6 +72397,920 @@ void Tool_hproof::markHarmonicTones(HTp tok, vector<int>& cts) {
 
 
 
+/////////////////////////////////
+//
+// Tool_hum2musicxml::Tool_hum2musicxml -- Set the recognized options for the tool.
+//
+
+Tool_hum2musicxml::Tool_hum2musicxml(void) {
+	define("S|no-stems=b", "do not print explicit stem directions");
+	define("B|no-beams=b", "do not print beams");
+}
+
+
+
+/////////////////////////////////
+//
+// Tool_hum2musicxml::run -- Do the main work of the tool.
+//
+
+bool Tool_hum2musicxml::run(HumdrumFileSet& infiles) {
+	bool status = true;
+	for (int i=0; i<infiles.getCount(); i++) {
+		status &= run(infiles[i]);
+	}
+	return status;
+}
+
+
+bool Tool_hum2musicxml::run(const string& indata, ostream& out) {
+	HumdrumFile infile(indata);
+	return run(infile, out);
+}
+
+
+bool Tool_hum2musicxml::run(HumdrumFile& infile, ostream& out) {
+	initialize();
+	return convert(out, infile);
+}
+
+
+bool Tool_hum2musicxml::run(HumdrumFile& infile) {
+	initialize();
+	return convert(m_free_text, infile);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::initialize --
+//
+
+void Tool_hum2musicxml::initialize(void) {
+	m_stemsQ = !getBoolean("no-stems");
+	m_beamsQ = !getBoolean("no-beams");
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::convert -- Write the **kern data of a Humdrum file
+//     as MusicXML to the output stream.
+//
+
+bool Tool_hum2musicxml::convert(ostream& out, HumdrumFile& infile) {
+	if (!infile.isValid()) {
+		m_error_text << infile.getParseError() << endl;
+		return false;
+	}
+	vector<HTp> kernstarts = infile.getKernSpineStartList();
+	if (kernstarts.empty()) {
+		m_error_text << "No **kern spines in input data" << endl;
+		return false;
+	}
+	if (!infile.isRhythmAnalyzed()) {
+		infile.analyzeRhythmStructure();
+	}
+	infile.analyzeKernAccidentals();
+	infile.analyzeSlurs();
+	m_divisions = infile.tpq();
+	if (m_divisions <= 0) {
+		m_divisions = 1;
+	}
+
+	// MusicXML parts are ordered from the top staff down:
+	std::reverse(kernstarts.begin(), kernstarts.end());
+
+	printHeader(out, infile);
+	printPartList(out, kernstarts);
+	for (int i=0; i<(int)kernstarts.size(); i++) {
+		printPart(out, infile, kernstarts[i], i + 1);
+	}
+	out << "</score-partwise>\n";
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printHeader -- Print the XML declaration and the
+//     score information from the reference records.
+//
+
+void Tool_hum2musicxml::printHeader(ostream& out, HumdrumFile& infile) {
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+	out << "<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 3.1 Partwise//EN\"";
+	out << " \"http://www.musicxml.org/dtds/partwise.dtd\">\n";
+	out << "<score-partwise version=\"3.1\">\n";
+
+	string title = infile.getReferenceRecord("OTL");
+	if (!title.empty()) {
+		out << "  <work>\n";
+		out << "    <work-title>" << escapeXml(title) << "</work-title>\n";
+		out << "  </work>\n";
+	}
+
+	out << "  <identification>\n";
+	string composer = infile.getReferenceRecord("COM");
+	if (!composer.empty()) {
+		out << "    <creator type=\"composer\">" << escapeXml(composer) << "</creator>\n";
+	}
+	out << "    <encoding>\n";
+	out << "      <software>humlib hum2musicxml</software>\n";
+	out << "    </encoding>\n";
+	out << "  </identification>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printPartList --
+//
+
+void Tool_hum2musicxml::printPartList(ostream& out, vector<HTp>& kernstarts) {
+	out << "  <part-list>\n";
+	for (int i=0; i<(int)kernstarts.size(); i++) {
+		out << "    <score-part id=\"P" << i + 1 << "\">\n";
+		out << "      <part-name>" << escapeXml(getPartName(kernstarts[i]))
+		    << "</part-name>\n";
+		out << "    </score-part>\n";
+	}
+	out << "  </part-list>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getPartName -- Return the instrument name (*I")
+//     given before the first data in the spine.
+//
+
+string Tool_hum2musicxml::getPartName(HTp kernstart) {
+	HTp current = kernstart;
+	while (current && !current->isData()) {
+		if (current->compare(0, 3, "*I\"") == 0) {
+			return current->substr(3);
+		}
+		current = current->getNextToken();
+	}
+	return "";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printPart -- Print the measures of a part.  The
+//     tokens of each measure are collected by voice (subtrack) and then
+//     printed.  Clefs, key and time signatures before the first data in a
+//     measure are printed in the initial attributes of the measure, and
+//     later ones are printed in line order in the first voice.
+//
+
+void Tool_hum2musicxml::printPart(ostream& out, HumdrumFile& infile,
+		HTp kernstart, int partnum) {
+	int track = kernstart->getTrack();
+	m_beamdepth.clear();
+	m_slurs.clear();
+
+	out << "  <part id=\"P" << partnum << "\">\n";
+
+	vector<vector<HTp>> voices(1);
+	vector<HTp> attributes;
+	HumNum starttime = 0;
+	int number = getFirstMeasureNumber(infile);
+	HTp leftbar = NULL;
+	bool dataQ = false;
+	bool firstQ = true;
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		HumdrumLine& line = infile[i];
+		if (line.isBarline()) {
+			HTp bar = NULL;
+			for (int j=0; j<line.getFieldCount(); j++) {
+				if (line.token(j)->getTrack() == track) {
+					bar = line.token(j);
+					break;
+				}
+			}
+			if (!bar) {
+				continue;
+			}
+			if (dataQ) {
+				printMeasure(out, voices, attributes, starttime, number, leftbar,
+						bar, firstQ);
+				firstQ = false;
+				attributes.clear();
+				number++;
+			} else {
+				// no notes in measure: carry clef/key/time to next measure
+				attributes.insert(attributes.end(), voices[0].begin(), voices[0].end());
+			}
+			voices.assign(1, vector<HTp>());
+			dataQ = false;
+			starttime = line.getDurationFromStart();
+			leftbar = bar;
+			int barnum = line.getBarNumber();
+			if (barnum >= 0) {
+				number = barnum;
+			}
+			continue;
+		}
+
+		if (line.isInterpretation()) {
+			bool clefQ = false;
+			bool keyQ = false;
+			bool timeQ = false;
+			for (int j=0; j<line.getFieldCount(); j++) {
+				HTp token = line.token(j);
+				if (token->getTrack() != track) {
+					continue;
+				}
+				// store one of each type on the line (split spines duplicate them):
+				if (token->isClef()) {
+					if (clefQ) {
+						continue;
+					}
+					clefQ = true;
+				} else if (token->isKeySignature()) {
+					if (keyQ) {
+						continue;
+					}
+					keyQ = true;
+				} else if (token->isTimeSignature()) {
+					if (timeQ) {
+						continue;
+					}
+					timeQ = true;
+				} else {
+					continue;
+				}
+				if (dataQ) {
+					voices[0].push_back(token);
+				} else {
+					attributes.push_back(token);
+				}
+			}
+			continue;
+		}
+
+		if (!line.isData()) {
+			continue;
+		}
+		for (int j=0; j<line.getFieldCount(); j++) {
+			HTp token = line.token(j);
+			if (token->getTrack() != track) {
+				continue;
+			}
+			if (token->isNull()) {
+				continue;
+			}
+			int voice = token->getSubtrack();
+			if (voice < 1) {
+				voice = 1;
+			}
+			if ((int)voices.size() < voice) {
+				voices.resize(voice);
+			}
+			voices[voice - 1].push_back(token);
+			dataQ = true;
+		}
+	}
+
+	if (dataQ) {
+		printMeasure(out, voices, attributes, starttime, number, leftbar, NULL, firstQ);
+	}
+
+	out << "  </part>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getFirstMeasureNumber -- Return the measure number for
+//     data before the first barline (0 if it is a pickup to measure 1).
+//
+
+int Tool_hum2musicxml::getFirstMeasureNumber(HumdrumFile& infile) {
+	bool dataQ = false;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			dataQ = true;
+		} else if (infile[i].isBarline()) {
+			int number = infile[i].getBarNumber();
+			if (number < 0) {
+				return 1;
+			}
+			if (dataQ && (number > 0)) {
+				return number - 1;
+			}
+			return number;
+		}
+	}
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printMeasure -- Print the voices of a measure, moving
+//     back to the start of the measure between voices.
+//
+
+void Tool_hum2musicxml::printMeasure(ostream& out, vector<vector<HTp>>& voices,
+		vector<HTp>& attributes, HumNum starttime, int number, HTp leftbar,
+		HTp rightbar, bool firstQ) {
+	out << "    <measure number=\"" << number << "\"";
+	if (number == 0) {
+		out << " implicit=\"yes\"";
+	}
+	out << ">\n";
+
+	if (leftbar && ((leftbar->find("|:") != string::npos) ||
+			(leftbar->find("!:") != string::npos))) {
+		out << "      <barline location=\"left\">\n";
+		out << "        <bar-style>heavy-light</bar-style>\n";
+		out << "        <repeat direction=\"forward\"/>\n";
+		out << "      </barline>\n";
+	}
+
+	printAttributes(out, attributes, firstQ);
+
+	int position = 0;
+	for (int v=0; v<(int)voices.size(); v++) {
+		if (voices[v].empty()) {
+			continue;
+		}
+		if (position > 0) {
+			out << "      <backup>\n";
+			out << "        <duration>" << position << "</duration>\n";
+			out << "      </backup>\n";
+			position = 0;
+		}
+		for (int i=0; i<(int)voices[v].size(); i++) {
+			HTp token = voices[v][i];
+			if (token->isInterpretation()) {
+				vector<HTp> change(1, token);
+				printAttributes(out, change, false);
+				continue;
+			}
+			int tokenstart = getTicks(token->getDurationFromStart() - starttime);
+			if (tokenstart > position) {
+				out << "      <forward>\n";
+				out << "        <duration>" << tokenstart - position << "</duration>\n";
+				out << "        <voice>" << v + 1 << "</voice>\n";
+				out << "      </forward>\n";
+			} else if (tokenstart < position) {
+				out << "      <backup>\n";
+				out << "        <duration>" << position - tokenstart << "</duration>\n";
+				out << "      </backup>\n";
+			}
+			position = tokenstart + printToken(out, token, v + 1);
+		}
+	}
+
+	if (rightbar) {
+		string style;
+		bool repeatQ = false;
+		if ((rightbar->find(":|") != string::npos) ||
+				(rightbar->find(":!") != string::npos)) {
+			style = "light-heavy";
+			repeatQ = true;
+		} else if (rightbar->compare(0, 2, "==") == 0) {
+			style = "light-heavy";
+		} else if (rightbar->find("||") != string::npos) {
+			style = "light-light";
+		}
+		if (!style.empty()) {
+			out << "      <barline location=\"right\">\n";
+			out << "        <bar-style>" << style << "</bar-style>\n";
+			if (repeatQ) {
+				out << "        <repeat direction=\"backward\"/>\n";
+			}
+			out << "      </barline>\n";
+		}
+	}
+
+	out << "    </measure>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printAttributes -- Print clef, key and time
+//     signature interpretations in MusicXML element order.
+//
+
+void Tool_hum2musicxml::printAttributes(ostream& out, vector<HTp>& tokens,
+		bool divisionsQ) {
+	HTp key  = NULL;
+	HTp time = NULL;
+	HTp clef = NULL;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		if (tokens[i]->isKeySignature()) {
+			key = tokens[i];
+		} else if (tokens[i]->isTimeSignature()) {
+			time = tokens[i];
+		} else if (tokens[i]->isClef()) {
+			clef = tokens[i];
+		}
+	}
+	if (!divisionsQ && !key && !time && !clef) {
+		return;
+	}
+
+	out << "      <attributes>\n";
+	if (divisionsQ) {
+		out << "        <divisions>" << m_divisions << "</divisions>\n";
+	}
+	if (key) {
+		printKey(out, key);
+	}
+	if (time) {
+		printTime(out, time);
+	}
+	if (clef) {
+		printClef(out, clef);
+	}
+	out << "      </attributes>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printKey -- Convert a key signature such as *k[f#c#]
+//     into a count of fifths.
+//
+
+void Tool_hum2musicxml::printKey(ostream& out, HTp token) {
+	int fifths = 0;
+	for (int i=0; i<(int)token->size(); i++) {
+		if (token->at(i) == '#') {
+			fifths++;
+		} else if (token->at(i) == '-') {
+			fifths--;
+		}
+	}
+	out << "        <key>\n";
+	out << "          <fifths>" << fifths << "</fifths>\n";
+	out << "        </key>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printTime -- Convert a time signature such as *M3/4.
+//
+
+void Tool_hum2musicxml::printTime(ostream& out, HTp token) {
+	int beats = 0;
+	int beattype = 0;
+	if (sscanf(token->c_str(), "*M%d/%d", &beats, &beattype) != 2) {
+		return;
+	}
+	out << "        <time>\n";
+	out << "          <beats>" << beats << "</beats>\n";
+	out << "          <beat-type>" << beattype << "</beat-type>\n";
+	out << "        </time>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printClef -- Convert a clef such as *clefG2 or
+//     *clefGv2 (octave-transposing treble clef).
+//
+
+void Tool_hum2musicxml::printClef(ostream& out, HTp token) {
+	string clef = token->substr(5);
+	if (clef.empty()) {
+		return;
+	}
+	char sign = clef[0];
+	if (sign == 'X') {
+		out << "        <clef>\n";
+		out << "          <sign>percussion</sign>\n";
+		out << "        </clef>\n";
+		return;
+	}
+	if ((sign != 'G') && (sign != 'F') && (sign != 'C')) {
+		return;
+	}
+	int octave = 0;
+	int line = 0;
+	for (int i=1; i<(int)clef.size(); i++) {
+		if (clef[i] == 'v') {
+			octave--;
+		} else if (clef[i] == '^') {
+			octave++;
+		} else if (isdigit(clef[i])) {
+			line = clef[i] - '0';
+		}
+	}
+	out << "        <clef>\n";
+	out << "          <sign>" << sign << "</sign>\n";
+	if (line > 0) {
+		out << "          <line>" << line << "</line>\n";
+	}
+	if (octave) {
+		out << "          <clef-octave-change>" << octave << "</clef-octave-change>\n";
+	}
+	out << "        </clef>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printToken -- Print a note, rest or chord.  Returns
+//     the duration of the token in divisions.
+//
+
+int Tool_hum2musicxml::printToken(ostream& out, HTp token, int voice) {
+	int ticks = 0;
+	if (!token->isGrace()) {
+		ticks = getTicks(token->getDuration());
+	}
+	vector<string> beams;
+	if (m_beamsQ && !token->isRest()) {
+		getBeamStates(beams, token, voice);
+	}
+	vector<string> subtoks = token->getSubtokens();
+	for (int i=0; i<(int)subtoks.size(); i++) {
+		printNote(out, token, i, subtoks[i], voice, ticks, beams);
+	}
+	return ticks;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printNote -- Print one note of a token (the index is
+//     the subtoken index in chords).
+//
+
+void Tool_hum2musicxml::printNote(ostream& out, HTp token, int index,
+		const string& subtok, int voice, int ticks, vector<string>& beams) {
+	bool restQ = subtok.find('r') != string::npos;
+	bool measurerestQ = restQ && (subtok.find("rr") != string::npos);
+	bool graceQ = subtok.find('q') != string::npos;
+
+	out << "      <note";
+	if (subtok.find("yy") != string::npos) {
+		out << " print-object=\"no\"";
+	}
+	out << ">\n";
+
+	if (graceQ) {
+		if (subtok.find("qq") != string::npos) {
+			out << "        <grace/>\n";
+		} else {
+			out << "        <grace slash=\"yes\"/>\n";
+		}
+	}
+	if (index > 0) {
+		out << "        <chord/>\n";
+	}
+
+	int alter = 0;
+	if (restQ) {
+		if (measurerestQ) {
+			out << "        <rest measure=\"yes\"/>\n";
+		} else {
+			out << "        <rest/>\n";
+		}
+	} else {
+		alter = Convert::kernToAccidentalCount(subtok);
+		out << "        <pitch>\n";
+		out << "          <step>" << Convert::kernToDiatonicUC(subtok) << "</step>\n";
+		if (alter) {
+			out << "          <alter>" << alter << "</alter>\n";
+		}
+		out << "          <octave>" << Convert::kernToOctaveNumber(subtok) << "</octave>\n";
+		out << "        </pitch>\n";
+	}
+
+	if (!graceQ) {
+		out << "        <duration>" << ticks << "</duration>\n";
+	}
+
+	bool tiestopQ  = (subtok.find('_') != string::npos) || (subtok.find(']') != string::npos);
+	bool tiestartQ = (subtok.find('_') != string::npos) || (subtok.find('[') != string::npos);
+	if (!restQ && tiestopQ) {
+		out << "        <tie type=\"stop\"/>\n";
+	}
+	if (!restQ && tiestartQ) {
+		out << "        <tie type=\"start\"/>\n";
+	}
+
+	out << "        <voice>" << voice << "</voice>\n";
+
+	// The printed duration without dots is a power of two.  Other
+	// durations are tuplets of the next longer power of two.
+	HumNum visual;
+	if (graceQ) {
+		string recip = subtok;
+		recip.erase(std::remove(recip.begin(), recip.end(), 'q'), recip.end());
+		visual = Convert::recipToDurationNoDots(recip);
+		if (visual == 0) {
+			visual.setValue(1, 2);
+		}
+	} else {
+		visual = Convert::recipToDurationNoDots(subtok);
+	}
+	HumNum normal = 1;
+	if (visual > 0) {
+		while (normal < visual) {
+			normal *= 2;
+		}
+		while (normal / 2 >= visual) {
+			normal = normal / 2;
+		}
+	}
+	if (!measurerestQ) {
+		out << "        <type>" << getNoteType(normal) << "</type>\n";
+		int dots = (int)std::count(subtok.begin(), subtok.end(), '.');
+		for (int i=0; i<dots; i++) {
+			out << "        <dot/>\n";
+		}
+	}
+
+	if (!restQ && (token->hasVisibleAccidental(index) == 1)) {
+		out << "        <accidental";
+		if (token->hasCautionaryAccidental(index) == 1) {
+			out << " cautionary=\"yes\"";
+		}
+		out << ">";
+		switch (alter) {
+			case -2: out << "flat-flat";    break;
+			case -1: out << "flat";         break;
+			case  1: out << "sharp";        break;
+			case  2: out << "double-sharp"; break;
+			default: out << "natural";
+		}
+		out << "</accidental>\n";
+	}
+
+	if ((visual > 0) && !graceQ && !measurerestQ && (normal != visual)) {
+		HumNum ratio = normal / visual;
+		out << "        <time-modification>\n";
+		out << "          <actual-notes>" << ratio.getNumerator() << "</actual-notes>\n";
+		out << "          <normal-notes>" << ratio.getDenominator() << "</normal-notes>\n";
+		out << "        </time-modification>\n";
+	}
+
+	if (m_stemsQ && !restQ) {
+		if (token->find('/') != string::npos) {
+			out << "        <stem>up</stem>\n";
+		} else if (token->find('\\') != string::npos) {
+			out << "        <stem>down</stem>\n";
+		}
+	}
+
+	if (index == 0) {
+		for (int i=0; i<(int)beams.size(); i++) {
+			out << "        <beam number=\"" << i + 1 << "\">" << beams[i] << "</beam>\n";
+		}
+	}
+
+	printNotations(out, token, index, subtok);
+
+	out << "      </note>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printNotations -- Print ties, slurs, fermatas and
+//     articulations.  Slurs and articulations are attached to the first
+//     note of a chord.
+//
+
+void Tool_hum2musicxml::printNotations(ostream& out, HTp token, int index,
+		const string& subtok) {
+	stringstream notations;
+
+	if (subtok.find('r') == string::npos) {
+		if ((subtok.find('_') != string::npos) || (subtok.find(']') != string::npos)) {
+			notations << "          <tied type=\"stop\"/>\n";
+		}
+		if ((subtok.find('_') != string::npos) || (subtok.find('[') != string::npos)) {
+			notations << "          <tied type=\"start\"/>\n";
+		}
+	}
+
+	if (index == 0) {
+		printSlurs(notations, token);
+
+		if (token->find(';') != string::npos) {
+			notations << "          <fermata/>\n";
+		}
+
+		string articulations;
+		if (token->find("^^") != string::npos) {
+			articulations += "            <strong-accent/>\n";
+		} else if (token->find('^') != string::npos) {
+			articulations += "            <accent/>\n";
+		}
+		if (token->find('`') != string::npos) {
+			articulations += "            <staccatissimo/>\n";
+		} else if (token->find('\'') != string::npos) {
+			articulations += "            <staccato/>\n";
+		}
+		if (token->find('~') != string::npos) {
+			articulations += "            <tenuto/>\n";
+		}
+		if (!articulations.empty()) {
+			notations << "          <articulations>\n";
+			notations << articulations;
+			notations << "          </articulations>\n";
+		}
+	}
+
+	string contents = notations.str();
+	if (!contents.empty()) {
+		out << "        <notations>\n";
+		out << contents;
+		out << "        </notations>\n";
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printSlurs -- Print the slur stops and starts on a
+//     note.  Slur ends are paired with their starts by analyzeSlurs(), and
+//     both ends of a slur are given the lowest MusicXML number not in use
+//     by another open slur in the part.  Slurs without a matching end are
+//     not printed.
+//
+
+void Tool_hum2musicxml::printSlurs(ostream& out, HTp token) {
+	int slurends = (int)std::count(token->begin(), token->end(), ')');
+	for (int i=0; i<slurends; i++) {
+		string suffix = (i > 0) ? to_string(i + 1) : "";
+		HTp start = token->getValueHTp("auto", "slurStartId" + suffix);
+		if (!start) {
+			continue;
+		}
+		int enumeration = token->getValueInt("auto", "slurStartNumber" + suffix);
+		auto it = m_slurs.find(std::make_pair(start, enumeration));
+		if (it == m_slurs.end()) {
+			continue;
+		}
+		out << "          <slur type=\"stop\" number=\"" << it->second << "\"/>\n";
+		m_slurs.erase(it);
+	}
+
+	int slurstarts = (int)std::count(token->begin(), token->end(), '(');
+	for (int i=0; i<slurstarts; i++) {
+		string suffix = (i > 0) ? to_string(i + 1) : "";
+		if (!token->getValueHTp("auto", "slurEndId" + suffix)) {
+			continue;
+		}
+		int number = 1;
+		bool usedQ = true;
+		while (usedQ) {
+			usedQ = false;
+			for (auto& slur : m_slurs) {
+				if (slur.second == number) {
+					usedQ = true;
+					number++;
+					break;
+				}
+			}
+		}
+		m_slurs[std::make_pair(token, i + 1)] = number;
+		out << "          <slur type=\"start\" number=\"" << number << "\"/>\n";
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getBeamStates -- Convert the beam markers of a token
+//     (L = start, J = end, K/k = partial beams) into MusicXML beam values
+//     for each beam level.  The number of open beams is tracked for each
+//     voice.
+//
+
+void Tool_hum2musicxml::getBeamStates(vector<string>& states, HTp token, int voice) {
+	states.clear();
+	if ((int)m_beamdepth.size() < voice) {
+		m_beamdepth.resize(voice, 0);
+	}
+	int& depth = m_beamdepth[voice - 1];
+	int starts = (int)std::count(token->begin(), token->end(), 'L');
+	int ends   = (int)std::count(token->begin(), token->end(), 'J');
+	int hooksf = (int)std::count(token->begin(), token->end(), 'K');
+	int hooksb = (int)std::count(token->begin(), token->end(), 'k');
+
+	for (int i=0; i<depth; i++) {
+		states.push_back("continue");
+	}
+	for (int i=0; i<ends; i++) {
+		int level = depth - 1 - i;
+		if (level >= 0) {
+			states[level] = "end";
+		}
+	}
+	depth -= ends;
+	if (depth < 0) {
+		depth = 0;
+	}
+	for (int i=0; i<starts; i++) {
+		int level = depth + i;
+		if (level < (int)states.size()) {
+			states[level] = "begin";
+		} else {
+			states.push_back("begin");
+		}
+	}
+	depth += starts;
+	for (int i=0; i<hooksf; i++) {
+		states.push_back("forward hook");
+	}
+	for (int i=0; i<hooksb; i++) {
+		states.push_back("backward hook");
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getNoteType -- Return the MusicXML type name of a
+//     duration in quarter notes.
+//
+
+string Tool_hum2musicxml::getNoteType(HumNum duration) {
+	if (duration == 16)             { return "long";    }
+	if (duration == 8)              { return "breve";   }
+	if (duration == 4)              { return "whole";   }
+	if (duration == 2)              { return "half";    }
+	if (duration == 1)              { return "quarter"; }
+	if (duration == HumNum(1, 2))   { return "eighth";  }
+	if (duration == HumNum(1, 4))   { return "16th";    }
+	if (duration == HumNum(1, 8))   { return "32nd";    }
+	if (duration == HumNum(1, 16))  { return "64th";    }
+	if (duration == HumNum(1, 32))  { return "128th";   }
+	if (duration == HumNum(1, 64))  { return "256th";   }
+	if (duration > 16)              { return "maxima";  }
+	return "quarter";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getTicks -- Convert a duration in quarter notes
+//     into MusicXML divisions.
+//
+
+int Tool_hum2musicxml::getTicks(HumNum duration) {
+	HumNum ticks = duration * m_divisions;
+	return ticks.getInteger();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::escapeXml -- Escape text for XML content.
+//
+
+string Tool_hum2musicxml::escapeXml(const string& value) {
+	string output;
+	output.reserve(value.size());
+	for (int i=0; i<(int)value.size(); i++) {
+		switch (value[i]) {
+			case '&':  output += "&amp;";  break;
+			case '<':  output += "&lt;";   break;
+			case '>':  output += "&gt;";   break;
+			case '"':  output += "&quot;"; break;
+			default:   output += value[i];
+		}
+	}
+	return output;
+}
+
+
+
 
 /////////////////////////////////
 //
@@ -69380,6 +73323,7 @@ Tool_humdiff::Tool_humdiff(void) {
 	define("time-points|times=b", "display timepoint lists for each file");
 	define("note-points|notes=b", "display notepoint lists for each file");
 	define("c|color=s:red",       "color for difference markers");
+	define("a|align=b",           "align measures to detect inserted or deleted measures");
 }
 
 
@@ -69390,6 +73334,11 @@ Tool_humdiff::Tool_humdiff(void) {
 //
 
 bool Tool_humdiff::run(HumdrumFileSet& infiles) {
+	m_marked = 0;
+	m_sources.clear();
+	m_structure.clear();
+	m_agreements.clear();
+
 	int reference = getInteger("reference") - 1;
 	if (reference < 0) {
 		cerr << "Error: reference has to be 1 or higher" << endl;
@@ -69409,8 +73358,13 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 		cerr << "Usage: " << getCommand() << " files" << endl;
 		return false;
 	} else {
+		bool alignQ = getBoolean("align");
 		HumNum targetdur = infiles[0].getScoreDuration();
 		for (int i=1; i<infiles.getSize(); i++) {
+			if (alignQ) {
+				// Aligned scores may differ in length.
+				break;
+			}
 			HumNum dur = infiles[i].getScoreDuration();
 			if (dur != targetdur) {
 				cerr << "Error: all files must have the same duration" << endl;
@@ -69418,20 +73372,43 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 			}
 		}
 
-		for (int i=0; i<infiles.getCount(); i++) {
-			if (i == reference) {
-				continue;
+		if (alignQ) {
+			// Measure alignment is done separately for each alternate score,
+			// but the measures of the reference are only extracted once.
+			vector<MeasurePoint> refmeasures;
+			extractMeasurePoints(refmeasures, infiles[reference]);
+			for (int i=0; i<infiles.getCount(); i++) {
+				if (i == reference) {
+					continue;
+				}
+				m_sources = { reference, i };
+				alignFiles(infiles[reference], refmeasures, infiles[i]);
 			}
-			compareFiles(infiles[reference], infiles[i]);
+		} else {
+			compareFiles(infiles, reference);
 		}
 
-		if (!getBoolean("report")) {
-			infiles[reference].createLinesFromTokens();
-			m_humdrum_text << infiles[reference];
+		if (getBoolean("report")) {
+			for (int i=0; i<(int)m_structure.size(); i++) {
+				m_free_text << m_structure[i] << endl;
+			}
+		} else {
+			HumdrumFile& infile = infiles[reference];
+			infile.createLinesFromTokens();
+			for (int i=0; i<infile.getLineCount(); i++) {
+				printAgreements(infile[i]);
+				m_humdrum_text << infile[i] << endl;
+			}
+			for (int i=0; i<(int)m_structure.size(); i++) {
+				m_humdrum_text << "!!humdiff: " << m_structure[i] << endl;
+			}
 			if (m_marked) {
 				m_humdrum_text << "!!!RDF**kern: @ = marked note";
+				if (!m_agreements.empty()) {
+					m_humdrum_text << ", text above note = count of other sources matching the note";
+				}
 				if (getBoolean("color")) {
-					m_humdrum_text << "color=\"" << getString("color") << "\"";
+					m_humdrum_text << ", color=\"" << getString("color") << "\"";
 				}
 				m_humdrum_text << endl;
 			}
@@ -69445,20 +73422,37 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 
 //////////////////////////////
 //
-// Tool_humdiff::compareFiles --
+// Tool_humdiff::compareFiles -- Compare all alternate scores to the
+//     reference score in a single pass.  The timepoints of each score are
+//     extracted once and merged together, so that each note in the
+//     reference is checked against all other scores at the same time.
 //
 
-void Tool_humdiff::compareFiles(HumdrumFile& reference, HumdrumFile& alternate) {
-	vector<vector<TimePoint>> timepoints(2);
-	extractTimePoints(timepoints.at(0), reference);
-	extractTimePoints(timepoints.at(1), alternate);
+void Tool_humdiff::compareFiles(HumdrumFileSet& infiles, int reference) {
+	vector<HumdrumFile*> files;
+	m_sources.clear();
+	files.push_back(&infiles[reference]);
+	m_sources.push_back(reference);
+	for (int i=0; i<infiles.getCount(); i++) {
+		if (i == reference) {
+			continue;
+		}
+		files.push_back(&infiles[i]);
+		m_sources.push_back(i);
+	}
+
+	vector<vector<TimePoint>> timepoints(files.size());
+	for (int i=0; i<(int)files.size(); i++) {
+		extractTimePoints(timepoints.at(i), *files[i]);
+	}
 
 	if (getBoolean("time-points")) {
-		printTimePoints(timepoints[0]);
-		printTimePoints(timepoints[1]);
+		for (int i=0; i<(int)timepoints.size(); i++) {
+			printTimePoints(timepoints[i]);
+		}
 	}
 
-	compareTimePoints(timepoints, reference, alternate);
+	compareTimePoints(timepoints, files);
 }
 
 
@@ -69483,16 +73477,12 @@ void Tool_humdiff::printTimePoints(vector<TimePoint>& timepoints) {
 //
 
 void Tool_humdiff::compareTimePoints(vector<vector<TimePoint>>& timepoints,
-		HumdrumFile& reference, HumdrumFile& alternate) {
+		vector<HumdrumFile*>& infiles) {
 	vector<int> indexes(timepoints.size(), 0);
 	HumNum minval;
 	HumNum value;
 	int found;
 
-	vector<HumdrumFile*> infiles(2, NULL);
-	infiles[0] = &reference;
-	infiles[1] = &alternate;
-
 	vector<int> increment(timepoints.size(), 0);
 
 	while ((1)) {
@@ -69566,14 +73556,29 @@ void Tool_humdiff::printNotePoints(vector<NotePoint>& notelist) {
 //////////////////////////////
 //
 // Tool_humdiff::markNote -- mark the note (since it does not have a match in other edition(s).
+//     When there is more than one other source, the number of other sources which
+//     contain the note is also stored, to be printed above the note as layout text
+//     (see printAgreements()).
 //
 
-void Tool_humdiff::markNote(NotePoint& np) {
+void Tool_humdiff::markNote(NotePoint& np, int sourcecount) {
 	m_marked = 1;
 	HTp token = np.token;
 	if (!token) {
 		return;
 	}
+	if (token->getSubtoken(np.subindex).find("@") != string::npos) {
+		// already marked from comparison with another score
+		return;
+	}
+	if (sourcecount > 1) {
+		string& text = m_agreements[token];
+		if (!text.empty()) {
+			// another note in the chord is also marked
+			text += " ";
+		}
+		text += to_string(np.agreement) + "/" + to_string(sourcecount);
+	}
 	if (!token->isChord()) {
 		string contents = *token;
 		contents += "@";
@@ -69592,6 +73597,39 @@ void Tool_humdiff::markNote(NotePoint& np) {
 
 
 
+//////////////////////////////
+//
+// Tool_humdiff::printAgreements -- Print a local comment line with layout
+//     text above each marked note in the line which gives the number of
+//     other sources that contain the note, such as "1/3" when the note is
+//     found in one of three other sources.
+//
+
+void Tool_humdiff::printAgreements(HumdrumLine& line) {
+	if (m_agreements.empty() || !line.isData()) {
+		return;
+	}
+	string output;
+	bool found = false;
+	for (int i=0; i<line.getFieldCount(); i++) {
+		if (i > 0) {
+			output += "\t";
+		}
+		auto it = m_agreements.find(line.token(i));
+		if (it == m_agreements.end()) {
+			output += "!";
+			continue;
+		}
+		output += "!LO:TX:a:t=" + it->second;
+		found = true;
+	}
+	if (found) {
+		m_humdrum_text << output << endl;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_humdiff::compareLines --
@@ -69605,8 +73643,6 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 	// cerr << "COMPARING LINES ====================================" << endl;
 	vector<vector<NotePoint>> notelist(indexes.size());
 
-	// Note: timepoints size must be 2
-	// and infiles size must be 2
 	for (int i=0; i<(int)timepoints.size(); i++) {
 		if (indexes.at(i) >= (int)timepoints.at(i).size()) {
 			continue;
@@ -69622,17 +73658,27 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 
 
 	}
+	vector<NoteIndex> noteindex(notelist.size());
+	for (int j=1; j<(int)notelist.size(); j++) {
+		buildNoteIndex(noteindex.at(j), notelist.at(j));
+	}
+
 	for (int i=0; i<(int)notelist.at(0).size(); i++) {
 		notelist.at(0).at(i).matched.resize(notelist.size());
 		fill(notelist.at(0).at(i).matched.begin(), notelist.at(0).at(i).matched.end(), -1);
 		notelist.at(0).at(i).matched.at(0) = i;
+		int agreement = 0;
 		for (int j=1; j<(int)notelist.size(); j++) {
-			int status = findNoteInList(notelist.at(0).at(i), notelist.at(j));
+			int status = findNoteInList(notelist.at(0).at(i), notelist.at(j), noteindex.at(j));
 			notelist.at(0).at(i).matched.at(j) = status;
-			if ((status < 0) && !reportQ) {
-				markNote(notelist.at(0).at(i));
+			if (status >= 0) {
+				agreement++;
 			}
 		}
+		notelist.at(0).at(i).agreement = agreement;
+		if ((agreement < (int)notelist.size() - 1) && !reportQ) {
+			markNote(notelist.at(0).at(i), (int)notelist.size() - 1);
+		}
 	}
 
 	if (getBoolean("notes")) {
@@ -69648,31 +73694,39 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 	}
 
 	// report
+	int sourcecount = (int)notelist.size() - 1;
 	for (int i=0; i<(int)notelist.at(0).size(); i++) {
-		for (int j=1; j<(int)notelist.at(0).at(i).matched.size(); j++) {
-			if (notelist.at(0).at(i).matched.at(j) < 0) {
-				cout << "NOTE " << notelist.at(0).at(i).subtoken
-				     << " DOES NOT HAVE EXACT MATCH IN SOURCE " << j << endl;
-				int humindex = notelist.at(0).at(i).token->getLineIndex();
-				cout << "\tREFERENCE MEASURE\t: " << notelist.at(0).at(i).measure << endl;
-				cout << "\tREFERENCE LINE NO.\t: " << humindex+1 << endl;
-				cout << "\tREFERENCE LINE TEXT\t: " << (*infiles[0])[humindex] << endl;
+		NotePoint& np = notelist.at(0).at(i);
+		for (int j=1; j<(int)np.matched.size(); j++) {
+			if (np.matched.at(j) < 0) {
+				int source = getSourceNumber(j);
+				m_free_text << "NOTE " << np.subtoken
+				     << " DOES NOT HAVE EXACT MATCH IN SOURCE " << source << endl;
+				int humindex = np.token->getLineIndex();
+				m_free_text << "\tREFERENCE MEASURE\t: " << np.measure << endl;
+				m_free_text << "\tREFERENCE LINE NO.\t: " << humindex+1 << endl;
+				m_free_text << "\tREFERENCE LINE TEXT\t: " << (*infiles[0])[humindex] << endl;
 
-				cout << "\tTARGET  " << j << " LINE NO. ";
-				if (j < 10) {
-					cout << " ";
+				m_free_text << "\tTARGET  " << source << " LINE NO. ";
+				if (source < 10) {
+					m_free_text << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				m_free_text << ":\t" << "X" << endl;
 
-				cout << "\tTARGET  " << j << " LINE TEXT";
-				if (j < 10) {
-					cout << " ";
+				m_free_text << "\tTARGET  " << source << " LINE TEXT";
+				if (source < 10) {
+					m_free_text << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				m_free_text << ":\t" << "X" << endl;
 
-				cout << endl;
+				m_free_text << endl;
 			}
 		}
+		if ((sourcecount > 1) && (np.agreement < sourcecount)) {
+			m_free_text << "NOTE " << np.subtoken << " IN REFERENCE MEASURE "
+			     << np.measure << " MATCHES " << np.agreement << " OF "
+			     << sourcecount << " SOURCES" << endl << endl;
+		}
 	}
 }
 
@@ -69680,30 +73734,399 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 
 //////////////////////////////
 //
-// Tool_humdiff::findNoteInList --
+// Tool_humdiff::getSourceNumber -- Return the file number (counting from
+//     1) of a position in the list of compared scores.
 //
 
-int Tool_humdiff::findNoteInList(NotePoint& np, vector<NotePoint>& nps) {
+int Tool_humdiff::getSourceNumber(int index) {
+	if ((index >= 0) && (index < (int)m_sources.size())) {
+		return m_sources[index] + 1;
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::findNoteInList -- Find an unprocessed note with the same
+//     pitch and duration using a hash index of the notes in the list.
+//     The matched note is marked as processed so that it will not be
+//     matched again (such as for doubled notes in a chord).
+//
+
+int Tool_humdiff::findNoteInList(NotePoint& np, vector<NotePoint>& nps,
+		NoteIndex& index) {
+	auto it = index.find(getNoteKey(np));
+	if (it == index.end()) {
+		return -1;
+	}
+	vector<int>& candidates = it->second;
+	for (int i=0; i<(int)candidates.size(); i++) {
+		NotePoint& target = nps.at(candidates[i]);
+		if (target.processed) {
+			continue;
+		}
+		if ((target.b40 != np.b40) || (target.duration != np.duration)) {
+			// hash collision
+			continue;
+		}
+		target.processed = 1;
+		return candidates[i];
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::buildNoteIndex -- Create a hash index for a list of notes.
+//
+
+void Tool_humdiff::buildNoteIndex(NoteIndex& index, vector<NotePoint>& nps) {
+	index.clear();
+	index.reserve(nps.size());
 	for (int i=0; i<(int)nps.size(); i++) {
-		// cerr << "COMPARING " << np.token << " (" << np.b40 << ") TO " << nps.at(i).token << " (" << nps.at(i).b40 << ") " << endl;
-		if (nps.at(i).processed) {
+		index[getNoteKey(nps[i])].push_back(i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getNoteKey -- Return a hash key for the pitch and
+//     duration of a note.
+//
+
+uint64_t Tool_humdiff::getNoteKey(NotePoint& np) {
+	uint64_t key = (uint64_t)(int64_t)np.b40;
+	key = key * 1000003 + (uint64_t)np.duration.getNumerator();
+	key = key * 1000003 + (uint64_t)np.duration.getDenominator();
+	return key;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignFiles -- Compare two scores after aligning their
+//     measures, so that measures which have been added to or removed
+//     from the alternate score are reported as structural differences
+//     rather than causing all following notes to mismatch.  Measures with
+//     identical contents are matched by their hashes using a longest
+//     common subsequence (Myers O(ND) difference algorithm), and the
+//     unmatched measures between them are compared note by note.
+//
+
+void Tool_humdiff::alignFiles(HumdrumFile& reference,
+		vector<MeasurePoint>& refmeasures, HumdrumFile& alternate) {
+	vector<MeasurePoint> altmeasures;
+	extractMeasurePoints(altmeasures, alternate);
+
+	vector<pair<int, int>> matches;
+	alignMeasures(matches, refmeasures, altmeasures);
+	matches.emplace_back((int)refmeasures.size(), (int)altmeasures.size());
+
+	int ri = 0;
+	int ai = 0;
+	for (int m=0; m<(int)matches.size(); m++) {
+		int rend = matches[m].first;
+		int aend = matches[m].second;
+		int common = std::min(rend - ri, aend - ai);
+		for (int k=0; k<common; k++) {
+			compareMeasures(refmeasures[ri+k], altmeasures[ai+k], reference, alternate);
+		}
+		for (int r=ri+common; r<rend; r++) {
+			markMeasure(refmeasures[r], reference);
+			m_structure.push_back("measure " + to_string(refmeasures[r].measure)
+					+ " (line " + to_string(refmeasures[r].startline + 1)
+					+ ") of reference is missing in source " + to_string(getSourceNumber(1)));
+		}
+		for (int a=ai+common; a<aend; a++) {
+			string message = "measure " + to_string(altmeasures[a].measure)
+					+ " (line " + to_string(altmeasures[a].startline + 1)
+					+ ") of source " + to_string(getSourceNumber(1))
+					+ " is inserted";
+			if (rend > 0) {
+				message += " after reference measure ";
+				message += to_string(refmeasures[std::min(rend, (int)refmeasures.size()) - 1].measure);
+			} else {
+				message += " at start of reference";
+			}
+			m_structure.push_back(message);
+		}
+		ri = rend + 1;
+		ai = aend + 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasures -- Find the longest common subsequence of
+//     measure hashes between the two scores with the Myers difference
+//     algorithm, which runs in O((N+M)D) time where D is the number of
+//     inserted and deleted measures.  The linear-space variant is used
+//     (see alignMeasureRange()), so memory use is O(N+M) even when the
+//     scores differ a lot.  The output is a list of matched (reference,
+//     alternate) measure index pairs in increasing order.
+//
+
+void Tool_humdiff::alignMeasures(vector<pair<int, int>>& matches,
+		vector<MeasurePoint>& reference, vector<MeasurePoint>& alternate) {
+	matches.clear();
+	alignMeasureRange(matches, reference, alternate, 0, (int)reference.size(),
+			0, (int)alternate.size());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasureRange -- Append the matched measures between
+//     reference measures [x0, x1) and alternate measures [y0, y1).  Common
+//     measures at the start and end are matched directly, then the range
+//     is divided at the middle snake of an optimal edit path and each half
+//     is aligned recursively.  Each half has at most half of the edits of
+//     the range, so the recursion depth is O(log D).
+//
+
+void Tool_humdiff::alignMeasureRange(vector<pair<int, int>>& matches,
+		vector<MeasurePoint>& reference, vector<MeasurePoint>& alternate,
+		int x0, int x1, int y0, int y1) {
+	while ((x0 < x1) && (y0 < y1) && (reference[x0].hash == alternate[y0].hash)) {
+		matches.emplace_back(x0, y0);
+		x0++;
+		y0++;
+	}
+	int suffix = 0;
+	while ((x1 > x0) && (y1 > y0) && (reference[x1-1].hash == alternate[y1-1].hash)) {
+		x1--;
+		y1--;
+		suffix++;
+	}
+
+	if ((x0 < x1) && (y0 < y1)) {
+		int xstart;
+		int ystart;
+		int xend;
+		int yend;
+		findMiddleSnake(reference, alternate, x0, x1, y0, y1, xstart, ystart,
+				xend, yend);
+		alignMeasureRange(matches, reference, alternate, x0, xstart, y0, ystart);
+		for (int i=0; i<xend-xstart; i++) {
+			matches.emplace_back(xstart + i, ystart + i);
+		}
+		alignMeasureRange(matches, reference, alternate, xend, x1, yend, y1);
+	}
+
+	for (int i=0; i<suffix; i++) {
+		matches.emplace_back(x1 + i, y1 + i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::findMiddleSnake -- Find the middle snake (the diagonal run
+//     of matching measures in the middle of an optimal edit path) between
+//     reference measures [x0, x1) and alternate measures [y0, y1) by
+//     searching forward from the start and backward from the end at the
+//     same time until the searches overlap.  Only the furthest reaching
+//     point on each diagonal for the current edit distance is stored.
+//     The snake runs from (xstart, ystart) to (xend, yend).
+//
+
+void Tool_humdiff::findMiddleSnake(vector<MeasurePoint>& reference,
+		vector<MeasurePoint>& alternate, int x0, int x1, int y0, int y1,
+		int& xstart, int& ystart, int& xend, int& yend) {
+	int n = x1 - x0;
+	int m = y1 - y0;
+	int delta = n - m;
+	bool odd = (delta % 2) != 0;
+	int maxd = (n + m + 1) / 2;
+	int offset = maxd + 1;
+	// forward[offset+k]: furthest x from the start on diagonal k = x - y.
+	// backward[offset+k]: furthest x from the end on reversed diagonal k.
+	vector<int> forward(2 * maxd + 3, 0);
+	vector<int> backward(2 * maxd + 3, 0);
+
+	for (int d=0; d<=maxd; d++) {
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (forward[offset+k-1] < forward[offset+k+1]))) {
+				x = forward[offset+k+1];
+			} else {
+				x = forward[offset+k-1] + 1;
+			}
+			int y = x - k;
+			int sx = x;
+			int sy = y;
+			while ((x < n) && (y < m) && (reference[x0+x].hash == alternate[y0+y].hash)) {
+				x++;
+				y++;
+			}
+			forward[offset+k] = x;
+			int c = delta - k;
+			if (odd && (c >= -(d-1)) && (c <= d-1) && (x + backward[offset+c] >= n)) {
+				xstart = x0 + sx;
+				ystart = y0 + sy;
+				xend = x0 + x;
+				yend = y0 + y;
+				return;
+			}
+		}
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (backward[offset+k-1] < backward[offset+k+1]))) {
+				x = backward[offset+k+1];
+			} else {
+				x = backward[offset+k-1] + 1;
+			}
+			int y = x - k;
+			int sx = x;
+			int sy = y;
+			while ((x < n) && (y < m) &&
+					(reference[x1-1-x].hash == alternate[y1-1-y].hash)) {
+				x++;
+				y++;
+			}
+			backward[offset+k] = x;
+			int c = delta - k;
+			if (!odd && (c >= -d) && (c <= d) && (x + forward[offset+c] >= n)) {
+				xstart = x1 - x;
+				ystart = y1 - y;
+				xend = x1 - sx;
+				yend = y1 - sy;
+				return;
+			}
+		}
+	}
+
+	// Not reached for non-empty ranges.
+	xstart = xend = x0;
+	ystart = yend = y0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::compareMeasures -- Compare the notes of two measures
+//     which have been aligned with each other.
+//
+
+void Tool_humdiff::compareMeasures(MeasurePoint& refmeasure,
+		MeasurePoint& altmeasure, HumdrumFile& reference, HumdrumFile& alternate) {
+	if (refmeasure.hash == altmeasure.hash) {
+		return;
+	}
+	vector<vector<TimePoint>> timepoints(2);
+	timepoints[0] = refmeasure.timepoints;
+	timepoints[1] = altmeasure.timepoints;
+	vector<HumdrumFile*> infiles(2, NULL);
+	infiles[0] = &reference;
+	infiles[1] = &alternate;
+	compareTimePoints(timepoints, infiles);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::markMeasure -- Mark all notes in a measure which does
+//     not have an equivalent in the other score.
+//
+
+void Tool_humdiff::markMeasure(MeasurePoint& measure, HumdrumFile& infile) {
+	if (getBoolean("report")) {
+		return;
+	}
+	for (int i=0; i<(int)measure.timepoints.size(); i++) {
+		vector<NotePoint> notelist;
+		getNoteList(notelist, infile, measure.timepoints[i].index[0],
+				measure.measure, 0, i);
+		// mark notes from last to first, since chord subtokens are rewritten:
+		for (int j=(int)notelist.size()-1; j>=0; j--) {
+			markNote(notelist[j]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::extractMeasurePoints -- Extract a list of measures in a
+//     file, with the timepoints of each measure and a hash of the notes
+//     in the measure.  The hash is the sum of mixed hashes for the pitch,
+//     duration and metric position of each note, so that it does not
+//     depend on the order of the notes on a line.
+//
+
+void Tool_humdiff::extractMeasurePoints(vector<MeasurePoint>& measures,
+		HumdrumFile& infile) {
+	measures.clear();
+	HumRegex hre;
+	MeasurePoint current;
+	current.startline = 0;
+	vector<NotePoint> notelist;
+	TimePoint tp;
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline()) {
+			current.endline = i;
+			if (!current.timepoints.empty()) {
+				measures.push_back(current);
+			}
+			current.clear();
+			current.startline = i;
+			current.start = infile[i].getDurationFromStart();
+			if (hre.search(infile.token(i, 0), "(\\d+)")) {
+				current.measure = hre.getMatchInt(1);
+			}
 			continue;
 		}
-		if (nps.at(i).b40 != np.b40) {
+		if (!infile[i].isData()) {
 			continue;
 		}
-		if (nps.at(i).duration != np.duration) {
+		if (infile[i].getDuration() == 0) {
+			// ignore grace notes for now
 			continue;
 		}
-		return i;
+		tp.clear();
+		tp.file.push_back(&infile);
+		tp.index.push_back(i);
+		tp.timestamp = infile[i].getDurationFromStart() - current.start;
+		tp.measure = current.measure;
+		current.timepoints.push_back(tp);
+
+		notelist.clear();
+		getNoteList(notelist, infile, i, current.measure, 0, 0);
+		for (int j=0; j<(int)notelist.size(); j++) {
+			uint64_t h = getNoteKey(notelist[j]);
+			h = h * 1000003 + (uint64_t)tp.timestamp.getNumerator();
+			h = h * 1000003 + (uint64_t)tp.timestamp.getDenominator();
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdULL;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ULL;
+			h ^= h >> 33;
+			current.hash += h;
+		}
+	}
+	current.endline = infile.getLineCount() - 1;
+	if (!current.timepoints.empty()) {
+		measures.push_back(current);
 	}
-	// cerr << "\tCannot find note " << np.token << " on line " << np.token->getLineIndex() << " in other work" << endl;
-	return -1;
 }
 
 
 
-
 //////////////////////////////
 //
 // Tool_humdiff::getNoteList --
@@ -69738,7 +74161,7 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 			notelist.back().subtoken = subtok;
 			notelist.back().subindex = j;
 			notelist.back().measurequarter = token->getDurationFromBarline();
-			notelist.back().measure =
+			notelist.back().measure = measure;
 			notelist.back().track = track;
 			notelist.back().layer = layer;
 			notelist.back().sourceindex = sourceindex;
@@ -72281,6 +76704,8 @@ Tool_mei2hum::Tool_mei2hum(void) {
 	define("s|stems=b", "include stems in output");
 	define("x|xmlids=b", "include xmlids in output");
 	define("P|no-place=b", "Do not convert placement attribute");
+	define("batch=b", "convert files listed in input (or stdin) with JSON-lines report");
+	define("threads=i:0", "number of threads for batch conversion (0 = all cores)");
 
 	m_maxverse.resize(m_maxstaff);
 	fill(m_maxverse.begin(), m_maxverse.end(), 0);
@@ -72313,10 +76738,10 @@ bool Tool_mei2hum::convertFile(ostream& out, const char* filename) {
 	xml_document doc;
 	auto result = doc.load_file(filename);
 	if (!result) {
-		cerr << "\nXML file [" << filename << "] has syntax errors\n";
-		cerr << "Error description:\t" << result.description() << "\n";
-		cerr << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+		m_error_text << "\nXML file [" << filename << "] has syntax errors\n";
+		m_error_text << "Error description:\t" << result.description() << "\n";
+		m_error_text << "Error offset:\t" << result.offset << "\n\n";
+		return false;
 	}
 
 	return convert(out, doc);
@@ -72354,10 +76779,10 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 	auto score = doc.select_node("/mei/music/body/mdiv/score").node();
 
 	if (!score) {
-		cerr << "Cannot find score, so cannot convert MEI file to Humdrum";
-		cerr << endl;
-		cerr << "Perhaps there is a problem in the XML structure of the file.";
-		cerr << endl;
+		m_error_text << "Cannot find score, so cannot convert MEI file to Humdrum";
+		m_error_text << endl;
+		m_error_text << "Perhaps there is a problem in the XML structure of the file.";
+		m_error_text << endl;
 		return false;
 	}
 
@@ -72366,7 +76791,7 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 		// probably mensural music
 		m_staffcount = extractStaffCountByScoreDef(score);
 		if (m_staffcount == 0) {
-			cerr << "error: no music detected in <score>" << endl;
+			m_error_text << "error: no music detected in <score>" << endl;
 		}
 	}
 
@@ -75248,12 +79673,9 @@ void Tool_mei2hum::processFermataAttribute(string& output, xml_node node) {
 //
 
 void Tool_mei2hum::processPreliminaryLinkedNodes(xml_node node) {
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_startlinks.find(id);
-		if (found != m_startlinks.end()) {
-			processNodeStartLinks2(node, (*found).second);
-		}
+	int id = getIdIndex(node);
+	if ((id >= 0) && !m_startlinks[id].empty()) {
+		processNodeStartLinks2(node, m_startlinks[id]);
 	}
 }
 
@@ -75265,16 +79687,15 @@ void Tool_mei2hum::processPreliminaryLinkedNodes(xml_node node) {
 //
 
 void Tool_mei2hum::processLinkedNodes(string& output, xml_node node) {
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_startlinks.find(id);
-		if (found != m_startlinks.end()) {
-			processNodeStartLinks(output, node, (*found).second);
-		}
-		found = m_stoplinks.find(id);
-		if (found != m_stoplinks.end()) {
-			processNodeStopLinks(output, node, (*found).second);
-		}
+	int id = getIdIndex(node);
+	if (id < 0) {
+		return;
+	}
+	if (!m_startlinks[id].empty()) {
+		processNodeStartLinks(output, node, m_startlinks[id]);
+	}
+	if (!m_stoplinks[id].empty()) {
+		processNodeStopLinks(output, node, m_stoplinks[id]);
 	}
 }
 
@@ -75556,15 +79977,12 @@ void Tool_mei2hum::parseSlurStop(string& output, xml_node node, xml_node slur) {
 void Tool_mei2hum::parseTieStart(string& output, xml_node node, xml_node tie) {
 	NODE_VERIFY(tie, )
 
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_stoplinks.find(id);
-		if (found != m_stoplinks.end()) {
-			for (auto item : (*found).second) {
-				if (strcmp(tie.attribute("startid").value(), item.attribute("endid").value()) == 0) {
-					// deal with tie middles in parseTieStop().
-					return;
-				}
+	int id = getIdIndex(node);
+	if (id >= 0) {
+		for (auto item : m_stoplinks[id]) {
+			if (strcmp(tie.attribute("startid").value(), item.attribute("endid").value()) == 0) {
+				// deal with tie middles in parseTieStop().
+				return;
 			}
 		}
 	}
@@ -75616,15 +80034,12 @@ void Tool_mei2hum::parseTrill(string& output, xml_node node, xml_node trill) {
 void Tool_mei2hum::parseTieStop(string& output, xml_node node, xml_node tie) {
 	NODE_VERIFY(tie, )
 
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_startlinks.find(id);
-		if (found != m_startlinks.end()) {
-			for (auto item : (*found).second) {
-				if (strcmp(tie.attribute("endid").value(), item.attribute("startid").value()) == 0) {
-					output += "_";
-					return;
-				}
+	int id = getIdIndex(node);
+	if (id >= 0) {
+		for (auto item : m_startlinks[id]) {
+			if (strcmp(tie.attribute("endid").value(), item.attribute("startid").value()) == 0) {
+				output += "_";
+				return;
 			}
 		}
 	}
@@ -76297,7 +80712,10 @@ void Tool_mei2hum::initialize(void) {
 
 //////////////////////////////
 //
-// Tool_mei2hum::buildIdLinkMap -- Build table of startid and endid links between elements.
+// Tool_mei2hum::buildIdLinkMap -- Build table of startid and endid links between
+//     elements in a single pass over the document.  ID strings are interned,
+//     so that the note/rest/chord parsers look up their linked control
+//     events by element rather than by reading and comparing attributes.
 //
 // Reference: https://pugixml.org/docs/samples/traverse_walker.cpp
 //
@@ -76306,51 +80724,88 @@ void Tool_mei2hum::buildIdLinkMap(xml_document& doc) {
 	class linkmap_walker : public pugi::xml_tree_walker {
 		public:
 			virtual bool for_each(pugi::xml_node& node) {
-				xml_attribute startid = node.attribute("startid");
-				xml_attribute endid = node.attribute("endid");
-				if (startid) {
-
-					string value = startid.value();
-					if (!value.empty()) {
-						if (value[0] == '#') {
-							value = value.substr(1, string::npos);
+				if (node.type() != pugi::node_element) {
+					return true;
+				}
+				int start = -1;
+				int stop = -1;
+				for (xml_attribute attribute = node.first_attribute(); attribute;
+						attribute = attribute.next_attribute()) {
+					const char* name = attribute.name();
+					if (strcmp(name, "xml:id") == 0) {
+						int id = tool->internId(attribute.value());
+						if (id >= 0) {
+							tool->m_nodeids[node.hash_value()] = id;
 						}
+					} else if (strcmp(name, "startid") == 0) {
+						start = tool->internId(attribute.value());
+					} else if (strcmp(name, "endid") == 0) {
+						stop = tool->internId(attribute.value());
 					}
-					if (!value.empty()) {
-						(*startlinks)[value].push_back(node);
-					}
-
 				}
-				if (endid) {
-
-					string value = endid.value();
-					if (!value.empty()) {
-						if (value[0] == '#') {
-							value = value.substr(1, string::npos);
-						}
-					}
-					if (!value.empty()) {
-						(*stoplinks)[value].push_back(node);
-					}
-
+				if (start >= 0) {
+					tool->m_startlinks[start].push_back(node);
+				}
+				if (stop >= 0) {
+					tool->m_stoplinks[stop].push_back(node);
 				}
 				return true; // continue traversal
 			}
 
-			map<string, vector<xml_node>>* startlinks = NULL;
-			map<string, vector<xml_node>>* stoplinks = NULL;
+			Tool_mei2hum* tool = NULL;
 	};
 
+	m_idindex.clear();
+	m_nodeids.clear();
 	m_startlinks.clear();
 	m_stoplinks.clear();
 	linkmap_walker walker;
-	walker.startlinks = &m_startlinks;
-	walker.stoplinks = &m_stoplinks;
+	walker.tool = this;
 	doc.traverse(walker);
 }
 
 
 
+//////////////////////////////
+//
+// Tool_mei2hum::internId -- Return the index of an ID string (with or without
+//     a leading "#"), adding it to the ID tables if necessary.  Returns -1
+//     for an empty ID.
+//
+
+int Tool_mei2hum::internId(const char* id) {
+	if (id[0] == '#') {
+		id++;
+	}
+	if (id[0] == '\0') {
+		return -1;
+	}
+	auto result = m_idindex.emplace(id, (int)m_idindex.size());
+	if (result.second) {
+		m_startlinks.emplace_back();
+		m_stoplinks.emplace_back();
+	}
+	return result.first->second;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_mei2hum::getIdIndex -- Return the interned xml:id of an element, or -1
+//     if it has none.
+//
+
+int Tool_mei2hum::getIdIndex(xml_node node) {
+	auto found = m_nodeids.find(node.hash_value());
+	if (found == m_nodeids.end()) {
+		return -1;
+	}
+	return found->second;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_mei2hum::parseDir -- Meter cannot change in middle of measure.
@@ -80888,6 +85343,7 @@ bool Tool_musedata2hum::convert(ostream& out, MuseDataSet& mds) {
 		return false;
 	}
 	initialize();
+	m_measuretimes.clear();
 
 	HumGrid outdata;
 	bool status = true;
@@ -81497,20 +85953,22 @@ void Tool_musedata2hum::setTimeSigDurInfo(const string& ktimesig) {
 
 //////////////////////////////
 //
-// Tool_musedata2hum::getMeasure --  Could be imporoved by NlogN search.
+// Tool_musedata2hum::getMeasure -- Return the measure starting at the
+//     given time.  Measures are indexed by their starting time, so each
+//     measure of a part is found without rescanning all previous measures.
 //
 
 GridMeasure* Tool_musedata2hum::getMeasure(HumGrid& outdata, HumNum starttime) {
-	for (int i=0; i<(int)outdata.size(); i++) {
-		if (outdata[i]->getTimestamp() == starttime) {
-			return outdata[i];
-		}
+	auto it = m_measuretimes.find(starttime);
+	if (it != m_measuretimes.end()) {
+		return it->second;
 	}
 	// Did not find measure in data, so append to end of list.
 	// Assuming that unknown measures are at a later timestamp
 	// than those in current list, but should fix this later perhaps.
 	GridMeasure* gm = new GridMeasure(&outdata);
 	outdata.push_back(gm);
+	m_measuretimes[starttime] = gm;
 	return gm;
 }
 
@@ -81568,6 +86026,9 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 	define("r|recip=b", "output **recip spine");
 	define("s|stems=b", "include stems in output");
+	define("batch=b", "convert files listed in input (or stdin) with JSON-lines report");
+	define("threads=i:0", "number of threads for batch conversion (0 = all cores)");
+	define("part-threads=i:0", "number of threads for parsing parts (0 = all cores)");
 
 	VoiceDebugQ = false;
 	DebugQ = false;
@@ -81578,26 +86039,22 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 //////////////////////////////
 //
 // Tool_musicxml2hum::convert -- Convert a MusicXML file into
-//     Humdrum content.
+//     Humdrum content.  Files and input streams are read incrementally
+//     with convertStream().
 //
 
 bool Tool_musicxml2hum::convertFile(ostream& out, const char* filename) {
-	xml_document doc;
-	auto result = doc.load_file(filename);
-	if (!result) {
-		cerr << "\nXML file [" << filename << "] has syntax errors\n";
-		cerr << "Error description:\t" << result.description() << "\n";
-		cerr << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+	ifstream input(filename, ios::in | ios::binary);
+	if (!input.is_open()) {
+		m_error_text << "\nCannot open XML file [" << filename << "]\n\n";
+		return false;
 	}
-
-	return convert(out, doc);
+	return convertStream(out, input);
 }
 
 
 bool Tool_musicxml2hum::convert(ostream& out, istream& input) {
-	string s(istreambuf_iterator<char>(input), {});
-	return convert(out, s.c_str());
+	return convertStream(out, input);
 }
 
 
@@ -81619,26 +86076,459 @@ bool Tool_musicxml2hum::convert(ostream& out, const char* input) {
 bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	initialize();
 
-	bool status = true; // for keeping track of problems in conversion process.
-
 	setSoftwareInfo(doc);
 	vector<string> partids;            // list of part IDs
 	map<string, xml_node> partinfo;    // mapping if IDs to score-part elements
 	map<string, xml_node> partcontent; // mapping of IDs to part elements
 
 	getPartInfo(partinfo, partids, doc);
+	getPartContent(partcontent, partids, doc);
+	vector<MxmlPart> partdata;
+	preparePartData(partdata, partids, partinfo);
+
+	fillPartData(partdata, partids, partinfo, partcontent);
+
+	return convertPartData(out, doc, partids, partinfo, partcontent, partdata);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertArchive -- Convert compressed MusicXML (.mxl)
+//     content.  The score named in META-INF/container.xml is decompressed
+//     into memory and parsed in place, without temporary files.
+//
+
+bool Tool_musicxml2hum::convertArchive(ostream& out, istream& input) {
+	MxmlArchive archive;
+	vector<char> content;
+	if (!archive.read(input) || !archive.getRootFile(content)) {
+		m_error_text << "\nCannot read compressed MusicXML content: "
+		             << archive.getError() << "\n\n";
+		return false;
+	}
+
+	xml_document doc;
+	auto result = doc.load_buffer_inplace(content.data(), content.size());
+	if (!result) {
+		m_error_text << "\nXML content has syntax errors\n";
+		m_error_text << "Error description:\t" << result.description() << "\n";
+		m_error_text << "Error offset:\t" << result.offset << "\n\n";
+		return false;
+	}
+	return convert(out, doc);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertStream -- Convert MusicXML content while
+//     reading it.  Only the <score-partwise> element's non-part children
+//     (identification, credits, part-list, etc.) are collected into a
+//     header document; each <measure> of a part is parsed as soon as its
+//     end tag is read, copied into a document for the part, and then added
+//     to the part data.  The full file text is never held in memory, and
+//     only one measure at a time is held as text or in a parse buffer.
+//     Input which is not UTF-8 <score-partwise> content is passed on to
+//     the document-based converter, and compressed MusicXML (.mxl) input
+//     is passed on to convertArchive().
+//
+
+bool Tool_musicxml2hum::convertStream(ostream& out, istream& input) {
+	streambuf* sb = input.rdbuf();
+	releaseFragments();
+	m_prolog.clear();
+
+	// UTF-16/32 input is not scanned (it would have a byte order mark
+	// or NUL bytes before the first markup character).
+	int c = sb->sgetc();
+	if (c == 'P') {
+		// "PK": ZIP archive (XML content cannot start with "P").
+		return convertArchive(out, input);
+	}
+	bool scannable = (c != EOF) && (c != 0) && (c != 0xfe) && (c != 0xff);
+
+	string markup;
+	string name;
+	string prefix;  // content before the root element
+	int type = mxml_eof;
+	while (scannable) {
+		type = readMarkup(sb, markup, name);
+		prefix += markup;
+		if ((type == mxml_eof) || (type == mxml_error) || (type == mxml_start)) {
+			break;
+		}
+		if ((type == mxml_other) && (markup.compare(0, 5, "<?xml") == 0)) {
+			m_prolog = markup;
+		}
+	}
+
+	if (!scannable || (type != mxml_start) || (name != "score-partwise")) {
+		// Timewise scores and unusual encodings are read into a document.
+		prefix.append(istreambuf_iterator<char>(sb), {});
+		xml_document doc;
+		auto result = doc.load_buffer(prefix.data(), prefix.size());
+		if (!result) {
+			m_error_text << "\nXML content has syntax errors\n";
+			m_error_text << "Error description:\t" << result.description() << "\n";
+			m_error_text << "Error offset:\t" << result.offset << "\n\n";
+			return false;
+		}
+		return convert(out, doc);
+	}
+
+	initialize();
+
+	string header = m_prolog + markup;
+	xml_document doc;
+	bool inheader = true;
+	vector<string> partids;
+	map<string, xml_node> partinfo;
+	map<string, xml_node> partcontent;
+	vector<MxmlPart> partdata;
+	vector<vector<xml_node>> partmeasures;
+	vector<bool> partfound;
+	int partindex = -1;
+	xml_node partnode;       // <part> element of the current part
+	xml_document measuredoc; // reused for parsing each measure
+	HumRegex hre;
+
+	while (true) {
+		type = readMarkup(sb, markup, name);
+		if (type == mxml_error) {
+			m_error_text << "Error: unterminated markup in MusicXML content" << endl;
+			return false;
+		}
+		bool rootend = (type == mxml_end) && (name == "score-partwise");
+		bool partstart = ((type == mxml_start) || (type == mxml_empty)) && (name == "part");
+
+		if (inheader && (partstart || rootend || (type == mxml_eof))) {
+			header += "</score-partwise>";
+			if (!parseFragment(doc, header, "header")) {
+				return false;
+			}
+			inheader = false;
+			setSoftwareInfo(doc);
+			getPartInfo(partinfo, partids, doc);
+			preparePartData(partdata, partids, partinfo);
+			for (int i=0; i<(int)partdata.size(); i++) {
+				preparePart(partdata[i], partinfo[partids[i]]);
+			}
+			partfound.resize(partids.size(), false);
+			partmeasures.resize(partids.size());
+		}
+
+		if (rootend || (type == mxml_eof)) {
+			break;
+		}
+		if (inheader) {
+			header += markup;
+			continue;
+		}
+
+		if (partstart) {
+			string partid;
+			if (hre.search(markup, "\\sid\\s*=\\s*[\"']([^\"']*)")) {
+				partid = hre.getMatch(1);
+			} else {
+				m_error_text << "Warning: Part " << partfound.size() << " has no ID" << endl;
+			}
+			auto it = find(partids.begin(), partids.end(), partid);
+			partindex = (int)(it - partids.begin());
+			if (it == partids.end()) {
+				m_error_text << "Error: Part ID " << partid
+				             << " is not present in part-list element list" << endl;
+				partindex = -1;
+			} else if (partfound[partindex]) {
+				m_error_text << "Error: ID " << partid
+				             << " is duplicated and secondary part will be ignored" << endl;
+				partindex = -1;
+			} else {
+				partfound[partindex] = true;
+			}
+			if (type == mxml_empty) {
+				partindex = -1;
+			}
+			if (partindex < 0) {
+				continue;
+			}
+			// Each part is collected into its own document, so that the
+			// measures are stored compactly after they are parsed.
+			xml_document* partdoc = new xml_document;
+			m_fragments.push_back(partdoc);
+			if (!parseFragment(*partdoc, m_prolog + markup + "</part>", "part " + partid)) {
+				return false;
+			}
+			partnode = partdoc->document_element();
+			partcontent[partid] = partnode;
+			continue;
+		}
+
+		if ((type == mxml_end) && (name == "part")) {
+			partindex = -1;
+			continue;
+		}
+
+		if (((type == mxml_start) || (type == mxml_empty)) && (name == "measure")) {
+			string text = m_prolog + markup;
+			if ((type == mxml_start) && !readElement(sb, text, name)) {
+				m_error_text << "Error: unterminated measure in MusicXML content" << endl;
+				return false;
+			}
+			if (partindex < 0) {
+				continue;
+			}
+			string description = "measure " + to_string(partmeasures[partindex].size() + 1)
+					+ " of part " + partids[partindex];
+			if (!parseFragment(measuredoc, text, description)) {
+				return false;
+			}
+			// Copy the measure into the part document; the memory of
+			// measuredoc is freed when the next measure is parsed.
+			xml_node measure = partnode.append_copy(measuredoc.document_element());
+			partmeasures[partindex].push_back(measure);
+		}
+	}
+
+	addPartMeasures(partdata, partmeasures);
+
+	for (int i=0; i<(int)partfound.size(); i++) {
+		if (!partfound[i]) {
+			m_error_text << "Error: part-list count does not match part count" << endl;
+			break;
+		}
+	}
+
+	return convertPartData(out, doc, partids, partinfo, partcontent, partdata);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::readMarkup -- Read the next markup item from the
+//     input: a start, end or empty element tag, a run of character data
+//     up to the next tag, or other markup (declarations, comments, CDATA
+//     and processing instructions).  The text of the item is returned in
+//     markup, and the element name for tags in name.
+//
+
+int Tool_musicxml2hum::readMarkup(streambuf* input, string& markup, string& name) {
+	markup.clear();
+	name.clear();
+
+	int c = input->sgetc();
+	if (c == EOF) {
+		return mxml_eof;
+	}
+	if (c != '<') {
+		while ((c != EOF) && (c != '<')) {
+			markup += (char)c;
+			c = input->snextc();
+		}
+		return mxml_text;
+	}
+
+	markup += (char)input->sbumpc();
+	c = input->sgetc();
+	if (c == '?') {
+		return readMarkupUntil(input, markup, "?>") ? mxml_other : mxml_error;
+	}
+
+	if (c == '!') {
+		markup += (char)input->sbumpc();
+		c = input->sgetc();
+		if (c == '-') {
+			return readMarkupUntil(input, markup, "-->") ? mxml_other : mxml_error;
+		}
+		if (c == '[') {
+			return readMarkupUntil(input, markup, "]]>") ? mxml_other : mxml_error;
+		}
+		// DOCTYPE, which may contain an internal subset in brackets.
+		int depth = 0;
+		char quote = '\0';
+		while ((c = input->sbumpc()) != EOF) {
+			markup += (char)c;
+			if (quote) {
+				if (c == quote) {
+					quote = '\0';
+				}
+			} else if ((c == '"') || (c == '\'')) {
+				quote = (char)c;
+			} else if (c == '[') {
+				depth++;
+			} else if (c == ']') {
+				depth--;
+			} else if ((c == '>') && (depth <= 0)) {
+				return mxml_other;
+			}
+		}
+		return mxml_error;
+	}
+
+	bool endtag = (c == '/');
+	char quote = '\0';
+	while ((c = input->sbumpc()) != EOF) {
+		markup += (char)c;
+		if (quote) {
+			if (c == quote) {
+				quote = '\0';
+			}
+		} else if ((c == '"') || (c == '\'')) {
+			quote = (char)c;
+		} else if (c == '>') {
+			break;
+		}
+	}
+	if (c == EOF) {
+		return mxml_error;
+	}
+
+	int start = endtag ? 2 : 1;
+	size_t end = markup.find_first_of(" \t\r\n/>", start);
+	name = markup.substr(start, end - start);
+	if (endtag) {
+		return mxml_end;
+	}
+	if (markup[markup.size() - 2] == '/') {
+		return mxml_empty;
+	}
+	return mxml_start;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::readMarkupUntil -- Append input characters to the
+//     markup until it ends with the given string.
+//
+
+bool Tool_musicxml2hum::readMarkupUntil(streambuf* input, string& markup,
+		const string& ending) {
+	int c;
+	size_t minsize = markup.size() + ending.size();
+	while ((c = input->sbumpc()) != EOF) {
+		markup += (char)c;
+		if ((c == ending.back()) && (markup.size() >= minsize) &&
+				(markup.compare(markup.size() - ending.size(), ending.size(), ending) == 0)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::readElement -- Append the content and end tag of an
+//     element whose start tag has already been read.
+//
+
+bool Tool_musicxml2hum::readElement(streambuf* input, string& text,
+		const string& name) {
+	string markup;
+	string tagname;
+	int depth = 1;
+	while (depth > 0) {
+		int type = readMarkup(input, markup, tagname);
+		if ((type == mxml_eof) || (type == mxml_error)) {
+			return false;
+		}
+		text += markup;
+		if (type == mxml_start) {
+			depth++;
+		} else if (type == mxml_end) {
+			depth--;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::parseFragment -- Parse a piece of streamed MusicXML
+//     content into a document, adding a description of any error to the
+//     error messages (see getError()).
+//
+
+bool Tool_musicxml2hum::parseFragment(xml_document& doc, const string& text,
+		const string& description) {
+	auto result = doc.load_buffer(text.data(), text.size());
+	if (!result) {
+		m_error_text << "\nXML content in " << description << " has syntax errors\n";
+		m_error_text << "Error description:\t" << result.description() << "\n";
+		m_error_text << "Error offset:\t" << result.offset << "\n\n";
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::releaseFragments -- Delete the documents of
+//     streamed parts.  Pending nodes which may point into them are
+//     also cleared.
+//
+
+void Tool_musicxml2hum::releaseFragments(void) {
+	for (int i=0; i<(int)m_fragments.size(); i++) {
+		delete m_fragments[i];
+	}
+	m_fragments.clear();
+	m_current_dynamic.clear();
+	m_current_brackets.clear();
+	m_used_hairpins.clear();
+	m_current_figured_bass.clear();
+	m_current_text.clear();
+	m_current_tempo.clear();
+	m_post_note_text.clear();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::preparePartData -- Allocate the part data and the
+//     per-part conversion state.
+//
+
+void Tool_musicxml2hum::preparePartData(vector<MxmlPart>& partdata,
+		const vector<string>& partids, map<string, xml_node>& partinfo) {
 	m_used_hairpins.resize(partinfo.size());
 
 	m_current_dynamic.resize(partids.size());
 	m_current_brackets.resize(partids.size());
 	m_stop_char.resize(partids.size(), "[");
 
-	getPartContent(partcontent, partids, doc);
-	vector<MxmlPart> partdata;
 	partdata.resize(partids.size());
 	m_last_ottava_direction.resize(partids.size());
+	for (int i=0; i<(int)partdata.size(); i++) {
+		partdata[i].setPartNumber(i+1);
+	}
+}
 
-	fillPartData(partdata, partids, partinfo, partcontent);
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertPartData -- Convert the filled part data
+//     into Humdrum content.  The doc only needs to contain the
+//     non-part children of <score-partwise>.
+//
+
+bool Tool_musicxml2hum::convertPartData(ostream& out, xml_document& doc,
+		vector<string>& partids, map<string, xml_node>& partinfo,
+		map<string, xml_node>& partcontent, vector<MxmlPart>& partdata) {
+
+	bool status = true; // for keeping track of problems in conversion process.
 
 	// for debugging:
 	//printPartInfo(partids, partinfo, partcontent, partdata);
@@ -81646,7 +86536,6 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	m_maxstaff = 0;
 	// check the voice info
 	for (int i=0; i<(int)partdata.size(); i++) {
-		partdata[i].prepareVoiceMapping();
 		m_maxstaff += partdata[i].getStaffCount();
 		// for debugging:
 		if (VoiceDebugQ) {
@@ -81660,6 +86549,9 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	HumGrid outdata;
 	status &= stitchParts(outdata, partids, partinfo, partcontent, partdata);
 
+	// The grid is filled, so streamed part documents are no longer needed.
+	releaseFragments();
+
 	if (outdata.size() > 2) {
 		if (outdata.at(0)->getDuration() == 0) {
 			while (!outdata.at(0)->empty()) {
@@ -81726,6 +86618,9 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	addHeaderRecords(outfile, doc);
 	addFooterRecords(outfile, doc);
 
+	// Link and analyze the grid output in memory for the tools below.
+	outfile.analyzeStructureFromTokens();
+
 	Tool_ruthfix ruthfix;
 	ruthfix.run(outfile);
 
@@ -81754,15 +86649,10 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 		argv.push_back("autobeam"); // name of program (placeholder)
 		argv.push_back("-g");       // beam adjacent grace notes
 		gracebeam.process(argv);
-		// Need to force a reparsing of the files contents to
-		// analyze strands.  For now just create a temporary
-		// Humdrum file to force the analysis of the strands.
-		stringstream sstream;
-		sstream << outfile;
-		HumdrumFile outfile2;
-		outfile2.readString(sstream.str());
-		gracebeam.run(outfile2);
-		outfile = outfile2;
+		// Need to reanalyze the file's contents to update strands
+		// after the tools above have edited the tokens.
+		outfile.analyzeStructureFromTokens();
+		gracebeam.run(outfile);
 	}
 
 	if (m_hasTransposition) {
@@ -81775,8 +86665,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 		if (transpose.hasHumdrumText()) {
 			stringstream ss;
 			transpose.getHumdrumText(ss);
-			outfile.readString(ss.str());
-			printResult(out, outfile);
+			printResult(out, outfile, ss);
 		}
 	} else {
 		for (int i=0; i<outfile.getLineCount(); i++) {
@@ -81903,6 +86792,45 @@ void Tool_musicxml2hum::printResult(ostream& out, HumdrumFile& outfile) {
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::printResult -- Print Humdrum text generated by a
+//      tool from outfile (such as transpose) with the same filtering,
+//      without parsing the text into another HumdrumFile.
+//
+
+void Tool_musicxml2hum::printResult(ostream& out, HumdrumFile& outfile,
+		istream& text) {
+	vector<HTp> kernspines = outfile.getKernSpineStartList();
+	string line;
+	while (getline(text, line)) {
+		if ((kernspines.size() > 1) || (line.compare(0, 1, "*") != 0)) {
+			out << line << "\n";
+			continue;
+		}
+		bool suppress = false;
+		size_t start = 0;
+		while (start <= line.size()) {
+			size_t end = line.find('\t', start);
+			if (end == string::npos) {
+				end = line.size();
+			}
+			string token = line.substr(start, end - start);
+			if ((token == "*I\"Piano") || (token == "*I'Pno.") ||
+					(token == "*staff1") || (token == "*part1")) {
+				suppress = true;
+				break;
+			}
+			start = end + 1;
+		}
+		if (!suppress) {
+			out << line << "\n";
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::printRdfs --
@@ -82182,6 +87110,10 @@ void Tool_musicxml2hum::addFooterRecords(HumdrumFile& outfile, xml_document& doc
 void Tool_musicxml2hum::initialize(void) {
 	m_recipQ = getBoolean("recip");
 	m_stemsQ = getBoolean("stems");
+	m_partthreads = getInteger("part-threads");
+	if (m_partthreads <= 0) {
+		m_partthreads = (int)std::thread::hardware_concurrency();
+	}
 	m_hasOrnamentsQ = false;
 }
 
@@ -82359,18 +87291,27 @@ bool Tool_musicxml2hum::fillPartData(vector<MxmlPart>& partdata,
 		const vector<string>& partids, map<string, xml_node>& partinfo,
 		map<string, xml_node>& partcontent) {
 
-	bool output = true;
+	vector<vector<xml_node>> partmeasures(partinfo.size());
 	for (int i=0; i<(int)partinfo.size(); i++) {
 		partdata[i].setPartNumber(i+1);
-		output &= fillPartData(partdata[i], partids[i], partinfo[partids[i]],
-				partcontent[partids[i]]);
+		preparePart(partdata[i], partinfo[partids[i]]);
+		for (xml_node measure : partcontent[partids[i]].children("measure")) {
+			partmeasures[i].push_back(measure);
+		}
 	}
-	return output;
+	addPartMeasures(partdata, partmeasures);
+	return true;
 }
 
 
-bool Tool_musicxml2hum::fillPartData(MxmlPart& partdata,
-		const string& id, xml_node partdeclaration, xml_node partcontent) {
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::preparePart -- Read the <score-part> declaration
+//     of a part before its measures are added.
+//
+
+void Tool_musicxml2hum::preparePart(MxmlPart& partdata, xml_node partdeclaration) {
 	if (m_stemsQ) {
 		partdata.enableStems();
 	}
@@ -82380,25 +87321,82 @@ bool Tool_musicxml2hum::fillPartData(MxmlPart& partdata,
 	// staff count is incorrect at this point? Just assume 32 staves in the part, which should
 	// be 28-30 staffs too many.
 	m_last_ottava_direction.at(partdata.getPartIndex()).resize(32);
+}
 
-	int count;
-	auto measures = partcontent.select_nodes("./measure");
-	for (int i=0; i<(int)measures.size(); i++) {
-		partdata.addMeasure(measures[i].node());
-		count = partdata.getMeasureCount();
-		if (count > 1) {
-			HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
-			if (dur == 0) {
-				HumNum dur = partdata.getMeasure(count-2)
-						->getTimeSigDur();
-				if (dur > 0) {
-					partdata.getMeasure(count - 1)->setTimeSigDur(dur);
-				}
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::addPartMeasure -- Add the next <measure> of a part.
+//
+
+void Tool_musicxml2hum::addPartMeasure(MxmlPart& partdata, xml_node measure) {
+	partdata.addMeasure(measure);
+	int count = partdata.getMeasureCount();
+	if (count > 1) {
+		HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
+		if (dur == 0) {
+			HumNum dur = partdata.getMeasure(count-2)
+					->getTimeSigDur();
+			if (dur > 0) {
+				partdata.getMeasure(count - 1)->setTimeSigDur(dur);
 			}
 		}
+	}
+}
 
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::addPartMeasures -- Add the measures of each part and
+//     prepare the part's voice mapping.  Parts are independent of each
+//     other until they are merged in stitchParts(), so they are filled on
+//     up to m_partthreads threads.  Each part is filled by a single thread,
+//     so the result does not depend on the number of threads.
+//
+
+void Tool_musicxml2hum::addPartMeasures(vector<MxmlPart>& partdata,
+		vector<vector<xml_node>>& partmeasures) {
+	int partcount = (int)partdata.size();
+	vector<std::exception_ptr> errors(partcount);
+	auto fillPart = [&](int index) {
+		try {
+			for (xml_node measure : partmeasures[index]) {
+				addPartMeasure(partdata[index], measure);
+			}
+			partdata[index].prepareVoiceMapping();
+		} catch (...) {
+			errors[index] = std::current_exception();
+		}
+	};
+
+	int threadcount = std::min(m_partthreads, partcount);
+	if (threadcount <= 1) {
+		for (int i=0; i<partcount; i++) {
+			fillPart(i);
+		}
+	} else {
+		std::atomic<int> next(0);
+		vector<std::thread> workers;
+		for (int i=0; i<threadcount; i++) {
+			workers.emplace_back([&]() {
+				int index;
+				while ((index = next++) < partcount) {
+					fillPart(index);
+				}
+			});
+		}
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	for (int i=0; i<partcount; i++) {
+		if (errors[i]) {
+			std::rethrow_exception(errors[i]);
+		}
 	}
-	return true;
 }
 
 
@@ -83165,7 +88163,9 @@ void Tool_musicxml2hum::addEvent(GridSlice* slice, GridMeasure* outdata, MxmlEve
 	if (!event->isFloating()) {
 		recip     = event->getRecip();
 		HumRegex hre;
-		if (hre.search(recip, "(\\d+)%(\\d+)(\\.*)")) {
+		// Rational rhythms are rare, so avoid compiling the regex for each note.
+		if ((recip.find('%') != string::npos) &&
+				hre.search(recip, "(\\d+)%(\\d+)(\\.*)")) {
 			int first = hre.getMatchInt(1);
 			int second = hre.getMatchInt(2);
 			string dots = hre.getMatch(3);
@@ -88559,76 +93559,46 @@ void Tool_myank::printEnding(HumdrumFile& infile, int lastline, int adjlin) {
 // Tool_myank::getMeasureStartStop --  Get a list of the (numbered) measures in the
 //    input file, and store the start/stop lines for those measures.
 //    All data before the first numbered measure is in measure 0.
-//    although, if the first measure is not labeled, then ...
+//    Unnumbered barlines do not start a new measure, so their contents
+//    are included in the previous numbered measure.
 //
 
 void Tool_myank::getMeasureStartStop(vector<MeasureInfo>& measurelist, HumdrumFile& infile) {
 	measurelist.reserve(infile.getLineCount());
 	measurelist.resize(0);
 
-	MeasureInfo current;
-	int i, ii;
-	int lastend = -1;
-	int dataend = -1;
-	int barnum1 = -1;
-	int barnum2 = -1;
-	HumRegex hre;
-
 	insertZerothMeasure(measurelist, infile);
 
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isInterpretation()) {
-			if (*infile.token(i, 0) == "*-") {
-				dataend = i;
-				break;
-			}
-		}
-		if (!infile[i].isBarline()) {
+	if (!infile.isRhythmAnalyzed()) {
+		infile.analyzeRhythmStructure();
+	}
+	MeasureInfo current;
+	bool openQ = false;
+	vector<HumMeasureInfo> measures = infile.getMeasures();
+	for (int i=0; i<(int)measures.size(); i++) {
+		if (measures[i].m_number < 0) {
+			// pickup measure or unnumbered barline
 			continue;
 		}
-		//if (!hre.search(infile.token(i, 0), "^=.*(\\d+)")) {
-		//   continue;
-		//}
-		//barnum1 = stoi(hre.getMatch(1));
-		if (!sscanf(infile.token(i, 0)->c_str(), "=%d", &barnum1)) {
-			continue;
+		if (openQ) {
+			current.stop = measures[i].m_startline;
+			measurelist.push_back(current);
 		}
 		current.clear();
-		current.start = i;
-		current.num   = barnum1;
-		for (ii=i+1; ii<infile.getLineCount(); ii++) {
-			if (!infile[ii].isBarline()) {
-				continue;
-			}
-			//if (hre.search(infile.token(ii, 0), "^=.*(\\d+)")) {
-			//   barnum2 = stoi(hre.getMatch(1));
-			//   current.stop = ii;
-			//   lastend = ii;
-			//   i = ii - 1;
-			//   measurelist.push_back(current);
-			//   break;
-			//}
-			if (hre.search(infile.token(ii, 0), "=[^\\d]*(\\d+)")) {
-			// if (sscanf(infile.token(ii, 0), "=%d", &barnum2)) {
-				barnum2 = stoi(hre.getMatch(1));
-				current.stop = ii;
-				lastend = ii;
-				i = ii - 1;
-				current.file = &infile;
-				measurelist.push_back(current);
-				break;
-			} else {
-				if (atEndOfFile(infile, ii)) {
-					break;
-				}
-			}
-		}
+		current.num = measures[i].m_number;
+		current.start = measures[i].m_startline;
+		current.file = &infile;
+		openQ = true;
+	}
+	if (!openQ) {
+		return;
 	}
 
+	int dataend     = -1;   // line of the spine terminators
 	int lastdata    = -1;   // last line in file with data
 	int lastmeasure = -1;   // last line in file with measure
 
-	for (i=infile.getLineCount()-1; i>=0; i--) {
+	for (int i=infile.getLineCount()-1; i>=0; i--) {
 		if ((lastdata < 0) && infile[i].isData()) {
 			lastdata = i;
 		}
@@ -88639,26 +93609,23 @@ void Tool_myank::getMeasureStartStop(vector<MeasureInfo>& measurelist, HumdrumFi
 			break;
 		}
 	}
-
-	if (lastmeasure < lastdata) {
-		// no final barline, so set to ignore
-		lastmeasure = -1;
-		lastdata    = -1;
-	}
-
-	if ((barnum2 >= 0) && (lastend >= 0) && (dataend >= 0)) {
-		current.clear();
-		current.num = barnum2;
-		current.start = lastend;
-		current.stop = dataend;
-		if (lastmeasure > lastdata) {
-			current.stop = lastmeasure;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isInterpretation() && (*infile.token(i, 0) == "*-")) {
+			dataend = i;
+			break;
 		}
-		current.file = &infile;
-		measurelist.push_back(current);
+	}
+	if (dataend < 0) {
+		return;
 	}
 
-
+	// The last measure ends at the final barline, or at the spine
+	// terminators if there is no barline after the last data.
+	current.stop = dataend;
+	if (lastmeasure > lastdata) {
+		current.stop = lastmeasure;
+	}
+	measurelist.push_back(current);
 }
 
 
@@ -92148,12 +97115,9 @@ void Tool_ruthfix::insertCrossBarTies(HumdrumFile& infile) {
 	int scount = infile.getStrandCount();
 	if (scount == 0) {
 		// The input file was not read from a file but was created
-		// dynamically.  The easiest thing to do is to reload to get the
-		// spine/strand information.
-		stringstream ss;
-		infile.createLinesFromTokens();
-		ss << infile;
-		infile.readString(ss.str());
+		// dynamically, so analyze its tokens to get the spine/strand
+		// information.
+		infile.analyzeStructureFromTokens();
 	}
 	scount = infile.getStrandCount();
 
@@ -95175,6 +100139,8 @@ MeasureData::MeasureData(void) {
 
 
 MeasureData::MeasureData(HumdrumFile& infile, int startline, int stopline) {
+	m_hist7pc.resize(7);
+	std::fill(m_hist7pc.begin(), m_hist7pc.end(), 0.0);
 	setStartLine(startline);
 	setStopLine(stopline);
 	setOwner(infile);
@@ -95182,6 +100148,8 @@ MeasureData::MeasureData(HumdrumFile& infile, int startline, int stopline) {
 
 
 MeasureData::MeasureData(HumdrumFile* infile, int startline, int stopline) {
+	m_hist7pc.resize(7);
+	std::fill(m_hist7pc.begin(), m_hist7pc.end(), 0.0);
 	setStartLine(startline);
 	setStopLine(stopline);
 	setOwner(infile);
@@ -95543,6 +100511,7 @@ void MeasureDataSet::clear(void) {
 //
 
 int MeasureDataSet::parse(HumdrumFile& infile) {
+	clear();
 	int lastbar = 0;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isBarline()) {
@@ -95713,7 +100682,48 @@ MeasureComparisonGrid::~MeasureComparisonGrid() {
 //
 
 void MeasureComparisonGrid::clear(void) {
+	m_matrix1.clear();
+	m_matrix2.clear();
+	m_state1.clear();
+	m_state2.clear();
 	m_grid.clear();
+	m_sparse.clear();
+	m_rows = 0;
+	m_cols = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::setThreadCount -- Number of threads used to
+//     calculate the grid.  A value less than one will use the number
+//     of hardware threads available.
+//
+
+void MeasureComparisonGrid::setThreadCount(int count) {
+	if (count < 1) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	if (count < 1) {
+		count = 1;
+	}
+	m_threads = count;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::setTopK -- Only store the best k matches for
+//     each measure of the first set.  Zero means store the full grid.
+//
+
+void MeasureComparisonGrid::setTopK(int count) {
+	if (count < 0) {
+		count = 0;
+	}
+	m_topk = count;
 }
 
 
@@ -95728,17 +100738,305 @@ void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2)
 }
 
 void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2) {
-	m_grid.resize(set1.size());
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		m_grid[i].resize(set2.size());
+	clear();
+	m_set1 = &set1;
+	m_set2 = &set2;
+	m_rows = set1.size();
+	m_cols = set2.size();
+	packHistograms(set1, m_matrix1, m_state1);
+	packHistograms(set2, m_matrix2, m_state2);
+
+	if (m_topk > 0) {
+		m_sparse.resize(m_rows);
+	} else {
+		m_grid.resize((size_t)m_rows * m_cols);
 	}
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			m_grid[i][j].compare(set1[i], set2[j]);
+
+	int threadcount = m_threads;
+	int blockcount = (m_rows + SIMAT_ROWBLOCK - 1) / SIMAT_ROWBLOCK;
+	if (threadcount > blockcount) {
+		threadcount = blockcount;
+	}
+	if (threadcount <= 1) {
+		correlateRows(0, m_rows);
+		return;
+	}
+
+	// Split the grid into contiguous bands of row blocks, one per thread.
+	// Each thread writes to its own rows only, so no locking is needed.
+	vector<std::thread> workers;
+	workers.reserve(threadcount);
+	int blocksperthread = (blockcount + threadcount - 1) / threadcount;
+	for (int t=0; t<threadcount; t++) {
+		int startrow = t * blocksperthread * SIMAT_ROWBLOCK;
+		int endrow = std::min(m_rows, startrow + blocksperthread * SIMAT_ROWBLOCK);
+		if (startrow >= endrow) {
+			break;
+		}
+		workers.emplace_back(&MeasureComparisonGrid::correlateRows, this, startrow, endrow);
+	}
+	for (int t=0; t<(int)workers.size(); t++) {
+		workers[t].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::packHistograms -- Store the pitch-class histograms
+//     of a measure set in a contiguous matrix with SIMAT_STRIDE values per
+//     row.  Each row is mean-centered and scaled to unit length so that
+//     the Pearson correlation between two rows is their dot product.  The
+//     state array records rows which need special handling:
+//        0 = normal row
+//        1 = measure contains no notes
+//        2 = histogram is flat (zero variance)
+//
+
+void MeasureComparisonGrid::packHistograms(MeasureDataSet& set,
+		vector<double>& matrix, vector<char>& state) {
+	int rows = set.size();
+	matrix.assign((size_t)rows * SIMAT_STRIDE, 0.0);
+	state.assign(rows, 0);
+	for (int i=0; i<rows; i++) {
+		if (set[i].getSum7pc() == 0.0) {
+			state[i] = 1;
+			continue;
+		}
+		vector<double>& hist = set[i].getHistogram7pc();
+		double* row = matrix.data() + (size_t)i * SIMAT_STRIDE;
+		double mean = 0.0;
+		for (int k=0; k<7; k++) {
+			mean += hist[k];
+		}
+		mean /= 7.0;
+		double norm = 0.0;
+		for (int k=0; k<7; k++) {
+			row[k] = hist[k] - mean;
+			norm += row[k] * row[k];
+		}
+		if (norm == 0.0) {
+			state[i] = 2;
+			continue;
+		}
+		norm = 1.0 / sqrt(norm);
+		for (int k=0; k<7; k++) {
+			row[k] *= norm;
 		}
 	}
-	m_set1 = &set1;
-	m_set2 = &set2;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::correlateRows -- Calculate the correlations for
+//     a range of rows in the grid.  Rows are processed in blocks of
+//     SIMAT_ROWBLOCK against blocks of SIMAT_COLBLOCK columns so that both
+//     operands stay in cache, and the inner loop runs over a fixed stride
+//     that the compiler can vectorize.
+//
+
+void MeasureComparisonGrid::correlateRows(int startrow, int endrow) {
+	vector<double> scratch((size_t)SIMAT_ROWBLOCK * m_cols);
+	const double* matrix1 = m_matrix1.data();
+	const double* matrix2 = m_matrix2.data();
+
+	for (int r0=startrow; r0<endrow; r0+=SIMAT_ROWBLOCK) {
+		int r1 = std::min(endrow, r0 + SIMAT_ROWBLOCK);
+		for (int c0=0; c0<m_cols; c0+=SIMAT_COLBLOCK) {
+			int c1 = std::min(m_cols, c0 + SIMAT_COLBLOCK);
+			for (int i=r0; i<r1; i++) {
+				const double* a = matrix1 + (size_t)i * SIMAT_STRIDE;
+				double* out = scratch.data() + (size_t)(i - r0) * m_cols;
+				for (int j=c0; j<c1; j++) {
+					const double* b = matrix2 + (size_t)j * SIMAT_STRIDE;
+					double sum = 0.0;
+					for (int k=0; k<SIMAT_STRIDE; k++) {
+						sum += a[k] * b[k];
+					}
+					out[j] = sum;
+				}
+			}
+		}
+		for (int i=r0; i<r1; i++) {
+			storeRow(i, scratch.data() + (size_t)(i - r0) * m_cols);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::storeRow -- Apply the special cases for empty
+//     and flat histograms, then store the row into the dense grid or
+//     keep the best matches for the row.
+//
+
+void MeasureComparisonGrid::storeRow(int row, const double* values) {
+	vector<double> correlations(values, values + m_cols);
+	for (int j=0; j<m_cols; j++) {
+		double& value = correlations[j];
+		if (m_state1[row] || m_state2[j]) {
+			if ((m_state1[row] == 1) && (m_state2[j] == 1)) {
+				value = 1.0;
+			} else {
+				value = 0.0;
+			}
+		} else if (fabs(value - 1.0) < 0.00000001) {
+			value = 1.0;
+		}
+	}
+
+	if (m_topk == 0) {
+		std::copy(correlations.begin(), correlations.end(),
+				m_grid.begin() + (size_t)row * m_cols);
+		return;
+	}
+
+	vector<pair<int, double>>& best = m_sparse[row];
+	best.resize(m_cols);
+	for (int j=0; j<m_cols; j++) {
+		best[j] = std::make_pair(j, correlations[j]);
+	}
+	auto higher = [](const pair<int, double>& a, const pair<int, double>& b) {
+		if (a.second != b.second) {
+			return a.second > b.second;
+		}
+		return a.first < b.first;
+	};
+	if (m_topk < m_cols) {
+		std::nth_element(best.begin(), best.begin() + m_topk, best.end(), higher);
+		best.resize(m_topk);
+	}
+	std::sort(best.begin(), best.end(),
+			[](const pair<int, double>& a, const pair<int, double>& b) {
+				return a.first < b.first;
+			});
+	best.shrink_to_fit();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::hasCorrelation -- Returns false if the cell
+//     was not kept when storing only the best matches.
+//
+
+bool MeasureComparisonGrid::hasCorrelation(int i, int j) {
+	if ((i < 0) || (j < 0) || (i >= m_rows) || (j >= m_cols)) {
+		return false;
+	}
+	if (m_topk == 0) {
+		return true;
+	}
+	const vector<pair<int, double>>& best = m_sparse[i];
+	auto it = std::lower_bound(best.begin(), best.end(), j,
+			[](const pair<int, double>& a, int value) { return a.first < value; });
+	return (it != best.end()) && (it->first == j);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getCorrelation7pc -- Return the pitch-class
+//     correlation between measure i of the first set and measure j of
+//     the second set.  Cells not kept in top-k mode return 0.0.
+//
+
+double MeasureComparisonGrid::getCorrelation7pc(int i, int j) {
+	if ((i < 0) || (j < 0) || (i >= m_rows) || (j >= m_cols)) {
+		return 0.0;
+	}
+	if (m_topk == 0) {
+		return m_grid[(size_t)i * m_cols + j];
+	}
+	const vector<pair<int, double>>& best = m_sparse[i];
+	auto it = std::lower_bound(best.begin(), best.end(), j,
+			[](const pair<int, double>& a, int value) { return a.first < value; });
+	if ((it != best.end()) && (it->first == j)) {
+		return it->second;
+	}
+	return 0.0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getBestMatchScore -- Return the average of the
+//     best correlation found for each measure, taken in both directions
+//     (rows and columns of the grid).  Measures without notes are ignored.
+//     Cells not kept in top-k mode are not considered.
+//
+
+double MeasureComparisonGrid::getBestMatchScore(void) {
+	vector<double> rowbest(m_rows, -1.0);
+	vector<double> colbest(m_cols, -1.0);
+	if (m_topk == 0) {
+		for (int i=0; i<m_rows; i++) {
+			const double* row = m_grid.data() + (size_t)i * m_cols;
+			for (int j=0; j<m_cols; j++) {
+				rowbest[i] = std::max(rowbest[i], row[j]);
+				colbest[j] = std::max(colbest[j], row[j]);
+			}
+		}
+	} else {
+		for (int i=0; i<m_rows; i++) {
+			for (auto& cell : m_sparse[i]) {
+				rowbest[i] = std::max(rowbest[i], cell.second);
+				colbest[cell.first] = std::max(colbest[cell.first], cell.second);
+			}
+		}
+	}
+
+	double rowsum = 0.0;
+	int rowcount = 0;
+	for (int i=0; i<m_rows; i++) {
+		if (m_state1[i] == 1) {
+			continue;
+		}
+		rowsum += rowbest[i];
+		rowcount++;
+	}
+	double colsum = 0.0;
+	int colcount = 0;
+	for (int j=0; j<m_cols; j++) {
+		if (m_state2[j] == 1) {
+			continue;
+		}
+		colsum += colbest[j];
+		colcount++;
+	}
+	if ((rowcount == 0) || (colcount == 0)) {
+		return 0.0;
+	}
+	return (rowsum / rowcount + colsum / colcount) / 2.0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::printCorrelation -- Print a grid cell rounded
+//     to two decimal places, or "." if the cell was not kept.
+//
+
+void MeasureComparisonGrid::printCorrelation(ostream& out, int i, int j) {
+	if (!hasCorrelation(i, j)) {
+		out << '.';
+		return;
+	}
+	double correl = getCorrelation7pc(i, j);
+	if (correl > 0.0) {
+		out << int(correl * 100.0 + 0.5)/100.0;
+	} else {
+		out << -int(-correl * 100.0 + 0.5)/100.0;
+	}
 }
 
 
@@ -95750,15 +101048,10 @@ void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2)
 //
 
 ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			printCorrelation(out, i, j);
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -95776,18 +101069,10 @@ ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
 //
 
 ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			if (i != j) {
-				continue;
-			}
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		if (i < m_cols) {
+			printCorrelation(out, i, i);
+			if (i < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -96085,15 +101370,18 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 	double sdur1 = getScoreDuration1();
 	double sdur2 = getScoreDuration2();
 
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			if (!hasCorrelation(i, j)) {
+				continue;
+			}
 			width = getDuration2(j) / sdur2 * imagewidth;
 			height = getDuration1(i) / sdur1 * imageheight;
 
 			x = getStartTime2(j)/sdur2 * imageheight;
 			y = getStartTime1(i)/sdur1 * imagewidth;
 
-			getColorMapping(m_grid[i][j].getCorrelation7pc(), hue, saturation, lightness);
+			getColorMapping(getCorrelation7pc(i, j), hue, saturation, lightness);
 			ss << "hsl(" << hue << "," << saturation << "%," << lightness << "%)";
 			crect = grid.append_child("rect");
 			crect.append_attribute("x") = to_string(x).c_str();
@@ -96126,6 +101414,11 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 Tool_simat::Tool_simat(void) {
 	define("r|raw=b", "output raw correlation matrix");
 	define("d|diagonal=b", "output diagonal of correlation matrix");
+	define("k|top=i:0",    "only keep the best k matches for each measure");
+	define("threads=i:0",  "number of threads for grid calculation (0 = all cores)");
+	define("c|corpus=b",   "compare all input files with each other");
+	define("p|prune=d:0.5", "minimum global pitch-class correlation for comparing files in corpus mode");
+	define("n|count=i:0",  "number of ranked pairs to report in corpus mode (0 = all)");
 }
 
 
@@ -96137,7 +101430,9 @@ Tool_simat::Tool_simat(void) {
 
 bool Tool_simat::run(HumdrumFileSet& infiles) {
 	bool status = true;
-	if (infiles.getCount() == 1) {
+	if (getBoolean("corpus")) {
+		processCorpus(infiles);
+	} else if (infiles.getCount() == 1) {
 		status = run(infiles[0], infiles[0]);
 	} else if (infiles.getCount() > 1) {
 		status = run(infiles[0], infiles[1]);
@@ -96208,6 +101503,8 @@ bool Tool_simat::run(HumdrumFile& infile1, HumdrumFile& infile2) {
 void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 	m_data1.parse(infile1);
 	m_data2.parse(infile2);
+	m_grid.setThreadCount(getInteger("threads"));
+	m_grid.setTopK(getInteger("top"));
 	m_grid.analyze(m_data1, m_data2);
 	if (getBoolean("raw")) {
 		m_grid.printCorrelationGrid(m_free_text);
@@ -96223,6 +101520,202 @@ void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 
 
 
+//////////////////////////////
+//
+// Tool_simat::processCorpus -- Compare every file in the set with every
+//     other file.  The measure histograms of each file are calculated
+//     once, and a global pitch-class sketch for each file is used to
+//     skip pairs of files that are unlikely to be related.  Files
+//     without a sketch (no notes, or all pitch classes equally common)
+//     cannot be pruned this way, so all of their pairs are kept.  The
+//     full measure comparison grid is calculated only for the candidate
+//     pairs, and pairs are reported in order of similarity.
+//
+
+void Tool_simat::processCorpus(HumdrumFileSet& infiles) {
+	int count = infiles.getCount();
+	vector<MeasureDataSet*> sets(count, NULL);
+	vector<vector<double>> sketches(count);
+	vector<bool> flat(count, false);
+	for (int i=0; i<count; i++) {
+		sets[i] = new MeasureDataSet(infiles[i]);
+		flat[i] = !createSketch(*sets[i], sketches[i]);
+	}
+
+	double threshold = getDouble("prune");
+	vector<pair<int, int>> candidates;
+	vector<double> sketchscores;
+	for (int i=0; i<count; i++) {
+		for (int j=i+1; j<count; j++) {
+			double score = 0.0;
+			for (int k=0; k<SIMAT_STRIDE; k++) {
+				score += sketches[i][k] * sketches[j][k];
+			}
+			if ((score < threshold) && !flat[i] && !flat[j]) {
+				continue;
+			}
+			candidates.emplace_back(i, j);
+			sketchscores.push_back(score);
+		}
+	}
+
+	vector<double> scores;
+	compareCandidates(sets, candidates, scores);
+	printCorpusResults(infiles, candidates, sketchscores, scores, flat);
+	suppressHumdrumFileOutput();
+
+	for (int i=0; i<count; i++) {
+		delete sets[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_simat::createSketch -- Sum the measure histograms of a file into
+//     a global pitch-class histogram, which is then mean-centered and
+//     scaled to unit length (so that the dot product of two sketches is
+//     their correlation).  Returns false if the histogram is flat (such
+//     as for a file without notes), in which case the sketch is all zeros.
+//
+
+bool Tool_simat::createSketch(MeasureDataSet& set, vector<double>& sketch) {
+	sketch.assign(SIMAT_STRIDE, 0.0);
+	for (int i=0; i<set.size(); i++) {
+		vector<double>& hist = set[i].getHistogram7pc();
+		for (int k=0; k<7; k++) {
+			sketch[k] += hist[k];
+		}
+	}
+	double mean = 0.0;
+	for (int k=0; k<7; k++) {
+		mean += sketch[k];
+	}
+	mean /= 7.0;
+	double norm = 0.0;
+	for (int k=0; k<7; k++) {
+		sketch[k] -= mean;
+		norm += sketch[k] * sketch[k];
+	}
+	if (norm == 0.0) {
+		return false;
+	}
+	norm = 1.0 / sqrt(norm);
+	for (int k=0; k<7; k++) {
+		sketch[k] *= norm;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_simat::compareCandidates -- Calculate the measure comparison grid
+//     for each candidate pair of files, returning the best-match score of
+//     each grid.  Pairs are distributed dynamically over the worker threads,
+//     and each grid is calculated single-threaded.
+//
+
+void Tool_simat::compareCandidates(vector<MeasureDataSet*>& sets,
+		vector<pair<int, int>>& candidates, vector<double>& scores) {
+	scores.assign(candidates.size(), 0.0);
+	int topk = getInteger("top");
+	std::atomic<int> next(0);
+
+	auto worker = [&]() {
+		MeasureComparisonGrid grid;
+		grid.setThreadCount(1);
+		grid.setTopK(topk);
+		while (true) {
+			int index = next++;
+			if (index >= (int)candidates.size()) {
+				break;
+			}
+			grid.analyze(sets[candidates[index].first], sets[candidates[index].second]);
+			scores[index] = grid.getBestMatchScore();
+		}
+	};
+
+	int threadcount = getInteger("threads");
+	if (threadcount < 1) {
+		threadcount = (int)std::thread::hardware_concurrency();
+	}
+	if (threadcount > (int)candidates.size()) {
+		threadcount = (int)candidates.size();
+	}
+	if (threadcount <= 1) {
+		worker();
+		return;
+	}
+	vector<std::thread> workers;
+	for (int t=0; t<threadcount; t++) {
+		workers.emplace_back(worker);
+	}
+	for (int t=0; t<threadcount; t++) {
+		workers[t].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_simat::printCorpusResults -- Print the compared pairs of files as
+//     Humdrum data, sorted from most to least similar.  Files without a
+//     sketch are listed in the header, and the sketch score of their
+//     pairs is null.
+//
+
+void Tool_simat::printCorpusResults(HumdrumFileSet& infiles,
+		vector<pair<int, int>>& candidates, vector<double>& sketchscores,
+		vector<double>& scores, vector<bool>& flat) {
+	vector<int> order(candidates.size());
+	for (int i=0; i<(int)order.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+			[&](int a, int b) { return scores[a] > scores[b]; });
+	int maxcount = getInteger("count");
+	if ((maxcount > 0) && (maxcount < (int)order.size())) {
+		order.resize(maxcount);
+	}
+
+	auto getName = [&](int index) {
+		string name = infiles[index].getFilename();
+		if (name.empty()) {
+			name = "#" + to_string(index + 1);
+		}
+		return name;
+	};
+
+	m_free_text << "!!!files: " << infiles.getCount() << endl;
+	m_free_text << "!!!candidates: " << candidates.size() << endl;
+	for (int i=0; i<(int)flat.size(); i++) {
+		if (flat[i]) {
+			m_free_text << "!!!flat-sketch: " << getName(i) << endl;
+		}
+	}
+	m_free_text << "**score\t**sketch\t**file1\t**file2" << endl;
+	for (int i=0; i<(int)order.size(); i++) {
+		int index = order[i];
+		m_free_text << std::round(scores[index] * 1000.0) / 1000.0;
+		m_free_text << '\t';
+		if (flat[candidates[index].first] || flat[candidates[index].second]) {
+			m_free_text << '.';
+		} else {
+			m_free_text << std::round(sketchscores[index] * 1000.0) / 1000.0;
+		}
+		m_free_text << '\t' << getName(candidates[index].first);
+		m_free_text << '\t' << getName(candidates[index].second);
+		m_free_text << endl;
+	}
+	m_free_text << "*-\t*-\t*-\t*-" << endl;
+}
+
+
+
 
 
 /////////////////////////////////
@@ -98309,6 +103802,12 @@ HumNum Tool_timebase::getMinimumTime(HumdrumFile& infile) {
 #define STYLE_CONCERT 0
 #define STYLE_WRITTEN 1
 
+// Types of pitch parsing for **kern subtokens:
+#define TRANSPOSE_ECHO  0  /* no pitch to transpose              */
+#define TRANSPOSE_NOTE  1  /* transpose pitch                    */
+#define TRANSPOSE_REST  2  /* transpose vertical position of rest */
+#define TRANSPOSE_OTHER 3  /* irregular pitch: use printNewKernString() */
+
 /////////////////////////////////
 //
 // Tool_transpose::Tool_transpose -- Set the recognized options for the tool.
@@ -98408,15 +103907,7 @@ bool Tool_transpose::run(HumdrumFile& infile) {
 		doAutoTransposeAnalysis(infile);
 	} else {
 		vector<bool> spineprocess;
-		infile.makeBooleanTrackList(spineprocess, spinestring);
-		// filter out non-kern spines so they are not analyzed.
-		// but now also allowing for *mxhm spines (musicxml harmony)
-		for (int t=1; t<=infile.getMaxTrack(); t++) {
-			if (!(infile.getTrackStart(t)->isKern() ||
-					infile.getTrackStart(t)->isDataType("mxhm"))) {
-				spineprocess[t] = false;
-			}
-		}
+		getSpineProcess(infile, spineprocess);
 		processFile(infile, spineprocess);
 	}
 
@@ -98425,6 +103916,84 @@ bool Tool_transpose::run(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_transpose::transposeToIntervals -- Transpose the file by each
+//    of the given base-40 intervals, storing the Humdrum text of each
+//    transposition in outputs.  The pitches in the file are parsed only
+//    once for all of the transpositions.  Options for the tool (such as
+//    -s) are applied to each transposition, but the -k, -C, -W and --auto
+//    options are ignored.
+//
+
+bool Tool_transpose::transposeToIntervals(HumdrumFile& infile,
+		const vector<int>& intervals, vector<string>& outputs) {
+	initialize(infile);
+	outputs.clear();
+	outputs.reserve(intervals.size());
+
+	vector<bool> spineprocess;
+	getSpineProcess(infile, spineprocess);
+	parseKernPitches(infile);
+
+	for (int i=0; i<(int)intervals.size(); i++) {
+		m_humdrum_text.str("");
+		m_humdrum_text.clear();
+		transval = intervals[i];
+		processFile(infile, spineprocess);
+		outputs.push_back(m_humdrum_text.str());
+	}
+
+	m_humdrum_text.str("");
+	m_humdrum_text.clear();
+	m_pitchfields.clear();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::transposeToKeys -- Transpose the file to each of the
+//    given tonics (base-40 pitch classes, as with the -k option), storing
+//    the Humdrum text of each transposition in outputs.  The -o option
+//    is added to each transposition.
+//
+
+bool Tool_transpose::transposeToKeys(HumdrumFile& infile,
+		const vector<int>& tonics, vector<string>& outputs) {
+	initialize(infile);
+	vector<int> intervals(tonics.size());
+	for (int i=0; i<(int)tonics.size(); i++) {
+		intervals[i] = calculateTranspositionFromKey(tonics[i] % 40, infile);
+		intervals[i] += octave * 40;
+	}
+	return transposeToIntervals(infile, intervals, outputs);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::getSpineProcess -- Identify the tracks to transpose
+//    (from the -s option).  Only **kern and **mxhm spines are transposed.
+//
+
+void Tool_transpose::getSpineProcess(HumdrumFile& infile,
+		vector<bool>& spineprocess) {
+	infile.makeBooleanTrackList(spineprocess, spinestring);
+	// filter out non-kern spines so they are not analyzed.
+	// but now also allowing for *mxhm spines (musicxml harmony)
+	for (int t=1; t<=infile.getMaxTrack(); t++) {
+		if (!(infile.getTrackStart(t)->isKern() ||
+				infile.getTrackStart(t)->isDataType("mxhm"))) {
+			spineprocess[t] = false;
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_transpose::convertScore -- create a concert pitch score from
@@ -98677,7 +104246,6 @@ void Tool_transpose::printTransposedToken(HumdrumFile& infile, int row, int col,
 
 int Tool_transpose::calculateTranspositionFromKey(int targetkey,
 		HumdrumFile& infile) {
-	HumRegex hre;
 	int base40 = 0;
 	int currentkey = 0;
 	int mode = 0;
@@ -98698,7 +104266,7 @@ int Tool_transpose::calculateTranspositionFromKey(int targetkey,
 			if (!infile.token(i, j)->isKern()) {
 				continue;
 			}
-			if (!hre.search(infile.token(i, j), "^\\*([A-G][#-]?):", "i")) {
+			if (!isKeyDesignation(*infile.token(i, j))) {
 				continue;
 			}
 
@@ -98932,9 +104500,7 @@ int Tool_transpose::checkForDeletedLine(HumdrumFile& infile, int line) {
 void Tool_transpose::processFile(HumdrumFile& infile,
 		vector<bool>& spineprocess) {
 	int i;
-	int diatonic;
 	int j;
-	HumRegex hre;
 	int interpstart = 0;
 
 	for (i=0; i<infile.getLineCount(); i++) {
@@ -98961,9 +104527,9 @@ void Tool_transpose::processFile(HumdrumFile& infile,
 				// Should also check tandem spines for updating
 				// key signatures in non-kern spines.
 				if (spineprocess[infile.token(i, j)->getTrack()] &&
-						hre.search(infile.token(i, j),
-							"^\\*k\\[([a-gA-G#-]*)\\]", "i")) {
-						string value = hre.getMatch(1);
+						isKeySignature(*infile.token(i, j))) {
+						string value = infile.token(i, j)->substr(3);
+						value.resize(value.find(']'));
 						printNewKeySignature(value, transval);
 						if (j<infile[i].getFieldCount()-1) {
 						m_humdrum_text << "\t";
@@ -98976,15 +104542,12 @@ void Tool_transpose::processFile(HumdrumFile& infile,
 				// Should also check tandem spines for updating
 				// key designations in non-kern spines.
 				if (spineprocess[infile.token(i, j)->getTrack()] &&
-						hre.search(infile.token(i, j), "^\\*([A-G])[#-]?:", "i")) {
-					diatonic = tolower(hre.getMatch(1)[0]) - 'a';
-					if (diatonic >= 0 && diatonic <= 6) {
-					  	printNewKeyInterpretation(infile[i], j, transval);
-					  	if (j<infile[i].getFieldCount()-1) {
-							m_humdrum_text << "\t";
-					  	}
-					  	continue;
+						isKeyDesignation(*infile.token(i, j))) {
+					printNewKeyInterpretation(infile[i], j, transval);
+					if (j<infile[i].getFieldCount()-1) {
+						m_humdrum_text << "\t";
 					}
+					continue;
 				}
 				m_humdrum_text << infile.token(i, j);
 				if (j<infile[i].getFieldCount()-1) {
@@ -99041,18 +104604,67 @@ void Tool_transpose::printNewKeyInterpretation(HumdrumLine& aRecord,
 	base40 = base40 % 40;
 	base40 = base40 + (3 + mode) * 40;
 
-	m_humdrum_text << "*" << Convert::base40ToKern(base40) << ":";
+	m_humdrum_text << "*" << getKernPitchName(base40) << ":";
 
-	HumRegex hre;
-	string tvalue = *aRecord.token(index);
-	if (hre.search(tvalue, ":(.+)$", "")) {
-		string value = hre.getMatch(1);
-		m_humdrum_text << value;
+	const string& tvalue = *aRecord.token(index);
+	size_t colon = tvalue.find(':');
+	if (colon != string::npos) {
+		m_humdrum_text << tvalue.substr(colon + 1);
 	}
 }
 
 
 
+//////////////////////////////
+//
+// Tool_transpose::isKeySignature -- Return true if the token is a key
+//    signature, such as "*k[f#c#]".
+//
+
+bool Tool_transpose::isKeySignature(const string& token) {
+	if ((token.size() < 4) || (token[0] != '*') ||
+			(tolower(token[1]) != 'k') || (token[2] != '[')) {
+		return false;
+	}
+	for (int i=3; i<(int)token.size(); i++) {
+		switch (tolower(token[i])) {
+			case ']':
+				return true;
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+			case '#': case '-':
+				break;
+			default:
+				return false;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::isKeyDesignation -- Return true if the token is a key
+//    designation, such as "*F#:" or "*e-:dor".
+//
+
+bool Tool_transpose::isKeyDesignation(const string& token) {
+	if ((token.size() < 3) || (token[0] != '*')) {
+		return false;
+	}
+	char diatonic = tolower(token[1]);
+	if ((diatonic < 'a') || (diatonic > 'g')) {
+		return false;
+	}
+	int index = 2;
+	if ((token[index] == '#') || (token[index] == '-')) {
+		index++;
+	}
+	return (index < (int)token.size()) && (token[index] == ':');
+}
+
+
+
 //////////////////////////////
 //
 // Tool_transpose::printHumdrumDataRecord --
@@ -99114,15 +104726,230 @@ void Tool_transpose::printHumdrumKernToken(HumdrumLine& record, int index,
 		m_humdrum_text << record.token(index);
 		return;
 	}
-	string buffer;
-	int tokencount = record.token(index)->getSubtokenCount();
-	for (int k=0; k<tokencount; k++) {
-		buffer = record.token(index)->getSubtoken(k);
-		printNewKernString(buffer, transval);
-		if (k<tokencount-1) {
+	int line = record.getLineIndex();
+	if ((line < (int)m_pitchfields.size()) &&
+			(index < (int)m_pitchfields[line].size())) {
+		printParsedKernToken(record.token(index), m_pitchfields[line][index],
+				transval);
+	} else {
+		parseKernToken(record.token(index), m_tempfields);
+		printParsedKernToken(record.token(index), m_tempfields, transval);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::parseKernPitches -- Parse the pitches of all **kern data
+//     tokens in the file, so that they can be transposed several times
+//     without being parsed again (see transposeToIntervals()).
+//
+
+void Tool_transpose::parseKernPitches(HumdrumFile& infile) {
+	m_pitchfields.clear();
+	m_pitchfields.resize(infile.getLineCount());
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isData()) {
+			continue;
+		}
+		m_pitchfields[i].resize(infile[i].getFieldCount());
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (token->isKern() && !token->isNull()) {
+				parseKernToken(token, m_pitchfields[i][j]);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::parseKernToken -- Identify the pitch in each subtoken
+//     of a **kern token.  Regular pitches (a repeated letter followed
+//     by accidentals) are converted directly into base-40; other pitch
+//     spellings are marked to be processed by printNewKernString().
+//
+
+void Tool_transpose::parseKernToken(HTp token,
+		vector<TransposePitchField>& fields) {
+	fields.clear();
+	const string& text = *token;
+	int size = (int)text.size();
+	int start = 0;
+	while (start <= size) {
+		int end = start;
+		while ((end < size) && (text[end] != ' ')) {
+			end++;
+		}
+		fields.emplace_back();
+		TransposePitchField& field = fields.back();
+		field.m_start = start;
+		field.m_length = end - start;
+		start = end + 1;
+
+		int pstart = -1;
+		int pend = -1;
+		int runs = 0;
+		bool rest = false;
+		bool unpitched = false;
+		for (int i=field.m_start; i<end; i++) {
+			char ch = text[i];
+			if (ch == 'R') {
+				unpitched = true;
+			} else if (ch == 'r') {
+				rest = true;
+			}
+			bool pitchchar = (('a' <= ch) && (ch <= 'g')) ||
+					(('A' <= ch) && (ch <= 'G')) ||
+					(ch == '#') || (ch == '-') || (ch == 'n');
+			if (!pitchchar) {
+				continue;
+			}
+			if (i != pend) {
+				runs++;
+				if (runs == 1) {
+					pstart = i;
+				}
+			}
+			pend = i + 1;
+			if (runs == 1) {
+				field.m_pitchsize = pend - pstart;
+			}
+		}
+
+		if (unpitched) {
+			field.m_type = TRANSPOSE_ECHO;
+			continue;
+		}
+		if ((field.m_length == 1) && (text[field.m_start] == '.')) {
+			field.m_type = TRANSPOSE_ECHO;
+			continue;
+		}
+		if (rest && (runs == 0)) {
+			field.m_type = TRANSPOSE_ECHO;
+			continue;
+		}
+		field.m_type = TRANSPOSE_OTHER;
+		if (runs != 1) {
+			continue;
+		}
+
+		// A single pitch, which must be letters followed by accidentals:
+		char letter = text[pstart];
+		if ((letter == '#') || (letter == '-') || (letter == 'n')) {
+			continue;
+		}
+		int count = 0;
+		int accid = 0;
+		bool valid = true;
+		for (int i=pstart; i<pstart+field.m_pitchsize; i++) {
+			char ch = text[i];
+			if (ch == letter) {
+				if (i > pstart + count) {
+					valid = false;
+					break;
+				}
+				count++;
+			} else if (ch == '#') {
+				accid++;
+			} else if (ch == '-') {
+				accid--;
+			} else if (ch != 'n') {
+				valid = false;
+				break;
+			}
+		}
+		if (!valid || (count == 0)) {
+			continue;
+		}
+		int pc = 0;
+		switch (tolower(letter)) {
+			case 'c': pc =  0; break;
+			case 'd': pc =  6; break;
+			case 'e': pc = 12; break;
+			case 'f': pc = 17; break;
+			case 'g': pc = 23; break;
+			case 'a': pc = 29; break;
+			case 'b': pc = 35; break;
+		}
+		pc += accid + 2;
+		if (pc < 0) {
+			continue;
+		}
+		int octave = islower(letter) ? 3 + count : 4 - count;
+		field.m_pitchstart = pstart;
+		field.m_base40 = pc + 40 * octave;
+		field.m_type = rest ? TRANSPOSE_REST : TRANSPOSE_NOTE;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::printParsedKernToken -- Print a **kern token which
+//     was parsed with parseKernToken(), transposing the pitches by the
+//     given base-40 interval.
+//
+
+void Tool_transpose::printParsedKernToken(HTp token,
+		vector<TransposePitchField>& fields, int transval) {
+	const string& text = *token;
+	for (int k=0; k<(int)fields.size(); k++) {
+		TransposePitchField& field = fields[k];
+		if (k > 0) {
 			m_humdrum_text << " ";
 		}
+		switch (field.m_type) {
+			case TRANSPOSE_ECHO:
+				m_humdrum_text.write(text.data() + field.m_start, field.m_length);
+				break;
+			case TRANSPOSE_OTHER:
+				printNewKernString(text.substr(field.m_start, field.m_length), transval);
+				break;
+			default:
+				{
+					const string& pitch = getKernPitchName(field.m_base40 + transval);
+					int pitchsize = (int)pitch.size();
+					if (field.m_type == TRANSPOSE_REST) {
+						// rests only indicate vertical position, so no accidentals
+						pitchsize = (int)pitch.find_first_of("#-");
+						if (pitchsize < 0) {
+							pitchsize = (int)pitch.size();
+						}
+					}
+					int end = field.m_start + field.m_length;
+					int pend = field.m_pitchstart + field.m_pitchsize;
+					m_humdrum_text.write(text.data() + field.m_start,
+							field.m_pitchstart - field.m_start);
+					m_humdrum_text.write(pitch.data(), pitchsize);
+					m_humdrum_text.write(text.data() + pend, end - pend);
+				}
+				break;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::getKernPitchName -- Return the **kern pitch name for
+//     a base-40 pitch.  Pitch names within the normal range of octaves
+//     are taken from the lookup table in Convert.
+//
+
+const string& Tool_transpose::getKernPitchName(int base40) {
+	const vector<string>& table = Convert::getBase40KernTable();
+	static thread_local string other;
+	if ((base40 >= 0) && (base40 < (int)table.size())) {
+		return table[base40];
 	}
+	other = Convert::base40ToKern(base40);
+	return other;
 }
 
 
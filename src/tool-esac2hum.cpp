@@ -20,8 +20,12 @@
 #include <stdio.h>
 #include <math.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -44,10 +48,14 @@ Tool_esac2hum::Tool_esac2hum(void) {
 	define("s|split=s:file",     "Split song info into separate files");
 	define("x|extension=s:.krn", "Split filename extension");
 	define("f|first=i:1",        "Number of first split filename");
+	define("threads=i:1",        "number of threads for converting songs (0 = all cores)");
+	define("segment=b",          "start each song with a !!!!SEGMENT record");
 	define("author=b",           "author of program");
 	define("version=b",          "compilation info");
 	define("example=b",          "example usages");
 	define("help=b",             "short description");
+
+	chartable.resize(256, 0);
 }
 
 
@@ -132,6 +140,14 @@ bool Tool_esac2hum::initialize(void) {
 	namebase = getString("split");
 	fileextension = getString("extension");
 	firstfilenum = getInteger("first");
+	segmentQ = getBoolean("segment");
+	threadcount = getInteger("threads");
+	if (threadcount <= 0) {
+		threadcount = (int)std::thread::hardware_concurrency();
+	}
+	if (threadcount <= 0) {
+		threadcount = 1;
+	}
 	return true;
 }
 
@@ -147,6 +163,10 @@ bool Tool_esac2hum::initialize(void) {
 
 void Tool_esac2hum::convertEsacToHumdrum(ostream& output, istream& infile) {
 	initialize();
+	if ((threadcount > 1) || splitQ || segmentQ) {
+		convertCollection(output, infile);
+		return;
+	}
 	vector<string> song;
 	song.reserve(400);
 	int init = 0;
@@ -198,6 +218,145 @@ void Tool_esac2hum::convertEsacToHumdrum(ostream& output, istream& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_esac2hum::convertCollection -- Find all of the songs in the input
+//     and then convert them on multiple threads.  The songs are printed in
+//     their original order, either to the output stream (optionally
+//     separated by !!!!SEGMENT records) or to separate files with the -s
+//     option.  Errors are reported for each song after the conversions,
+//     and a song which cannot be converted does not stop the conversion
+//     of the rest of the collection.
+//
+
+void Tool_esac2hum::convertCollection(ostream& output, istream& infile) {
+	vector<vector<string>> songs;
+	vector<int> songlines;
+	vector<string> song;
+	song.reserve(400);
+	int init = 0;
+	while (!infile.eof()) {
+		songlines.push_back(inputline);
+		getSong(song, infile, init);
+		init = 1;
+		songs.push_back(song);
+	}
+
+	int songcount = (int)songs.size();
+	vector<string> outputs(songcount);
+	vector<string> errors(songcount);
+
+	// Song conversion stores state in the tool (special character counts),
+	// so each thread uses its own converter.
+	int workercount = std::max(1, std::min(threadcount, songcount));
+	vector<Tool_esac2hum> converters(workercount);
+	for (int i=0; i<workercount; i++) {
+		converters[i].debugQ   = debugQ;
+		converters[i].verboseQ = verboseQ;
+		converters[i].header   = header;
+		converters[i].trailer  = trailer;
+	}
+
+	auto convertIndex = [&](Tool_esac2hum& converter, int index) {
+		stringstream out;
+		stringstream err;
+		converter.errorstream = &err;
+		converter.inputline = songlines[index];
+		try {
+			converter.convertSong(songs[index], out);
+			outputs[index] = out.str();
+		} catch (const std::exception& e) {
+			err << "Error: " << e.what() << endl;
+		}
+		errors[index] = err.str();
+	};
+
+	if (workercount == 1) {
+		for (int i=0; i<songcount; i++) {
+			convertIndex(converters[0], i);
+		}
+	} else {
+		std::atomic<int> next(0);
+		vector<std::thread> workers;
+		for (int i=0; i<workercount; i++) {
+			workers.emplace_back([&, i]() {
+				int index;
+				while ((index = next++) < songcount) {
+					convertIndex(converters[i], index);
+				}
+			});
+		}
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	for (int i=0; i<songcount; i++) {
+		if (outputs[i].empty()) {
+			continue;
+		}
+		if (splitQ) {
+			string filename = getSplitFilename(i);
+			ofstream outfile(filename);
+			if (!outfile.is_open()) {
+				errors[i] += "Error: cannot write to file: " + filename + "\n";
+				continue;
+			}
+			outfile << outputs[i];
+		} else {
+			if (segmentQ) {
+				output << "!!!!SEGMENT: " << getSplitFilename(i) << "\n";
+			}
+			output << outputs[i];
+		}
+	}
+
+	for (int i=0; i<songcount; i++) {
+		if (!errors[i].empty()) {
+			cerr << "Song " << i + 1;
+			string key = getSongKey(songs[i]);
+			if (!key.empty()) {
+				cerr << " (KEY " << key << ")";
+			}
+			cerr << ":\n" << errors[i];
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_esac2hum::getSplitFilename -- Return the filename for a song
+//     in the collection (index 0 is the first song).
+//
+
+string Tool_esac2hum::getSplitFilename(int index) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%04d", firstfilenum + index);
+	return namebase + buffer + fileextension;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_esac2hum::getSongKey -- Return the song identifier from the
+//     KEY[] field of a song.
+//
+
+string Tool_esac2hum::getSongKey(vector<string>& song) {
+	for (int i=0; i<(int)song.size(); i++) {
+		if (song[i].compare(0, 4, "KEY[") == 0) {
+			size_t end = song[i].find_first_of(" ]", 4);
+			return song[i].substr(4, end == string::npos ? string::npos : end - 4);
+		}
+	}
+	return "";
+}
+
+
+
 //////////////////////////////
 //
 // Tool_esac2hum::getSong -- get a song from the ESac file
@@ -460,7 +619,7 @@ bool Tool_esac2hum::placeLyrics(vector<string>& song, vector<NoteData>& songdata
 	string buffer;
 	for (line=0; line<=stop-start; line++) {
 		if (song[line+start].size() <= 4) {
-			cerr << "Error: lyric line is too short!: "
+			*errorstream << "Error: lyric line is too short!: "
 				  << song[line+start] << endl;
 			return false;
 		}
@@ -620,8 +779,8 @@ bool Tool_esac2hum::placeLyricPhrase(vector<NoteData>& songdata, vector<string>&
 	start = i;
 
 	if (!found) {
-		cerr << "Error: cannot find music for lyrics line " << line << endl;
-		cerr << "Error near input data line: " << inputline << endl;
+		*errorstream << "Error: cannot find music for lyrics line " << line << endl;
+		*errorstream << "Error near input data line: " << inputline << endl;
 		return false;
 	}
 
@@ -750,7 +909,7 @@ bool Tool_esac2hum::printTitleInfo(vector<string>& song, ostream& out) {
 	int stop = -1;
 	getLineRange(song, "CUT", start, stop);
 	if (start == -1) {
-		cerr << "Error: cannot find CUT[] field in song: " << song[0] << endl;
+		*errorstream << "Error: cannot find CUT[] field in song: " << song[0] << endl;
 		return false;
 	}
 
@@ -1159,15 +1318,18 @@ void Tool_esac2hum::postProcessSongData(vector<NoteData>& songdata, vector<int>&
 
 void Tool_esac2hum::getMeterInfo(string& meter, vector<int>& numerator,
 		vector<int>& denominator) {
-	char buffer[256] = {0};
-	strcpy(buffer, meter.c_str());
 	numerator.resize(0);
 	denominator.resize(0);
 	int num = -1;
 	int denom = -1;
-	char* ptr;
-	ptr = strtok(buffer, " \t\n");
-	while (ptr != NULL) {
+	// split into words (not with strtok() so that songs can be converted
+	// in parallel):
+	size_t start = meter.find_first_not_of(" \t\n");
+	while (start != string::npos) {
+		size_t end = meter.find_first_of(" \t\n", start);
+		string word = meter.substr(start, end == string::npos ? string::npos : end - start);
+		start = meter.find_first_not_of(" \t\n", end);
+		const char* ptr = word.c_str();
 		if (strcmp(ptr, "frei") == 0 || strcmp(ptr, "Frei") == 0) {
 			num = -1;
 			denom = -1;
@@ -1187,7 +1349,6 @@ void Tool_esac2hum::getMeterInfo(string& meter, vector<int>& numerator,
 				denominator.push_back(denom);
 			}
 		}
-		ptr = strtok(NULL, " \t\n");
 	}
 
 }
@@ -1256,7 +1417,7 @@ bool Tool_esac2hum::getNoteList(vector<string>& song, vector<NoteData>& songdata
 
 	for (i=melstart; i<=melstop; i++) {
 		if (song[i].size() < 4) {
-			cerr << "Error: invalid line in MEL[]: " << song[i] << endl;
+			*errorstream << "Error: invalid line in MEL[]: " << song[i] << endl;
 			return false;
 		}
 		j = 4;
@@ -1318,7 +1479,7 @@ bool Tool_esac2hum::getNoteList(vector<string>& song, vector<NoteData>& songdata
 //            case '>':                     break;   // unknown marker
 //            case '<':                     break;   //
 				case '^': tie = 1; state = STATE_NOTE; break;
-				default : cerr << "Error: unknown character " << song[i][j]
+				default : *errorstream << "Error: unknown character " << song[i][j]
 							      << " on the line: " << song[i] << endl;
 							 return false;
 			}
@@ -1570,15 +1731,15 @@ bool Tool_esac2hum::getKeyInfo(vector<string>& song, string& key, double& mindur
 
 			tonic = Convert::kernToBase40(tonicstr);
 			if (tonic <= 0) {
-				cerr << "Error: invalid tonic on line: " << song[i] << endl;
+				*errorstream << "Error: invalid tonic on line: " << song[i] << endl;
 				return false;
 			}
 			tonic = tonic % 40;
 			meter = song[i].substr(17);
 			if (meter.back() != ']') {
-				cerr << "Error with meter on line: " << song[i] << endl;
-				cerr << "Meter area: " << meter << endl;
-				cerr << "Expected ] as last character but found " << meter.back() << endl;
+				*errorstream << "Error with meter on line: " << song[i] << endl;
+				*errorstream << "Meter area: " << meter << endl;
+				*errorstream << "Expected ] as last character but found " << meter.back() << endl;
 				return false;
 			} else {
 				meter.resize((int)meter.size() - 1);
@@ -1586,7 +1747,7 @@ bool Tool_esac2hum::getKeyInfo(vector<string>& song, string& key, double& mindur
 			return true;
 		}
 	}
-	cerr << "Error: did not find a KEY field" << endl;
+	*errorstream << "Error: did not find a KEY field" << endl;
 	return false;
 }
 
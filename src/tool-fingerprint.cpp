@@ -0,0 +1,488 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 20:41:17 UTC 2026
+// Last Modified: Fri Oct 16 20:41:17 UTC 2026
+// Filename:      tool-fingerprint.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-fingerprint.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Identify duplicate and near-duplicate scores.  Each score
+//                is reduced to a set of shingles, which are hashes of short
+//                sequences of melodic intervals and duration ratios in each
+//                voice (so they do not change when the music is transposed
+//                or notated with different rhythmic values).  The shingle
+//                set is summarized by a MinHash signature, and signatures
+//                are bucketed with locality-sensitive hashing (LSH) so that
+//                only scores sharing a band of their signature are compared.
+//
+
+#include "tool-fingerprint.h"
+#include "NoteCell.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+/////////////////////////////////
+//
+// Tool_fingerprint::Tool_fingerprint -- Set the recognized options for the tool.
+//
+
+Tool_fingerprint::Tool_fingerprint(void) {
+	define("s|shingle=i:4",    "number of intervals in each shingle");
+	define("k|hashes=i:64",    "number of MinHash values in each signature");
+	define("b|bands=i:16",     "number of LSH bands (must divide hashes)");
+	define("t|threshold=d:0.5", "minimum estimated similarity for duplicates");
+	define("g|group=s",        "combine movements having same reference record (such as OPR)");
+	define("p|print=b",        "print signatures rather than duplicate clusters");
+}
+
+
+
+/////////////////////////////////
+//
+// Tool_fingerprint::run -- Do the main work of the tool.
+//
+
+bool Tool_fingerprint::run(HumdrumFileSet& infiles) {
+	if (!initialize()) {
+		return false;
+	}
+	for (int i=0; i<infiles.getCount(); i++) {
+		processFile(infiles[i]);
+	}
+	finish();
+	return true;
+}
+
+
+bool Tool_fingerprint::run(const string& indata, ostream& out) {
+	HumdrumFile infile(indata);
+	bool status = run(infile);
+	if (hasAnyText()) {
+		getAllText(out);
+	}
+	return status;
+}
+
+
+bool Tool_fingerprint::run(HumdrumFile& infile, ostream& out) {
+	bool status = run(infile);
+	if (hasAnyText()) {
+		getAllText(out);
+	}
+	return status;
+}
+
+
+bool Tool_fingerprint::run(HumdrumFile& infile) {
+	if (!initialize()) {
+		return false;
+	}
+	processFile(infile);
+	finish();
+	return true;
+}
+
+//
+// Streaming interface: only the signatures of the scores are kept in memory,
+// and each score is released after its signature has been calculated.
+//
+
+bool Tool_fingerprint::run(HumdrumFileStream& instream) {
+	if (!initialize()) {
+		return false;
+	}
+	HumdrumFileSet infiles;
+	while (instream.readSingleSegment(infiles)) {
+		if (infiles.getCount() > 0) {
+			processFile(infiles[0]);
+		}
+	}
+	finish();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::initialize -- Returns false if the number of bands
+//     does not divide the number of hashes, since each band must have
+//     the same number of rows and every hash must be in a band.
+//
+
+bool Tool_fingerprint::initialize(void) {
+	m_shingle   = getInteger("shingle");
+	m_hashcount = getInteger("hashes");
+	m_bands     = getInteger("bands");
+	m_threshold = getDouble("threshold");
+	m_group     = getString("group");
+	if (m_shingle < 1) {
+		m_shingle = 1;
+	}
+	if (m_hashcount < 1) {
+		m_hashcount = 1;
+	}
+	if ((m_bands < 1) || (m_hashcount % m_bands != 0)) {
+		m_error_text << "Error: the number of bands (" << m_bands
+		             << ") must divide the number of hashes ("
+		             << m_hashcount << ")" << endl;
+		return false;
+	}
+	m_rows = m_hashcount / m_bands;
+
+	m_seeds.resize(m_hashcount);
+	for (int i=0; i<m_hashcount; i++) {
+		m_seeds[i] = mixHash(0x9e3779b97f4a7c15ULL * (i + 1));
+	}
+
+	m_count = 0;
+	m_names.clear();
+	m_signatures.clear();
+	m_parent.clear();
+	m_buckets.clear();
+	m_buckets.resize(m_bands);
+	m_groups.clear();
+	m_grouporder.clear();
+	m_initialized = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::processFile -- Calculate the signature of a score and
+//     add it to the LSH tables (or to its movement group).
+//
+
+void Tool_fingerprint::processFile(HumdrumFile& infile) {
+	if (!m_initialized && !initialize()) {
+		return;
+	}
+	m_count++;
+	vector<uint64_t> shingles;
+	getShingles(shingles, infile);
+
+	string name = infile.getFilename();
+	if (name.empty()) {
+		name = "#" + to_string(m_count);
+	}
+
+	vector<uint64_t> signature;
+	getSignature(signature, shingles);
+
+	if (!m_group.empty()) {
+		string key = infile.getReferenceRecord(m_group);
+		if (key.empty()) {
+			key = name;
+		}
+		auto it = m_groups.find(key);
+		if (it == m_groups.end()) {
+			m_groups[key] = signature;
+			m_grouporder.push_back(key);
+		} else {
+			// The MinHash of a union is the minimum of the MinHashes.
+			for (int i=0; i<(int)signature.size(); i++) {
+				it->second[i] = std::min(it->second[i], signature[i]);
+			}
+		}
+		return;
+	}
+
+	if (getBoolean("print")) {
+		printSignature(name, (int)shingles.size(), signature);
+		return;
+	}
+	if (shingles.empty()) {
+		// Scores without melodic content cannot be compared.
+		return;
+	}
+	addSignature(name, signature);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::finish -- Add movement groups to the LSH tables, then
+//     print the duplicate clusters.
+//
+
+void Tool_fingerprint::finish(void) {
+	for (int i=0; i<(int)m_grouporder.size(); i++) {
+		vector<uint64_t>& signature = m_groups[m_grouporder[i]];
+		if (getBoolean("print")) {
+			printSignature(m_grouporder[i], -1, signature);
+			continue;
+		}
+		if (signature.empty() || (signature[0] == FINGERPRINT_EMPTY)) {
+			continue;
+		}
+		addSignature(m_grouporder[i], signature);
+	}
+	m_groups.clear();
+	m_grouporder.clear();
+
+	if (!getBoolean("print")) {
+		printClusters();
+	}
+	m_initialized = false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::getShingles -- Extract the shingles of a score.  Each
+//     shingle is a hash of m_shingle consecutive base-40 intervals between
+//     note attacks in a voice, together with the ratio of the durations of
+//     the two notes forming each interval.  Rests are skipped.
+//
+
+void Tool_fingerprint::getShingles(vector<uint64_t>& shingles, HumdrumFile& infile) {
+	shingles.clear();
+	NoteGrid grid(infile);
+	vector<NoteCell*> attacks;
+	vector<uint64_t> steps;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		steps.clear();
+		int lastpitch = -1;
+		HumNum lastdur = 0;
+		for (int i=0; i<(int)attacks.size(); i++) {
+			if (attacks[i]->isRest()) {
+				continue;
+			}
+			int pitch = (int)attacks[i]->getAbsBase40Pitch();
+			HumNum duration = attacks[i]->getDuration();
+			if (duration <= 0) {
+				continue;
+			}
+			if (lastpitch >= 0) {
+				HumNum ratio = duration / lastdur;
+				uint64_t step = (uint64_t)(int64_t)(pitch - lastpitch);
+				step = step * 1000003 + (uint64_t)ratio.getNumerator();
+				step = step * 1000003 + (uint64_t)ratio.getDenominator();
+				steps.push_back(mixHash(step));
+			}
+			lastpitch = pitch;
+			lastdur = duration;
+		}
+		for (int i=0; i+m_shingle<=(int)steps.size(); i++) {
+			uint64_t value = 0;
+			for (int j=0; j<m_shingle; j++) {
+				value = mixHash(value ^ steps[i+j]);
+			}
+			shingles.push_back(value);
+		}
+	}
+	std::sort(shingles.begin(), shingles.end());
+	shingles.erase(std::unique(shingles.begin(), shingles.end()), shingles.end());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::getSignature -- Calculate the MinHash signature of a
+//     shingle set.  An empty set has all values set to FINGERPRINT_EMPTY.
+//
+
+void Tool_fingerprint::getSignature(vector<uint64_t>& signature,
+		vector<uint64_t>& shingles) {
+	signature.assign(m_hashcount, FINGERPRINT_EMPTY);
+	for (int i=0; i<(int)shingles.size(); i++) {
+		for (int j=0; j<m_hashcount; j++) {
+			uint64_t value = mixHash(shingles[i] ^ m_seeds[j]);
+			if (value < signature[j]) {
+				signature[j] = value;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::addSignature -- Store a signature and compare it to
+//     previous signatures which share at least one LSH band with it.
+//     Signatures that are similar enough are joined into the same cluster.
+//
+
+void Tool_fingerprint::addSignature(const string& name, vector<uint64_t>& signature) {
+	int index = (int)m_signatures.size();
+	m_names.push_back(name);
+	m_signatures.push_back(signature);
+	m_parent.push_back(index);
+
+	for (int b=0; b<m_bands; b++) {
+		uint64_t key = b;
+		for (int r=0; r<m_rows; r++) {
+			key = mixHash(key ^ signature[b * m_rows + r]);
+		}
+		vector<int>& bucket = m_buckets[b][key];
+		for (int i=0; i<(int)bucket.size(); i++) {
+			if (findCluster(bucket[i]) == findCluster(index)) {
+				continue;
+			}
+			if (getSimilarity(bucket[i], index) >= m_threshold) {
+				joinClusters(bucket[i], index);
+			}
+		}
+		bucket.push_back(index);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::getSimilarity -- Estimate the Jaccard similarity of
+//     two shingle sets from the fraction of equal MinHash values.
+//
+
+double Tool_fingerprint::getSimilarity(int index1, int index2) {
+	vector<uint64_t>& sig1 = m_signatures[index1];
+	vector<uint64_t>& sig2 = m_signatures[index2];
+	int same = 0;
+	for (int i=0; i<m_hashcount; i++) {
+		if (sig1[i] == sig2[i]) {
+			same++;
+		}
+	}
+	return (double)same / m_hashcount;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::findCluster -- Return the root of the union-find tree
+//     for a signature (with path halving).
+//
+
+int Tool_fingerprint::findCluster(int index) {
+	while (m_parent[index] != index) {
+		m_parent[index] = m_parent[m_parent[index]];
+		index = m_parent[index];
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::joinClusters -- Merge the clusters of two signatures,
+//     keeping the earliest signature as the root.
+//
+
+void Tool_fingerprint::joinClusters(int index1, int index2) {
+	int root1 = findCluster(index1);
+	int root2 = findCluster(index2);
+	if (root1 == root2) {
+		return;
+	}
+	if (root1 < root2) {
+		m_parent[root2] = root1;
+	} else {
+		m_parent[root1] = root2;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::printSignature --
+//
+
+void Tool_fingerprint::printSignature(const string& name, int shinglecount,
+		vector<uint64_t>& signature) {
+	m_free_text << name << "\t";
+	if (shinglecount >= 0) {
+		m_free_text << shinglecount;
+	} else {
+		m_free_text << ".";
+	}
+	m_free_text << "\t";
+	char buffer[32];
+	for (int i=0; i<(int)signature.size(); i++) {
+		if (i > 0) {
+			m_free_text << " ";
+		}
+		snprintf(buffer, 32, "%016llx", (unsigned long long)signature[i]);
+		m_free_text << buffer;
+	}
+	m_free_text << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::printClusters -- Print all clusters of two or more
+//     scores as Humdrum data.  The similarity is estimated relative to the
+//     first score in the cluster.
+//
+
+void Tool_fingerprint::printClusters(void) {
+	int count = (int)m_signatures.size();
+	vector<vector<int>> clusters(count);
+	for (int i=0; i<count; i++) {
+		clusters[findCluster(i)].push_back(i);
+	}
+
+	m_free_text << "!!!scores: " << count << endl;
+	m_free_text << "**cluster\t**similarity\t**file" << endl;
+	int number = 0;
+	for (int i=0; i<count; i++) {
+		if (clusters[i].size() < 2) {
+			continue;
+		}
+		number++;
+		for (int j=0; j<(int)clusters[i].size(); j++) {
+			int index = clusters[i][j];
+			double similarity = getSimilarity(clusters[i][0], index);
+			m_free_text << number << "\t";
+			m_free_text << int(similarity * 1000.0 + 0.5) / 1000.0 << "\t";
+			m_free_text << m_names[index] << endl;
+		}
+	}
+	m_free_text << "*-\t*-\t*-" << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_fingerprint::mixHash -- Scramble the bits of a 64-bit value
+//     (MurmurHash3 finalizer).
+//
+
+uint64_t Tool_fingerprint::mixHash(uint64_t value) {
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
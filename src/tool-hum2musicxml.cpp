@@ -0,0 +1,952 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Fri Oct 16 20:58:12 UTC 2026
+// Last Modified: Fri Oct 16 20:58:12 UTC 2026
+// Filename:      tool-hum2musicxml.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-hum2musicxml.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Convert **kern data into MusicXML (partwise).
+//
+// Each **kern spine is converted into a MusicXML part, with the
+// highest staff (last spine) as the first part.  Spine splits are
+// converted into voices.  The MusicXML text is written directly from
+// the parsed Humdrum data in one pass over each part, so no XML tree
+// is built for the output.  Accidental display is taken from
+// HumdrumFileContent::analyzeKernAccidentals().  Converted features:
+// clefs, key and time signatures, notes, rests, chords, grace notes,
+// tuplets, ties, slurs, beams, stem directions, fermatas, common
+// articulations and repeat/final barlines.
+//
+
+#include "tool-hum2musicxml.h"
+#include "Convert.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+/////////////////////////////////
+//
+// Tool_hum2musicxml::Tool_hum2musicxml -- Set the recognized options for the tool.
+//
+
+Tool_hum2musicxml::Tool_hum2musicxml(void) {
+	define("S|no-stems=b", "do not print explicit stem directions");
+	define("B|no-beams=b", "do not print beams");
+}
+
+
+
+/////////////////////////////////
+//
+// Tool_hum2musicxml::run -- Do the main work of the tool.
+//
+
+bool Tool_hum2musicxml::run(HumdrumFileSet& infiles) {
+	bool status = true;
+	for (int i=0; i<infiles.getCount(); i++) {
+		status &= run(infiles[i]);
+	}
+	return status;
+}
+
+
+bool Tool_hum2musicxml::run(const string& indata, ostream& out) {
+	HumdrumFile infile(indata);
+	return run(infile, out);
+}
+
+
+bool Tool_hum2musicxml::run(HumdrumFile& infile, ostream& out) {
+	initialize();
+	return convert(out, infile);
+}
+
+
+bool Tool_hum2musicxml::run(HumdrumFile& infile) {
+	initialize();
+	return convert(m_free_text, infile);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::initialize --
+//
+
+void Tool_hum2musicxml::initialize(void) {
+	m_stemsQ = !getBoolean("no-stems");
+	m_beamsQ = !getBoolean("no-beams");
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::convert -- Write the **kern data of a Humdrum file
+//     as MusicXML to the output stream.
+//
+
+bool Tool_hum2musicxml::convert(ostream& out, HumdrumFile& infile) {
+	if (!infile.isValid()) {
+		m_error_text << infile.getParseError() << endl;
+		return false;
+	}
+	vector<HTp> kernstarts = infile.getKernSpineStartList();
+	if (kernstarts.empty()) {
+		m_error_text << "No **kern spines in input data" << endl;
+		return false;
+	}
+	if (!infile.isRhythmAnalyzed()) {
+		infile.analyzeRhythmStructure();
+	}
+	infile.analyzeKernAccidentals();
+	infile.analyzeSlurs();
+	m_divisions = infile.tpq();
+	if (m_divisions <= 0) {
+		m_divisions = 1;
+	}
+
+	// MusicXML parts are ordered from the top staff down:
+	std::reverse(kernstarts.begin(), kernstarts.end());
+
+	printHeader(out, infile);
+	printPartList(out, kernstarts);
+	for (int i=0; i<(int)kernstarts.size(); i++) {
+		printPart(out, infile, kernstarts[i], i + 1);
+	}
+	out << "</score-partwise>\n";
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printHeader -- Print the XML declaration and the
+//     score information from the reference records.
+//
+
+void Tool_hum2musicxml::printHeader(ostream& out, HumdrumFile& infile) {
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+	out << "<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 3.1 Partwise//EN\"";
+	out << " \"http://www.musicxml.org/dtds/partwise.dtd\">\n";
+	out << "<score-partwise version=\"3.1\">\n";
+
+	string title = infile.getReferenceRecord("OTL");
+	if (!title.empty()) {
+		out << "  <work>\n";
+		out << "    <work-title>" << escapeXml(title) << "</work-title>\n";
+		out << "  </work>\n";
+	}
+
+	out << "  <identification>\n";
+	string composer = infile.getReferenceRecord("COM");
+	if (!composer.empty()) {
+		out << "    <creator type=\"composer\">" << escapeXml(composer) << "</creator>\n";
+	}
+	out << "    <encoding>\n";
+	out << "      <software>humlib hum2musicxml</software>\n";
+	out << "    </encoding>\n";
+	out << "  </identification>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printPartList --
+//
+
+void Tool_hum2musicxml::printPartList(ostream& out, vector<HTp>& kernstarts) {
+	out << "  <part-list>\n";
+	for (int i=0; i<(int)kernstarts.size(); i++) {
+		out << "    <score-part id=\"P" << i + 1 << "\">\n";
+		out << "      <part-name>" << escapeXml(getPartName(kernstarts[i]))
+		    << "</part-name>\n";
+		out << "    </score-part>\n";
+	}
+	out << "  </part-list>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getPartName -- Return the instrument name (*I")
+//     given before the first data in the spine.
+//
+
+string Tool_hum2musicxml::getPartName(HTp kernstart) {
+	HTp current = kernstart;
+	while (current && !current->isData()) {
+		if (current->compare(0, 3, "*I\"") == 0) {
+			return current->substr(3);
+		}
+		current = current->getNextToken();
+	}
+	return "";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printPart -- Print the measures of a part.  The
+//     tokens of each measure are collected by voice (subtrack) and then
+//     printed.  Clefs, key and time signatures before the first data in a
+//     measure are printed in the initial attributes of the measure, and
+//     later ones are printed in line order in the first voice.
+//
+
+void Tool_hum2musicxml::printPart(ostream& out, HumdrumFile& infile,
+		HTp kernstart, int partnum) {
+	int track = kernstart->getTrack();
+	m_beamdepth.clear();
+	m_slurs.clear();
+
+	out << "  <part id=\"P" << partnum << "\">\n";
+
+	vector<vector<HTp>> voices(1);
+	vector<HTp> attributes;
+	HumNum starttime = 0;
+	int number = getFirstMeasureNumber(infile);
+	HTp leftbar = NULL;
+	bool dataQ = false;
+	bool firstQ = true;
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		HumdrumLine& line = infile[i];
+		if (line.isBarline()) {
+			HTp bar = NULL;
+			for (int j=0; j<line.getFieldCount(); j++) {
+				if (line.token(j)->getTrack() == track) {
+					bar = line.token(j);
+					break;
+				}
+			}
+			if (!bar) {
+				continue;
+			}
+			if (dataQ) {
+				printMeasure(out, voices, attributes, starttime, number, leftbar,
+						bar, firstQ);
+				firstQ = false;
+				attributes.clear();
+				number++;
+			} else {
+				// no notes in measure: carry clef/key/time to next measure
+				attributes.insert(attributes.end(), voices[0].begin(), voices[0].end());
+			}
+			voices.assign(1, vector<HTp>());
+			dataQ = false;
+			starttime = line.getDurationFromStart();
+			leftbar = bar;
+			int barnum = line.getBarNumber();
+			if (barnum >= 0) {
+				number = barnum;
+			}
+			continue;
+		}
+
+		if (line.isInterpretation()) {
+			bool clefQ = false;
+			bool keyQ = false;
+			bool timeQ = false;
+			for (int j=0; j<line.getFieldCount(); j++) {
+				HTp token = line.token(j);
+				if (token->getTrack() != track) {
+					continue;
+				}
+				// store one of each type on the line (split spines duplicate them):
+				if (token->isClef()) {
+					if (clefQ) {
+						continue;
+					}
+					clefQ = true;
+				} else if (token->isKeySignature()) {
+					if (keyQ) {
+						continue;
+					}
+					keyQ = true;
+				} else if (token->isTimeSignature()) {
+					if (timeQ) {
+						continue;
+					}
+					timeQ = true;
+				} else {
+					continue;
+				}
+				if (dataQ) {
+					voices[0].push_back(token);
+				} else {
+					attributes.push_back(token);
+				}
+			}
+			continue;
+		}
+
+		if (!line.isData()) {
+			continue;
+		}
+		for (int j=0; j<line.getFieldCount(); j++) {
+			HTp token = line.token(j);
+			if (token->getTrack() != track) {
+				continue;
+			}
+			if (token->isNull()) {
+				continue;
+			}
+			int voice = token->getSubtrack();
+			if (voice < 1) {
+				voice = 1;
+			}
+			if ((int)voices.size() < voice) {
+				voices.resize(voice);
+			}
+			voices[voice - 1].push_back(token);
+			dataQ = true;
+		}
+	}
+
+	if (dataQ) {
+		printMeasure(out, voices, attributes, starttime, number, leftbar, NULL, firstQ);
+	}
+
+	out << "  </part>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getFirstMeasureNumber -- Return the measure number for
+//     data before the first barline (0 if it is a pickup to measure 1).
+//
+
+int Tool_hum2musicxml::getFirstMeasureNumber(HumdrumFile& infile) {
+	bool dataQ = false;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			dataQ = true;
+		} else if (infile[i].isBarline()) {
+			int number = infile[i].getBarNumber();
+			if (number < 0) {
+				return 1;
+			}
+			if (dataQ && (number > 0)) {
+				return number - 1;
+			}
+			return number;
+		}
+	}
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printMeasure -- Print the voices of a measure, moving
+//     back to the start of the measure between voices.
+//
+
+void Tool_hum2musicxml::printMeasure(ostream& out, vector<vector<HTp>>& voices,
+		vector<HTp>& attributes, HumNum starttime, int number, HTp leftbar,
+		HTp rightbar, bool firstQ) {
+	out << "    <measure number=\"" << number << "\"";
+	if (number == 0) {
+		out << " implicit=\"yes\"";
+	}
+	out << ">\n";
+
+	if (leftbar && ((leftbar->find("|:") != string::npos) ||
+			(leftbar->find("!:") != string::npos))) {
+		out << "      <barline location=\"left\">\n";
+		out << "        <bar-style>heavy-light</bar-style>\n";
+		out << "        <repeat direction=\"forward\"/>\n";
+		out << "      </barline>\n";
+	}
+
+	printAttributes(out, attributes, firstQ);
+
+	int position = 0;
+	for (int v=0; v<(int)voices.size(); v++) {
+		if (voices[v].empty()) {
+			continue;
+		}
+		if (position > 0) {
+			out << "      <backup>\n";
+			out << "        <duration>" << position << "</duration>\n";
+			out << "      </backup>\n";
+			position = 0;
+		}
+		for (int i=0; i<(int)voices[v].size(); i++) {
+			HTp token = voices[v][i];
+			if (token->isInterpretation()) {
+				vector<HTp> change(1, token);
+				printAttributes(out, change, false);
+				continue;
+			}
+			int tokenstart = getTicks(token->getDurationFromStart() - starttime);
+			if (tokenstart > position) {
+				out << "      <forward>\n";
+				out << "        <duration>" << tokenstart - position << "</duration>\n";
+				out << "        <voice>" << v + 1 << "</voice>\n";
+				out << "      </forward>\n";
+			} else if (tokenstart < position) {
+				out << "      <backup>\n";
+				out << "        <duration>" << position - tokenstart << "</duration>\n";
+				out << "      </backup>\n";
+			}
+			position = tokenstart + printToken(out, token, v + 1);
+		}
+	}
+
+	if (rightbar) {
+		string style;
+		bool repeatQ = false;
+		if ((rightbar->find(":|") != string::npos) ||
+				(rightbar->find(":!") != string::npos)) {
+			style = "light-heavy";
+			repeatQ = true;
+		} else if (rightbar->compare(0, 2, "==") == 0) {
+			style = "light-heavy";
+		} else if (rightbar->find("||") != string::npos) {
+			style = "light-light";
+		}
+		if (!style.empty()) {
+			out << "      <barline location=\"right\">\n";
+			out << "        <bar-style>" << style << "</bar-style>\n";
+			if (repeatQ) {
+				out << "        <repeat direction=\"backward\"/>\n";
+			}
+			out << "      </barline>\n";
+		}
+	}
+
+	out << "    </measure>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printAttributes -- Print clef, key and time
+//     signature interpretations in MusicXML element order.
+//
+
+void Tool_hum2musicxml::printAttributes(ostream& out, vector<HTp>& tokens,
+		bool divisionsQ) {
+	HTp key  = NULL;
+	HTp time = NULL;
+	HTp clef = NULL;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		if (tokens[i]->isKeySignature()) {
+			key = tokens[i];
+		} else if (tokens[i]->isTimeSignature()) {
+			time = tokens[i];
+		} else if (tokens[i]->isClef()) {
+			clef = tokens[i];
+		}
+	}
+	if (!divisionsQ && !key && !time && !clef) {
+		return;
+	}
+
+	out << "      <attributes>\n";
+	if (divisionsQ) {
+		out << "        <divisions>" << m_divisions << "</divisions>\n";
+	}
+	if (key) {
+		printKey(out, key);
+	}
+	if (time) {
+		printTime(out, time);
+	}
+	if (clef) {
+		printClef(out, clef);
+	}
+	out << "      </attributes>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printKey -- Convert a key signature such as *k[f#c#]
+//     into a count of fifths.
+//
+
+void Tool_hum2musicxml::printKey(ostream& out, HTp token) {
+	int fifths = 0;
+	for (int i=0; i<(int)token->size(); i++) {
+		if (token->at(i) == '#') {
+			fifths++;
+		} else if (token->at(i) == '-') {
+			fifths--;
+		}
+	}
+	out << "        <key>\n";
+	out << "          <fifths>" << fifths << "</fifths>\n";
+	out << "        </key>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printTime -- Convert a time signature such as *M3/4.
+//
+
+void Tool_hum2musicxml::printTime(ostream& out, HTp token) {
+	int beats = 0;
+	int beattype = 0;
+	if (sscanf(token->c_str(), "*M%d/%d", &beats, &beattype) != 2) {
+		return;
+	}
+	out << "        <time>\n";
+	out << "          <beats>" << beats << "</beats>\n";
+	out << "          <beat-type>" << beattype << "</beat-type>\n";
+	out << "        </time>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printClef -- Convert a clef such as *clefG2 or
+//     *clefGv2 (octave-transposing treble clef).
+//
+
+void Tool_hum2musicxml::printClef(ostream& out, HTp token) {
+	string clef = token->substr(5);
+	if (clef.empty()) {
+		return;
+	}
+	char sign = clef[0];
+	if (sign == 'X') {
+		out << "        <clef>\n";
+		out << "          <sign>percussion</sign>\n";
+		out << "        </clef>\n";
+		return;
+	}
+	if ((sign != 'G') && (sign != 'F') && (sign != 'C')) {
+		return;
+	}
+	int octave = 0;
+	int line = 0;
+	for (int i=1; i<(int)clef.size(); i++) {
+		if (clef[i] == 'v') {
+			octave--;
+		} else if (clef[i] == '^') {
+			octave++;
+		} else if (isdigit(clef[i])) {
+			line = clef[i] - '0';
+		}
+	}
+	out << "        <clef>\n";
+	out << "          <sign>" << sign << "</sign>\n";
+	if (line > 0) {
+		out << "          <line>" << line << "</line>\n";
+	}
+	if (octave) {
+		out << "          <clef-octave-change>" << octave << "</clef-octave-change>\n";
+	}
+	out << "        </clef>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printToken -- Print a note, rest or chord.  Returns
+//     the duration of the token in divisions.
+//
+
+int Tool_hum2musicxml::printToken(ostream& out, HTp token, int voice) {
+	int ticks = 0;
+	if (!token->isGrace()) {
+		ticks = getTicks(token->getDuration());
+	}
+	vector<string> beams;
+	if (m_beamsQ && !token->isRest()) {
+		getBeamStates(beams, token, voice);
+	}
+	vector<string> subtoks = token->getSubtokens();
+	for (int i=0; i<(int)subtoks.size(); i++) {
+		printNote(out, token, i, subtoks[i], voice, ticks, beams);
+	}
+	return ticks;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printNote -- Print one note of a token (the index is
+//     the subtoken index in chords).
+//
+
+void Tool_hum2musicxml::printNote(ostream& out, HTp token, int index,
+		const string& subtok, int voice, int ticks, vector<string>& beams) {
+	bool restQ = subtok.find('r') != string::npos;
+	bool measurerestQ = restQ && (subtok.find("rr") != string::npos);
+	bool graceQ = subtok.find('q') != string::npos;
+
+	out << "      <note";
+	if (subtok.find("yy") != string::npos) {
+		out << " print-object=\"no\"";
+	}
+	out << ">\n";
+
+	if (graceQ) {
+		if (subtok.find("qq") != string::npos) {
+			out << "        <grace/>\n";
+		} else {
+			out << "        <grace slash=\"yes\"/>\n";
+		}
+	}
+	if (index > 0) {
+		out << "        <chord/>\n";
+	}
+
+	int alter = 0;
+	if (restQ) {
+		if (measurerestQ) {
+			out << "        <rest measure=\"yes\"/>\n";
+		} else {
+			out << "        <rest/>\n";
+		}
+	} else {
+		alter = Convert::kernToAccidentalCount(subtok);
+		out << "        <pitch>\n";
+		out << "          <step>" << Convert::kernToDiatonicUC(subtok) << "</step>\n";
+		if (alter) {
+			out << "          <alter>" << alter << "</alter>\n";
+		}
+		out << "          <octave>" << Convert::kernToOctaveNumber(subtok) << "</octave>\n";
+		out << "        </pitch>\n";
+	}
+
+	if (!graceQ) {
+		out << "        <duration>" << ticks << "</duration>\n";
+	}
+
+	bool tiestopQ  = (subtok.find('_') != string::npos) || (subtok.find(']') != string::npos);
+	bool tiestartQ = (subtok.find('_') != string::npos) || (subtok.find('[') != string::npos);
+	if (!restQ && tiestopQ) {
+		out << "        <tie type=\"stop\"/>\n";
+	}
+	if (!restQ && tiestartQ) {
+		out << "        <tie type=\"start\"/>\n";
+	}
+
+	out << "        <voice>" << voice << "</voice>\n";
+
+	// The printed duration without dots is a power of two.  Other
+	// durations are tuplets of the next longer power of two.
+	HumNum visual;
+	if (graceQ) {
+		string recip = subtok;
+		recip.erase(std::remove(recip.begin(), recip.end(), 'q'), recip.end());
+		visual = Convert::recipToDurationNoDots(recip);
+		if (visual == 0) {
+			visual.setValue(1, 2);
+		}
+	} else {
+		visual = Convert::recipToDurationNoDots(subtok);
+	}
+	HumNum normal = 1;
+	if (visual > 0) {
+		while (normal < visual) {
+			normal *= 2;
+		}
+		while (normal / 2 >= visual) {
+			normal = normal / 2;
+		}
+	}
+	if (!measurerestQ) {
+		out << "        <type>" << getNoteType(normal) << "</type>\n";
+		int dots = (int)std::count(subtok.begin(), subtok.end(), '.');
+		for (int i=0; i<dots; i++) {
+			out << "        <dot/>\n";
+		}
+	}
+
+	if (!restQ && (token->hasVisibleAccidental(index) == 1)) {
+		out << "        <accidental";
+		if (token->hasCautionaryAccidental(index) == 1) {
+			out << " cautionary=\"yes\"";
+		}
+		out << ">";
+		switch (alter) {
+			case -2: out << "flat-flat";    break;
+			case -1: out << "flat";         break;
+			case  1: out << "sharp";        break;
+			case  2: out << "double-sharp"; break;
+			default: out << "natural";
+		}
+		out << "</accidental>\n";
+	}
+
+	if ((visual > 0) && !graceQ && !measurerestQ && (normal != visual)) {
+		HumNum ratio = normal / visual;
+		out << "        <time-modification>\n";
+		out << "          <actual-notes>" << ratio.getNumerator() << "</actual-notes>\n";
+		out << "          <normal-notes>" << ratio.getDenominator() << "</normal-notes>\n";
+		out << "        </time-modification>\n";
+	}
+
+	if (m_stemsQ && !restQ) {
+		if (token->find('/') != string::npos) {
+			out << "        <stem>up</stem>\n";
+		} else if (token->find('\\') != string::npos) {
+			out << "        <stem>down</stem>\n";
+		}
+	}
+
+	if (index == 0) {
+		for (int i=0; i<(int)beams.size(); i++) {
+			out << "        <beam number=\"" << i + 1 << "\">" << beams[i] << "</beam>\n";
+		}
+	}
+
+	printNotations(out, token, index, subtok);
+
+	out << "      </note>\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printNotations -- Print ties, slurs, fermatas and
+//     articulations.  Slurs and articulations are attached to the first
+//     note of a chord.
+//
+
+void Tool_hum2musicxml::printNotations(ostream& out, HTp token, int index,
+		const string& subtok) {
+	stringstream notations;
+
+	if (subtok.find('r') == string::npos) {
+		if ((subtok.find('_') != string::npos) || (subtok.find(']') != string::npos)) {
+			notations << "          <tied type=\"stop\"/>\n";
+		}
+		if ((subtok.find('_') != string::npos) || (subtok.find('[') != string::npos)) {
+			notations << "          <tied type=\"start\"/>\n";
+		}
+	}
+
+	if (index == 0) {
+		printSlurs(notations, token);
+
+		if (token->find(';') != string::npos) {
+			notations << "          <fermata/>\n";
+		}
+
+		string articulations;
+		if (token->find("^^") != string::npos) {
+			articulations += "            <strong-accent/>\n";
+		} else if (token->find('^') != string::npos) {
+			articulations += "            <accent/>\n";
+		}
+		if (token->find('`') != string::npos) {
+			articulations += "            <staccatissimo/>\n";
+		} else if (token->find('\'') != string::npos) {
+			articulations += "            <staccato/>\n";
+		}
+		if (token->find('~') != string::npos) {
+			articulations += "            <tenuto/>\n";
+		}
+		if (!articulations.empty()) {
+			notations << "          <articulations>\n";
+			notations << articulations;
+			notations << "          </articulations>\n";
+		}
+	}
+
+	string contents = notations.str();
+	if (!contents.empty()) {
+		out << "        <notations>\n";
+		out << contents;
+		out << "        </notations>\n";
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::printSlurs -- Print the slur stops and starts on a
+//     note.  Slur ends are paired with their starts by analyzeSlurs(), and
+//     both ends of a slur are given the lowest MusicXML number not in use
+//     by another open slur in the part.  Slurs without a matching end are
+//     not printed.
+//
+
+void Tool_hum2musicxml::printSlurs(ostream& out, HTp token) {
+	int slurends = (int)std::count(token->begin(), token->end(), ')');
+	for (int i=0; i<slurends; i++) {
+		string suffix = (i > 0) ? to_string(i + 1) : "";
+		HTp start = token->getValueHTp("auto", "slurStartId" + suffix);
+		if (!start) {
+			continue;
+		}
+		int enumeration = token->getValueInt("auto", "slurStartNumber" + suffix);
+		auto it = m_slurs.find(std::make_pair(start, enumeration));
+		if (it == m_slurs.end()) {
+			continue;
+		}
+		out << "          <slur type=\"stop\" number=\"" << it->second << "\"/>\n";
+		m_slurs.erase(it);
+	}
+
+	int slurstarts = (int)std::count(token->begin(), token->end(), '(');
+	for (int i=0; i<slurstarts; i++) {
+		string suffix = (i > 0) ? to_string(i + 1) : "";
+		if (!token->getValueHTp("auto", "slurEndId" + suffix)) {
+			continue;
+		}
+		int number = 1;
+		bool usedQ = true;
+		while (usedQ) {
+			usedQ = false;
+			for (auto& slur : m_slurs) {
+				if (slur.second == number) {
+					usedQ = true;
+					number++;
+					break;
+				}
+			}
+		}
+		m_slurs[std::make_pair(token, i + 1)] = number;
+		out << "          <slur type=\"start\" number=\"" << number << "\"/>\n";
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getBeamStates -- Convert the beam markers of a token
+//     (L = start, J = end, K/k = partial beams) into MusicXML beam values
+//     for each beam level.  The number of open beams is tracked for each
+//     voice.
+//
+
+void Tool_hum2musicxml::getBeamStates(vector<string>& states, HTp token, int voice) {
+	states.clear();
+	if ((int)m_beamdepth.size() < voice) {
+		m_beamdepth.resize(voice, 0);
+	}
+	int& depth = m_beamdepth[voice - 1];
+	int starts = (int)std::count(token->begin(), token->end(), 'L');
+	int ends   = (int)std::count(token->begin(), token->end(), 'J');
+	int hooksf = (int)std::count(token->begin(), token->end(), 'K');
+	int hooksb = (int)std::count(token->begin(), token->end(), 'k');
+
+	for (int i=0; i<depth; i++) {
+		states.push_back("continue");
+	}
+	for (int i=0; i<ends; i++) {
+		int level = depth - 1 - i;
+		if (level >= 0) {
+			states[level] = "end";
+		}
+	}
+	depth -= ends;
+	if (depth < 0) {
+		depth = 0;
+	}
+	for (int i=0; i<starts; i++) {
+		int level = depth + i;
+		if (level < (int)states.size()) {
+			states[level] = "begin";
+		} else {
+			states.push_back("begin");
+		}
+	}
+	depth += starts;
+	for (int i=0; i<hooksf; i++) {
+		states.push_back("forward hook");
+	}
+	for (int i=0; i<hooksb; i++) {
+		states.push_back("backward hook");
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getNoteType -- Return the MusicXML type name of a
+//     duration in quarter notes.
+//
+
+string Tool_hum2musicxml::getNoteType(HumNum duration) {
+	if (duration == 16)             { return "long";    }
+	if (duration == 8)              { return "breve";   }
+	if (duration == 4)              { return "whole";   }
+	if (duration == 2)              { return "half";    }
+	if (duration == 1)              { return "quarter"; }
+	if (duration == HumNum(1, 2))   { return "eighth";  }
+	if (duration == HumNum(1, 4))   { return "16th";    }
+	if (duration == HumNum(1, 8))   { return "32nd";    }
+	if (duration == HumNum(1, 16))  { return "64th";    }
+	if (duration == HumNum(1, 32))  { return "128th";   }
+	if (duration == HumNum(1, 64))  { return "256th";   }
+	if (duration > 16)              { return "maxima";  }
+	return "quarter";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::getTicks -- Convert a duration in quarter notes
+//     into MusicXML divisions.
+//
+
+int Tool_hum2musicxml::getTicks(HumNum duration) {
+	HumNum ticks = duration * m_divisions;
+	return ticks.getInteger();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_hum2musicxml::escapeXml -- Escape text for XML content.
+//
+
+string Tool_hum2musicxml::escapeXml(const string& value) {
+	string output;
+	output.reserve(value.size());
+	for (int i=0; i<(int)value.size(); i++) {
+		switch (value[i]) {
+			case '&':  output += "&amp;";  break;
+			case '<':  output += "&lt;";   break;
+			case '>':  output += "&gt;";   break;
+			case '"':  output += "&quot;"; break;
+			default:   output += value[i];
+		}
+	}
+	return output;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Jul 29 11:38:01 CEST 2019
-// Last Modified: Sat Aug  3 17:48:04 EDT 2019
+// Last Modified: Fri Oct 16 20:02:41 UTC 2026
 // Filename:      humdiff.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/cli/humdiff.cpp
 // Syntax:        C++11
@@ -13,6 +13,8 @@
 #include "tool-humdiff.h"
 #include "HumRegex.h"
 #include "Convert.h"
+
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -33,6 +35,7 @@ Tool_humdiff::Tool_humdiff(void) {
 	define("time-points|times=b", "display timepoint lists for each file");
 	define("note-points|notes=b", "display notepoint lists for each file");
 	define("c|color=s:red",       "color for difference markers");
+	define("a|align=b",           "align measures to detect inserted or deleted measures");
 }
 
 
@@ -43,6 +46,11 @@ Tool_humdiff::Tool_humdiff(void) {
 //
 
 bool Tool_humdiff::run(HumdrumFileSet& infiles) {
+	m_marked = 0;
+	m_sources.clear();
+	m_structure.clear();
+	m_agreements.clear();
+
 	int reference = getInteger("reference") - 1;
 	if (reference < 0) {
 		cerr << "Error: reference has to be 1 or higher" << endl;
@@ -62,8 +70,13 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 		cerr << "Usage: " << getCommand() << " files" << endl;
 		return false;
 	} else {
+		bool alignQ = getBoolean("align");
 		HumNum targetdur = infiles[0].getScoreDuration();
 		for (int i=1; i<infiles.getSize(); i++) {
+			if (alignQ) {
+				// Aligned scores may differ in length.
+				break;
+			}
 			HumNum dur = infiles[i].getScoreDuration();
 			if (dur != targetdur) {
 				cerr << "Error: all files must have the same duration" << endl;
@@ -71,20 +84,43 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 			}
 		}
 
-		for (int i=0; i<infiles.getCount(); i++) {
-			if (i == reference) {
-				continue;
+		if (alignQ) {
+			// Measure alignment is done separately for each alternate score,
+			// but the measures of the reference are only extracted once.
+			vector<MeasurePoint> refmeasures;
+			extractMeasurePoints(refmeasures, infiles[reference]);
+			for (int i=0; i<infiles.getCount(); i++) {
+				if (i == reference) {
+					continue;
+				}
+				m_sources = { reference, i };
+				alignFiles(infiles[reference], refmeasures, infiles[i]);
 			}
-			compareFiles(infiles[reference], infiles[i]);
+		} else {
+			compareFiles(infiles, reference);
 		}
 
-		if (!getBoolean("report")) {
-			infiles[reference].createLinesFromTokens();
-			m_humdrum_text << infiles[reference];
+		if (getBoolean("report")) {
+			for (int i=0; i<(int)m_structure.size(); i++) {
+				m_free_text << m_structure[i] << endl;
+			}
+		} else {
+			HumdrumFile& infile = infiles[reference];
+			infile.createLinesFromTokens();
+			for (int i=0; i<infile.getLineCount(); i++) {
+				printAgreements(infile[i]);
+				m_humdrum_text << infile[i] << endl;
+			}
+			for (int i=0; i<(int)m_structure.size(); i++) {
+				m_humdrum_text << "!!humdiff: " << m_structure[i] << endl;
+			}
 			if (m_marked) {
 				m_humdrum_text << "!!!RDF**kern: @ = marked note";
+				if (!m_agreements.empty()) {
+					m_humdrum_text << ", text above note = count of other sources matching the note";
+				}
 				if (getBoolean("color")) {
-					m_humdrum_text << "color=\"" << getString("color") << "\"";
+					m_humdrum_text << ", color=\"" << getString("color") << "\"";
 				}
 				m_humdrum_text << endl;
 			}
@@ -98,20 +134,37 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 
 //////////////////////////////
 //
-// Tool_humdiff::compareFiles --
+// Tool_humdiff::compareFiles -- Compare all alternate scores to the
+//     reference score in a single pass.  The timepoints of each score are
+//     extracted once and merged together, so that each note in the
+//     reference is checked against all other scores at the same time.
 //
 
-void Tool_humdiff::compareFiles(HumdrumFile& reference, HumdrumFile& alternate) {
-	vector<vector<TimePoint>> timepoints(2);
-	extractTimePoints(timepoints.at(0), reference);
-	extractTimePoints(timepoints.at(1), alternate);
+void Tool_humdiff::compareFiles(HumdrumFileSet& infiles, int reference) {
+	vector<HumdrumFile*> files;
+	m_sources.clear();
+	files.push_back(&infiles[reference]);
+	m_sources.push_back(reference);
+	for (int i=0; i<infiles.getCount(); i++) {
+		if (i == reference) {
+			continue;
+		}
+		files.push_back(&infiles[i]);
+		m_sources.push_back(i);
+	}
+
+	vector<vector<TimePoint>> timepoints(files.size());
+	for (int i=0; i<(int)files.size(); i++) {
+		extractTimePoints(timepoints.at(i), *files[i]);
+	}
 
 	if (getBoolean("time-points")) {
-		printTimePoints(timepoints[0]);
-		printTimePoints(timepoints[1]);
+		for (int i=0; i<(int)timepoints.size(); i++) {
+			printTimePoints(timepoints[i]);
+		}
 	}
 
-	compareTimePoints(timepoints, reference, alternate);
+	compareTimePoints(timepoints, files);
 }
 
 
@@ -136,16 +189,12 @@ void Tool_humdiff::printTimePoints(vector<TimePoint>& timepoints) {
 //
 
 void Tool_humdiff::compareTimePoints(vector<vector<TimePoint>>& timepoints,
-		HumdrumFile& reference, HumdrumFile& alternate) {
+		vector<HumdrumFile*>& infiles) {
 	vector<int> indexes(timepoints.size(), 0);
 	HumNum minval;
 	HumNum value;
 	int found;
 
-	vector<HumdrumFile*> infiles(2, NULL);
-	infiles[0] = &reference;
-	infiles[1] = &alternate;
-
 	vector<int> increment(timepoints.size(), 0);
 
 	while ((1)) {
@@ -219,14 +268,29 @@ void Tool_humdiff::printNotePoints(vector<NotePoint>& notelist) {
 //////////////////////////////
 //
 // Tool_humdiff::markNote -- mark the note (since it does not have a match in other edition(s).
+//     When there is more than one other source, the number of other sources which
+//     contain the note is also stored, to be printed above the note as layout text
+//     (see printAgreements()).
 //
 
-void Tool_humdiff::markNote(NotePoint& np) {
+void Tool_humdiff::markNote(NotePoint& np, int sourcecount) {
 	m_marked = 1;
 	HTp token = np.token;
 	if (!token) {
 		return;
 	}
+	if (token->getSubtoken(np.subindex).find("@") != string::npos) {
+		// already marked from comparison with another score
+		return;
+	}
+	if (sourcecount > 1) {
+		string& text = m_agreements[token];
+		if (!text.empty()) {
+			// another note in the chord is also marked
+			text += " ";
+		}
+		text += to_string(np.agreement) + "/" + to_string(sourcecount);
+	}
 	if (!token->isChord()) {
 		string contents = *token;
 		contents += "@";
@@ -245,6 +309,39 @@ void Tool_humdiff::markNote(NotePoint& np) {
 
 
 
+//////////////////////////////
+//
+// Tool_humdiff::printAgreements -- Print a local comment line with layout
+//     text above each marked note in the line which gives the number of
+//     other sources that contain the note, such as "1/3" when the note is
+//     found in one of three other sources.
+//
+
+void Tool_humdiff::printAgreements(HumdrumLine& line) {
+	if (m_agreements.empty() || !line.isData()) {
+		return;
+	}
+	string output;
+	bool found = false;
+	for (int i=0; i<line.getFieldCount(); i++) {
+		if (i > 0) {
+			output += "\t";
+		}
+		auto it = m_agreements.find(line.token(i));
+		if (it == m_agreements.end()) {
+			output += "!";
+			continue;
+		}
+		output += "!LO:TX:a:t=" + it->second;
+		found = true;
+	}
+	if (found) {
+		m_humdrum_text << output << endl;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_humdiff::compareLines --
@@ -258,8 +355,6 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 	// cerr << "COMPARING LINES ====================================" << endl;
 	vector<vector<NotePoint>> notelist(indexes.size());
 
-	// Note: timepoints size must be 2
-	// and infiles size must be 2
 	for (int i=0; i<(int)timepoints.size(); i++) {
 		if (indexes.at(i) >= (int)timepoints.at(i).size()) {
 			continue;
@@ -275,17 +370,27 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 
 
 	}
+	vector<NoteIndex> noteindex(notelist.size());
+	for (int j=1; j<(int)notelist.size(); j++) {
+		buildNoteIndex(noteindex.at(j), notelist.at(j));
+	}
+
 	for (int i=0; i<(int)notelist.at(0).size(); i++) {
 		notelist.at(0).at(i).matched.resize(notelist.size());
 		fill(notelist.at(0).at(i).matched.begin(), notelist.at(0).at(i).matched.end(), -1);
 		notelist.at(0).at(i).matched.at(0) = i;
+		int agreement = 0;
 		for (int j=1; j<(int)notelist.size(); j++) {
-			int status = findNoteInList(notelist.at(0).at(i), notelist.at(j));
+			int status = findNoteInList(notelist.at(0).at(i), notelist.at(j), noteindex.at(j));
 			notelist.at(0).at(i).matched.at(j) = status;
-			if ((status < 0) && !reportQ) {
-				markNote(notelist.at(0).at(i));
+			if (status >= 0) {
+				agreement++;
 			}
 		}
+		notelist.at(0).at(i).agreement = agreement;
+		if ((agreement < (int)notelist.size() - 1) && !reportQ) {
+			markNote(notelist.at(0).at(i), (int)notelist.size() - 1);
+		}
 	}
 
 	if (getBoolean("notes")) {
@@ -301,31 +406,39 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 	}
 
 	// report
+	int sourcecount = (int)notelist.size() - 1;
 	for (int i=0; i<(int)notelist.at(0).size(); i++) {
-		for (int j=1; j<(int)notelist.at(0).at(i).matched.size(); j++) {
-			if (notelist.at(0).at(i).matched.at(j) < 0) {
-				cout << "NOTE " << notelist.at(0).at(i).subtoken
-				     << " DOES NOT HAVE EXACT MATCH IN SOURCE " << j << endl;
-				int humindex = notelist.at(0).at(i).token->getLineIndex();
-				cout << "\tREFERENCE MEASURE\t: " << notelist.at(0).at(i).measure << endl;
-				cout << "\tREFERENCE LINE NO.\t: " << humindex+1 << endl;
-				cout << "\tREFERENCE LINE TEXT\t: " << (*infiles[0])[humindex] << endl;
-
-				cout << "\tTARGET  " << j << " LINE NO. ";
-				if (j < 10) {
-					cout << " ";
+		NotePoint& np = notelist.at(0).at(i);
+		for (int j=1; j<(int)np.matched.size(); j++) {
+			if (np.matched.at(j) < 0) {
+				int source = getSourceNumber(j);
+				m_free_text << "NOTE " << np.subtoken
+				     << " DOES NOT HAVE EXACT MATCH IN SOURCE " << source << endl;
+				int humindex = np.token->getLineIndex();
+				m_free_text << "\tREFERENCE MEASURE\t: " << np.measure << endl;
+				m_free_text << "\tREFERENCE LINE NO.\t: " << humindex+1 << endl;
+				m_free_text << "\tREFERENCE LINE TEXT\t: " << (*infiles[0])[humindex] << endl;
+
+				m_free_text << "\tTARGET  " << source << " LINE NO. ";
+				if (source < 10) {
+					m_free_text << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				m_free_text << ":\t" << "X" << endl;
 
-				cout << "\tTARGET  " << j << " LINE TEXT";
-				if (j < 10) {
-					cout << " ";
+				m_free_text << "\tTARGET  " << source << " LINE TEXT";
+				if (source < 10) {
+					m_free_text << " ";
 				}
-				cout << ":\t" << "X" << endl;
+				m_free_text << ":\t" << "X" << endl;
 
-				cout << endl;
+				m_free_text << endl;
 			}
 		}
+		if ((sourcecount > 1) && (np.agreement < sourcecount)) {
+			m_free_text << "NOTE " << np.subtoken << " IN REFERENCE MEASURE "
+			     << np.measure << " MATCHES " << np.agreement << " OF "
+			     << sourcecount << " SOURCES" << endl << endl;
+		}
 	}
 }
 
@@ -333,30 +446,399 @@ void Tool_humdiff::compareLines(HumNum minval, vector<int>& indexes,
 
 //////////////////////////////
 //
-// Tool_humdiff::findNoteInList --
+// Tool_humdiff::getSourceNumber -- Return the file number (counting from
+//     1) of a position in the list of compared scores.
 //
 
-int Tool_humdiff::findNoteInList(NotePoint& np, vector<NotePoint>& nps) {
+int Tool_humdiff::getSourceNumber(int index) {
+	if ((index >= 0) && (index < (int)m_sources.size())) {
+		return m_sources[index] + 1;
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::findNoteInList -- Find an unprocessed note with the same
+//     pitch and duration using a hash index of the notes in the list.
+//     The matched note is marked as processed so that it will not be
+//     matched again (such as for doubled notes in a chord).
+//
+
+int Tool_humdiff::findNoteInList(NotePoint& np, vector<NotePoint>& nps,
+		NoteIndex& index) {
+	auto it = index.find(getNoteKey(np));
+	if (it == index.end()) {
+		return -1;
+	}
+	vector<int>& candidates = it->second;
+	for (int i=0; i<(int)candidates.size(); i++) {
+		NotePoint& target = nps.at(candidates[i]);
+		if (target.processed) {
+			continue;
+		}
+		if ((target.b40 != np.b40) || (target.duration != np.duration)) {
+			// hash collision
+			continue;
+		}
+		target.processed = 1;
+		return candidates[i];
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::buildNoteIndex -- Create a hash index for a list of notes.
+//
+
+void Tool_humdiff::buildNoteIndex(NoteIndex& index, vector<NotePoint>& nps) {
+	index.clear();
+	index.reserve(nps.size());
 	for (int i=0; i<(int)nps.size(); i++) {
-		// cerr << "COMPARING " << np.token << " (" << np.b40 << ") TO " << nps.at(i).token << " (" << nps.at(i).b40 << ") " << endl;
-		if (nps.at(i).processed) {
+		index[getNoteKey(nps[i])].push_back(i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getNoteKey -- Return a hash key for the pitch and
+//     duration of a note.
+//
+
+uint64_t Tool_humdiff::getNoteKey(NotePoint& np) {
+	uint64_t key = (uint64_t)(int64_t)np.b40;
+	key = key * 1000003 + (uint64_t)np.duration.getNumerator();
+	key = key * 1000003 + (uint64_t)np.duration.getDenominator();
+	return key;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignFiles -- Compare two scores after aligning their
+//     measures, so that measures which have been added to or removed
+//     from the alternate score are reported as structural differences
+//     rather than causing all following notes to mismatch.  Measures with
+//     identical contents are matched by their hashes using a longest
+//     common subsequence (Myers O(ND) difference algorithm), and the
+//     unmatched measures between them are compared note by note.
+//
+
+void Tool_humdiff::alignFiles(HumdrumFile& reference,
+		vector<MeasurePoint>& refmeasures, HumdrumFile& alternate) {
+	vector<MeasurePoint> altmeasures;
+	extractMeasurePoints(altmeasures, alternate);
+
+	vector<pair<int, int>> matches;
+	alignMeasures(matches, refmeasures, altmeasures);
+	matches.emplace_back((int)refmeasures.size(), (int)altmeasures.size());
+
+	int ri = 0;
+	int ai = 0;
+	for (int m=0; m<(int)matches.size(); m++) {
+		int rend = matches[m].first;
+		int aend = matches[m].second;
+		int common = std::min(rend - ri, aend - ai);
+		for (int k=0; k<common; k++) {
+			compareMeasures(refmeasures[ri+k], altmeasures[ai+k], reference, alternate);
+		}
+		for (int r=ri+common; r<rend; r++) {
+			markMeasure(refmeasures[r], reference);
+			m_structure.push_back("measure " + to_string(refmeasures[r].measure)
+					+ " (line " + to_string(refmeasures[r].startline + 1)
+					+ ") of reference is missing in source " + to_string(getSourceNumber(1)));
+		}
+		for (int a=ai+common; a<aend; a++) {
+			string message = "measure " + to_string(altmeasures[a].measure)
+					+ " (line " + to_string(altmeasures[a].startline + 1)
+					+ ") of source " + to_string(getSourceNumber(1))
+					+ " is inserted";
+			if (rend > 0) {
+				message += " after reference measure ";
+				message += to_string(refmeasures[std::min(rend, (int)refmeasures.size()) - 1].measure);
+			} else {
+				message += " at start of reference";
+			}
+			m_structure.push_back(message);
+		}
+		ri = rend + 1;
+		ai = aend + 1;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasures -- Find the longest common subsequence of
+//     measure hashes between the two scores with the Myers difference
+//     algorithm, which runs in O((N+M)D) time where D is the number of
+//     inserted and deleted measures.  The linear-space variant is used
+//     (see alignMeasureRange()), so memory use is O(N+M) even when the
+//     scores differ a lot.  The output is a list of matched (reference,
+//     alternate) measure index pairs in increasing order.
+//
+
+void Tool_humdiff::alignMeasures(vector<pair<int, int>>& matches,
+		vector<MeasurePoint>& reference, vector<MeasurePoint>& alternate) {
+	matches.clear();
+	alignMeasureRange(matches, reference, alternate, 0, (int)reference.size(),
+			0, (int)alternate.size());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasureRange -- Append the matched measures between
+//     reference measures [x0, x1) and alternate measures [y0, y1).  Common
+//     measures at the start and end are matched directly, then the range
+//     is divided at the middle snake of an optimal edit path and each half
+//     is aligned recursively.  Each half has at most half of the edits of
+//     the range, so the recursion depth is O(log D).
+//
+
+void Tool_humdiff::alignMeasureRange(vector<pair<int, int>>& matches,
+		vector<MeasurePoint>& reference, vector<MeasurePoint>& alternate,
+		int x0, int x1, int y0, int y1) {
+	while ((x0 < x1) && (y0 < y1) && (reference[x0].hash == alternate[y0].hash)) {
+		matches.emplace_back(x0, y0);
+		x0++;
+		y0++;
+	}
+	int suffix = 0;
+	while ((x1 > x0) && (y1 > y0) && (reference[x1-1].hash == alternate[y1-1].hash)) {
+		x1--;
+		y1--;
+		suffix++;
+	}
+
+	if ((x0 < x1) && (y0 < y1)) {
+		int xstart;
+		int ystart;
+		int xend;
+		int yend;
+		findMiddleSnake(reference, alternate, x0, x1, y0, y1, xstart, ystart,
+				xend, yend);
+		alignMeasureRange(matches, reference, alternate, x0, xstart, y0, ystart);
+		for (int i=0; i<xend-xstart; i++) {
+			matches.emplace_back(xstart + i, ystart + i);
+		}
+		alignMeasureRange(matches, reference, alternate, xend, x1, yend, y1);
+	}
+
+	for (int i=0; i<suffix; i++) {
+		matches.emplace_back(x1 + i, y1 + i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::findMiddleSnake -- Find the middle snake (the diagonal run
+//     of matching measures in the middle of an optimal edit path) between
+//     reference measures [x0, x1) and alternate measures [y0, y1) by
+//     searching forward from the start and backward from the end at the
+//     same time until the searches overlap.  Only the furthest reaching
+//     point on each diagonal for the current edit distance is stored.
+//     The snake runs from (xstart, ystart) to (xend, yend).
+//
+
+void Tool_humdiff::findMiddleSnake(vector<MeasurePoint>& reference,
+		vector<MeasurePoint>& alternate, int x0, int x1, int y0, int y1,
+		int& xstart, int& ystart, int& xend, int& yend) {
+	int n = x1 - x0;
+	int m = y1 - y0;
+	int delta = n - m;
+	bool odd = (delta % 2) != 0;
+	int maxd = (n + m + 1) / 2;
+	int offset = maxd + 1;
+	// forward[offset+k]: furthest x from the start on diagonal k = x - y.
+	// backward[offset+k]: furthest x from the end on reversed diagonal k.
+	vector<int> forward(2 * maxd + 3, 0);
+	vector<int> backward(2 * maxd + 3, 0);
+
+	for (int d=0; d<=maxd; d++) {
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (forward[offset+k-1] < forward[offset+k+1]))) {
+				x = forward[offset+k+1];
+			} else {
+				x = forward[offset+k-1] + 1;
+			}
+			int y = x - k;
+			int sx = x;
+			int sy = y;
+			while ((x < n) && (y < m) && (reference[x0+x].hash == alternate[y0+y].hash)) {
+				x++;
+				y++;
+			}
+			forward[offset+k] = x;
+			int c = delta - k;
+			if (odd && (c >= -(d-1)) && (c <= d-1) && (x + backward[offset+c] >= n)) {
+				xstart = x0 + sx;
+				ystart = y0 + sy;
+				xend = x0 + x;
+				yend = y0 + y;
+				return;
+			}
+		}
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (backward[offset+k-1] < backward[offset+k+1]))) {
+				x = backward[offset+k+1];
+			} else {
+				x = backward[offset+k-1] + 1;
+			}
+			int y = x - k;
+			int sx = x;
+			int sy = y;
+			while ((x < n) && (y < m) &&
+					(reference[x1-1-x].hash == alternate[y1-1-y].hash)) {
+				x++;
+				y++;
+			}
+			backward[offset+k] = x;
+			int c = delta - k;
+			if (!odd && (c >= -d) && (c <= d) && (x + forward[offset+c] >= n)) {
+				xstart = x1 - x;
+				ystart = y1 - y;
+				xend = x1 - sx;
+				yend = y1 - sy;
+				return;
+			}
+		}
+	}
+
+	// Not reached for non-empty ranges.
+	xstart = xend = x0;
+	ystart = yend = y0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::compareMeasures -- Compare the notes of two measures
+//     which have been aligned with each other.
+//
+
+void Tool_humdiff::compareMeasures(MeasurePoint& refmeasure,
+		MeasurePoint& altmeasure, HumdrumFile& reference, HumdrumFile& alternate) {
+	if (refmeasure.hash == altmeasure.hash) {
+		return;
+	}
+	vector<vector<TimePoint>> timepoints(2);
+	timepoints[0] = refmeasure.timepoints;
+	timepoints[1] = altmeasure.timepoints;
+	vector<HumdrumFile*> infiles(2, NULL);
+	infiles[0] = &reference;
+	infiles[1] = &alternate;
+	compareTimePoints(timepoints, infiles);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::markMeasure -- Mark all notes in a measure which does
+//     not have an equivalent in the other score.
+//
+
+void Tool_humdiff::markMeasure(MeasurePoint& measure, HumdrumFile& infile) {
+	if (getBoolean("report")) {
+		return;
+	}
+	for (int i=0; i<(int)measure.timepoints.size(); i++) {
+		vector<NotePoint> notelist;
+		getNoteList(notelist, infile, measure.timepoints[i].index[0],
+				measure.measure, 0, i);
+		// mark notes from last to first, since chord subtokens are rewritten:
+		for (int j=(int)notelist.size()-1; j>=0; j--) {
+			markNote(notelist[j]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::extractMeasurePoints -- Extract a list of measures in a
+//     file, with the timepoints of each measure and a hash of the notes
+//     in the measure.  The hash is the sum of mixed hashes for the pitch,
+//     duration and metric position of each note, so that it does not
+//     depend on the order of the notes on a line.
+//
+
+void Tool_humdiff::extractMeasurePoints(vector<MeasurePoint>& measures,
+		HumdrumFile& infile) {
+	measures.clear();
+	HumRegex hre;
+	MeasurePoint current;
+	current.startline = 0;
+	vector<NotePoint> notelist;
+	TimePoint tp;
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline()) {
+			current.endline = i;
+			if (!current.timepoints.empty()) {
+				measures.push_back(current);
+			}
+			current.clear();
+			current.startline = i;
+			current.start = infile[i].getDurationFromStart();
+			if (hre.search(infile.token(i, 0), "(\\d+)")) {
+				current.measure = hre.getMatchInt(1);
+			}
 			continue;
 		}
-		if (nps.at(i).b40 != np.b40) {
+		if (!infile[i].isData()) {
 			continue;
 		}
-		if (nps.at(i).duration != np.duration) {
+		if (infile[i].getDuration() == 0) {
+			// ignore grace notes for now
 			continue;
 		}
-		return i;
+		tp.clear();
+		tp.file.push_back(&infile);
+		tp.index.push_back(i);
+		tp.timestamp = infile[i].getDurationFromStart() - current.start;
+		tp.measure = current.measure;
+		current.timepoints.push_back(tp);
+
+		notelist.clear();
+		getNoteList(notelist, infile, i, current.measure, 0, 0);
+		for (int j=0; j<(int)notelist.size(); j++) {
+			uint64_t h = getNoteKey(notelist[j]);
+			h = h * 1000003 + (uint64_t)tp.timestamp.getNumerator();
+			h = h * 1000003 + (uint64_t)tp.timestamp.getDenominator();
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdULL;
+			h ^= h >> 33;
+			h *= 0xc4ceb9fe1a85ec53ULL;
+			h ^= h >> 33;
+			current.hash += h;
+		}
+	}
+	current.endline = infile.getLineCount() - 1;
+	if (!current.timepoints.empty()) {
+		measures.push_back(current);
 	}
-	// cerr << "\tCannot find note " << np.token << " on line " << np.token->getLineIndex() << " in other work" << endl;
-	return -1;
 }
 
 
 
-
 //////////////////////////////
 //
 // Tool_humdiff::getNoteList --
@@ -391,7 +873,7 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 			notelist.back().subtoken = subtok;
 			notelist.back().subindex = j;
 			notelist.back().measurequarter = token->getDurationFromBarline();
-			notelist.back().measure =
+			notelist.back().measure = measure;
 			notelist.back().track = track;
 			notelist.back().layer = layer;
 			notelist.back().sourceindex = sourceindex;
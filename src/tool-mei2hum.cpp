@@ -65,6 +65,8 @@ Tool_mei2hum::Tool_mei2hum(void) {
 	define("s|stems=b", "include stems in output");
 	define("x|xmlids=b", "include xmlids in output");
 	define("P|no-place=b", "Do not convert placement attribute");
+	define("batch=b", "convert files listed in input (or stdin) with JSON-lines report");
+	define("threads=i:0", "number of threads for batch conversion (0 = all cores)");
 
 	m_maxverse.resize(m_maxstaff);
 	fill(m_maxverse.begin(), m_maxverse.end(), 0);
@@ -97,10 +99,10 @@ bool Tool_mei2hum::convertFile(ostream& out, const char* filename) {
 	xml_document doc;
 	auto result = doc.load_file(filename);
 	if (!result) {
-		cerr << "\nXML file [" << filename << "] has syntax errors\n";
-		cerr << "Error description:\t" << result.description() << "\n";
-		cerr << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+		m_error_text << "\nXML file [" << filename << "] has syntax errors\n";
+		m_error_text << "Error description:\t" << result.description() << "\n";
+		m_error_text << "Error offset:\t" << result.offset << "\n\n";
+		return false;
 	}
 
 	return convert(out, doc);
@@ -138,10 +140,10 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 	auto score = doc.select_node("/mei/music/body/mdiv/score").node();
 
 	if (!score) {
-		cerr << "Cannot find score, so cannot convert MEI file to Humdrum";
-		cerr << endl;
-		cerr << "Perhaps there is a problem in the XML structure of the file.";
-		cerr << endl;
+		m_error_text << "Cannot find score, so cannot convert MEI file to Humdrum";
+		m_error_text << endl;
+		m_error_text << "Perhaps there is a problem in the XML structure of the file.";
+		m_error_text << endl;
 		return false;
 	}
 
@@ -150,7 +152,7 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 		// probably mensural music
 		m_staffcount = extractStaffCountByScoreDef(score);
 		if (m_staffcount == 0) {
-			cerr << "error: no music detected in <score>" << endl;
+			m_error_text << "error: no music detected in <score>" << endl;
 		}
 	}
 
@@ -3032,12 +3034,9 @@ void Tool_mei2hum::processFermataAttribute(string& output, xml_node node) {
 //
 
 void Tool_mei2hum::processPreliminaryLinkedNodes(xml_node node) {
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_startlinks.find(id);
-		if (found != m_startlinks.end()) {
-			processNodeStartLinks2(node, (*found).second);
-		}
+	int id = getIdIndex(node);
+	if ((id >= 0) && !m_startlinks[id].empty()) {
+		processNodeStartLinks2(node, m_startlinks[id]);
 	}
 }
 
@@ -3049,16 +3048,15 @@ void Tool_mei2hum::processPreliminaryLinkedNodes(xml_node node) {
 //
 
 void Tool_mei2hum::processLinkedNodes(string& output, xml_node node) {
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_startlinks.find(id);
-		if (found != m_startlinks.end()) {
-			processNodeStartLinks(output, node, (*found).second);
-		}
-		found = m_stoplinks.find(id);
-		if (found != m_stoplinks.end()) {
-			processNodeStopLinks(output, node, (*found).second);
-		}
+	int id = getIdIndex(node);
+	if (id < 0) {
+		return;
+	}
+	if (!m_startlinks[id].empty()) {
+		processNodeStartLinks(output, node, m_startlinks[id]);
+	}
+	if (!m_stoplinks[id].empty()) {
+		processNodeStopLinks(output, node, m_stoplinks[id]);
 	}
 }
 
@@ -3340,15 +3338,12 @@ void Tool_mei2hum::parseSlurStop(string& output, xml_node node, xml_node slur) {
 void Tool_mei2hum::parseTieStart(string& output, xml_node node, xml_node tie) {
 	NODE_VERIFY(tie, )
 
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_stoplinks.find(id);
-		if (found != m_stoplinks.end()) {
-			for (auto item : (*found).second) {
-				if (strcmp(tie.attribute("startid").value(), item.attribute("endid").value()) == 0) {
-					// deal with tie middles in parseTieStop().
-					return;
-				}
+	int id = getIdIndex(node);
+	if (id >= 0) {
+		for (auto item : m_stoplinks[id]) {
+			if (strcmp(tie.attribute("startid").value(), item.attribute("endid").value()) == 0) {
+				// deal with tie middles in parseTieStop().
+				return;
 			}
 		}
 	}
@@ -3400,15 +3395,12 @@ void Tool_mei2hum::parseTrill(string& output, xml_node node, xml_node trill) {
 void Tool_mei2hum::parseTieStop(string& output, xml_node node, xml_node tie) {
 	NODE_VERIFY(tie, )
 
-	string id = node.attribute("xml:id").value();
-	if (!id.empty()) {
-		auto found = m_startlinks.find(id);
-		if (found != m_startlinks.end()) {
-			for (auto item : (*found).second) {
-				if (strcmp(tie.attribute("endid").value(), item.attribute("startid").value()) == 0) {
-					output += "_";
-					return;
-				}
+	int id = getIdIndex(node);
+	if (id >= 0) {
+		for (auto item : m_startlinks[id]) {
+			if (strcmp(tie.attribute("endid").value(), item.attribute("startid").value()) == 0) {
+				output += "_";
+				return;
 			}
 		}
 	}
@@ -4081,7 +4073,10 @@ void Tool_mei2hum::initialize(void) {
 
 //////////////////////////////
 //
-// Tool_mei2hum::buildIdLinkMap -- Build table of startid and endid links between elements.
+// Tool_mei2hum::buildIdLinkMap -- Build table of startid and endid links between
+//     elements in a single pass over the document.  ID strings are interned,
+//     so that the note/rest/chord parsers look up their linked control
+//     events by element rather than by reading and comparing attributes.
 //
 // Reference: https://pugixml.org/docs/samples/traverse_walker.cpp
 //
@@ -4090,51 +4085,88 @@ void Tool_mei2hum::buildIdLinkMap(xml_document& doc) {
 	class linkmap_walker : public pugi::xml_tree_walker {
 		public:
 			virtual bool for_each(pugi::xml_node& node) {
-				xml_attribute startid = node.attribute("startid");
-				xml_attribute endid = node.attribute("endid");
-				if (startid) {
-
-					string value = startid.value();
-					if (!value.empty()) {
-						if (value[0] == '#') {
-							value = value.substr(1, string::npos);
-						}
-					}
-					if (!value.empty()) {
-						(*startlinks)[value].push_back(node);
-					}
-
+				if (node.type() != pugi::node_element) {
+					return true;
 				}
-				if (endid) {
-
-					string value = endid.value();
-					if (!value.empty()) {
-						if (value[0] == '#') {
-							value = value.substr(1, string::npos);
+				int start = -1;
+				int stop = -1;
+				for (xml_attribute attribute = node.first_attribute(); attribute;
+						attribute = attribute.next_attribute()) {
+					const char* name = attribute.name();
+					if (strcmp(name, "xml:id") == 0) {
+						int id = tool->internId(attribute.value());
+						if (id >= 0) {
+							tool->m_nodeids[node.hash_value()] = id;
 						}
+					} else if (strcmp(name, "startid") == 0) {
+						start = tool->internId(attribute.value());
+					} else if (strcmp(name, "endid") == 0) {
+						stop = tool->internId(attribute.value());
 					}
-					if (!value.empty()) {
-						(*stoplinks)[value].push_back(node);
-					}
-
+				}
+				if (start >= 0) {
+					tool->m_startlinks[start].push_back(node);
+				}
+				if (stop >= 0) {
+					tool->m_stoplinks[stop].push_back(node);
 				}
 				return true; // continue traversal
 			}
 
-			map<string, vector<xml_node>>* startlinks = NULL;
-			map<string, vector<xml_node>>* stoplinks = NULL;
+			Tool_mei2hum* tool = NULL;
 	};
 
+	m_idindex.clear();
+	m_nodeids.clear();
 	m_startlinks.clear();
 	m_stoplinks.clear();
 	linkmap_walker walker;
-	walker.startlinks = &m_startlinks;
-	walker.stoplinks = &m_stoplinks;
+	walker.tool = this;
 	doc.traverse(walker);
 }
 
 
 
+//////////////////////////////
+//
+// Tool_mei2hum::internId -- Return the index of an ID string (with or without
+//     a leading "#"), adding it to the ID tables if necessary.  Returns -1
+//     for an empty ID.
+//
+
+int Tool_mei2hum::internId(const char* id) {
+	if (id[0] == '#') {
+		id++;
+	}
+	if (id[0] == '\0') {
+		return -1;
+	}
+	auto result = m_idindex.emplace(id, (int)m_idindex.size());
+	if (result.second) {
+		m_startlinks.emplace_back();
+		m_stoplinks.emplace_back();
+	}
+	return result.first->second;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_mei2hum::getIdIndex -- Return the interned xml:id of an element, or -1
+//     if it has none.
+//
+
+int Tool_mei2hum::getIdIndex(xml_node node) {
+	auto found = m_nodeids.find(node.hash_value());
+	if (found == m_nodeids.end()) {
+		return -1;
+	}
+	return found->second;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_mei2hum::parseDir -- Meter cannot change in middle of measure.
@@ -126,6 +126,7 @@ bool Tool_musedata2hum::convert(ostream& out, MuseDataSet& mds) {
 		return false;
 	}
 	initialize();
+	m_measuretimes.clear();
 
 	HumGrid outdata;
 	bool status = true;
@@ -735,20 +736,22 @@ void Tool_musedata2hum::setTimeSigDurInfo(const string& ktimesig) {
 
 //////////////////////////////
 //
-// Tool_musedata2hum::getMeasure --  Could be imporoved by NlogN search.
+// Tool_musedata2hum::getMeasure -- Return the measure starting at the
+//     given time.  Measures are indexed by their starting time, so each
+//     measure of a part is found without rescanning all previous measures.
 //
 
 GridMeasure* Tool_musedata2hum::getMeasure(HumGrid& outdata, HumNum starttime) {
-	for (int i=0; i<(int)outdata.size(); i++) {
-		if (outdata[i]->getTimestamp() == starttime) {
-			return outdata[i];
-		}
+	auto it = m_measuretimes.find(starttime);
+	if (it != m_measuretimes.end()) {
+		return it->second;
 	}
 	// Did not find measure in data, so append to end of list.
 	// Assuming that unknown measures are at a later timestamp
 	// than those in current list, but should fix this later perhaps.
 	GridMeasure* gm = new GridMeasure(&outdata);
 	outdata.push_back(gm);
+	m_measuretimes[starttime] = gm;
 	return gm;
 }
 
@@ -21,13 +21,18 @@
 #include "Convert.h"
 #include "HumGrid.h"
 #include "HumRegex.h"
+#include "MxmlArchive.h"
 
 #include <string.h>
 #include <stdlib.h>
 
 #include <cctype>
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
 #include <regex>
+#include <thread>
 // #include <vector>
 
 using namespace std;
@@ -48,6 +53,9 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 	define("r|recip=b", "output **recip spine");
 	define("s|stems=b", "include stems in output");
+	define("batch=b", "convert files listed in input (or stdin) with JSON-lines report");
+	define("threads=i:0", "number of threads for batch conversion (0 = all cores)");
+	define("part-threads=i:0", "number of threads for parsing parts (0 = all cores)");
 
 	VoiceDebugQ = false;
 	DebugQ = false;
@@ -58,26 +66,22 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 //////////////////////////////
 //
 // Tool_musicxml2hum::convert -- Convert a MusicXML file into
-//     Humdrum content.
+//     Humdrum content.  Files and input streams are read incrementally
+//     with convertStream().
 //
 
 bool Tool_musicxml2hum::convertFile(ostream& out, const char* filename) {
-	xml_document doc;
-	auto result = doc.load_file(filename);
-	if (!result) {
-		cerr << "\nXML file [" << filename << "] has syntax errors\n";
-		cerr << "Error description:\t" << result.description() << "\n";
-		cerr << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+	ifstream input(filename, ios::in | ios::binary);
+	if (!input.is_open()) {
+		m_error_text << "\nCannot open XML file [" << filename << "]\n\n";
+		return false;
 	}
-
-	return convert(out, doc);
+	return convertStream(out, input);
 }
 
 
 bool Tool_musicxml2hum::convert(ostream& out, istream& input) {
-	string s(istreambuf_iterator<char>(input), {});
-	return convert(out, s.c_str());
+	return convertStream(out, input);
 }
 
 
@@ -99,26 +103,459 @@ bool Tool_musicxml2hum::convert(ostream& out, const char* input) {
 bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	initialize();
 
-	bool status = true; // for keeping track of problems in conversion process.
-
 	setSoftwareInfo(doc);
 	vector<string> partids;            // list of part IDs
 	map<string, xml_node> partinfo;    // mapping if IDs to score-part elements
 	map<string, xml_node> partcontent; // mapping of IDs to part elements
 
 	getPartInfo(partinfo, partids, doc);
+	getPartContent(partcontent, partids, doc);
+	vector<MxmlPart> partdata;
+	preparePartData(partdata, partids, partinfo);
+
+	fillPartData(partdata, partids, partinfo, partcontent);
+
+	return convertPartData(out, doc, partids, partinfo, partcontent, partdata);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertArchive -- Convert compressed MusicXML (.mxl)
+//     content.  The score named in META-INF/container.xml is decompressed
+//     into memory and parsed in place, without temporary files.
+//
+
+bool Tool_musicxml2hum::convertArchive(ostream& out, istream& input) {
+	MxmlArchive archive;
+	vector<char> content;
+	if (!archive.read(input) || !archive.getRootFile(content)) {
+		m_error_text << "\nCannot read compressed MusicXML content: "
+		             << archive.getError() << "\n\n";
+		return false;
+	}
+
+	xml_document doc;
+	auto result = doc.load_buffer_inplace(content.data(), content.size());
+	if (!result) {
+		m_error_text << "\nXML content has syntax errors\n";
+		m_error_text << "Error description:\t" << result.description() << "\n";
+		m_error_text << "Error offset:\t" << result.offset << "\n\n";
+		return false;
+	}
+	return convert(out, doc);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertStream -- Convert MusicXML content while
+//     reading it.  Only the <score-partwise> element's non-part children
+//     (identification, credits, part-list, etc.) are collected into a
+//     header document; each <measure> of a part is parsed as soon as its
+//     end tag is read, copied into a document for the part, and then added
+//     to the part data.  The full file text is never held in memory, and
+//     only one measure at a time is held as text or in a parse buffer.
+//     Input which is not UTF-8 <score-partwise> content is passed on to
+//     the document-based converter, and compressed MusicXML (.mxl) input
+//     is passed on to convertArchive().
+//
+
+bool Tool_musicxml2hum::convertStream(ostream& out, istream& input) {
+	streambuf* sb = input.rdbuf();
+	releaseFragments();
+	m_prolog.clear();
+
+	// UTF-16/32 input is not scanned (it would have a byte order mark
+	// or NUL bytes before the first markup character).
+	int c = sb->sgetc();
+	if (c == 'P') {
+		// "PK": ZIP archive (XML content cannot start with "P").
+		return convertArchive(out, input);
+	}
+	bool scannable = (c != EOF) && (c != 0) && (c != 0xfe) && (c != 0xff);
+
+	string markup;
+	string name;
+	string prefix;  // content before the root element
+	int type = mxml_eof;
+	while (scannable) {
+		type = readMarkup(sb, markup, name);
+		prefix += markup;
+		if ((type == mxml_eof) || (type == mxml_error) || (type == mxml_start)) {
+			break;
+		}
+		if ((type == mxml_other) && (markup.compare(0, 5, "<?xml") == 0)) {
+			m_prolog = markup;
+		}
+	}
+
+	if (!scannable || (type != mxml_start) || (name != "score-partwise")) {
+		// Timewise scores and unusual encodings are read into a document.
+		prefix.append(istreambuf_iterator<char>(sb), {});
+		xml_document doc;
+		auto result = doc.load_buffer(prefix.data(), prefix.size());
+		if (!result) {
+			m_error_text << "\nXML content has syntax errors\n";
+			m_error_text << "Error description:\t" << result.description() << "\n";
+			m_error_text << "Error offset:\t" << result.offset << "\n\n";
+			return false;
+		}
+		return convert(out, doc);
+	}
+
+	initialize();
+
+	string header = m_prolog + markup;
+	xml_document doc;
+	bool inheader = true;
+	vector<string> partids;
+	map<string, xml_node> partinfo;
+	map<string, xml_node> partcontent;
+	vector<MxmlPart> partdata;
+	vector<vector<xml_node>> partmeasures;
+	vector<bool> partfound;
+	int partindex = -1;
+	xml_node partnode;       // <part> element of the current part
+	xml_document measuredoc; // reused for parsing each measure
+	HumRegex hre;
+
+	while (true) {
+		type = readMarkup(sb, markup, name);
+		if (type == mxml_error) {
+			m_error_text << "Error: unterminated markup in MusicXML content" << endl;
+			return false;
+		}
+		bool rootend = (type == mxml_end) && (name == "score-partwise");
+		bool partstart = ((type == mxml_start) || (type == mxml_empty)) && (name == "part");
+
+		if (inheader && (partstart || rootend || (type == mxml_eof))) {
+			header += "</score-partwise>";
+			if (!parseFragment(doc, header, "header")) {
+				return false;
+			}
+			inheader = false;
+			setSoftwareInfo(doc);
+			getPartInfo(partinfo, partids, doc);
+			preparePartData(partdata, partids, partinfo);
+			for (int i=0; i<(int)partdata.size(); i++) {
+				preparePart(partdata[i], partinfo[partids[i]]);
+			}
+			partfound.resize(partids.size(), false);
+			partmeasures.resize(partids.size());
+		}
+
+		if (rootend || (type == mxml_eof)) {
+			break;
+		}
+		if (inheader) {
+			header += markup;
+			continue;
+		}
+
+		if (partstart) {
+			string partid;
+			if (hre.search(markup, "\\sid\\s*=\\s*[\"']([^\"']*)")) {
+				partid = hre.getMatch(1);
+			} else {
+				m_error_text << "Warning: Part " << partfound.size() << " has no ID" << endl;
+			}
+			auto it = find(partids.begin(), partids.end(), partid);
+			partindex = (int)(it - partids.begin());
+			if (it == partids.end()) {
+				m_error_text << "Error: Part ID " << partid
+				             << " is not present in part-list element list" << endl;
+				partindex = -1;
+			} else if (partfound[partindex]) {
+				m_error_text << "Error: ID " << partid
+				             << " is duplicated and secondary part will be ignored" << endl;
+				partindex = -1;
+			} else {
+				partfound[partindex] = true;
+			}
+			if (type == mxml_empty) {
+				partindex = -1;
+			}
+			if (partindex < 0) {
+				continue;
+			}
+			// Each part is collected into its own document, so that the
+			// measures are stored compactly after they are parsed.
+			xml_document* partdoc = new xml_document;
+			m_fragments.push_back(partdoc);
+			if (!parseFragment(*partdoc, m_prolog + markup + "</part>", "part " + partid)) {
+				return false;
+			}
+			partnode = partdoc->document_element();
+			partcontent[partid] = partnode;
+			continue;
+		}
+
+		if ((type == mxml_end) && (name == "part")) {
+			partindex = -1;
+			continue;
+		}
+
+		if (((type == mxml_start) || (type == mxml_empty)) && (name == "measure")) {
+			string text = m_prolog + markup;
+			if ((type == mxml_start) && !readElement(sb, text, name)) {
+				m_error_text << "Error: unterminated measure in MusicXML content" << endl;
+				return false;
+			}
+			if (partindex < 0) {
+				continue;
+			}
+			string description = "measure " + to_string(partmeasures[partindex].size() + 1)
+					+ " of part " + partids[partindex];
+			if (!parseFragment(measuredoc, text, description)) {
+				return false;
+			}
+			// Copy the measure into the part document; the memory of
+			// measuredoc is freed when the next measure is parsed.
+			xml_node measure = partnode.append_copy(measuredoc.document_element());
+			partmeasures[partindex].push_back(measure);
+		}
+	}
+
+	addPartMeasures(partdata, partmeasures);
+
+	for (int i=0; i<(int)partfound.size(); i++) {
+		if (!partfound[i]) {
+			m_error_text << "Error: part-list count does not match part count" << endl;
+			break;
+		}
+	}
+
+	return convertPartData(out, doc, partids, partinfo, partcontent, partdata);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::readMarkup -- Read the next markup item from the
+//     input: a start, end or empty element tag, a run of character data
+//     up to the next tag, or other markup (declarations, comments, CDATA
+//     and processing instructions).  The text of the item is returned in
+//     markup, and the element name for tags in name.
+//
+
+int Tool_musicxml2hum::readMarkup(streambuf* input, string& markup, string& name) {
+	markup.clear();
+	name.clear();
+
+	int c = input->sgetc();
+	if (c == EOF) {
+		return mxml_eof;
+	}
+	if (c != '<') {
+		while ((c != EOF) && (c != '<')) {
+			markup += (char)c;
+			c = input->snextc();
+		}
+		return mxml_text;
+	}
+
+	markup += (char)input->sbumpc();
+	c = input->sgetc();
+	if (c == '?') {
+		return readMarkupUntil(input, markup, "?>") ? mxml_other : mxml_error;
+	}
+
+	if (c == '!') {
+		markup += (char)input->sbumpc();
+		c = input->sgetc();
+		if (c == '-') {
+			return readMarkupUntil(input, markup, "-->") ? mxml_other : mxml_error;
+		}
+		if (c == '[') {
+			return readMarkupUntil(input, markup, "]]>") ? mxml_other : mxml_error;
+		}
+		// DOCTYPE, which may contain an internal subset in brackets.
+		int depth = 0;
+		char quote = '\0';
+		while ((c = input->sbumpc()) != EOF) {
+			markup += (char)c;
+			if (quote) {
+				if (c == quote) {
+					quote = '\0';
+				}
+			} else if ((c == '"') || (c == '\'')) {
+				quote = (char)c;
+			} else if (c == '[') {
+				depth++;
+			} else if (c == ']') {
+				depth--;
+			} else if ((c == '>') && (depth <= 0)) {
+				return mxml_other;
+			}
+		}
+		return mxml_error;
+	}
+
+	bool endtag = (c == '/');
+	char quote = '\0';
+	while ((c = input->sbumpc()) != EOF) {
+		markup += (char)c;
+		if (quote) {
+			if (c == quote) {
+				quote = '\0';
+			}
+		} else if ((c == '"') || (c == '\'')) {
+			quote = (char)c;
+		} else if (c == '>') {
+			break;
+		}
+	}
+	if (c == EOF) {
+		return mxml_error;
+	}
+
+	int start = endtag ? 2 : 1;
+	size_t end = markup.find_first_of(" \t\r\n/>", start);
+	name = markup.substr(start, end - start);
+	if (endtag) {
+		return mxml_end;
+	}
+	if (markup[markup.size() - 2] == '/') {
+		return mxml_empty;
+	}
+	return mxml_start;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::readMarkupUntil -- Append input characters to the
+//     markup until it ends with the given string.
+//
+
+bool Tool_musicxml2hum::readMarkupUntil(streambuf* input, string& markup,
+		const string& ending) {
+	int c;
+	size_t minsize = markup.size() + ending.size();
+	while ((c = input->sbumpc()) != EOF) {
+		markup += (char)c;
+		if ((c == ending.back()) && (markup.size() >= minsize) &&
+				(markup.compare(markup.size() - ending.size(), ending.size(), ending) == 0)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::readElement -- Append the content and end tag of an
+//     element whose start tag has already been read.
+//
+
+bool Tool_musicxml2hum::readElement(streambuf* input, string& text,
+		const string& name) {
+	string markup;
+	string tagname;
+	int depth = 1;
+	while (depth > 0) {
+		int type = readMarkup(input, markup, tagname);
+		if ((type == mxml_eof) || (type == mxml_error)) {
+			return false;
+		}
+		text += markup;
+		if (type == mxml_start) {
+			depth++;
+		} else if (type == mxml_end) {
+			depth--;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::parseFragment -- Parse a piece of streamed MusicXML
+//     content into a document, adding a description of any error to the
+//     error messages (see getError()).
+//
+
+bool Tool_musicxml2hum::parseFragment(xml_document& doc, const string& text,
+		const string& description) {
+	auto result = doc.load_buffer(text.data(), text.size());
+	if (!result) {
+		m_error_text << "\nXML content in " << description << " has syntax errors\n";
+		m_error_text << "Error description:\t" << result.description() << "\n";
+		m_error_text << "Error offset:\t" << result.offset << "\n\n";
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::releaseFragments -- Delete the documents of
+//     streamed parts.  Pending nodes which may point into them are
+//     also cleared.
+//
+
+void Tool_musicxml2hum::releaseFragments(void) {
+	for (int i=0; i<(int)m_fragments.size(); i++) {
+		delete m_fragments[i];
+	}
+	m_fragments.clear();
+	m_current_dynamic.clear();
+	m_current_brackets.clear();
+	m_used_hairpins.clear();
+	m_current_figured_bass.clear();
+	m_current_text.clear();
+	m_current_tempo.clear();
+	m_post_note_text.clear();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::preparePartData -- Allocate the part data and the
+//     per-part conversion state.
+//
+
+void Tool_musicxml2hum::preparePartData(vector<MxmlPart>& partdata,
+		const vector<string>& partids, map<string, xml_node>& partinfo) {
 	m_used_hairpins.resize(partinfo.size());
 
 	m_current_dynamic.resize(partids.size());
 	m_current_brackets.resize(partids.size());
 	m_stop_char.resize(partids.size(), "[");
 
-	getPartContent(partcontent, partids, doc);
-	vector<MxmlPart> partdata;
 	partdata.resize(partids.size());
 	m_last_ottava_direction.resize(partids.size());
+	for (int i=0; i<(int)partdata.size(); i++) {
+		partdata[i].setPartNumber(i+1);
+	}
+}
 
-	fillPartData(partdata, partids, partinfo, partcontent);
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertPartData -- Convert the filled part data
+//     into Humdrum content.  The doc only needs to contain the
+//     non-part children of <score-partwise>.
+//
+
+bool Tool_musicxml2hum::convertPartData(ostream& out, xml_document& doc,
+		vector<string>& partids, map<string, xml_node>& partinfo,
+		map<string, xml_node>& partcontent, vector<MxmlPart>& partdata) {
+
+	bool status = true; // for keeping track of problems in conversion process.
 
 	// for debugging:
 	//printPartInfo(partids, partinfo, partcontent, partdata);
@@ -126,7 +563,6 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	m_maxstaff = 0;
 	// check the voice info
 	for (int i=0; i<(int)partdata.size(); i++) {
-		partdata[i].prepareVoiceMapping();
 		m_maxstaff += partdata[i].getStaffCount();
 		// for debugging:
 		if (VoiceDebugQ) {
@@ -140,6 +576,9 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	HumGrid outdata;
 	status &= stitchParts(outdata, partids, partinfo, partcontent, partdata);
 
+	// The grid is filled, so streamed part documents are no longer needed.
+	releaseFragments();
+
 	if (outdata.size() > 2) {
 		if (outdata.at(0)->getDuration() == 0) {
 			while (!outdata.at(0)->empty()) {
@@ -206,6 +645,9 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	addHeaderRecords(outfile, doc);
 	addFooterRecords(outfile, doc);
 
+	// Link and analyze the grid output in memory for the tools below.
+	outfile.analyzeStructureFromTokens();
+
 	Tool_ruthfix ruthfix;
 	ruthfix.run(outfile);
 
@@ -234,15 +676,10 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 		argv.push_back("autobeam"); // name of program (placeholder)
 		argv.push_back("-g");       // beam adjacent grace notes
 		gracebeam.process(argv);
-		// Need to force a reparsing of the files contents to
-		// analyze strands.  For now just create a temporary
-		// Humdrum file to force the analysis of the strands.
-		stringstream sstream;
-		sstream << outfile;
-		HumdrumFile outfile2;
-		outfile2.readString(sstream.str());
-		gracebeam.run(outfile2);
-		outfile = outfile2;
+		// Need to reanalyze the file's contents to update strands
+		// after the tools above have edited the tokens.
+		outfile.analyzeStructureFromTokens();
+		gracebeam.run(outfile);
 	}
 
 	if (m_hasTransposition) {
@@ -255,8 +692,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 		if (transpose.hasHumdrumText()) {
 			stringstream ss;
 			transpose.getHumdrumText(ss);
-			outfile.readString(ss.str());
-			printResult(out, outfile);
+			printResult(out, outfile, ss);
 		}
 	} else {
 		for (int i=0; i<outfile.getLineCount(); i++) {
@@ -383,6 +819,45 @@ void Tool_musicxml2hum::printResult(ostream& out, HumdrumFile& outfile) {
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::printResult -- Print Humdrum text generated by a
+//      tool from outfile (such as transpose) with the same filtering,
+//      without parsing the text into another HumdrumFile.
+//
+
+void Tool_musicxml2hum::printResult(ostream& out, HumdrumFile& outfile,
+		istream& text) {
+	vector<HTp> kernspines = outfile.getKernSpineStartList();
+	string line;
+	while (getline(text, line)) {
+		if ((kernspines.size() > 1) || (line.compare(0, 1, "*") != 0)) {
+			out << line << "\n";
+			continue;
+		}
+		bool suppress = false;
+		size_t start = 0;
+		while (start <= line.size()) {
+			size_t end = line.find('\t', start);
+			if (end == string::npos) {
+				end = line.size();
+			}
+			string token = line.substr(start, end - start);
+			if ((token == "*I\"Piano") || (token == "*I'Pno.") ||
+					(token == "*staff1") || (token == "*part1")) {
+				suppress = true;
+				break;
+			}
+			start = end + 1;
+		}
+		if (!suppress) {
+			out << line << "\n";
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::printRdfs --
@@ -662,6 +1137,10 @@ void Tool_musicxml2hum::addFooterRecords(HumdrumFile& outfile, xml_document& doc
 void Tool_musicxml2hum::initialize(void) {
 	m_recipQ = getBoolean("recip");
 	m_stemsQ = getBoolean("stems");
+	m_partthreads = getInteger("part-threads");
+	if (m_partthreads <= 0) {
+		m_partthreads = (int)std::thread::hardware_concurrency();
+	}
 	m_hasOrnamentsQ = false;
 }
 
@@ -839,18 +1318,27 @@ bool Tool_musicxml2hum::fillPartData(vector<MxmlPart>& partdata,
 		const vector<string>& partids, map<string, xml_node>& partinfo,
 		map<string, xml_node>& partcontent) {
 
-	bool output = true;
+	vector<vector<xml_node>> partmeasures(partinfo.size());
 	for (int i=0; i<(int)partinfo.size(); i++) {
 		partdata[i].setPartNumber(i+1);
-		output &= fillPartData(partdata[i], partids[i], partinfo[partids[i]],
-				partcontent[partids[i]]);
+		preparePart(partdata[i], partinfo[partids[i]]);
+		for (xml_node measure : partcontent[partids[i]].children("measure")) {
+			partmeasures[i].push_back(measure);
+		}
 	}
-	return output;
+	addPartMeasures(partdata, partmeasures);
+	return true;
 }
 
 
-bool Tool_musicxml2hum::fillPartData(MxmlPart& partdata,
-		const string& id, xml_node partdeclaration, xml_node partcontent) {
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::preparePart -- Read the <score-part> declaration
+//     of a part before its measures are added.
+//
+
+void Tool_musicxml2hum::preparePart(MxmlPart& partdata, xml_node partdeclaration) {
 	if (m_stemsQ) {
 		partdata.enableStems();
 	}
@@ -860,25 +1348,82 @@ bool Tool_musicxml2hum::fillPartData(MxmlPart& partdata,
 	// staff count is incorrect at this point? Just assume 32 staves in the part, which should
 	// be 28-30 staffs too many.
 	m_last_ottava_direction.at(partdata.getPartIndex()).resize(32);
+}
 
-	int count;
-	auto measures = partcontent.select_nodes("./measure");
-	for (int i=0; i<(int)measures.size(); i++) {
-		partdata.addMeasure(measures[i].node());
-		count = partdata.getMeasureCount();
-		if (count > 1) {
-			HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
-			if (dur == 0) {
-				HumNum dur = partdata.getMeasure(count-2)
-						->getTimeSigDur();
-				if (dur > 0) {
-					partdata.getMeasure(count - 1)->setTimeSigDur(dur);
-				}
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::addPartMeasure -- Add the next <measure> of a part.
+//
+
+void Tool_musicxml2hum::addPartMeasure(MxmlPart& partdata, xml_node measure) {
+	partdata.addMeasure(measure);
+	int count = partdata.getMeasureCount();
+	if (count > 1) {
+		HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
+		if (dur == 0) {
+			HumNum dur = partdata.getMeasure(count-2)
+					->getTimeSigDur();
+			if (dur > 0) {
+				partdata.getMeasure(count - 1)->setTimeSigDur(dur);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::addPartMeasures -- Add the measures of each part and
+//     prepare the part's voice mapping.  Parts are independent of each
+//     other until they are merged in stitchParts(), so they are filled on
+//     up to m_partthreads threads.  Each part is filled by a single thread,
+//     so the result does not depend on the number of threads.
+//
+
+void Tool_musicxml2hum::addPartMeasures(vector<MxmlPart>& partdata,
+		vector<vector<xml_node>>& partmeasures) {
+	int partcount = (int)partdata.size();
+	vector<std::exception_ptr> errors(partcount);
+	auto fillPart = [&](int index) {
+		try {
+			for (xml_node measure : partmeasures[index]) {
+				addPartMeasure(partdata[index], measure);
 			}
+			partdata[index].prepareVoiceMapping();
+		} catch (...) {
+			errors[index] = std::current_exception();
 		}
+	};
 
+	int threadcount = std::min(m_partthreads, partcount);
+	if (threadcount <= 1) {
+		for (int i=0; i<partcount; i++) {
+			fillPart(i);
+		}
+	} else {
+		std::atomic<int> next(0);
+		vector<std::thread> workers;
+		for (int i=0; i<threadcount; i++) {
+			workers.emplace_back([&]() {
+				int index;
+				while ((index = next++) < partcount) {
+					fillPart(index);
+				}
+			});
+		}
+		for (int i=0; i<(int)workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	for (int i=0; i<partcount; i++) {
+		if (errors[i]) {
+			std::rethrow_exception(errors[i]);
+		}
 	}
-	return true;
 }
 
 
@@ -1645,7 +2190,9 @@ void Tool_musicxml2hum::addEvent(GridSlice* slice, GridMeasure* outdata, MxmlEve
 	if (!event->isFloating()) {
 		recip     = event->getRecip();
 		HumRegex hre;
-		if (hre.search(recip, "(\\d+)%(\\d+)(\\.*)")) {
+		// Rational rhythms are rare, so avoid compiling the regex for each note.
+		if ((recip.find('%') != string::npos) &&
+				hre.search(recip, "(\\d+)%(\\d+)(\\.*)")) {
 			int first = hre.getMatchInt(1);
 			int second = hre.getMatchInt(2);
 			string dots = hre.getMatch(3);
@@ -1554,76 +1554,46 @@ void Tool_myank::printEnding(HumdrumFile& infile, int lastline, int adjlin) {
 // Tool_myank::getMeasureStartStop --  Get a list of the (numbered) measures in the
 //    input file, and store the start/stop lines for those measures.
 //    All data before the first numbered measure is in measure 0.
-//    although, if the first measure is not labeled, then ...
+//    Unnumbered barlines do not start a new measure, so their contents
+//    are included in the previous numbered measure.
 //
 
 void Tool_myank::getMeasureStartStop(vector<MeasureInfo>& measurelist, HumdrumFile& infile) {
 	measurelist.reserve(infile.getLineCount());
 	measurelist.resize(0);
 
-	MeasureInfo current;
-	int i, ii;
-	int lastend = -1;
-	int dataend = -1;
-	int barnum1 = -1;
-	int barnum2 = -1;
-	HumRegex hre;
-
 	insertZerothMeasure(measurelist, infile);
 
-	for (i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isInterpretation()) {
-			if (*infile.token(i, 0) == "*-") {
-				dataend = i;
-				break;
-			}
-		}
-		if (!infile[i].isBarline()) {
+	if (!infile.isRhythmAnalyzed()) {
+		infile.analyzeRhythmStructure();
+	}
+	MeasureInfo current;
+	bool openQ = false;
+	vector<HumMeasureInfo> measures = infile.getMeasures();
+	for (int i=0; i<(int)measures.size(); i++) {
+		if (measures[i].m_number < 0) {
+			// pickup measure or unnumbered barline
 			continue;
 		}
-		//if (!hre.search(infile.token(i, 0), "^=.*(\\d+)")) {
-		//   continue;
-		//}
-		//barnum1 = stoi(hre.getMatch(1));
-		if (!sscanf(infile.token(i, 0)->c_str(), "=%d", &barnum1)) {
-			continue;
+		if (openQ) {
+			current.stop = measures[i].m_startline;
+			measurelist.push_back(current);
 		}
 		current.clear();
-		current.start = i;
-		current.num   = barnum1;
-		for (ii=i+1; ii<infile.getLineCount(); ii++) {
-			if (!infile[ii].isBarline()) {
-				continue;
-			}
-			//if (hre.search(infile.token(ii, 0), "^=.*(\\d+)")) {
-			//   barnum2 = stoi(hre.getMatch(1));
-			//   current.stop = ii;
-			//   lastend = ii;
-			//   i = ii - 1;
-			//   measurelist.push_back(current);
-			//   break;
-			//}
-			if (hre.search(infile.token(ii, 0), "=[^\\d]*(\\d+)")) {
-			// if (sscanf(infile.token(ii, 0), "=%d", &barnum2)) {
-				barnum2 = stoi(hre.getMatch(1));
-				current.stop = ii;
-				lastend = ii;
-				i = ii - 1;
-				current.file = &infile;
-				measurelist.push_back(current);
-				break;
-			} else {
-				if (atEndOfFile(infile, ii)) {
-					break;
-				}
-			}
-		}
+		current.num = measures[i].m_number;
+		current.start = measures[i].m_startline;
+		current.file = &infile;
+		openQ = true;
+	}
+	if (!openQ) {
+		return;
 	}
 
+	int dataend     = -1;   // line of the spine terminators
 	int lastdata    = -1;   // last line in file with data
 	int lastmeasure = -1;   // last line in file with measure
 
-	for (i=infile.getLineCount()-1; i>=0; i--) {
+	for (int i=infile.getLineCount()-1; i>=0; i--) {
 		if ((lastdata < 0) && infile[i].isData()) {
 			lastdata = i;
 		}
@@ -1634,26 +1604,23 @@ void Tool_myank::getMeasureStartStop(vector<MeasureInfo>& measurelist, HumdrumFi
 			break;
 		}
 	}
-
-	if (lastmeasure < lastdata) {
-		// no final barline, so set to ignore
-		lastmeasure = -1;
-		lastdata    = -1;
-	}
-
-	if ((barnum2 >= 0) && (lastend >= 0) && (dataend >= 0)) {
-		current.clear();
-		current.num = barnum2;
-		current.start = lastend;
-		current.stop = dataend;
-		if (lastmeasure > lastdata) {
-			current.stop = lastmeasure;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isInterpretation() && (*infile.token(i, 0) == "*-")) {
+			dataend = i;
+			break;
 		}
-		current.file = &infile;
-		measurelist.push_back(current);
+	}
+	if (dataend < 0) {
+		return;
 	}
 
-
+	// The last measure ends at the final barline, or at the spine
+	// terminators if there is no barline after the last data.
+	current.stop = dataend;
+	if (lastmeasure > lastdata) {
+		current.stop = lastmeasure;
+	}
+	measurelist.push_back(current);
 }
 
 
@@ -89,12 +89,9 @@ void Tool_ruthfix::insertCrossBarTies(HumdrumFile& infile) {
 	int scount = infile.getStrandCount();
 	if (scount == 0) {
 		// The input file was not read from a file but was created
-		// dynamically.  The easiest thing to do is to reload to get the
-		// spine/strand information.
-		stringstream ss;
-		infile.createLinesFromTokens();
-		ss << infile;
-		infile.readString(ss.str());
+		// dynamically, so analyze its tokens to get the spine/strand
+		// information.
+		infile.analyzeStructureFromTokens();
 	}
 	scount = infile.getStrandCount();
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Jul 15 09:57:12 CEST 2018
-// Last Modified: Sun Jul 15 09:57:16 CEST 2018
+// Last Modified: Fri Oct 16 19:30:12 UTC 2026
 // Filename:      tool-simat.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-simat.cpp
 // Syntax:        C++11; humlib
@@ -13,7 +13,10 @@
 #include "tool-simat.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <sstream>
+#include <thread>
 
 #include "Convert.h"
 #include "HumRegex.h"
@@ -39,6 +42,8 @@ MeasureData::MeasureData(void) {
 
 
 MeasureData::MeasureData(HumdrumFile& infile, int startline, int stopline) {
+	m_hist7pc.resize(7);
+	std::fill(m_hist7pc.begin(), m_hist7pc.end(), 0.0);
 	setStartLine(startline);
 	setStopLine(stopline);
 	setOwner(infile);
@@ -46,6 +51,8 @@ MeasureData::MeasureData(HumdrumFile& infile, int startline, int stopline) {
 
 
 MeasureData::MeasureData(HumdrumFile* infile, int startline, int stopline) {
+	m_hist7pc.resize(7);
+	std::fill(m_hist7pc.begin(), m_hist7pc.end(), 0.0);
 	setStartLine(startline);
 	setStopLine(stopline);
 	setOwner(infile);
@@ -407,6 +414,7 @@ void MeasureDataSet::clear(void) {
 //
 
 int MeasureDataSet::parse(HumdrumFile& infile) {
+	clear();
 	int lastbar = 0;
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isBarline()) {
@@ -577,7 +585,48 @@ MeasureComparisonGrid::~MeasureComparisonGrid() {
 //
 
 void MeasureComparisonGrid::clear(void) {
+	m_matrix1.clear();
+	m_matrix2.clear();
+	m_state1.clear();
+	m_state2.clear();
 	m_grid.clear();
+	m_sparse.clear();
+	m_rows = 0;
+	m_cols = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::setThreadCount -- Number of threads used to
+//     calculate the grid.  A value less than one will use the number
+//     of hardware threads available.
+//
+
+void MeasureComparisonGrid::setThreadCount(int count) {
+	if (count < 1) {
+		count = (int)std::thread::hardware_concurrency();
+	}
+	if (count < 1) {
+		count = 1;
+	}
+	m_threads = count;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::setTopK -- Only store the best k matches for
+//     each measure of the first set.  Zero means store the full grid.
+//
+
+void MeasureComparisonGrid::setTopK(int count) {
+	if (count < 0) {
+		count = 0;
+	}
+	m_topk = count;
 }
 
 
@@ -592,17 +641,305 @@ void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2)
 }
 
 void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2) {
-	m_grid.resize(set1.size());
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		m_grid[i].resize(set2.size());
+	clear();
+	m_set1 = &set1;
+	m_set2 = &set2;
+	m_rows = set1.size();
+	m_cols = set2.size();
+	packHistograms(set1, m_matrix1, m_state1);
+	packHistograms(set2, m_matrix2, m_state2);
+
+	if (m_topk > 0) {
+		m_sparse.resize(m_rows);
+	} else {
+		m_grid.resize((size_t)m_rows * m_cols);
+	}
+
+	int threadcount = m_threads;
+	int blockcount = (m_rows + SIMAT_ROWBLOCK - 1) / SIMAT_ROWBLOCK;
+	if (threadcount > blockcount) {
+		threadcount = blockcount;
+	}
+	if (threadcount <= 1) {
+		correlateRows(0, m_rows);
+		return;
 	}
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			m_grid[i][j].compare(set1[i], set2[j]);
+
+	// Split the grid into contiguous bands of row blocks, one per thread.
+	// Each thread writes to its own rows only, so no locking is needed.
+	vector<std::thread> workers;
+	workers.reserve(threadcount);
+	int blocksperthread = (blockcount + threadcount - 1) / threadcount;
+	for (int t=0; t<threadcount; t++) {
+		int startrow = t * blocksperthread * SIMAT_ROWBLOCK;
+		int endrow = std::min(m_rows, startrow + blocksperthread * SIMAT_ROWBLOCK);
+		if (startrow >= endrow) {
+			break;
 		}
+		workers.emplace_back(&MeasureComparisonGrid::correlateRows, this, startrow, endrow);
+	}
+	for (int t=0; t<(int)workers.size(); t++) {
+		workers[t].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::packHistograms -- Store the pitch-class histograms
+//     of a measure set in a contiguous matrix with SIMAT_STRIDE values per
+//     row.  Each row is mean-centered and scaled to unit length so that
+//     the Pearson correlation between two rows is their dot product.  The
+//     state array records rows which need special handling:
+//        0 = normal row
+//        1 = measure contains no notes
+//        2 = histogram is flat (zero variance)
+//
+
+void MeasureComparisonGrid::packHistograms(MeasureDataSet& set,
+		vector<double>& matrix, vector<char>& state) {
+	int rows = set.size();
+	matrix.assign((size_t)rows * SIMAT_STRIDE, 0.0);
+	state.assign(rows, 0);
+	for (int i=0; i<rows; i++) {
+		if (set[i].getSum7pc() == 0.0) {
+			state[i] = 1;
+			continue;
+		}
+		vector<double>& hist = set[i].getHistogram7pc();
+		double* row = matrix.data() + (size_t)i * SIMAT_STRIDE;
+		double mean = 0.0;
+		for (int k=0; k<7; k++) {
+			mean += hist[k];
+		}
+		mean /= 7.0;
+		double norm = 0.0;
+		for (int k=0; k<7; k++) {
+			row[k] = hist[k] - mean;
+			norm += row[k] * row[k];
+		}
+		if (norm == 0.0) {
+			state[i] = 2;
+			continue;
+		}
+		norm = 1.0 / sqrt(norm);
+		for (int k=0; k<7; k++) {
+			row[k] *= norm;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::correlateRows -- Calculate the correlations for
+//     a range of rows in the grid.  Rows are processed in blocks of
+//     SIMAT_ROWBLOCK against blocks of SIMAT_COLBLOCK columns so that both
+//     operands stay in cache, and the inner loop runs over a fixed stride
+//     that the compiler can vectorize.
+//
+
+void MeasureComparisonGrid::correlateRows(int startrow, int endrow) {
+	vector<double> scratch((size_t)SIMAT_ROWBLOCK * m_cols);
+	const double* matrix1 = m_matrix1.data();
+	const double* matrix2 = m_matrix2.data();
+
+	for (int r0=startrow; r0<endrow; r0+=SIMAT_ROWBLOCK) {
+		int r1 = std::min(endrow, r0 + SIMAT_ROWBLOCK);
+		for (int c0=0; c0<m_cols; c0+=SIMAT_COLBLOCK) {
+			int c1 = std::min(m_cols, c0 + SIMAT_COLBLOCK);
+			for (int i=r0; i<r1; i++) {
+				const double* a = matrix1 + (size_t)i * SIMAT_STRIDE;
+				double* out = scratch.data() + (size_t)(i - r0) * m_cols;
+				for (int j=c0; j<c1; j++) {
+					const double* b = matrix2 + (size_t)j * SIMAT_STRIDE;
+					double sum = 0.0;
+					for (int k=0; k<SIMAT_STRIDE; k++) {
+						sum += a[k] * b[k];
+					}
+					out[j] = sum;
+				}
+			}
+		}
+		for (int i=r0; i<r1; i++) {
+			storeRow(i, scratch.data() + (size_t)(i - r0) * m_cols);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::storeRow -- Apply the special cases for empty
+//     and flat histograms, then store the row into the dense grid or
+//     keep the best matches for the row.
+//
+
+void MeasureComparisonGrid::storeRow(int row, const double* values) {
+	vector<double> correlations(values, values + m_cols);
+	for (int j=0; j<m_cols; j++) {
+		double& value = correlations[j];
+		if (m_state1[row] || m_state2[j]) {
+			if ((m_state1[row] == 1) && (m_state2[j] == 1)) {
+				value = 1.0;
+			} else {
+				value = 0.0;
+			}
+		} else if (fabs(value - 1.0) < 0.00000001) {
+			value = 1.0;
+		}
+	}
+
+	if (m_topk == 0) {
+		std::copy(correlations.begin(), correlations.end(),
+				m_grid.begin() + (size_t)row * m_cols);
+		return;
+	}
+
+	vector<pair<int, double>>& best = m_sparse[row];
+	best.resize(m_cols);
+	for (int j=0; j<m_cols; j++) {
+		best[j] = std::make_pair(j, correlations[j]);
+	}
+	auto higher = [](const pair<int, double>& a, const pair<int, double>& b) {
+		if (a.second != b.second) {
+			return a.second > b.second;
+		}
+		return a.first < b.first;
+	};
+	if (m_topk < m_cols) {
+		std::nth_element(best.begin(), best.begin() + m_topk, best.end(), higher);
+		best.resize(m_topk);
+	}
+	std::sort(best.begin(), best.end(),
+			[](const pair<int, double>& a, const pair<int, double>& b) {
+				return a.first < b.first;
+			});
+	best.shrink_to_fit();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::hasCorrelation -- Returns false if the cell
+//     was not kept when storing only the best matches.
+//
+
+bool MeasureComparisonGrid::hasCorrelation(int i, int j) {
+	if ((i < 0) || (j < 0) || (i >= m_rows) || (j >= m_cols)) {
+		return false;
+	}
+	if (m_topk == 0) {
+		return true;
+	}
+	const vector<pair<int, double>>& best = m_sparse[i];
+	auto it = std::lower_bound(best.begin(), best.end(), j,
+			[](const pair<int, double>& a, int value) { return a.first < value; });
+	return (it != best.end()) && (it->first == j);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getCorrelation7pc -- Return the pitch-class
+//     correlation between measure i of the first set and measure j of
+//     the second set.  Cells not kept in top-k mode return 0.0.
+//
+
+double MeasureComparisonGrid::getCorrelation7pc(int i, int j) {
+	if ((i < 0) || (j < 0) || (i >= m_rows) || (j >= m_cols)) {
+		return 0.0;
+	}
+	if (m_topk == 0) {
+		return m_grid[(size_t)i * m_cols + j];
+	}
+	const vector<pair<int, double>>& best = m_sparse[i];
+	auto it = std::lower_bound(best.begin(), best.end(), j,
+			[](const pair<int, double>& a, int value) { return a.first < value; });
+	if ((it != best.end()) && (it->first == j)) {
+		return it->second;
+	}
+	return 0.0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::getBestMatchScore -- Return the average of the
+//     best correlation found for each measure, taken in both directions
+//     (rows and columns of the grid).  Measures without notes are ignored.
+//     Cells not kept in top-k mode are not considered.
+//
+
+double MeasureComparisonGrid::getBestMatchScore(void) {
+	vector<double> rowbest(m_rows, -1.0);
+	vector<double> colbest(m_cols, -1.0);
+	if (m_topk == 0) {
+		for (int i=0; i<m_rows; i++) {
+			const double* row = m_grid.data() + (size_t)i * m_cols;
+			for (int j=0; j<m_cols; j++) {
+				rowbest[i] = std::max(rowbest[i], row[j]);
+				colbest[j] = std::max(colbest[j], row[j]);
+			}
+		}
+	} else {
+		for (int i=0; i<m_rows; i++) {
+			for (auto& cell : m_sparse[i]) {
+				rowbest[i] = std::max(rowbest[i], cell.second);
+				colbest[cell.first] = std::max(colbest[cell.first], cell.second);
+			}
+		}
+	}
+
+	double rowsum = 0.0;
+	int rowcount = 0;
+	for (int i=0; i<m_rows; i++) {
+		if (m_state1[i] == 1) {
+			continue;
+		}
+		rowsum += rowbest[i];
+		rowcount++;
+	}
+	double colsum = 0.0;
+	int colcount = 0;
+	for (int j=0; j<m_cols; j++) {
+		if (m_state2[j] == 1) {
+			continue;
+		}
+		colsum += colbest[j];
+		colcount++;
+	}
+	if ((rowcount == 0) || (colcount == 0)) {
+		return 0.0;
+	}
+	return (rowsum / rowcount + colsum / colcount) / 2.0;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::printCorrelation -- Print a grid cell rounded
+//     to two decimal places, or "." if the cell was not kept.
+//
+
+void MeasureComparisonGrid::printCorrelation(ostream& out, int i, int j) {
+	if (!hasCorrelation(i, j)) {
+		out << '.';
+		return;
+	}
+	double correl = getCorrelation7pc(i, j);
+	if (correl > 0.0) {
+		out << int(correl * 100.0 + 0.5)/100.0;
+	} else {
+		out << -int(-correl * 100.0 + 0.5)/100.0;
 	}
-	m_set1 = &set1;
-	m_set2 = &set2;
 }
 
 
@@ -614,15 +951,10 @@ void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2)
 //
 
 ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			printCorrelation(out, i, j);
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -640,18 +972,10 @@ ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
 //
 
 ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			if (i != j) {
-				continue;
-			}
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		if (i < m_cols) {
+			printCorrelation(out, i, i);
+			if (i < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -949,15 +1273,18 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 	double sdur1 = getScoreDuration1();
 	double sdur2 = getScoreDuration2();
 
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			if (!hasCorrelation(i, j)) {
+				continue;
+			}
 			width = getDuration2(j) / sdur2 * imagewidth;
 			height = getDuration1(i) / sdur1 * imageheight;
 
 			x = getStartTime2(j)/sdur2 * imageheight;
 			y = getStartTime1(i)/sdur1 * imagewidth;
 
-			getColorMapping(m_grid[i][j].getCorrelation7pc(), hue, saturation, lightness);
+			getColorMapping(getCorrelation7pc(i, j), hue, saturation, lightness);
 			ss << "hsl(" << hue << "," << saturation << "%," << lightness << "%)";
 			crect = grid.append_child("rect");
 			crect.append_attribute("x") = to_string(x).c_str();
@@ -990,6 +1317,11 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 Tool_simat::Tool_simat(void) {
 	define("r|raw=b", "output raw correlation matrix");
 	define("d|diagonal=b", "output diagonal of correlation matrix");
+	define("k|top=i:0",    "only keep the best k matches for each measure");
+	define("threads=i:0",  "number of threads for grid calculation (0 = all cores)");
+	define("c|corpus=b",   "compare all input files with each other");
+	define("p|prune=d:0.5", "minimum global pitch-class correlation for comparing files in corpus mode");
+	define("n|count=i:0",  "number of ranked pairs to report in corpus mode (0 = all)");
 }
 
 
@@ -1001,7 +1333,9 @@ Tool_simat::Tool_simat(void) {
 
 bool Tool_simat::run(HumdrumFileSet& infiles) {
 	bool status = true;
-	if (infiles.getCount() == 1) {
+	if (getBoolean("corpus")) {
+		processCorpus(infiles);
+	} else if (infiles.getCount() == 1) {
 		status = run(infiles[0], infiles[0]);
 	} else if (infiles.getCount() > 1) {
 		status = run(infiles[0], infiles[1]);
@@ -1072,6 +1406,8 @@ bool Tool_simat::run(HumdrumFile& infile1, HumdrumFile& infile2) {
 void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 	m_data1.parse(infile1);
 	m_data2.parse(infile2);
+	m_grid.setThreadCount(getInteger("threads"));
+	m_grid.setTopK(getInteger("top"));
 	m_grid.analyze(m_data1, m_data2);
 	if (getBoolean("raw")) {
 		m_grid.printCorrelationGrid(m_free_text);
@@ -1087,6 +1423,202 @@ void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
 
 
 
+//////////////////////////////
+//
+// Tool_simat::processCorpus -- Compare every file in the set with every
+//     other file.  The measure histograms of each file are calculated
+//     once, and a global pitch-class sketch for each file is used to
+//     skip pairs of files that are unlikely to be related.  Files
+//     without a sketch (no notes, or all pitch classes equally common)
+//     cannot be pruned this way, so all of their pairs are kept.  The
+//     full measure comparison grid is calculated only for the candidate
+//     pairs, and pairs are reported in order of similarity.
+//
+
+void Tool_simat::processCorpus(HumdrumFileSet& infiles) {
+	int count = infiles.getCount();
+	vector<MeasureDataSet*> sets(count, NULL);
+	vector<vector<double>> sketches(count);
+	vector<bool> flat(count, false);
+	for (int i=0; i<count; i++) {
+		sets[i] = new MeasureDataSet(infiles[i]);
+		flat[i] = !createSketch(*sets[i], sketches[i]);
+	}
+
+	double threshold = getDouble("prune");
+	vector<pair<int, int>> candidates;
+	vector<double> sketchscores;
+	for (int i=0; i<count; i++) {
+		for (int j=i+1; j<count; j++) {
+			double score = 0.0;
+			for (int k=0; k<SIMAT_STRIDE; k++) {
+				score += sketches[i][k] * sketches[j][k];
+			}
+			if ((score < threshold) && !flat[i] && !flat[j]) {
+				continue;
+			}
+			candidates.emplace_back(i, j);
+			sketchscores.push_back(score);
+		}
+	}
+
+	vector<double> scores;
+	compareCandidates(sets, candidates, scores);
+	printCorpusResults(infiles, candidates, sketchscores, scores, flat);
+	suppressHumdrumFileOutput();
+
+	for (int i=0; i<count; i++) {
+		delete sets[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_simat::createSketch -- Sum the measure histograms of a file into
+//     a global pitch-class histogram, which is then mean-centered and
+//     scaled to unit length (so that the dot product of two sketches is
+//     their correlation).  Returns false if the histogram is flat (such
+//     as for a file without notes), in which case the sketch is all zeros.
+//
+
+bool Tool_simat::createSketch(MeasureDataSet& set, vector<double>& sketch) {
+	sketch.assign(SIMAT_STRIDE, 0.0);
+	for (int i=0; i<set.size(); i++) {
+		vector<double>& hist = set[i].getHistogram7pc();
+		for (int k=0; k<7; k++) {
+			sketch[k] += hist[k];
+		}
+	}
+	double mean = 0.0;
+	for (int k=0; k<7; k++) {
+		mean += sketch[k];
+	}
+	mean /= 7.0;
+	double norm = 0.0;
+	for (int k=0; k<7; k++) {
+		sketch[k] -= mean;
+		norm += sketch[k] * sketch[k];
+	}
+	if (norm == 0.0) {
+		return false;
+	}
+	norm = 1.0 / sqrt(norm);
+	for (int k=0; k<7; k++) {
+		sketch[k] *= norm;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_simat::compareCandidates -- Calculate the measure comparison grid
+//     for each candidate pair of files, returning the best-match score of
+//     each grid.  Pairs are distributed dynamically over the worker threads,
+//     and each grid is calculated single-threaded.
+//
+
+void Tool_simat::compareCandidates(vector<MeasureDataSet*>& sets,
+		vector<pair<int, int>>& candidates, vector<double>& scores) {
+	scores.assign(candidates.size(), 0.0);
+	int topk = getInteger("top");
+	std::atomic<int> next(0);
+
+	auto worker = [&]() {
+		MeasureComparisonGrid grid;
+		grid.setThreadCount(1);
+		grid.setTopK(topk);
+		while (true) {
+			int index = next++;
+			if (index >= (int)candidates.size()) {
+				break;
+			}
+			grid.analyze(sets[candidates[index].first], sets[candidates[index].second]);
+			scores[index] = grid.getBestMatchScore();
+		}
+	};
+
+	int threadcount = getInteger("threads");
+	if (threadcount < 1) {
+		threadcount = (int)std::thread::hardware_concurrency();
+	}
+	if (threadcount > (int)candidates.size()) {
+		threadcount = (int)candidates.size();
+	}
+	if (threadcount <= 1) {
+		worker();
+		return;
+	}
+	vector<std::thread> workers;
+	for (int t=0; t<threadcount; t++) {
+		workers.emplace_back(worker);
+	}
+	for (int t=0; t<threadcount; t++) {
+		workers[t].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_simat::printCorpusResults -- Print the compared pairs of files as
+//     Humdrum data, sorted from most to least similar.  Files without a
+//     sketch are listed in the header, and the sketch score of their
+//     pairs is null.
+//
+
+void Tool_simat::printCorpusResults(HumdrumFileSet& infiles,
+		vector<pair<int, int>>& candidates, vector<double>& sketchscores,
+		vector<double>& scores, vector<bool>& flat) {
+	vector<int> order(candidates.size());
+	for (int i=0; i<(int)order.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+			[&](int a, int b) { return scores[a] > scores[b]; });
+	int maxcount = getInteger("count");
+	if ((maxcount > 0) && (maxcount < (int)order.size())) {
+		order.resize(maxcount);
+	}
+
+	auto getName = [&](int index) {
+		string name = infiles[index].getFilename();
+		if (name.empty()) {
+			name = "#" + to_string(index + 1);
+		}
+		return name;
+	};
+
+	m_free_text << "!!!files: " << infiles.getCount() << endl;
+	m_free_text << "!!!candidates: " << candidates.size() << endl;
+	for (int i=0; i<(int)flat.size(); i++) {
+		if (flat[i]) {
+			m_free_text << "!!!flat-sketch: " << getName(i) << endl;
+		}
+	}
+	m_free_text << "**score\t**sketch\t**file1\t**file2" << endl;
+	for (int i=0; i<(int)order.size(); i++) {
+		int index = order[i];
+		m_free_text << std::round(scores[index] * 1000.0) / 1000.0;
+		m_free_text << '\t';
+		if (flat[candidates[index].first] || flat[candidates[index].second]) {
+			m_free_text << '.';
+		} else {
+			m_free_text << std::round(sketchscores[index] * 1000.0) / 1000.0;
+		}
+		m_free_text << '\t' << getName(candidates[index].first);
+		m_free_text << '\t' << getName(candidates[index].second);
+		m_free_text << endl;
+	}
+	m_free_text << "*-\t*-\t*-\t*-" << endl;
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
@@ -11,6 +11,7 @@
 // Last Modified: Mon Dec  5 23:28:50 PST 2016 Ported to humlib from humextras
 // Last Modified: Wed May 16 22:47:11 PDT 2018 Added **mxhm transposition
 // Last Modified: Thu Jun 14 15:30:53 PDT 2018 Added rest position transposition
+// Last Modified: Fri Oct 16 23:55:00 UTC 2026 Table-driven pitch transposition
 // Filename:      tool-transpose.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-transpose.cpp
 // Syntax:        C++11; humlib; humlib
@@ -35,6 +36,12 @@ namespace hum {
 #define STYLE_CONCERT 0
 #define STYLE_WRITTEN 1
 
+// Types of pitch parsing for **kern subtokens:
+#define TRANSPOSE_ECHO  0  /* no pitch to transpose              */
+#define TRANSPOSE_NOTE  1  /* transpose pitch                    */
+#define TRANSPOSE_REST  2  /* transpose vertical position of rest */
+#define TRANSPOSE_OTHER 3  /* irregular pitch: use printNewKernString() */
+
 /////////////////////////////////
 //
 // Tool_transpose::Tool_transpose -- Set the recognized options for the tool.
@@ -134,15 +141,7 @@ bool Tool_transpose::run(HumdrumFile& infile) {
 		doAutoTransposeAnalysis(infile);
 	} else {
 		vector<bool> spineprocess;
-		infile.makeBooleanTrackList(spineprocess, spinestring);
-		// filter out non-kern spines so they are not analyzed.
-		// but now also allowing for *mxhm spines (musicxml harmony)
-		for (int t=1; t<=infile.getMaxTrack(); t++) {
-			if (!(infile.getTrackStart(t)->isKern() ||
-					infile.getTrackStart(t)->isDataType("mxhm"))) {
-				spineprocess[t] = false;
-			}
-		}
+		getSpineProcess(infile, spineprocess);
 		processFile(infile, spineprocess);
 	}
 
@@ -151,6 +150,84 @@ bool Tool_transpose::run(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_transpose::transposeToIntervals -- Transpose the file by each
+//    of the given base-40 intervals, storing the Humdrum text of each
+//    transposition in outputs.  The pitches in the file are parsed only
+//    once for all of the transpositions.  Options for the tool (such as
+//    -s) are applied to each transposition, but the -k, -C, -W and --auto
+//    options are ignored.
+//
+
+bool Tool_transpose::transposeToIntervals(HumdrumFile& infile,
+		const vector<int>& intervals, vector<string>& outputs) {
+	initialize(infile);
+	outputs.clear();
+	outputs.reserve(intervals.size());
+
+	vector<bool> spineprocess;
+	getSpineProcess(infile, spineprocess);
+	parseKernPitches(infile);
+
+	for (int i=0; i<(int)intervals.size(); i++) {
+		m_humdrum_text.str("");
+		m_humdrum_text.clear();
+		transval = intervals[i];
+		processFile(infile, spineprocess);
+		outputs.push_back(m_humdrum_text.str());
+	}
+
+	m_humdrum_text.str("");
+	m_humdrum_text.clear();
+	m_pitchfields.clear();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::transposeToKeys -- Transpose the file to each of the
+//    given tonics (base-40 pitch classes, as with the -k option), storing
+//    the Humdrum text of each transposition in outputs.  The -o option
+//    is added to each transposition.
+//
+
+bool Tool_transpose::transposeToKeys(HumdrumFile& infile,
+		const vector<int>& tonics, vector<string>& outputs) {
+	initialize(infile);
+	vector<int> intervals(tonics.size());
+	for (int i=0; i<(int)tonics.size(); i++) {
+		intervals[i] = calculateTranspositionFromKey(tonics[i] % 40, infile);
+		intervals[i] += octave * 40;
+	}
+	return transposeToIntervals(infile, intervals, outputs);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::getSpineProcess -- Identify the tracks to transpose
+//    (from the -s option).  Only **kern and **mxhm spines are transposed.
+//
+
+void Tool_transpose::getSpineProcess(HumdrumFile& infile,
+		vector<bool>& spineprocess) {
+	infile.makeBooleanTrackList(spineprocess, spinestring);
+	// filter out non-kern spines so they are not analyzed.
+	// but now also allowing for *mxhm spines (musicxml harmony)
+	for (int t=1; t<=infile.getMaxTrack(); t++) {
+		if (!(infile.getTrackStart(t)->isKern() ||
+				infile.getTrackStart(t)->isDataType("mxhm"))) {
+			spineprocess[t] = false;
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_transpose::convertScore -- create a concert pitch score from
@@ -403,7 +480,6 @@ void Tool_transpose::printTransposedToken(HumdrumFile& infile, int row, int col,
 
 int Tool_transpose::calculateTranspositionFromKey(int targetkey,
 		HumdrumFile& infile) {
-	HumRegex hre;
 	int base40 = 0;
 	int currentkey = 0;
 	int mode = 0;
@@ -424,7 +500,7 @@ int Tool_transpose::calculateTranspositionFromKey(int targetkey,
 			if (!infile.token(i, j)->isKern()) {
 				continue;
 			}
-			if (!hre.search(infile.token(i, j), "^\\*([A-G][#-]?):", "i")) {
+			if (!isKeyDesignation(*infile.token(i, j))) {
 				continue;
 			}
 
@@ -658,9 +734,7 @@ int Tool_transpose::checkForDeletedLine(HumdrumFile& infile, int line) {
 void Tool_transpose::processFile(HumdrumFile& infile,
 		vector<bool>& spineprocess) {
 	int i;
-	int diatonic;
 	int j;
-	HumRegex hre;
 	int interpstart = 0;
 
 	for (i=0; i<infile.getLineCount(); i++) {
@@ -687,9 +761,9 @@ void Tool_transpose::processFile(HumdrumFile& infile,
 				// Should also check tandem spines for updating
 				// key signatures in non-kern spines.
 				if (spineprocess[infile.token(i, j)->getTrack()] &&
-						hre.search(infile.token(i, j),
-							"^\\*k\\[([a-gA-G#-]*)\\]", "i")) {
-						string value = hre.getMatch(1);
+						isKeySignature(*infile.token(i, j))) {
+						string value = infile.token(i, j)->substr(3);
+						value.resize(value.find(']'));
 						printNewKeySignature(value, transval);
 						if (j<infile[i].getFieldCount()-1) {
 						m_humdrum_text << "\t";
@@ -702,15 +776,12 @@ void Tool_transpose::processFile(HumdrumFile& infile,
 				// Should also check tandem spines for updating
 				// key designations in non-kern spines.
 				if (spineprocess[infile.token(i, j)->getTrack()] &&
-						hre.search(infile.token(i, j), "^\\*([A-G])[#-]?:", "i")) {
-					diatonic = tolower(hre.getMatch(1)[0]) - 'a';
-					if (diatonic >= 0 && diatonic <= 6) {
-					  	printNewKeyInterpretation(infile[i], j, transval);
-					  	if (j<infile[i].getFieldCount()-1) {
-							m_humdrum_text << "\t";
-					  	}
-					  	continue;
+						isKeyDesignation(*infile.token(i, j))) {
+					printNewKeyInterpretation(infile[i], j, transval);
+					if (j<infile[i].getFieldCount()-1) {
+						m_humdrum_text << "\t";
 					}
+					continue;
 				}
 				m_humdrum_text << infile.token(i, j);
 				if (j<infile[i].getFieldCount()-1) {
@@ -767,14 +838,63 @@ void Tool_transpose::printNewKeyInterpretation(HumdrumLine& aRecord,
 	base40 = base40 % 40;
 	base40 = base40 + (3 + mode) * 40;
 
-	m_humdrum_text << "*" << Convert::base40ToKern(base40) << ":";
+	m_humdrum_text << "*" << getKernPitchName(base40) << ":";
 
-	HumRegex hre;
-	string tvalue = *aRecord.token(index);
-	if (hre.search(tvalue, ":(.+)$", "")) {
-		string value = hre.getMatch(1);
-		m_humdrum_text << value;
+	const string& tvalue = *aRecord.token(index);
+	size_t colon = tvalue.find(':');
+	if (colon != string::npos) {
+		m_humdrum_text << tvalue.substr(colon + 1);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::isKeySignature -- Return true if the token is a key
+//    signature, such as "*k[f#c#]".
+//
+
+bool Tool_transpose::isKeySignature(const string& token) {
+	if ((token.size() < 4) || (token[0] != '*') ||
+			(tolower(token[1]) != 'k') || (token[2] != '[')) {
+		return false;
+	}
+	for (int i=3; i<(int)token.size(); i++) {
+		switch (tolower(token[i])) {
+			case ']':
+				return true;
+			case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+			case '#': case '-':
+				break;
+			default:
+				return false;
+		}
 	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::isKeyDesignation -- Return true if the token is a key
+//    designation, such as "*F#:" or "*e-:dor".
+//
+
+bool Tool_transpose::isKeyDesignation(const string& token) {
+	if ((token.size() < 3) || (token[0] != '*')) {
+		return false;
+	}
+	char diatonic = tolower(token[1]);
+	if ((diatonic < 'a') || (diatonic > 'g')) {
+		return false;
+	}
+	int index = 2;
+	if ((token[index] == '#') || (token[index] == '-')) {
+		index++;
+	}
+	return (index < (int)token.size()) && (token[index] == ':');
 }
 
 
@@ -840,15 +960,230 @@ void Tool_transpose::printHumdrumKernToken(HumdrumLine& record, int index,
 		m_humdrum_text << record.token(index);
 		return;
 	}
-	string buffer;
-	int tokencount = record.token(index)->getSubtokenCount();
-	for (int k=0; k<tokencount; k++) {
-		buffer = record.token(index)->getSubtoken(k);
-		printNewKernString(buffer, transval);
-		if (k<tokencount-1) {
+	int line = record.getLineIndex();
+	if ((line < (int)m_pitchfields.size()) &&
+			(index < (int)m_pitchfields[line].size())) {
+		printParsedKernToken(record.token(index), m_pitchfields[line][index],
+				transval);
+	} else {
+		parseKernToken(record.token(index), m_tempfields);
+		printParsedKernToken(record.token(index), m_tempfields, transval);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::parseKernPitches -- Parse the pitches of all **kern data
+//     tokens in the file, so that they can be transposed several times
+//     without being parsed again (see transposeToIntervals()).
+//
+
+void Tool_transpose::parseKernPitches(HumdrumFile& infile) {
+	m_pitchfields.clear();
+	m_pitchfields.resize(infile.getLineCount());
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (!infile[i].isData()) {
+			continue;
+		}
+		m_pitchfields[i].resize(infile[i].getFieldCount());
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (token->isKern() && !token->isNull()) {
+				parseKernToken(token, m_pitchfields[i][j]);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::parseKernToken -- Identify the pitch in each subtoken
+//     of a **kern token.  Regular pitches (a repeated letter followed
+//     by accidentals) are converted directly into base-40; other pitch
+//     spellings are marked to be processed by printNewKernString().
+//
+
+void Tool_transpose::parseKernToken(HTp token,
+		vector<TransposePitchField>& fields) {
+	fields.clear();
+	const string& text = *token;
+	int size = (int)text.size();
+	int start = 0;
+	while (start <= size) {
+		int end = start;
+		while ((end < size) && (text[end] != ' ')) {
+			end++;
+		}
+		fields.emplace_back();
+		TransposePitchField& field = fields.back();
+		field.m_start = start;
+		field.m_length = end - start;
+		start = end + 1;
+
+		int pstart = -1;
+		int pend = -1;
+		int runs = 0;
+		bool rest = false;
+		bool unpitched = false;
+		for (int i=field.m_start; i<end; i++) {
+			char ch = text[i];
+			if (ch == 'R') {
+				unpitched = true;
+			} else if (ch == 'r') {
+				rest = true;
+			}
+			bool pitchchar = (('a' <= ch) && (ch <= 'g')) ||
+					(('A' <= ch) && (ch <= 'G')) ||
+					(ch == '#') || (ch == '-') || (ch == 'n');
+			if (!pitchchar) {
+				continue;
+			}
+			if (i != pend) {
+				runs++;
+				if (runs == 1) {
+					pstart = i;
+				}
+			}
+			pend = i + 1;
+			if (runs == 1) {
+				field.m_pitchsize = pend - pstart;
+			}
+		}
+
+		if (unpitched) {
+			field.m_type = TRANSPOSE_ECHO;
+			continue;
+		}
+		if ((field.m_length == 1) && (text[field.m_start] == '.')) {
+			field.m_type = TRANSPOSE_ECHO;
+			continue;
+		}
+		if (rest && (runs == 0)) {
+			field.m_type = TRANSPOSE_ECHO;
+			continue;
+		}
+		field.m_type = TRANSPOSE_OTHER;
+		if (runs != 1) {
+			continue;
+		}
+
+		// A single pitch, which must be letters followed by accidentals:
+		char letter = text[pstart];
+		if ((letter == '#') || (letter == '-') || (letter == 'n')) {
+			continue;
+		}
+		int count = 0;
+		int accid = 0;
+		bool valid = true;
+		for (int i=pstart; i<pstart+field.m_pitchsize; i++) {
+			char ch = text[i];
+			if (ch == letter) {
+				if (i > pstart + count) {
+					valid = false;
+					break;
+				}
+				count++;
+			} else if (ch == '#') {
+				accid++;
+			} else if (ch == '-') {
+				accid--;
+			} else if (ch != 'n') {
+				valid = false;
+				break;
+			}
+		}
+		if (!valid || (count == 0)) {
+			continue;
+		}
+		int pc = 0;
+		switch (tolower(letter)) {
+			case 'c': pc =  0; break;
+			case 'd': pc =  6; break;
+			case 'e': pc = 12; break;
+			case 'f': pc = 17; break;
+			case 'g': pc = 23; break;
+			case 'a': pc = 29; break;
+			case 'b': pc = 35; break;
+		}
+		pc += accid + 2;
+		if (pc < 0) {
+			continue;
+		}
+		int octave = islower(letter) ? 3 + count : 4 - count;
+		field.m_pitchstart = pstart;
+		field.m_base40 = pc + 40 * octave;
+		field.m_type = rest ? TRANSPOSE_REST : TRANSPOSE_NOTE;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::printParsedKernToken -- Print a **kern token which
+//     was parsed with parseKernToken(), transposing the pitches by the
+//     given base-40 interval.
+//
+
+void Tool_transpose::printParsedKernToken(HTp token,
+		vector<TransposePitchField>& fields, int transval) {
+	const string& text = *token;
+	for (int k=0; k<(int)fields.size(); k++) {
+		TransposePitchField& field = fields[k];
+		if (k > 0) {
 			m_humdrum_text << " ";
 		}
+		switch (field.m_type) {
+			case TRANSPOSE_ECHO:
+				m_humdrum_text.write(text.data() + field.m_start, field.m_length);
+				break;
+			case TRANSPOSE_OTHER:
+				printNewKernString(text.substr(field.m_start, field.m_length), transval);
+				break;
+			default:
+				{
+					const string& pitch = getKernPitchName(field.m_base40 + transval);
+					int pitchsize = (int)pitch.size();
+					if (field.m_type == TRANSPOSE_REST) {
+						// rests only indicate vertical position, so no accidentals
+						pitchsize = (int)pitch.find_first_of("#-");
+						if (pitchsize < 0) {
+							pitchsize = (int)pitch.size();
+						}
+					}
+					int end = field.m_start + field.m_length;
+					int pend = field.m_pitchstart + field.m_pitchsize;
+					m_humdrum_text.write(text.data() + field.m_start,
+							field.m_pitchstart - field.m_start);
+					m_humdrum_text.write(pitch.data(), pitchsize);
+					m_humdrum_text.write(text.data() + pend, end - pend);
+				}
+				break;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_transpose::getKernPitchName -- Return the **kern pitch name for
+//     a base-40 pitch.  Pitch names within the normal range of octaves
+//     are taken from the lookup table in Convert.
+//
+
+const string& Tool_transpose::getKernPitchName(int base40) {
+	const vector<string>& table = Convert::getBase40KernTable();
+	static thread_local string other;
+	if ((base40 >= 0) && (base40 < (int)table.size())) {
+		return table[base40];
 	}
+	other = Convert::base40ToKern(base40);
+	return other;
 }
 
 
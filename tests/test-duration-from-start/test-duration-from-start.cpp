@@ -0,0 +1,70 @@
+// Description: Check the durationFromStart of each line in a file.  Each
+// line must start when the previous line ends, and each non-null **kern
+// data token must end where the next non-null data token in its spine
+// starts (following the left side of spine splits).
+// Files to try: tests/files/test-spine-float.krn (floating spine added
+// with *+) and tests/files/test-manipulators.krn (*^, *v and *x).
+
+#include "humlib.h"
+
+using namespace hum;
+
+int main(int argc, char** argv) {
+   if (argc != 2) {
+      return 1;
+   }
+   HumdrumFile infile;
+   if (!infile.read(argv[1])) {
+      return 1;
+   }
+   int errors = 0;
+   for (int i=0; i<infile.getLineCount(); i++) {
+      HumNum start = infile[i].getDurationFromStart();
+      cout << start << "\t" << infile[i].getDuration() << "\t::\t" << infile[i] << endl;
+      if ((i == 0) && (start != 0)) {
+         cerr << "ERROR: first line does not start at 0" << endl;
+         errors++;
+      }
+      if ((i > 0) && (start != infile[i-1].getDurationFromStart()
+            + infile[i-1].getDuration())) {
+         cerr << "ERROR: line " << i+1
+              << " does not start at the end of the previous line" << endl;
+         errors++;
+      }
+      if (!infile[i].isData()) {
+         continue;
+      }
+      for (int j=0; j<infile[i].getTokenCount(); j++) {
+         HTp token = infile.token(i, j);
+         if (!token->isKern() || token->isNull() || (token->getDuration() < 0)) {
+            continue;
+         }
+         HumNum end = start + token->getDuration();
+         // Follow the spine (and the left side of any split) to the next
+         // non-null data token:
+         HTp next = token->getNextToken();
+         while (next && !next->isTerminator()) {
+            if (next->isData() && !next->isNull() && !next->empty()) {
+               break;
+            }
+            next = next->getNextToken();
+         }
+         if (!next || next->isTerminator()) {
+            continue;
+         }
+         if (next->getDurationFromStart() != end) {
+            cerr << "ERROR: " << *next << " on line " << next->getLineNumber()
+                 << " starts at " << next->getDurationFromStart()
+                 << " rather than at " << end << endl;
+            errors++;
+         }
+      }
+   }
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
+
+
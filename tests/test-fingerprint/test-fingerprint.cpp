@@ -0,0 +1,72 @@
+// Description: Check that fingerprint clusters a melody (#1) with an exact
+// copy (#2) and a transposed copy (#3), but not with an unrelated melody
+// (#4).  Also check that a band count which does not divide the hash
+// count is rejected.
+
+#include "humlib.h"
+
+using namespace hum;
+
+string melody =
+   "**kern\n*M4/4\n=1\n4c\n8d\n8e\n4f\n4g\n=2\n4a\n8g\n8f\n4e\n4d\n"
+   "=3\n2c\n4e\n4g\n=4\n4cc\n8b\n8a\n4g\n4f\n=5\n4e\n4d\n2c\n==\n*-\n";
+
+string transposed =
+   "**kern\n*M4/4\n=1\n4d\n8e\n8f#\n4g\n4a\n=2\n4b\n8a\n8g\n4f#\n4e\n"
+   "=3\n2d\n4f#\n4a\n=4\n4dd\n8cc#\n8b\n4a\n4g\n=5\n4f#\n4e\n2d\n==\n*-\n";
+
+string unrelated =
+   "**kern\n*M3/4\n=1\n2.G\n=2\n4B\n4D\n4F#\n=3\n8A\n8c\n8e\n8c\n4A\n"
+   "=4\n4G\n2B\n=5\n8d\n8B\n8G\n8B\n4d\n=6\n2.G\n==\n*-\n";
+
+int main(int argc, char** argv) {
+   int errors = 0;
+   HumdrumFileSet infiles;
+   infiles.readString(melody + melody + transposed + unrelated);
+
+   Tool_fingerprint fingerprint;
+   fingerprint.process("fingerprint");
+   fingerprint.run(infiles);
+   string output = fingerprint.getFreeText();
+   cout << output;
+
+   map<string, string> cluster;
+   stringstream text(output);
+   string line;
+   while (getline(text, line)) {
+      if (line.empty() || (line[0] == '!') || (line[0] == '*')) {
+         continue;
+      }
+      stringstream fields(line);
+      string number;
+      string similarity;
+      string name;
+      fields >> number >> similarity >> name;
+      cluster[name] = number;
+   }
+   if (cluster["#1"].empty() || (cluster["#1"] != cluster["#2"])) {
+      cerr << "ERROR: exact copy is not in the cluster of the melody" << endl;
+      errors++;
+   }
+   if (cluster["#1"].empty() || (cluster["#1"] != cluster["#3"])) {
+      cerr << "ERROR: transposed copy is not in the cluster of the melody" << endl;
+      errors++;
+   }
+   if (!cluster["#4"].empty()) {
+      cerr << "ERROR: unrelated melody is in a cluster" << endl;
+      errors++;
+   }
+
+   Tool_fingerprint badbands;
+   badbands.process("fingerprint -k 64 -b 10");
+   if (badbands.run(infiles) || !badbands.hasError()) {
+      cerr << "ERROR: 10 bands for 64 hashes is not rejected" << endl;
+      errors++;
+   }
+
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,92 @@
+// Description: Check that hum2musicxml pairs slur starts and stops in
+// each voice when slurs in two voices cross the same barline.  Each
+// slur must stop with the number that it started with, and slurs that
+// are open at the same time must have different numbers.
+
+#include "humlib.h"
+
+using namespace hum;
+
+string input =
+   "**kern\n"
+   "*M4/4\n"
+   "*^\t\n"
+   "2e\t2c\n"
+   "2f(\t2d(\n"
+   "=1\t=1\n"
+   "2g)\t2e\n"
+   "2a\t2f)\n"
+   "=2\t=2\n"
+   "*v\t*v\n"
+   "*-\n";
+
+int main(int argc, char** argv) {
+   Tool_hum2musicxml tool;
+   HumdrumFile infile;
+   infile.readString(input);
+   stringstream output;
+   if (!tool.convert(output, infile)) {
+      cerr << "ERROR: conversion failed: " << tool.getError() << endl;
+      return 1;
+   }
+   string xml = output.str();
+
+   // Collect the slurs of each note in order: voice, type and number.
+   vector<int> voices;
+   vector<string> types;
+   vector<string> numbers;
+   regex voicere("<voice>(\\d+)</voice>");
+   regex slurre("<slur type=\"(\\w+)\" number=\"(\\d+)\"/>");
+   size_t position = 0;
+   while ((position = xml.find("<note", position)) != string::npos) {
+      size_t end = xml.find("</note>", position);
+      string note = xml.substr(position, end - position);
+      position = end;
+      std::smatch match;
+      if (!regex_search(note, match, voicere)) {
+         continue;
+      }
+      int voice = std::stoi(match[1]);
+      auto it = std::sregex_iterator(note.begin(), note.end(), slurre);
+      for ( ; it != std::sregex_iterator(); ++it) {
+         voices.push_back(voice);
+         types.push_back((*it)[1]);
+         numbers.push_back((*it)[2]);
+         cout << "voice " << voice << ": slur " << (*it)[1]
+              << " " << (*it)[2] << endl;
+      }
+   }
+
+   int errors = 0;
+   map<int, string> open;
+   set<string> used;
+   for (int i=0; i<(int)voices.size(); i++) {
+      if (types[i] == "start") {
+         if (used.count(numbers[i])) {
+            cerr << "ERROR: slur number " << numbers[i]
+                 << " is already in use" << endl;
+            errors++;
+         }
+         open[voices[i]] = numbers[i];
+         used.insert(numbers[i]);
+      } else {
+         if (open[voices[i]] != numbers[i]) {
+            cerr << "ERROR: slur in voice " << voices[i] << " stops with number "
+                 << numbers[i] << " rather than " << open[voices[i]] << endl;
+            errors++;
+         }
+         used.erase(open[voices[i]]);
+         open.erase(voices[i]);
+      }
+   }
+   if (voices.size() != 4) {
+      cerr << "ERROR: expected 4 slur elements rather than " << voices.size() << endl;
+      errors++;
+   }
+
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,78 @@
+// Description: Check the links between tokens and the spine info of each
+// token in a file, such as tests/files/test-manipulators.krn.  Each link
+// to a next token must have a matching link back from that token, and the
+// spine info of the tokens after a split must be that of the split spine
+// followed by "a" and "b".  Spine info is printed for each token.
+
+#include "humlib.h"
+
+using namespace hum;
+
+int main(int argc, char** argv) {
+   if (argc != 2) {
+      return 1;
+   }
+   HumdrumFile infile;
+   if (!infile.read(argv[1])) {
+      return 1;
+   }
+   int errors = 0;
+   for (int i=0; i<infile.getLineCount(); i++) {
+      if (!infile[i].hasSpines()) {
+         cout << infile[i] << endl;
+         continue;
+      }
+      for (int j=0; j<infile[i].getTokenCount(); j++) {
+         HTp token = infile.token(i, j);
+         cout << token->getSpineInfo() << "\t";
+         vector<HTp> next = token->getNextTokens();
+         if ((int)next.size() != token->getNextTokenCount()) {
+            cerr << "ERROR: next token count of " << *token << " on line "
+                 << token->getLineNumber() << " is wrong" << endl;
+            errors++;
+         }
+         for (int k=0; k<(int)next.size(); k++) {
+            vector<HTp> previous = next[k]->getPreviousTokens();
+            if (std::find(previous.begin(), previous.end(), token) == previous.end()) {
+               cerr << "ERROR: " << *next[k] << " on line " << next[k]->getLineNumber()
+                    << " is not linked back to " << *token << " on line "
+                    << token->getLineNumber() << endl;
+               errors++;
+            }
+         }
+         vector<HTp> previous = token->getPreviousTokens();
+         for (int k=0; k<(int)previous.size(); k++) {
+            vector<HTp> following = previous[k]->getNextTokens();
+            if (std::find(following.begin(), following.end(), token) == following.end()) {
+               cerr << "ERROR: " << *previous[k] << " on line " << previous[k]->getLineNumber()
+                    << " is not linked forward to " << *token << " on line "
+                    << token->getLineNumber() << endl;
+               errors++;
+            }
+         }
+         if (token->isTerminator() && !next.empty()) {
+            cerr << "ERROR: terminator on line " << token->getLineNumber()
+                 << " has next tokens" << endl;
+            errors++;
+         }
+         if (token->isSplitInterpretation()) {
+            string info = token->getSpineInfo();
+            if ((next.size() != 2) ||
+                  (next[0]->getSpineInfo() != "(" + info + ")a") ||
+                  (next[1]->getSpineInfo() != "(" + info + ")b")) {
+               cerr << "ERROR: bad split of " << info << " on line "
+                    << token->getLineNumber() << endl;
+               errors++;
+            }
+         }
+      }
+      cout << "::\t" << infile[i] << endl;
+   }
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
+
+
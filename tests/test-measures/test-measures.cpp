@@ -0,0 +1,108 @@
+// Description: Check HumdrumFileStructure::getMeasure() and
+// getMeasureIndex() for a file with a pickup measure, repeat and
+// unnumbered barlines, and for indexes outside of the file.
+
+#include "humlib.h"
+
+using namespace hum;
+
+// line  0: **kern        (pickup measure 0 starts at the first line)
+// line  3: =1            measure 1
+// line  5: =2:|!|:       measure 2
+// line  7: =             measure 3 (unnumbered)
+// line  9: =3            measure 4
+// line 11: ==            measure 5 (final barline)
+string pickup =
+   "**kern\n"
+   "*M3/4\n"
+   "4c\n"
+   "=1\n"
+   "2.d\n"
+   "=2:|!|:\n"
+   "2.e\n"
+   "=\n"
+   "2.f\n"
+   "=3\n"
+   "2.g\n"
+   "==\n"
+   "*-\n";
+
+string nopickup =
+   "**kern\n"
+   "*M3/4\n"
+   "=1\n"
+   "2.c\n"
+   "==\n"
+   "*-\n";
+
+int errors = 0;
+
+void check(const string& test, int value, int expected) {
+   if (value != expected) {
+      cerr << "ERROR: " << test << " is " << value << " rather than "
+           << expected << endl;
+      errors++;
+   }
+}
+
+int main(int argc, char** argv) {
+   HumdrumFile infile;
+   infile.readString(pickup);
+
+   vector<HumMeasureInfo> measures = infile.getMeasures();
+   for (int i=0; i<(int)measures.size(); i++) {
+      HumMeasureInfo& m = measures[i];
+      cout << "measure " << m.m_index << ": lines " << m.m_startline << "-"
+           << m.m_endline << " number " << m.m_number << " start "
+           << m.m_durationFromStart << " duration " << m.m_duration
+           << (m.m_repeatstart ? " repeat-start" : "")
+           << (m.m_repeatend ? " repeat-end" : "") << endl;
+   }
+   check("measure count", (int)measures.size(), 6);
+   if (measures.size() == 6) {
+      check("pickup start line", measures[0].m_startline, 0);
+      check("pickup end line", measures[0].m_endline, 2);
+      check("pickup number", measures[0].m_number, -1);
+      check("pickup barline", measures[0].m_barline != NULL, 0);
+      check("pickup duration", measures[0].m_duration == 1, 1);
+      check("measure 1 number", measures[1].m_number, 1);
+      check("measure 1 repeat end", measures[1].m_repeatend, 1);
+      check("measure 2 number", measures[2].m_number, 2);
+      check("measure 2 repeat start", measures[2].m_repeatstart, 1);
+      check("unnumbered measure number", measures[3].m_number, -1);
+      check("unnumbered measure start", measures[3].m_durationFromStart == 7, 1);
+      check("measure 4 number", measures[4].m_number, 3);
+      check("final measure end line", measures[5].m_endline, 12);
+      check("final measure duration", measures[5].m_duration == 0, 1);
+   }
+
+   // measure index of each line:
+   vector<int> expected = {0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5};
+   check("line count", infile.getLineCount(), (int)expected.size());
+   for (int i=0; i<(int)expected.size(); i++) {
+      check("measure index of line " + to_string(i),
+            infile.getMeasureIndex(i), expected[i]);
+   }
+
+   // out-of-range requests:
+   check("measure index of line -1", infile.getMeasureIndex(-1), -1);
+   check("measure index of line 13", infile.getMeasureIndex(13), -1);
+   check("measure 6", infile.getMeasure(6).m_index, -1);
+   check("measure -1", infile.getMeasure(-1).m_index, 5);
+   check("measure -7", infile.getMeasure(-7).m_index, -1);
+
+   // without a pickup, lines before the first barline are not in a measure:
+   HumdrumFile infile2;
+   infile2.readString(nopickup);
+   check("measure index of exclusive interpretation",
+         infile2.getMeasureIndex(0), -1);
+   check("measure index of time signature", infile2.getMeasureIndex(1), -1);
+   check("measure index of first barline", infile2.getMeasureIndex(2), 0);
+   check("first measure number", infile2.getMeasure(0).m_number, 1);
+
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
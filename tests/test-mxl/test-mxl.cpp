@@ -0,0 +1,230 @@
+// Description: Check reading compressed MusicXML (.mxl) archives with
+// MxmlArchive: deflated and stored entries, a truncated archive, a
+// checksum mismatch and an entry which inflates to more than its declared
+// size.  A deflated archive must also convert in the same way as the
+// uncompressed MusicXML.
+
+#include "humlib.h"
+
+using namespace hum;
+
+string xml =
+   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<score-partwise version=\"3.1\">"
+   "<part-list><score-part id=\"P1\"><part-name>Melody</part-name>"
+   "</score-part></part-list><part id=\"P1\"><measure number=\"1\"><attributes>"
+   "<divisions>1</divisions><time><beats>4</beats><beat-type>4</beat-type>"
+   "</time><clef><sign>G</sign><line>2</line></clef></attributes>"
+   "<note><pitch><step>C</step><octave>4</octave></pitch><duration>"
+   "1</duration><type>quarter</type></note><note><pitch><step>D</step>"
+   "<octave>4</octave></pitch><duration>1</duration><type>quarter</type>"
+   "</note><note><pitch><step>E</step><octave>4</octave></pitch>"
+   "<duration>1</duration><type>quarter</type></note><note><pitch>"
+   "<step>F</step><octave>4</octave></pitch><duration>1</duration>"
+   "<type>quarter</type></note></measure><measure number=\"2\"><note>"
+   "<pitch><step>G</step><octave>4</octave></pitch><duration>1</duration>"
+   "<type>quarter</type></note><note><pitch><step>F</step><octave>"
+   "4</octave></pitch><duration>1</duration><type>quarter</type>"
+   "</note><note><pitch><step>E</step><octave>4</octave></pitch>"
+   "<duration>1</duration><type>quarter</type></note><note><pitch>"
+   "<step>D</step><octave>4</octave></pitch><duration>1</duration>"
+   "<type>quarter</type></note></measure></part></score-partwise>"
+   "\n";
+
+// xml compressed as raw deflate data (with dynamic Huffman codes):
+string deflatedhex =
+   "d554bd52c3300cdefb1439efa949616050d581d24edc31c003388928be4bec60"
+   "2b81be3d4e9c92f6cada724cfad7f7c9d219565f759574e4bcb66629b2f98d48"
+   "c814b6d466b714af2f9bf45eac7006beb08ed24639fed49ea682db7926107a7f"
+   "5a69cf789498e872299e7fc246d5844f54d9720f72f2809c2a700cc44ea73d6a"
+   "52be759498b6cec905a6c1a7989dce5b268f50ea4ef7943c6620270358f72039"
+   "29f67807322a839df2bea1832f1a20637a51d15b1845ef0c6e03c15e42a50de1"
+   "02e42041c614794cc1580e914673f11e8a991a7c08c5bd045bb0ea06b0510b93"
+   "c6bcb2758a03d581f6418781cd471b5e805c2015b9c5fee728ebaba03c5e0565"
+   "73011439decef9112dc46f1cb6ff76d2bfdadafaa25b93e3df70fa07e1ec1b";
+
+string container =
+   "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+   "<container><rootfiles><rootfile full-path=\"score.xml\"/>"
+   "</rootfiles></container>\n";
+
+struct Entry {
+   string name;
+   int method;        // 0 = stored, 8 = deflated
+   string data;       // contents in the archive
+   uint32_t crc;      // CRC-32 of the uncompressed contents
+   uint32_t size;     // declared uncompressed size
+};
+
+uint32_t crc32(const string& data) {
+   uint32_t crc = 0xffffffff;
+   for (int i=0; i<(int)data.size(); i++) {
+      crc ^= (unsigned char)data[i];
+      for (int j=0; j<8; j++) {
+         crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+      }
+   }
+   return ~crc;
+}
+
+void addUint16(string& out, uint32_t value) {
+   out += (char)(value & 0xff);
+   out += (char)((value >> 8) & 0xff);
+}
+
+void addUint32(string& out, uint32_t value) {
+   addUint16(out, value & 0xffff);
+   addUint16(out, value >> 16);
+}
+
+Entry makeEntry(const string& name, const string& contents, bool deflate) {
+   Entry entry;
+   entry.name = name;
+   entry.method = deflate ? 8 : 0;
+   entry.crc = crc32(contents);
+   entry.size = (uint32_t)contents.size();
+   if (!deflate) {
+      entry.data = contents;
+      return entry;
+   }
+   for (int i=0; i<(int)deflatedhex.size(); i+=2) {
+      entry.data += (char)stoi(deflatedhex.substr(i, 2), NULL, 16);
+   }
+   return entry;
+}
+
+string makeArchive(vector<Entry>& entries) {
+   string output;
+   string directory;
+   for (int i=0; i<(int)entries.size(); i++) {
+      Entry& entry = entries[i];
+      uint32_t offset = (uint32_t)output.size();
+      addUint32(output, 0x04034b50);
+      addUint16(output, 20);
+      addUint16(output, 0);
+      addUint16(output, entry.method);
+      addUint32(output, 0);
+      addUint32(output, entry.crc);
+      addUint32(output, (uint32_t)entry.data.size());
+      addUint32(output, entry.size);
+      addUint16(output, (uint32_t)entry.name.size());
+      addUint16(output, 0);
+      output += entry.name + entry.data;
+
+      addUint32(directory, 0x02014b50);
+      addUint16(directory, 20);
+      addUint16(directory, 20);
+      addUint16(directory, 0);
+      addUint16(directory, entry.method);
+      addUint32(directory, 0);
+      addUint32(directory, entry.crc);
+      addUint32(directory, (uint32_t)entry.data.size());
+      addUint32(directory, entry.size);
+      addUint16(directory, (uint32_t)entry.name.size());
+      addUint32(directory, 0);
+      addUint32(directory, 0);
+      addUint32(directory, 0);
+      addUint32(directory, offset);
+      directory += entry.name;
+   }
+   uint32_t diroffset = (uint32_t)output.size();
+   output += directory;
+   addUint32(output, 0x06054b50);
+   addUint32(output, 0);
+   addUint16(output, (uint32_t)entries.size());
+   addUint16(output, (uint32_t)entries.size());
+   addUint32(output, (uint32_t)directory.size());
+   addUint32(output, diroffset);
+   addUint16(output, 0);
+   return output;
+}
+
+// Returns the error message of reading score.xml, or "" if it was read
+// and matches xml.
+string readScore(const string& archive) {
+   MxmlArchive reader;
+   if (!reader.readBuffer(archive.data(), archive.size())) {
+      return reader.getError();
+   }
+   vector<char> data;
+   if (!reader.getRootFile(data)) {
+      return reader.getError();
+   }
+   if (string(data.begin(), data.end()) != xml) {
+      return "contents do not match";
+   }
+   return "";
+}
+
+int check(const string& test, const string& result, const string& expected) {
+   cout << test << ": " << (result.empty() ? "ok" : result) << endl;
+   if (result != expected) {
+      cerr << "ERROR: " << test << " gives \"" << result
+           << "\" rather than \"" << expected << "\"" << endl;
+      return 1;
+   }
+   return 0;
+}
+
+int main(int argc, char** argv) {
+   int errors = 0;
+
+   vector<Entry> entries;
+   entries.push_back(makeEntry("META-INF/container.xml", container, false));
+   entries.push_back(makeEntry("score.xml", xml, true));
+   string deflated = makeArchive(entries);
+   errors += check("deflated", readScore(deflated), "");
+
+   entries[1] = makeEntry("score.xml", xml, false);
+   string stored = makeArchive(entries);
+   errors += check("stored", readScore(stored), "");
+
+   errors += check("truncated directory",
+         readScore(deflated.substr(0, deflated.size() - 30)),
+         "Cannot find ZIP central directory");
+   entries[1] = makeEntry("score.xml", xml, true);
+   entries[1].data.resize(entries[1].data.size() / 2);
+   string archive = makeArchive(entries);
+   errors += check("truncated data", readScore(archive),
+         "Cannot decompress score.xml");
+
+   // Compressed size in the central directory running past the end of
+   // the archive:
+   archive = deflated;
+   size_t header = archive.rfind("PK\x01\x02");
+   archive[header + 21] = (char)0x7f;
+   errors += check("truncated entry", readScore(archive),
+         "Truncated data for score.xml");
+
+   entries[1] = makeEntry("score.xml", xml, true);
+   entries[1].crc ^= 1;
+   archive = makeArchive(entries);
+   errors += check("checksum", readScore(archive),
+         "Checksum error for score.xml");
+
+   // The inflated data must stop at the declared size rather than
+   // being decompressed completely and then rejected.
+   entries[1] = makeEntry("score.xml", xml, true);
+   entries[1].size = 100;
+   archive = makeArchive(entries);
+   errors += check("declared size", readScore(archive),
+         "Cannot decompress score.xml");
+
+   Tool_musicxml2hum converter;
+   stringstream xmlinput(xml);
+   stringstream xmloutput;
+   converter.convert(xmloutput, xmlinput);
+   stringstream mxlinput(deflated);
+   stringstream mxloutput;
+   converter.convert(mxloutput, mxlinput);
+   cout << mxloutput.str();
+   if (xmloutput.str().empty() || (mxloutput.str() != xmloutput.str())) {
+      cerr << "ERROR: .mxl conversion differs from MusicXML conversion" << endl;
+      errors++;
+   }
+
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,92 @@
+// Description: Check the ranking of simat corpus mode (-c, -p and -n) on
+// a small corpus: a melody (#1), an exact copy of it (#2), an unrelated
+// melody (#3) and a file with only rests (#4), which has a flat sketch.
+
+#include "humlib.h"
+
+using namespace hum;
+
+string melody1 =
+   "**kern\n*M4/4\n=1\n4c\n4e\n4g\n4cc\n=2\n4b\n4g\n4d\n4f\n"
+   "=3\n4e\n4c\n4g\n4e\n=4\n1c\n==\n*-\n";
+
+string melody2 =
+   "**kern\n*M4/4\n=1\n4f#\n4a#\n4c#\n4f#\n=2\n4g#\n4d#\n4a#\n4f#\n"
+   "=3\n4c#\n4f#\n4g#\n4d#\n=4\n1f#\n==\n*-\n";
+
+string rests =
+   "**kern\n*M4/4\n=1\n1r\n=2\n1r\n=3\n1r\n=4\n1r\n==\n*-\n";
+
+vector<vector<string>> runSimat(const string& options) {
+   HumdrumFileSet infiles;
+   infiles.readString(melody1 + melody1 + melody2 + rests);
+   Tool_simat simat;
+   simat.process("simat " + options);
+   simat.run(infiles);
+   cout << "simat " << options << ":" << endl;
+   vector<vector<string>> rows;
+   stringstream text(simat.getFreeText());
+   string line;
+   while (getline(text, line)) {
+      cout << line << endl;
+      if (line.empty() || (line[0] == '!') || (line[0] == '*')) {
+         continue;
+      }
+      rows.emplace_back();
+      stringstream fields(line);
+      string field;
+      while (getline(fields, field, '\t')) {
+         rows.back().push_back(field);
+      }
+   }
+   return rows;
+}
+
+int main(int argc, char** argv) {
+   int errors = 0;
+
+   vector<vector<string>> rows = runSimat("-c");
+   if (rows.empty() || (rows[0][0] != "1") || (rows[0][2] != "#1")
+         || (rows[0][3] != "#2")) {
+      cerr << "ERROR: the copies are not ranked first with a score of 1" << endl;
+      errors++;
+   }
+   int flatcount = 0;
+   for (int i=0; i<(int)rows.size(); i++) {
+      bool flat = (rows[i][2] == "#4") || (rows[i][3] == "#4");
+      if (flat) {
+         flatcount++;
+      }
+      if (flat != (rows[i][1] == ".")) {
+         cerr << "ERROR: wrong sketch score for " << rows[i][2] << " and "
+              << rows[i][3] << endl;
+         errors++;
+      }
+      if ((rows[i][2] != "#4") && (rows[i][3] == "#3")) {
+         cerr << "ERROR: unrelated melody was not pruned" << endl;
+         errors++;
+      }
+   }
+   if (flatcount != 3) {
+      cerr << "ERROR: pairs with a flat sketch were pruned" << endl;
+      errors++;
+   }
+
+   rows = runSimat("-c -p -1");
+   if (rows.size() != 6) {
+      cerr << "ERROR: -p -1 does not compare all pairs" << endl;
+      errors++;
+   }
+
+   rows = runSimat("-c -n 1");
+   if (rows.size() != 1) {
+      cerr << "ERROR: -n 1 does not limit the output to one pair" << endl;
+      errors++;
+   }
+
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,147 @@
+// Description: Insert and delete lines in a file and check after each
+// change that the timeline index, which is updated in place, matches a
+// timeline built from scratch for the same lines.
+
+#include "humlib.h"
+
+#include <random>
+
+using namespace hum;
+
+string input =
+   "!!!COM: Test\n"
+   "**kern\t**kern\n"
+   "*M3/4\t*M3/4\n"
+   "=1\t=1\n"
+   "4c\t6e\n"
+   ".\t6f\n"
+   "4d\t.\n"
+   ".\t6g\n"
+   "4e\t4a\n"
+   "=2\t=2\n"
+   "!! comment\n"
+   "8f\t2.b\n"
+   "8g\t.\n"
+   "2a\t.\n"
+   "=3\t=3\n"
+   "*^\t*\n"
+   "4b\t4cc\t4dd\n"
+   "12a\t4cc\t4dd\n"
+   "12g\t.\t.\n"
+   "12f\t.\t.\n"
+   "4e\t4cc\t4dd\n"
+   "*v\t*v\t*\n"
+   "==\t==\n"
+   "*-\t*-\n"
+   "!!!END: test\n";
+
+// Test class which can build a new timeline without changing the
+// timeline of the file.
+class TestFile : public HumdrumFile {
+   public:
+      vector<HumTimelineEntry> getNewTimeline(void) {
+         vector<HumTimelineEntry> saved = m_timeline;
+         int64_t savedtpq = m_timelinetpq;
+         clearTimeIndexes();
+         vector<HumTimelineEntry> output = getTimeline();
+         m_timeline = saved;
+         m_timelinetpq = savedtpq;
+         return output;
+      }
+};
+
+string printTime(HumNum timestamp) {
+   stringstream output;
+   output << timestamp;
+   return output.str();
+}
+
+string printEntry(const HumTimelineEntry& entry) {
+   stringstream output;
+   output << entry.m_timestamp << " lines " << entry.m_firstline << "-"
+          << entry.m_lastline << " data " << entry.m_firstdata << "/"
+          << entry.m_lastdata << " measure " << entry.m_measure;
+   return output.str();
+}
+
+bool compareTimelines(const vector<HumTimelineEntry>& timeline,
+      const vector<HumTimelineEntry>& expected) {
+   if (timeline.size() != expected.size()) {
+      cerr << "ERROR: timeline has " << timeline.size()
+           << " entries rather than " << expected.size() << endl;
+      return false;
+   }
+   for (int i=0; i<(int)timeline.size(); i++) {
+      if ((timeline[i].m_timestamp != expected[i].m_timestamp) ||
+            (timeline[i].m_firstline != expected[i].m_firstline) ||
+            (timeline[i].m_lastline != expected[i].m_lastline) ||
+            (timeline[i].m_firstdata != expected[i].m_firstdata) ||
+            (timeline[i].m_lastdata != expected[i].m_lastdata) ||
+            (timeline[i].m_measure != expected[i].m_measure)) {
+         cerr << "ERROR: timeline entry " << i << " is "
+              << printEntry(timeline[i]) << " rather than "
+              << printEntry(expected[i]) << endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+int main(int argc, char** argv) {
+   TestFile infile;
+   infile.readString(input);
+   HumNum duration = infile.getScoreDuration();
+   int errors = 0;
+   int inserted = 0;
+   int deleted = 0;
+
+   std::mt19937 random(1);
+   for (int i=0; i<300; i++) {
+      // The timeline is built before each change, so that the change
+      // updates it in place.
+      infile.getTimeline();
+      string change;
+      int choice = random() % 4;
+      if (choice == 0) {
+         // timestamps at twelfths of a quarter note (some are not on a
+         // tick of the current timeline):
+         HumNum timestamp((int)(random() % (duration.getNumerator() * 12 + 1)), 12);
+         change = "insert data line at " + printTime(timestamp);
+         infile.insertNullDataLine(timestamp);
+         inserted++;
+      } else if (choice == 1) {
+         HumNum timestamp((int)(random() % (duration.getNumerator() * 4 + 1)), 4);
+         change = "insert interpretation line at " + printTime(timestamp);
+         infile.insertNullInterpretationLine(timestamp);
+         inserted++;
+      } else if (choice == 2) {
+         // lines inserted as text have no timestamp:
+         int index = 1 + random() % (infile.getLineCount() - 2);
+         change = "insert global comment at line " + to_string(index);
+         infile.insertLine(index, "!! inserted comment");
+         inserted++;
+      } else {
+         int index = random() % infile.getLineCount();
+         HumdrumLine& line = infile[index];
+         if (!(line.isGlobalComment() || (line.isData() && line.isAllNull()))) {
+            continue;
+         }
+         change = "delete line " + to_string(index);
+         infile.deleteLine(index);
+         deleted++;
+      }
+      if (!compareTimelines(infile.getTimeline(), infile.getNewTimeline())) {
+         cerr << "ERROR: after change " << i << ": " << change << endl;
+         errors++;
+         break;
+      }
+   }
+   cout << "Inserted " << inserted << " and deleted " << deleted
+        << " lines" << endl;
+
+   if (errors) {
+      cerr << errors << " ERRORS" << endl;
+      return 1;
+   }
+   return 0;
+}